@@ -0,0 +1,223 @@
+#include "analytics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+using namespace th_recording;
+
+int run_aggregate::marginBin(float risk)
+{
+	if (risk < 0 || std::isnan(risk))
+		return 0;
+	if (risk < 1)
+		return 1;
+	int e;
+	frexp(risk, &e);
+	// risk within [2^(e-1), 2^e)
+	return std::min(1 + e, MARGIN_BINS - 1);
+}
+
+void run_aggregate::addChunk(uint32_t run, const std::string& game, const uint8_t* chunk)
+{
+	chunk_header h;
+	memcpy(&h, chunk, sizeof(h));
+	const frame_record* f = reinterpret_cast<const frame_record*>(chunk + sizeof(h));
+	const uint8_t* end = chunk + sizeof(h) + h.bytes;
+
+	heatmap* map = nullptr;
+	uint32_t mapStage = 0;
+	for (uint32_t i = 0; i < h.frames; ++i)
+	{
+		// stop at frames which claim more objects than the chunk holds
+		if (reinterpret_cast<const uint8_t*>(f + 1) > end
+			|| reinterpret_cast<const uint8_t*>(f->next()) > end)
+			break;
+
+		if (!map || f->stage != mapStage)
+		{
+			mapStage = f->stage;
+			map = &heatmaps[std::make_pair(game, mapStage)];
+		}
+		addFrame(run, *map, *f);
+		f = f->next();
+	}
+}
+
+void run_aggregate::addFrame(uint32_t run, heatmap& map, const frame_record& f)
+{
+	++frames;
+	++map.frames;
+	bullets += f.bullets;
+
+	const object_record& p = f.player;
+	const float playerRadius = std::min(p.w, p.h) / 2;
+	const object_record* objs = f.objects();
+	for (uint32_t i = 0; i < f.bullets; ++i)
+	{
+		const object_record& b = objs[i];
+
+		const int cx = (int)(b.x / HEATMAP_CELL);
+		const int cy = (int)(b.y / HEATMAP_CELL);
+		if (b.x >= 0 && b.y >= 0 && cx < HEATMAP_WIDTH && cy < HEATMAP_HEIGHT)
+			++map.cells[cy * HEATMAP_WIDTH + cx];
+
+		// Each pass of a bullet is counted once, on the step containing its
+		// closest approach to the player under the recorded velocities
+		const float dx = b.x - p.x, dy = b.y - p.y;
+		const float vx = b.vx - p.vx, vy = b.vy - p.vy;
+		const float vv = vx * vx + vy * vy;
+		if (vv == 0)
+			continue;
+		const float tc = -(dx * vx + dy * vy) / vv;
+		if (tc < 0 || tc >= 1)
+			continue;
+
+		const float qx = dx + vx * tc, qy = dy + vy * tc;
+		const float gap = sqrt(qx * qx + qy * qy) - std::min(b.w, b.h) / 2 - playerRadius;
+		if (gap >= GRAZE_DISTANCE)
+			continue;
+
+		graze_histogram& g = grazes[b.meta];
+		if (gap < 0)
+		{
+			++g.hits;
+			continue;
+		}
+		++g.grazes;
+		++g.bins[std::min((int)(gap * GRAZE_BINS / GRAZE_DISTANCE), GRAZE_BINS - 1)];
+	}
+
+	if (f.flags & Observed)
+		return;
+	++margins[marginBin(f.risk)];
+	if ((f.flags & Bomb) && f.risk < DEATHBOMB_RISK)
+		deathbombs.push_back({ run, f.gameTick, f.stage, p.x, p.y, f.risk });
+
+	// as while playing, bombed worlds make no route, see th_algorithm::onTick
+	if (collectRoutes && f.move >= 0 && !(f.flags & Bomb) && f.risk >= 0)
+	{
+		route_book::route r = {};
+		r.key = route_book::key(f.stage, p, objs, f.bullets);
+		r.stage = f.stage;
+		r.gameTick = f.gameTick;
+		r.move = f.move;
+		r.flags = f.flags & (Fire | Skip);
+		r.runs = 1;
+		r.margin = f.risk;
+		auto it = routes.find(r.key);
+		if (it == routes.end())
+			routes.emplace(r.key, r);
+		else
+			route_book::merge(it->second, r);
+	}
+}
+
+void run_aggregate::merge(const run_aggregate& o)
+{
+	for (const auto& kv : o.heatmaps)
+	{
+		heatmap& h = heatmaps[kv.first];
+		for (size_t i = 0; i < h.cells.size(); ++i)
+			h.cells[i] += kv.second.cells[i];
+		h.frames += kv.second.frames;
+	}
+	for (const auto& kv : o.grazes)
+	{
+		graze_histogram& g = grazes[kv.first];
+		for (int i = 0; i < GRAZE_BINS; ++i)
+			g.bins[i] += kv.second.bins[i];
+		g.grazes += kv.second.grazes;
+		g.hits += kv.second.hits;
+	}
+	for (int i = 0; i < MARGIN_BINS; ++i)
+		margins[i] += o.margins[i];
+	deathbombs.insert(deathbombs.end(), o.deathbombs.begin(), o.deathbombs.end());
+	for (const auto& kv : o.routes)
+	{
+		auto it = routes.find(kv.first);
+		if (it == routes.end())
+			routes.emplace(kv.first, kv.second);
+		else
+			route_book::merge(it->second, kv.second);
+	}
+	frames += o.frames;
+	bullets += o.bullets;
+}
+
+bool run_aggregate::write(const std::string& dir, const std::vector<std::string>& runs) const
+{
+	bool ok = true;
+	char buf[64];
+
+	// Average bullets per frame in each cell, one row of cells per line
+	for (const auto& kv : heatmaps)
+	{
+		std::ofstream out(dir + "/heatmap_" + kv.first.first + "_stage" + std::to_string(kv.first.second) + ".csv");
+		ok &= out.good();
+		const heatmap& h = kv.second;
+		for (int y = 0; y < HEATMAP_HEIGHT; ++y)
+		{
+			for (int x = 0; x < HEATMAP_WIDTH; ++x)
+			{
+				snprintf(buf, sizeof(buf), "%s%.4g", x ? "," : "",
+					h.frames ? (double)h.cells[y * HEATMAP_WIDTH + x] / h.frames : 0.0);
+				out << buf;
+			}
+			out << "\n";
+		}
+	}
+
+	{
+		std::ofstream out(dir + "/grazes.csv");
+		ok &= out.good();
+		out << "type,grazes,hits";
+		for (int i = 0; i < GRAZE_BINS; ++i)
+		{
+			snprintf(buf, sizeof(buf), ",gap_lt_%g", (i + 1) * GRAZE_DISTANCE / GRAZE_BINS);
+			out << buf;
+		}
+		out << "\n";
+		for (const auto& kv : grazes)
+		{
+			out << kv.first << "," << kv.second.grazes << "," << kv.second.hits;
+			for (uint64_t n : kv.second.bins)
+				out << "," << n;
+			out << "\n";
+		}
+	}
+
+	{
+		std::ofstream out(dir + "/margins.csv");
+		ok &= out.good();
+		out << "low,high,frames\n";
+		out << "unknown,unknown," << margins[0] << "\n";
+		for (int i = 1; i < MARGIN_BINS; ++i)
+		{
+			const float low = i == 1 ? 0.f : std::ldexp(1.f, i - 2);
+			if (i == MARGIN_BINS - 1)
+				out << low << ",inf," << margins[i] << "\n";
+			else
+				out << low << "," << std::ldexp(1.f, i - 1) << "," << margins[i] << "\n";
+		}
+	}
+
+	{
+		std::vector<deathbomb> sorted = deathbombs;
+		std::sort(sorted.begin(), sorted.end(), [](const deathbomb& a, const deathbomb& b)
+		{
+			return a.run != b.run ? a.run < b.run : a.gameTick < b.gameTick;
+		});
+
+		std::ofstream out(dir + "/deathbombs.csv");
+		ok &= out.good();
+		out << "run,tick,stage,x,y,risk\n";
+		for (const deathbomb& d : sorted)
+		{
+			snprintf(buf, sizeof(buf), ",%.1f,%.1f,%.3f\n", d.x, d.y, d.risk);
+			out << runs[d.run] << "," << d.gameTick << "," << d.stage << buf;
+		}
+	}
+	return ok;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "algo/route_book.h"
+#include "algo/th_recording.h"
+
+/**
+ * \brief Statistics over recorded frames (see th_recording).
+ *
+ * Every worker thread fills its own aggregate from the chunks it claims, and
+ * the aggregates are merged once all chunks are done, so workers never share
+ * mutable data.
+ */
+class run_aggregate
+{
+public:
+	// Bullet density heatmaps use square cells over the playing field
+	static const int HEATMAP_CELL = 8;
+	static const int HEATMAP_WIDTH = 384 / HEATMAP_CELL;
+	static const int HEATMAP_HEIGHT = 448 / HEATMAP_CELL;
+
+	// Closest approaches of bullets within this gap to the player are near misses
+	static constexpr float GRAZE_DISTANCE = 16.f;
+	static const int GRAZE_BINS = 16;
+
+	// Bin 0 counts unknown margins, bin i > 0 margins within [2^(i-2), 2^(i-1))
+	// frames with bin 1 holding [0, 1), and the last bin everything beyond
+	static const int MARGIN_BINS = 16;
+
+	// A bomb fired with less margin than this is a deathbomb, as in th_vo_algo
+	static constexpr float DEATHBOMB_RISK = 0.5f;
+
+	struct heatmap
+	{
+		std::vector<uint64_t> cells = std::vector<uint64_t>(HEATMAP_WIDTH * HEATMAP_HEIGHT);
+		uint64_t frames = 0;
+	};
+
+	struct graze_histogram
+	{
+		// Bin i counts near misses with a gap within [i, i + 1) * GRAZE_DISTANCE / GRAZE_BINS
+		uint64_t bins[GRAZE_BINS] = {};
+		uint64_t grazes = 0;
+		// Closest approaches which overlapped the player
+		uint64_t hits = 0;
+	};
+
+	struct deathbomb
+	{
+		uint32_t run;
+		uint32_t gameTick;
+		uint32_t stage;
+		float x, y;
+		float risk;
+	};
+
+	// By game and stage
+	std::map<std::pair<std::string, uint32_t>, heatmap> heatmaps;
+	// By bullet type (object_record::meta)
+	std::map<uint32_t, graze_histogram> grazes;
+	// Margins of decided (not observed) frames
+	uint64_t margins[MARGIN_BINS] = {};
+	std::vector<deathbomb> deathbombs;
+
+	// Best route taken in each world, only collected if collectRoutes is set
+	bool collectRoutes = false;
+	std::unordered_map<uint64_t, route_book::route> routes;
+
+	uint64_t frames = 0;
+	uint64_t bullets = 0;
+
+	/**
+	 * \brief Add the frames of a chunk
+	 * \param run Index of the recording
+	 * \param game Game of the recording
+	 * \param chunk Chunk header followed by its frames
+	 */
+	void addChunk(uint32_t run, const std::string& game, const uint8_t* chunk);
+
+	/**
+	 * \brief Add the statistics of another aggregate
+	 */
+	void merge(const run_aggregate& o);
+
+	/**
+	 * \brief Write the summary tables as CSV files
+	 * \param dir Output directory, which must exist
+	 * \param runs Names of the recordings, by index
+	 * \return Whether all tables could be written
+	 */
+	bool write(const std::string& dir, const std::vector<std::string>& runs) const;
+
+	static int marginBin(float risk);
+
+private:
+	void addFrame(uint32_t run, heatmap& map, const th_recording::frame_record& f);
+};
@@ -0,0 +1,172 @@
+// Offline analytics over recordings made with the twinject "record" option
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analytics.h"
+#include "util/mapped_file.h"
+
+namespace fs = std::filesystem;
+
+static const char* const RECORDING_EXTENSION = ".thr";
+// Chunks claimed by a worker at once, to keep the shared counter cold
+static const size_t CHUNK_BATCH = 16;
+
+struct run
+{
+	std::string name;
+	std::string game;
+	mapped_file file;
+	std::vector<size_t> chunks;
+};
+
+struct work_item
+{
+	uint32_t run;
+	size_t offset;
+};
+
+static void collectRecordings(const fs::path& path, std::vector<fs::path>& out)
+{
+	if (fs::is_directory(path))
+	{
+		for (const auto& e : fs::recursive_directory_iterator(path))
+		{
+			if (e.is_regular_file() && e.path().extension() == RECORDING_EXTENSION)
+				out.push_back(e.path());
+		}
+	}
+	else
+	{
+		out.push_back(path);
+	}
+}
+
+int main(const int argc, const char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage: thanalytics <output dir> <recording or dir>... [-j threads] [-r route book]" << std::endl;
+		return 1;
+	}
+
+	const std::string outDir = argv[1];
+	unsigned threads = 0;
+	std::string bookPath;
+	std::vector<fs::path> paths;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (std::string(argv[i]) == "-j" && i + 1 < argc)
+			threads = (unsigned)std::stoul(argv[++i]);
+		else if (std::string(argv[i]) == "-r" && i + 1 < argc)
+			bookPath = argv[++i];
+		else
+			collectRecordings(argv[i], paths);
+	}
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	std::sort(paths.begin(), paths.end());
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Map and index every recording, the chunks of all runs form one work list
+	std::vector<std::unique_ptr<run>> runs;
+	std::vector<work_item> work;
+	size_t bytes = 0;
+	for (const fs::path& p : paths)
+	{
+		auto r = std::make_unique<run>();
+		r->name = p.filename().string();
+		if (!r->file.open(p.string()) || !th_recording::validHeader(r->file.data(), r->file.size()))
+		{
+			std::cerr << "thanalytics: skipping " << p.string() << ", not a recording" << std::endl;
+			continue;
+		}
+
+		th_recording::file_header h;
+		memcpy(&h, r->file.data(), sizeof(h));
+		r->game.assign(h.game, strnlen(h.game, sizeof(h.game)));
+		r->chunks = th_recording::indexChunks(r->file.data(), r->file.size());
+		for (size_t offset : r->chunks)
+			work.push_back({ (uint32_t)runs.size(), offset });
+		bytes += r->file.size();
+		runs.push_back(std::move(r));
+	}
+
+	// Workers claim batches of chunks and aggregate them privately
+	std::vector<run_aggregate> partial(threads);
+	for (run_aggregate& a : partial)
+		a.collectRoutes = !bookPath.empty();
+	std::atomic<size_t> next{ 0 };
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&, t]
+		{
+			for (;;)
+			{
+				const size_t first = next.fetch_add(CHUNK_BATCH);
+				if (first >= work.size())
+					break;
+				const size_t last = std::min(first + CHUNK_BATCH, work.size());
+				for (size_t i = first; i < last; ++i)
+				{
+					const run& r = *runs[work[i].run];
+					partial[t].addChunk(work[i].run, r.game, r.file.data() + work[i].offset);
+				}
+			}
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+
+	run_aggregate total;
+	for (const run_aggregate& a : partial)
+		total.merge(a);
+
+	const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<std::string> names;
+	for (const auto& r : runs)
+		names.push_back(r->name);
+	fs::create_directories(outDir);
+	if (!total.write(outDir, names))
+	{
+		std::cerr << "thanalytics: could not write all tables to " << outDir << std::endl;
+		return 1;
+	}
+
+	// Routes of the recordings improve the book wherever they kept a larger margin
+	if (!bookPath.empty())
+	{
+		route_book book;
+		if (!book.open(bookPath))
+		{
+			std::cerr << "thanalytics: " << bookPath << " is not a route book" << std::endl;
+			return 1;
+		}
+		for (const auto& kv : total.routes)
+			book.add(kv.second);
+		if (!book.save())
+		{
+			std::cerr << "thanalytics: could not write route book " << bookPath << std::endl;
+			return 1;
+		}
+		std::cout << "thanalytics: " << total.routes.size() << " routes, "
+			<< book.size() << " in " << bookPath << std::endl;
+	}
+
+	std::cout << "thanalytics: " << runs.size() << " runs, " << work.size() << " chunks, "
+		<< total.frames << " frames, " << total.bullets << " bullets, "
+		<< total.deathbombs.size() << " deathbombs" << std::endl;
+	std::cout << "thanalytics: " << bytes / 1e6 << " MB in " << seconds << " s ("
+		<< bytes / 1e9 / seconds << " GB/s) on " << threads << " threads" << std::endl;
+	return 0;
+}
@@ -0,0 +1,403 @@
+#include "fuzz.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const char* const TARGET_NAMES[fuzz::TargetCount] = { "aabb", "circle", "sat", "kernels" };
+	const char* const OUTCOME_NAMES[fuzz::OutcomeCount] = { "agree", "missed", "early", "late", "mismatch" };
+
+	// Columns per kernel call, a whole vector even for AVX-512 so no lane
+	// falls back to the scalar predictor
+	const size_t KERNEL_LANES = 16;
+	// Frames the discrete kernels test, as VO_HORIZON
+	const int DISCRETE_HORIZON = 600;
+	// Passes of minimize() over all coordinates
+	const int MINIMIZE_PASSES = 8;
+	const float TWO_PI = 6.28318530718f;
+
+	float coordinate(fuzz::rng& r)
+	{
+		switch (r.below(8))
+		{
+		case 0: return (float)(r.below(129) - 64);
+		case 1: return (float)(r.below(257) - 128) / 2;
+		case 2: return 0;
+		case 3: return r.uniform(-4000, 4000);
+		case 4: return r.uniform(-1e-3f, 1e-3f);
+		default: return r.uniform(-400, 400);
+		}
+	}
+
+	float speed(fuzz::rng& r)
+	{
+		switch (r.below(8))
+		{
+		case 0: return 0;
+		case 1: return (float)(r.below(9) - 4);
+		case 2: return (float)(r.below(33) - 16) / 4;
+		// slow enough to reach the horizon
+		case 3: return r.uniform(-1e-3f, 1e-3f);
+		default: return r.uniform(-8, 8);
+		}
+	}
+
+	float extent(fuzz::rng& r)
+	{
+		switch (r.below(8))
+		{
+		case 0: return 0;
+		case 1: return (float)(r.below(32) + 1);
+		default: return r.uniform(.5f, 32);
+		}
+	}
+
+	vec2 center(const oracle::shape& s)
+	{
+		switch (s.type)
+		{
+		case oracle::shape::Box:
+			return s.position + s.size / 2;
+		case oracle::shape::Circle:
+			return s.position;
+		default:
+			return (vec2::minv(s.points) + vec2::maxv(s.points)) / 2;
+		}
+	}
+
+	void polygon(fuzz::rng& r, oracle::shape& s)
+	{
+		const vec2 c(coordinate(r), coordinate(r));
+		s.points.clear();
+		if (r.below(4) == 0)
+		{
+			// the vertex order of aabb::toPolygon
+			const vec2 size(extent(r) + .5f, extent(r) + .5f);
+			s.points = { c, vec2(c.x + size.x, c.y), c + size, vec2(c.x, c.y + size.y) };
+			return;
+		}
+
+		// vertices on an ellipse in angular order are convex
+		const int n = 3 + r.below(4);
+		const float rx = extent(r) + .5f, ry = extent(r) + .5f;
+		const float phase = r.uniform(0, TWO_PI);
+		for (int i = 0; i < n; ++i)
+		{
+			const float a = phase + TWO_PI * (i + r.uniform(0, .8f)) / n;
+			s.points.push_back(c + vec2(rx * cosf(a), ry * sinf(a)));
+		}
+		if (r.below(2) == 0)
+			std::reverse(s.points.begin(), s.points.end());
+	}
+
+	void shape(fuzz::target t, fuzz::rng& r, oracle::shape& s)
+	{
+		switch (t)
+		{
+		case fuzz::Aabb:
+			s.type = oracle::shape::Box;
+			s.position = vec2(coordinate(r), coordinate(r));
+			s.size = vec2(extent(r), extent(r));
+			break;
+		case fuzz::Circle:
+			s.type = oracle::shape::Circle;
+			s.position = vec2(coordinate(r), coordinate(r));
+			s.radius = extent(r);
+			break;
+		default:
+			s.type = oracle::shape::Polygon;
+			do
+				polygon(r, s);
+			while (!oracle::isConvex(s.points));
+			break;
+		}
+		s.velocity = vec2(speed(r), speed(r));
+	}
+
+	void translate(oracle::shape& s, const vec2& d)
+	{
+		s.position += d;
+		for (vec2& p : s.points)
+			p += d;
+	}
+
+	// Coordinates of a trial which minimize() may change
+	std::vector<float*> fields(fuzz::trial& c)
+	{
+		std::vector<float*> f;
+		for (oracle::shape* s : { &c.a, &c.b })
+		{
+			if (s->type == oracle::shape::Polygon)
+			{
+				for (vec2& p : s->points)
+				{
+					f.push_back(&p.x);
+					f.push_back(&p.y);
+				}
+			}
+			else
+			{
+				f.push_back(&s->position.x);
+				f.push_back(&s->position.y);
+				if (s->type == oracle::shape::Box)
+				{
+					f.push_back(&s->size.x);
+					f.push_back(&s->size.y);
+				}
+				else
+				{
+					f.push_back(&s->radius);
+				}
+			}
+			f.push_back(&s->velocity.x);
+			f.push_back(&s->velocity.y);
+		}
+		return f;
+	}
+
+	std::string format(const vec2& v)
+	{
+		char buf[64];
+		snprintf(buf, sizeof(buf), "vec2(%.9g, %.9g)", v.x, v.y);
+		return buf;
+	}
+
+	std::string format(const std::vector<vec2>& points)
+	{
+		std::string s = "{ ";
+		for (size_t i = 0; i < points.size(); ++i)
+			s += (i ? ", " : "") + format(points[i]);
+		return s + " }";
+	}
+
+	float kernelResults(const fuzz::trial& c, kernels::isa level, float* out)
+	{
+		const kernels::table* t = kernels::variant(level);
+		kernels::columns cols;
+		for (size_t i = 0; i < KERNEL_LANES; ++i)
+		{
+			if (c.b.type == oracle::shape::Circle)
+				cols.addCircle(c.b.position, c.b.radius, c.b.velocity);
+			else
+				cols.addBox(c.b.position, c.b.size, c.b.velocity);
+		}
+		const bool discrete = c.predictor == kernels::Discrete;
+		if (c.a.type == oracle::shape::Circle && discrete)
+			t->discreteCircles(c.a.position, c.a.radius, c.a.velocity, DISCRETE_HORIZON, cols, out);
+		else if (c.a.type == oracle::shape::Circle)
+			t->circles(c.a.position, c.a.radius, c.a.velocity, cols, out);
+		else if (discrete)
+			t->discreteBoxes(c.a.position, c.a.size, c.a.velocity, DISCRETE_HORIZON, cols, out);
+		else
+			t->boxes(c.a.position, c.a.size, c.a.velocity, cols, out);
+		return out[0];
+	}
+}
+
+const char* fuzz::name(target t)
+{
+	return t < TargetCount ? TARGET_NAMES[t] : "unknown";
+}
+
+const char* fuzz::name(outcome o)
+{
+	return o < OutcomeCount ? OUTCOME_NAMES[o] : "unknown";
+}
+
+bool fuzz::parse(const char* name, target& t)
+{
+	for (int i = 0; i < TargetCount; ++i)
+	{
+		if (strcmp(name, TARGET_NAMES[i]) == 0)
+		{
+			t = (target)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t fuzz::rng::next()
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+int fuzz::rng::below(int n)
+{
+	return (int)(next() % (uint64_t)n);
+}
+
+float fuzz::rng::uniform(float lo, float hi)
+{
+	return lo + (hi - lo) * (float)((next() >> 40) * (1. / (1ull << 24)));
+}
+
+void fuzz::generate(target t, rng& r, trial& out)
+{
+	out.type = t;
+	out.level = kernels::Scalar;
+	out.predictor = kernels::Continuous;
+	if (t == Kernels)
+	{
+		// every supported instruction set above scalar in turn
+		int levels = 0;
+		while (levels + 1 < kernels::IsaCount && kernels::supported((kernels::isa)(levels + 1)))
+			++levels;
+		out.level = (kernels::isa)(levels ? 1 + r.below(levels) : 0);
+		out.predictor = r.below(2) ? kernels::Discrete : kernels::Continuous;
+		t = r.below(2) ? Aabb : Circle;
+	}
+	shape(t, r, out.a);
+	shape(t, r, out.b);
+
+	switch (r.below(8))
+	{
+	case 0:
+	case 1:
+	case 2:
+	{
+		// aimed to meet within a few hundred frames, or exactly at the horizon
+		const float frames = r.below(8) ? r.uniform(1, 400) : HORIZON;
+		out.b.velocity = out.a.velocity + (center(out.a) - center(out.b)) / frames;
+		break;
+	}
+	case 3:
+		// parallel on an axis, which the AABB predictor divides by zero on
+		if (r.below(2))
+			out.b.velocity.x = out.a.velocity.x;
+		else
+			out.b.velocity.y = out.a.velocity.y;
+		break;
+	case 4:
+		// edge to edge
+		if (t == Aabb)
+			translate(out.b, vec2(out.a.position.x + out.a.size.x - out.b.position.x, 0));
+		else if (t == Circle)
+			translate(out.b, vec2(out.a.position.x + out.a.radius + out.b.radius - out.b.position.x,
+				out.a.position.y - out.b.position.y));
+		else
+			translate(out.b, vec2(vec2::maxv(out.a.points).x - vec2::minv(out.b.points).x, 0));
+		break;
+	default:
+		break;
+	}
+}
+
+float fuzz::predict(const trial& c)
+{
+	const oracle::shape& a = c.a;
+	const oracle::shape& b = c.b;
+	switch (c.type)
+	{
+	case Aabb:
+		return vec2::willCollideAABB(a.position, b.position, a.size, b.size, a.velocity, b.velocity);
+	case Circle:
+		return vec2::willCollideCircle(a.position, b.position, a.radius, b.radius, a.velocity, b.velocity);
+	case Sat:
+		return vec2::willCollideSAT(a.points, a.velocity, b.points, b.velocity);
+	default:
+	{
+		float out[KERNEL_LANES];
+		return kernelResults(c, c.level, out);
+	}
+	}
+}
+
+fuzz::outcome fuzz::check(const trial& c, double epsilon)
+{
+	if (c.type == Kernels)
+	{
+		float expected[KERNEL_LANES], actual[KERNEL_LANES];
+		kernelResults(c, kernels::Scalar, expected);
+		kernelResults(c, c.level, actual);
+		return memcmp(expected, actual, sizeof(expected)) == 0 ? Agree : Mismatch;
+	}
+	return (outcome)oracle::judge(c.a, c.b, predict(c), HORIZON, epsilon);
+}
+
+int fuzz::minimize(trial& c, outcome o, double epsilon)
+{
+	int simplified = 0;
+	for (int pass = 0; pass < MINIMIZE_PASSES; ++pass)
+	{
+		int changed = 0;
+		for (float* f : fields(c))
+		{
+			const float v = *f;
+			// halving shrinks large coordinates, small ones are only rounded
+			const float candidates[] = {
+				0.f, truncf(v), roundf(v * 2) / 2, roundf(v * 10) / 10, std::abs(v) > 1 ? v / 2 : v };
+			for (float x : candidates)
+			{
+				if (x == v)
+					continue;
+				*f = x;
+				const bool convex = c.type != Sat
+					|| (oracle::isConvex(c.a.points) && oracle::isConvex(c.b.points));
+				if (convex && check(c, epsilon) == o)
+				{
+					++changed;
+					break;
+				}
+				*f = v;
+			}
+		}
+		simplified += changed;
+		if (changed == 0)
+			break;
+	}
+	return simplified;
+}
+
+std::string fuzz::reproducer(const trial& c)
+{
+	const oracle::shape& a = c.a;
+	const oracle::shape& b = c.b;
+	switch (c.type)
+	{
+	case Aabb:
+		return "vec2::willCollideAABB(" + format(a.position) + ", " + format(b.position) + ", "
+			+ format(a.size) + ", " + format(b.size) + ", "
+			+ format(a.velocity) + ", " + format(b.velocity) + ")";
+	case Circle:
+	{
+		char radii[64];
+		snprintf(radii, sizeof(radii), "%.9g, %.9g", a.radius, b.radius);
+		return "vec2::willCollideCircle(" + format(a.position) + ", " + format(b.position) + ", "
+			+ radii + ", " + format(a.velocity) + ", " + format(b.velocity) + ")";
+	}
+	case Sat:
+		return "vec2::willCollideSAT(" + format(a.points) + ", " + format(a.velocity) + ", "
+			+ format(b.points) + ", " + format(b.velocity) + ")";
+	default:
+	{
+		const bool circles = a.type == oracle::shape::Circle;
+		char lanes[160];
+		if (circles)
+			snprintf(lanes, sizeof(lanes), "c.addCircle(%s, %.9g, %s)",
+				format(b.position).c_str(), b.radius, format(b.velocity).c_str());
+		else
+			snprintf(lanes, sizeof(lanes), "c.addBox(%s, %s, %s)",
+				format(b.position).c_str(), format(b.size).c_str(), format(b.velocity).c_str());
+		// the discrete kernels take the horizon before the columns
+		const bool discrete = c.predictor == kernels::Discrete;
+		const std::string horizon = discrete ? std::to_string(DISCRETE_HORIZON) + ", " : "";
+		char call[192];
+		if (circles)
+			snprintf(call, sizeof(call), "%s(%s, %.9g, %s, %sc, out)", discrete ? "discreteCircles" : "circles",
+				format(a.position).c_str(), a.radius, format(a.velocity).c_str(), horizon.c_str());
+		else
+			snprintf(call, sizeof(call), "%s(%s, %s, %s, %sc, out)", discrete ? "discreteBoxes" : "boxes",
+				format(a.position).c_str(), format(a.size).c_str(), format(a.velocity).c_str(), horizon.c_str());
+		return std::to_string(KERNEL_LANES) + " x " + lanes + "; kernels::variant(kernels::"
+			+ (c.level == kernels::SSE41 ? "SSE41" : c.level == kernels::AVX2 ? "AVX2" : "AVX512")
+			+ ")->" + call;
+	}
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "oracle.h"
+#include "util/kernels.h"
+
+/**
+ * \brief Random shapes for the collision predictors, and the predictors
+ * under test.
+ *
+ * Coordinates are drawn from several distributions at once: uniform, whole and
+ * half pixels, zero, far from the origin and tiny. Pairs are often aimed at
+ * each other, placed edge to edge, or given equal velocities on an axis, which
+ * are the cases the closed form predictors divide by zero or lose precision on.
+ */
+namespace fuzz
+{
+	// Frames the predictors look ahead, see vec2::willCollideAABB
+	const float HORIZON = 6000;
+
+	enum target : uint8_t
+	{
+		Aabb,		// vec2::willCollideAABB
+		Circle,		// vec2::willCollideCircle
+		Sat,		// vec2::willCollideSAT
+		Kernels,	// kernels::table of every supported instruction set and predictor
+
+		TargetCount
+	};
+
+	// Oracle verdicts, and results of the kernels which differ from the scalar ones
+	enum outcome : uint8_t
+	{
+		Agree = oracle::Agree,
+		Missed = oracle::Missed,
+		Early = oracle::Early,
+		Late = oracle::Late,
+		Mismatch = oracle::VerdictCount,
+
+		OutcomeCount
+	};
+
+	const char* name(target t);
+	const char* name(outcome o);
+
+	/**
+	 * \brief Find a target by name
+	 * \param name As returned by name(), case sensitive
+	 * \param t Set to the target if found
+	 * \return Whether the name is known
+	 */
+	bool parse(const char* name, target& t);
+
+	// splitmix64
+	struct rng
+	{
+		uint64_t state;
+
+		explicit rng(uint64_t seed) : state(seed) {}
+		uint64_t next();
+		// Uniform in [0, n)
+		int below(int n);
+		// Uniform in [lo, hi)
+		float uniform(float lo, float hi);
+	};
+
+	/**
+	 * \brief One pair of shapes for a predictor
+	 *
+	 * For the kernels, a is the moving shape and b is every column, both boxes
+	 * or both circles.
+	 */
+	struct trial
+	{
+		target type = Aabb;
+		kernels::isa level = kernels::Scalar;
+		kernels::predictor predictor = kernels::Continuous;
+		oracle::shape a, b;
+	};
+
+	void generate(target t, rng& r, trial& out);
+
+	/**
+	 * \brief Run the predictor of a trial
+	 * \return Frames until collision as returned by the predictor
+	 */
+	float predict(const trial& c);
+
+	/**
+	 * \brief Run a trial and judge its result
+	 * \param epsilon Separation in pixels within which shapes are touching
+	 */
+	outcome check(const trial& c, double epsilon);
+
+	/**
+	 * \brief Simplify the coordinates of a divergent trial, as long as it keeps
+	 * diverging the same way
+	 * \return Number of coordinates simplified
+	 */
+	int minimize(trial& c, outcome o, double epsilon);
+
+	// C++ statement which calls the predictor of a trial
+	std::string reproducer(const trial& c);
+}
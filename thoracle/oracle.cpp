@@ -0,0 +1,216 @@
+#include "oracle.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	const char* const VERDICT_NAMES[oracle::VerdictCount] = { "agree", "missed", "early", "late" };
+
+	double boxGap(const oracle::shape& a, const oracle::shape& b, double t)
+	{
+		const double ax = a.position.x + (double)a.velocity.x * t;
+		const double ay = a.position.y + (double)a.velocity.y * t;
+		const double bx = b.position.x + (double)b.velocity.x * t;
+		const double by = b.position.y + (double)b.velocity.y * t;
+		return std::max(
+			std::max(ax - (bx + b.size.x), bx - (ax + a.size.x)),
+			std::max(ay - (by + b.size.y), by - (ay + a.size.y)));
+	}
+
+	double circleGap(const oracle::shape& a, const oracle::shape& b, double t)
+	{
+		const double dx = b.position.x - (double)a.position.x + ((double)b.velocity.x - a.velocity.x) * t;
+		const double dy = b.position.y - (double)a.position.y + ((double)b.velocity.y - a.velocity.y) * t;
+		return std::hypot(dx, dy) - ((double)a.radius + b.radius);
+	}
+
+	// Projection of a polygon moved by (ox, oy) onto an axis
+	void project(const std::vector<vec2>& points, double ox, double oy,
+		double nx, double ny, double& min, double& max)
+	{
+		min = DBL_MAX;
+		max = -DBL_MAX;
+		for (const vec2& p : points)
+		{
+			const double d = (p.x + ox) * nx + (p.y + oy) * ny;
+			min = std::min(min, d);
+			max = std::max(max, d);
+		}
+	}
+
+	// Largest gap along the edge normals of one polygon
+	double polygonGap(const oracle::shape& edges, const oracle::shape& a, const oracle::shape& b, double t)
+	{
+		const double ax = a.velocity.x * t, ay = a.velocity.y * t;
+		const double bx = b.velocity.x * t, by = b.velocity.y * t;
+		const size_t n = edges.points.size();
+		double gap = -DBL_MAX;
+		for (size_t i = 0; i < n; ++i)
+		{
+			const vec2& p = edges.points[i];
+			const vec2& q = edges.points[(i + 1) % n];
+			const double ex = (double)q.x - p.x, ey = (double)q.y - p.y;
+			const double len = std::hypot(ex, ey);
+			if (len == 0)
+				continue;
+			const double nx = -ey / len, ny = ex / len;
+			double minA, maxA, minB, maxB;
+			project(a.points, ax, ay, nx, ny, minA, maxA);
+			project(b.points, bx, by, nx, ny, minB, maxB);
+			gap = std::max(gap, std::max(minB - maxA, minA - maxB));
+		}
+		return gap;
+	}
+
+	// Largest absolute coordinate of the shapes at some time
+	double magnitude(const oracle::shape& a, const oracle::shape& b, double t)
+	{
+		double m = 0;
+		for (const oracle::shape* s : { &a, &b })
+		{
+			const vec2& p = s->type == oracle::shape::Polygon && !s->points.empty()
+				? s->points[0] : s->position;
+			m = std::max(m, std::abs(p.x + (double)s->velocity.x * t));
+			m = std::max(m, std::abs(p.y + (double)s->velocity.y * t));
+		}
+		return m;
+	}
+
+	// Last time the separation is above a level before it is at most the level at hi
+	double bisect(const oracle::shape& a, const oracle::shape& b, double lo, double hi, double level)
+	{
+		for (int i = 0; i < oracle::REFINE_STEPS && lo < hi; ++i)
+		{
+			const double mid = (lo + hi) / 2;
+			if (mid <= lo || mid >= hi)
+				break;
+			if (oracle::separation(a, b, mid) <= level)
+				hi = mid;
+			else
+				lo = mid;
+		}
+		return hi;
+	}
+}
+
+const char* oracle::name(verdict v)
+{
+	return v < VerdictCount ? VERDICT_NAMES[v] : "unknown";
+}
+
+double oracle::separation(const shape& a, const shape& b, double t)
+{
+	switch (a.type)
+	{
+	case shape::Box:
+		return boxGap(a, b, t);
+	case shape::Circle:
+		return circleGap(a, b, t);
+	default:
+		return std::max(polygonGap(a, a, b, t), polygonGap(b, a, b, t));
+	}
+}
+
+double oracle::firstBelow(const shape& a, const shape& b, double horizon, double level)
+{
+	double prev = separation(a, b, 0);
+	if (prev <= level)
+		return 0;
+
+	// the sublevel set of a convex function is an interval, so the first sample
+	// below the level follows the first crossing
+	int minIndex = 0;
+	double minSep = prev;
+	for (int i = 1; i <= RASTER_STEPS; ++i)
+	{
+		const double t = horizon * i / RASTER_STEPS;
+		const double s = separation(a, b, t);
+		if (s <= level)
+			return bisect(a, b, horizon * (i - 1) / RASTER_STEPS, t, level);
+		if (s < minSep)
+		{
+			minSep = s;
+			minIndex = i;
+		}
+	}
+
+	// no sample reached the level, but the minimum next to the smallest sample may
+	const double phi = (std::sqrt(5.) - 1) / 2;
+	const double lo = horizon * std::max(0, minIndex - 1) / RASTER_STEPS;
+	double l = lo;
+	double h = horizon * std::min(RASTER_STEPS, minIndex + 1) / RASTER_STEPS;
+	double m1 = h - phi * (h - l), m2 = l + phi * (h - l);
+	double s1 = separation(a, b, m1), s2 = separation(a, b, m2);
+	for (int i = 0; i < REFINE_STEPS; ++i)
+	{
+		if (s1 <= level)
+			return bisect(a, b, lo, m1, level);
+		if (s2 <= level)
+			return bisect(a, b, lo, m2, level);
+		if (s1 < s2)
+		{
+			h = m2; m2 = m1; s2 = s1;
+			m1 = h - phi * (h - l);
+			s1 = separation(a, b, m1);
+		}
+		else
+		{
+			l = m1; m1 = m2; s1 = s2;
+			m2 = l + phi * (h - l);
+			s2 = separation(a, b, m2);
+		}
+	}
+	return -1;
+}
+
+oracle::verdict oracle::judge(const shape& a, const shape& b, float predicted, double horizon, double epsilon)
+{
+	const double speed = std::hypot((double)b.velocity.x - a.velocity.x, (double)b.velocity.y - a.velocity.y);
+	if (!(predicted >= 0 && predicted <= horizon))
+	{
+		// precision is lowest where the shapes are farthest out
+		const double e = epsilon + RELATIVE_EPSILON
+			* std::max(magnitude(a, b, 0), magnitude(a, b, horizon));
+		const double solid = firstBelow(a, b, horizon, -e);
+		// a collision just before the horizon may be cut off by the predictor
+		if (solid < 0 || (speed > 0 && solid > horizon - e / speed))
+			return Agree;
+		return Missed;
+	}
+
+	const double e = epsilon + RELATIVE_EPSILON * magnitude(a, b, predicted);
+	const double s = separation(a, b, predicted);
+	if (s > e)
+		return Early;
+	if (predicted == 0)
+		return Agree;
+	if (s < -e)
+		return Late;
+	const double solid = firstBelow(a, b, predicted, -e);
+	if (solid >= 0 && speed > 0 && predicted > solid + e / speed)
+		return Late;
+	return Agree;
+}
+
+bool oracle::isConvex(const std::vector<vec2>& points)
+{
+	const size_t n = points.size();
+	if (n < 3)
+		return false;
+	int sign = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		const vec2& p = points[i];
+		const vec2& q = points[(i + 1) % n];
+		const vec2& r = points[(i + 2) % n];
+		const double cross = ((double)q.x - p.x) * ((double)r.y - q.y)
+			- ((double)q.y - p.y) * ((double)r.x - q.x);
+		const int s = cross > 0 ? 1 : cross < 0 ? -1 : 0;
+		if (s == 0 || (sign != 0 && s != sign))
+			return false;
+		sign = s;
+	}
+	return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "util/vec2.h"
+
+/**
+ * \brief Brute force reference for the collision predictors.
+ *
+ * The oracle never solves for a time of impact. It only measures how far apart
+ * two shapes are at a given time, moving each shape from scratch in double
+ * precision: the separation is the largest gap along any separating axis
+ * (edge normals, or the line between circle centers), negative when the
+ * shapes overlap. For shapes moving linearly the separation is convex in time,
+ * so rasterizing it at RASTER_STEPS times over the horizon brackets its
+ * minimum, which golden section search then refines. The first time the
+ * separation falls below a level is found by bisection before the minimum.
+ *
+ * A prediction is judged against two levels: shapes are touching where the
+ * separation is below epsilon, and solidly overlapping where it is below
+ * -epsilon. A predictor may report any time at which the shapes touch, as
+ * long as it is not after they first overlap solidly, and may only report no
+ * collision if they never overlap solidly. Grazing contacts within epsilon
+ * are therefore allowed either way.
+ */
+namespace oracle
+{
+	// Uniform samples of the separation over the horizon
+	const int RASTER_STEPS = 64;
+	// Refinement iterations of golden section search and bisection
+	const int REFINE_STEPS = 80;
+	// Epsilon grows with the magnitude of coordinates, as float predictors lose
+	// precision; this is about 32 float ulps
+	const double RELATIVE_EPSILON = 4e-6;
+
+	struct shape
+	{
+		enum kind : uint8_t
+		{
+			Box,
+			Circle,
+			Polygon
+		};
+
+		kind type = Box;
+		// Corner of boxes, or center of circles
+		vec2 position;
+		vec2 size;
+		float radius = 0;
+		// Vertices of convex polygons, in order
+		std::vector<vec2> points;
+		vec2 velocity;
+	};
+
+	enum verdict : uint8_t
+	{
+		Agree,
+		Missed,		// no collision predicted, but the shapes overlap solidly
+		Early,		// the shapes are apart at the predicted time
+		Late,		// the shapes overlap solidly before or at the predicted time
+
+		VerdictCount
+	};
+
+	const char* name(verdict v);
+
+	/**
+	 * \brief Gap between two shapes of the same kind some frames from now
+	 * \return Largest gap along a separating axis, negative if overlapping
+	 */
+	double separation(const shape& a, const shape& b, double t);
+
+	/**
+	 * \brief First time the separation is at most a level
+	 * \param horizon Frames to search
+	 * \param level Separation to reach
+	 * \return Frames until the level is reached, or -1 if not within the horizon
+	 */
+	double firstBelow(const shape& a, const shape& b, double horizon, double level);
+
+	/**
+	 * \brief Judge a predicted time of collision
+	 * \param predicted Predictor output, negative or beyond the horizon if none
+	 * \param horizon Frames the predictor looks ahead
+	 * \param epsilon Separation in pixels within which shapes are touching
+	 * \return Whether the prediction agrees with the oracle, or how it diverges
+	 */
+	verdict judge(const shape& a, const shape& b, float predicted, double horizon, double epsilon);
+
+	/**
+	 * \brief Whether polygon vertices are convex and in a consistent order
+	 */
+	bool isConvex(const std::vector<vec2>& points);
+}
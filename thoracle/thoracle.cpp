@@ -0,0 +1,298 @@
+// Differential testing of the collision predictors against a brute force oracle
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fuzz.h"
+#include "oracle.h"
+
+using clock_type = std::chrono::steady_clock;
+
+static const double DEFAULT_SECONDS = 10;
+static const double DEFAULT_EPSILON = .01;
+// Divergences kept per target and outcome, which are minimized after the run
+static const size_t SAMPLES = 4;
+// Trials between checks of the deadline
+static const int DEADLINE_BATCH = 64;
+// Trials and columns timed per target by the throughput comparison
+static const size_t BENCHMARK_TRIALS = 4096;
+static const size_t BENCHMARK_COLUMNS = 4096;
+static const int BENCHMARK_REPEATS = 16;
+// Horizons of the discrete kernels, as ROUTE_HORIZON and VO_HORIZON
+static const int BENCHMARK_HORIZONS[] = { 30, 600 };
+
+// Keeps timed results alive
+static volatile float benchmarkSink;
+
+struct tally
+{
+	uint64_t trials[fuzz::TargetCount] = {};
+	uint64_t outcomes[fuzz::TargetCount][fuzz::OutcomeCount] = {};
+	std::vector<fuzz::trial> samples[fuzz::TargetCount][fuzz::OutcomeCount];
+
+	void add(const fuzz::trial& c, fuzz::outcome o)
+	{
+		++trials[c.type];
+		++outcomes[c.type][o];
+		auto& s = samples[c.type][o];
+		if (o != fuzz::Agree && s.size() < SAMPLES)
+			s.push_back(c);
+	}
+
+	void merge(const tally& o)
+	{
+		for (int t = 0; t < fuzz::TargetCount; ++t)
+		{
+			trials[t] += o.trials[t];
+			for (int i = 0; i < fuzz::OutcomeCount; ++i)
+			{
+				outcomes[t][i] += o.outcomes[t][i];
+				auto& s = samples[t][i];
+				for (size_t j = 0; j < o.samples[t][i].size() && s.size() < SAMPLES; ++j)
+					s.push_back(o.samples[t][i][j]);
+			}
+		}
+	}
+};
+
+static double secondsSince(clock_type::time_point start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static void report(fuzz::trial& c, fuzz::outcome o, double epsilon)
+{
+	const int simplified = fuzz::minimize(c, o, epsilon);
+	std::cout << "  " << fuzz::name(c.type) << " " << fuzz::name(o);
+	if (c.type == fuzz::Kernels)
+		std::cout << " (" << kernels::name(c.level) << ", " << kernels::name(c.predictor) << ")";
+	std::cout << ", " << simplified << " coordinates simplified" << std::endl;
+
+	char line[160];
+	if (c.type == fuzz::Kernels)
+	{
+		fuzz::trial scalar = c;
+		scalar.level = kernels::Scalar;
+		snprintf(line, sizeof(line), "    predicted %.9g, scalar %.9g",
+			fuzz::predict(c), fuzz::predict(scalar));
+	}
+	else
+	{
+		const double touch = oracle::firstBelow(c.a, c.b, fuzz::HORIZON, epsilon);
+		const double solid = oracle::firstBelow(c.a, c.b, fuzz::HORIZON, -epsilon);
+		snprintf(line, sizeof(line), "    predicted %.9g, oracle touches at %.9g, overlaps at %.9g",
+			fuzz::predict(c), touch, solid);
+	}
+	std::cout << line << std::endl;
+	std::cout << "    " << fuzz::reproducer(c) << std::endl;
+}
+
+static void benchmark(fuzz::target t, uint64_t seed, double epsilon)
+{
+	fuzz::rng r(seed);
+	std::vector<fuzz::trial> trials(BENCHMARK_TRIALS);
+	for (fuzz::trial& c : trials)
+		fuzz::generate(t, r, c);
+
+	auto start = clock_type::now();
+	float sink = 0;
+	for (int i = 0; i < BENCHMARK_REPEATS; ++i)
+	{
+		for (const fuzz::trial& c : trials)
+			sink += fuzz::predict(c);
+	}
+	const double predictor = BENCHMARK_REPEATS * trials.size() / secondsSince(start);
+
+	start = clock_type::now();
+	size_t agree = 0;
+	for (const fuzz::trial& c : trials)
+		agree += fuzz::check(c, epsilon) == fuzz::Agree;
+	const double checked = trials.size() / secondsSince(start);
+	benchmarkSink = sink + agree;
+
+	char line[160];
+	snprintf(line, sizeof(line), "  %-8s %12.0f predictions/s %12.0f checks/s",
+		fuzz::name(t), predictor, checked);
+	std::cout << line << std::endl;
+}
+
+static void benchmarkKernels(uint64_t seed)
+{
+	fuzz::rng r(seed);
+	kernels::columns boxes, circles;
+	for (size_t i = 0; i < BENCHMARK_COLUMNS; ++i)
+	{
+		fuzz::trial c;
+		fuzz::generate(fuzz::Aabb, r, c);
+		boxes.addBox(c.b.position, c.b.size, c.b.velocity);
+		fuzz::generate(fuzz::Circle, r, c);
+		circles.addCircle(c.b.position, c.b.radius, c.b.velocity);
+	}
+
+	std::vector<float> out(BENCHMARK_COLUMNS);
+	double scalar = 0;
+	for (int i = 0; i < kernels::IsaCount; ++i)
+	{
+		const kernels::table* t = kernels::variant((kernels::isa)i);
+		if (!t)
+			continue;
+		// shapes per second of the continuous kernels, or the discrete ones up to a horizon
+		auto measure = [&](int horizon)
+		{
+			const auto start = clock_type::now();
+			for (int j = 0; j < BENCHMARK_REPEATS; ++j)
+			{
+				if (horizon < 0)
+				{
+					t->boxes(vec2(j), vec2(8, 8), vec2(1, -1), boxes, out.data());
+					t->circles(vec2(j), 4, vec2(1, -1), circles, out.data());
+				}
+				else
+				{
+					t->discreteBoxes(vec2(j), vec2(8, 8), vec2(1, -1), horizon, boxes, out.data());
+					t->discreteCircles(vec2(j), 4, vec2(1, -1), horizon, circles, out.data());
+				}
+			}
+			benchmarkSink = out[0];
+			return 2. * BENCHMARK_REPEATS * BENCHMARK_COLUMNS / secondsSince(start);
+		};
+
+		const double rate = measure(-1);
+		if (i == kernels::Scalar)
+			scalar = rate;
+
+		char line[160];
+		snprintf(line, sizeof(line), "  %-8s %-13s %12.0f shapes/s %8.2fx scalar",
+			kernels::name((kernels::isa)i), "continuous", rate, rate / scalar);
+		std::cout << line << std::endl;
+		for (int horizon : BENCHMARK_HORIZONS)
+		{
+			const double discrete = measure(horizon);
+			char label[32];
+			snprintf(label, sizeof(label), "discrete/%d", horizon);
+			snprintf(line, sizeof(line), "  %-8s %-13s %12.0f shapes/s %8.2fx continuous",
+				"", label, discrete, discrete / rate);
+			std::cout << line << std::endl;
+		}
+	}
+}
+
+int main(const int argc, const char* argv[])
+{
+	double seconds = DEFAULT_SECONDS;
+	double epsilon = DEFAULT_EPSILON;
+	unsigned threads = 0;
+	uint64_t seed = (uint64_t)clock_type::now().time_since_epoch().count();
+	std::vector<fuzz::target> targets;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		fuzz::target t;
+		if (arg == "-t" && i + 1 < argc)
+			seconds = std::stod(argv[++i]);
+		else if (arg == "-j" && i + 1 < argc)
+			threads = (unsigned)std::stoul(argv[++i]);
+		else if (arg == "-s" && i + 1 < argc)
+			seed = std::stoull(argv[++i]);
+		else if (arg == "-e" && i + 1 < argc)
+			epsilon = std::stod(argv[++i]);
+		else if (fuzz::parse(argv[i], t))
+			targets.push_back(t);
+		else
+		{
+			std::cerr << "usage: thoracle [-t seconds] [-j threads] [-s seed] [-e epsilon] "
+				"[aabb|circle|sat|kernels]..." << std::endl;
+			return 1;
+		}
+	}
+	if (targets.empty())
+	{
+		for (int t = 0; t < fuzz::TargetCount; ++t)
+			targets.push_back((fuzz::target)t);
+	}
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::cout << "thoracle: seed " << seed << ", epsilon " << epsilon << " px, "
+		<< seconds << " s on " << threads << " threads" << std::endl;
+
+	// Workers cycle through the targets with their own generator and tally
+	const auto start = clock_type::now();
+	std::vector<tally> partial(threads);
+	std::atomic<bool> done{ false };
+	std::vector<std::thread> workers;
+	for (unsigned w = 0; w < threads; ++w)
+	{
+		workers.emplace_back([&, w]
+		{
+			fuzz::rng r(seed + w * 0x632BE59BD9B4E019ull);
+			fuzz::trial c;
+			for (size_t n = 0; !done.load(std::memory_order_relaxed); ++n)
+			{
+				for (int i = 0; i < DEADLINE_BATCH; ++i)
+				{
+					fuzz::generate(targets[(n + i) % targets.size()], r, c);
+					partial[w].add(c, fuzz::check(c, epsilon));
+				}
+				if (w == 0 && secondsSince(start) >= seconds)
+					done = true;
+			}
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+	const double elapsed = secondsSince(start);
+
+	tally total;
+	for (const tally& t : partial)
+		total.merge(t);
+
+	uint64_t trials = 0, divergent = 0;
+	std::cout << "  target         trials";
+	for (int o = 0; o < fuzz::OutcomeCount; ++o)
+		std::cout << " " << std::string(10 - strlen(fuzz::name((fuzz::outcome)o)), ' ')
+			<< fuzz::name((fuzz::outcome)o);
+	std::cout << std::endl;
+	for (fuzz::target t : targets)
+	{
+		char line[160];
+		snprintf(line, sizeof(line), "  %-8s %12llu", fuzz::name(t), (unsigned long long)total.trials[t]);
+		std::cout << line;
+		for (int o = 0; o < fuzz::OutcomeCount; ++o)
+		{
+			snprintf(line, sizeof(line), " %10llu", (unsigned long long)total.outcomes[t][o]);
+			std::cout << line;
+			if (o != fuzz::Agree)
+				divergent += total.outcomes[t][o];
+		}
+		std::cout << std::endl;
+		trials += total.trials[t];
+	}
+	std::cout << "thoracle: " << trials << " trials in " << elapsed << " s ("
+		<< trials / elapsed << " trials/s), " << divergent << " divergent" << std::endl;
+
+	for (fuzz::target t : targets)
+	{
+		for (int o = 1; o < fuzz::OutcomeCount; ++o)
+		{
+			for (fuzz::trial& c : total.samples[t][o])
+				report(c, (fuzz::outcome)o, epsilon);
+		}
+	}
+
+	std::cout << "thoracle: throughput" << std::endl;
+	for (fuzz::target t : targets)
+	{
+		if (t == fuzz::Kernels)
+			benchmarkKernels(seed);
+		else
+			benchmark(t, seed, epsilon);
+	}
+	return divergent ? 2 : 0;
+}
@@ -0,0 +1,243 @@
+#include "planner_service.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include "model/entity.h"
+
+namespace
+{
+	// The service sleeps once no request arrived for this long; Sleep on Win32
+	// takes a whole scheduler tick, which is longer than a client waits
+	const auto IDLE_SPIN = std::chrono::milliseconds(50);
+	const auto IDLE_SLEEP = std::chrono::microseconds(200);
+}
+
+worker_pool::worker_pool(unsigned workers)
+{
+	for (unsigned i = 1; i < std::max(1u, workers); ++i)
+		threads.emplace_back(&worker_pool::work, this, i);
+}
+
+worker_pool::~worker_pool()
+{
+	{
+		std::lock_guard<std::mutex> l(m);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& t : threads)
+		t.join();
+}
+
+void worker_pool::run(size_t jobs, const std::function<void(size_t, unsigned)>& f)
+{
+	if (jobs == 0)
+		return;
+	{
+		std::lock_guard<std::mutex> l(m);
+		job = &f;
+		this->jobs = jobs;
+		next = 0;
+		// threads beyond the number of jobs have nothing to do
+		busy = (unsigned)std::min<size_t>(threads.size(), jobs - 1);
+		++generation;
+	}
+	if (busy > 0)
+		wake.notify_all();
+	drain(0);
+
+	std::unique_lock<std::mutex> l(m);
+	done.wait(l, [&] { return busy == 0; });
+	job = nullptr;
+}
+
+void worker_pool::drain(unsigned worker)
+{
+	for (size_t i = next.fetch_add(1); i < jobs; i = next.fetch_add(1))
+		(*job)(i, worker);
+}
+
+void worker_pool::work(unsigned worker)
+{
+	uint64_t seen = 0;
+	for (;;)
+	{
+		unsigned participants;
+		{
+			std::unique_lock<std::mutex> l(m);
+			wake.wait(l, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+			participants = (unsigned)std::min<size_t>(threads.size(), jobs - 1);
+		}
+		if (worker > participants)
+			continue;
+
+		drain(worker);
+		std::lock_guard<std::mutex> l(m);
+		if (--busy == 0)
+			done.notify_one();
+	}
+}
+
+planner_service::planner_service(planner::block& slots, unsigned workers)
+	: slots(slots),
+	pool(workers ? workers : std::max(1u, std::thread::hardware_concurrency())),
+	scratches(pool.size())
+{
+}
+
+size_t planner_service::poll()
+{
+	planner::header& h = slots.header();
+	h.heartbeat.fetch_add(1, std::memory_order_relaxed);
+
+	batch.clear();
+	for (uint32_t i = 0; i < slots.slotCount(); ++i)
+	{
+		planner::slot& s = slots.at(i);
+		uint32_t expected = planner::Requested;
+		if (s.state.load(std::memory_order_relaxed) == planner::Requested
+			&& s.state.compare_exchange_strong(expected, planner::Planning, std::memory_order_acquire))
+			batch.push_back(&s);
+	}
+	if (batch.empty())
+		return 0;
+
+	// the most urgent requests are taken first
+	std::sort(batch.begin(), batch.end(), [](const planner::slot* a, const planner::slot* b)
+	{
+		return a->req.deadline < b->req.deadline;
+	});
+
+	std::atomic<uint64_t> late{ 0 };
+	std::atomic<uint64_t> abandoned{ 0 };
+	const uint32_t size = (uint32_t)batch.size();
+	pool.run(batch.size(), [&](size_t job, unsigned worker)
+	{
+		planner::slot& s = *batch[job];
+		planner::response r;
+		scratch& w = scratches[worker];
+		plan(s.req, w.circles, w.boxes, w.times, r);
+		r.sequence = s.req.sequence;
+		r.batch = size;
+		const bool isLate = planner::now() > s.req.deadline;
+		s.resp = r;
+
+		// fails if the client disconnected meanwhile, the slot stays as it left it
+		uint32_t expected = planner::Planning;
+		if (!s.state.compare_exchange_strong(expected, planner::Answered, std::memory_order_release))
+			abandoned.fetch_add(1, std::memory_order_relaxed);
+		else if (isLate)
+			late.fetch_add(1, std::memory_order_relaxed);
+	});
+
+	const uint64_t answered = size - abandoned;
+	h.answered.fetch_add(answered, std::memory_order_relaxed);
+	h.late.fetch_add(late, std::memory_order_relaxed);
+	++counts.batches;
+	counts.answered += answered;
+	counts.late += late;
+	counts.abandoned += abandoned;
+	counts.largestBatch = std::max(counts.largestBatch, size);
+	return size;
+}
+
+void planner_service::run(const std::atomic<bool>& stop)
+{
+	using clock = std::chrono::steady_clock;
+	auto lastRequest = clock::now();
+	while (!stop.load(std::memory_order_relaxed))
+	{
+		if (poll() > 0)
+			lastRequest = clock::now();
+		else if (clock::now() - lastRequest > IDLE_SPIN)
+			std::this_thread::sleep_for(IDLE_SLEEP);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void planner_service::plan(const planner::request& r, kernels::columns& circles, kernels::columns& boxes,
+	std::vector<float>& times, planner::response& out)
+{
+	const th_recording::object_record& p = r.player;
+	const bool circlePlayer = p.shape == entity::Circle;
+	const vec2 center(p.x, p.y);
+	const vec2 size(p.w, p.h);
+	const vec2 corner = center - size / 2;
+	const float radius = p.w / 2;
+
+	circles.clear();
+	boxes.clear();
+	const uint32_t count = std::min(r.objectCount, planner::MAX_OBJECTS);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const th_recording::object_record& o = r.objects[i];
+		const vec2 extent(o.w, o.h);
+		if (circlePlayer && o.shape == entity::Circle)
+			circles.addCircle(vec2(o.x, o.y), o.w / 2, vec2(o.vx, o.vy));
+		else
+			boxes.addBox(vec2(o.x, o.y) - extent / 2, extent, vec2(o.vx, o.vy));
+	}
+	times.resize(std::max(circles.size(), boxes.size()));
+
+	const int moves = std::min((int)r.moves, planner::MAX_MOVES);
+	const kernels::predictor predictor = r.predictor == kernels::Discrete ? kernels::Discrete : kernels::Continuous;
+	std::fill_n(out.ticks, planner::MAX_MOVES, FLT_MAX);
+
+	// Obstacle collision frame calculations
+	bool bounded = true;
+	for (int dir = 0; dir < moves; ++dir)
+	{
+		const vec2 vel(r.velocity[dir][0], r.velocity[dir][1]);
+		float t = FLT_MAX;
+		if (circles.size() > 0)
+		{
+			kernels::circles(center, radius, vel, circles, times.data(), r.horizon, predictor);
+			const float c = kernels::earliest(times.data(), circles.size());
+			if (c >= 0)
+				t = c;
+		}
+		if (boxes.size() > 0)
+		{
+			kernels::boxes(corner, size, vel, boxes, times.data(), r.horizon, predictor);
+			const float b = kernels::earliest(times.data(), boxes.size());
+			if (b >= 0)
+				t = std::min(t, b);
+		}
+		if (t <= r.horizon)
+		{
+			out.ticks[dir] = t;
+			bounded = false;
+		}
+	}
+
+	// Wall collision frame calculations
+	const vec2 bounds(r.width, r.height);
+	for (int dir = 1; dir < moves; ++dir)
+	{
+		const vec2 vel(r.velocity[dir][0], r.velocity[dir][1]);
+		const float t = vec2::willExitAABB(vec2(), corner, bounds, size, vec2(), vel);
+		if (t >= 0 && t < out.ticks[dir])
+			out.ticks[dir] = t;
+	}
+
+	// Direction with maximum frames until collision, as th_vo_algo without a
+	// target: holding position only if no obstacle threatens the player
+	int best = bounded || moves < 2 ? 0 : 1;
+	for (int dir = 1; dir < moves; ++dir)
+	{
+		if (out.ticks[dir] != FLT_MAX && out.ticks[dir] > out.ticks[best])
+			best = dir;
+	}
+
+	out.move = best;
+	out.risk = out.ticks[best];
+	// deathbomb if the player collides within the next frame
+	out.bomb = out.risk < 0.5f;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ipc/planner_slots.h"
+#include "util/kernels.h"
+
+/**
+ * \brief Threads which run the jobs of one batch at a time.
+ *
+ * The threads stay alive between batches, since starting threads would take
+ * longer than planning a small batch. The caller of run() works on the batch
+ * as well, so a pool of one worker has no threads.
+ */
+class worker_pool
+{
+public:
+	/**
+	 * \param workers Workers including the caller of run(), at least 1
+	 */
+	explicit worker_pool(unsigned workers);
+	~worker_pool();
+
+	worker_pool(const worker_pool& other) = delete;
+	worker_pool& operator=(const worker_pool& other) = delete;
+
+	/**
+	 * \brief Run jobs on all workers and wait for them
+	 * \param jobs Number of jobs
+	 * \param f Called once per job with the job and the index of the worker
+	 */
+	void run(size_t jobs, const std::function<void(size_t job, unsigned worker)>& f);
+
+	unsigned size() const { return (unsigned)threads.size() + 1; }
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex m;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(size_t, unsigned)>* job = nullptr;
+	size_t jobs = 0;
+	std::atomic<size_t> next{ 0 };
+	// Threads still working on the current batch
+	unsigned busy = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+
+	void work(unsigned worker);
+	void drain(unsigned worker);
+};
+
+/**
+ * \brief Plans the requests of all clients of a block of planner slots.
+ *
+ * Every poll takes all pending requests as one batch, ordered by deadline,
+ * and plans one request per job on the worker pool. A request is planned
+ * like th_vo_algo decides without targets: for every candidate move, the
+ * frames until the player collides with an obstacle are predicted with the
+ * batch kernels, or until the player leaves the game area. The move which
+ * collides last wins; holding position only if nothing threatens the player.
+ *
+ * The kernels predict boxes against boxes and circles against circles. A
+ * circle player is predicted against circle obstacles as it is, and against
+ * the bounding boxes of any other obstacles with its own bounding box; a box
+ * player against the bounding boxes of all obstacles. Lasers at an angle are
+ * therefore much larger than they are, which errs on the safe side.
+ */
+class planner_service
+{
+public:
+	struct totals
+	{
+		uint64_t batches = 0;
+		uint64_t answered = 0;
+		// Answered after the client's deadline
+		uint64_t late = 0;
+		// Requests of clients which disconnected while they were planned
+		uint64_t abandoned = 0;
+		uint32_t largestBatch = 0;
+	};
+
+	/**
+	 * \param slots Block created by the caller
+	 * \param workers Workers planning requests, 0 for all hardware threads
+	 */
+	planner_service(planner::block& slots, unsigned workers);
+
+	/**
+	 * \brief Plan all pending requests
+	 * \return Number of requests taken
+	 */
+	size_t poll();
+
+	/**
+	 * \brief Poll until stopped, spinning while requests arrive and sleeping
+	 * a little while there are none
+	 */
+	void run(const std::atomic<bool>& stop);
+
+	const totals& stats() const { return counts; }
+	unsigned workers() const { return pool.size(); }
+
+	/**
+	 * \brief Plan one request
+	 * \param r The request
+	 * \param circles Scratch columns of circle obstacles
+	 * \param boxes Scratch columns of box obstacles
+	 * \param times Scratch output of the kernels
+	 * \param out Response to fill, except for its sequence and batch
+	 */
+	static void plan(const planner::request& r, kernels::columns& circles, kernels::columns& boxes,
+		std::vector<float>& times, planner::response& out);
+
+private:
+	struct scratch
+	{
+		kernels::columns circles, boxes;
+		std::vector<float> times;
+	};
+
+	planner::block& slots;
+	worker_pool pool;
+	std::vector<scratch> scratches;
+	std::vector<planner::slot*> batch;
+	totals counts;
+};
@@ -0,0 +1,378 @@
+// Planner service for several twinhook instances, and a load test of it with simulated clients
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config/th_config.h"
+#include "control/movement.h"
+#include "ipc/planner_slots.h"
+#include "ipc/telemetry_collector.h"
+#include "sim/danmaku.h"
+#include "planner_service.h"
+
+using clock_type = std::chrono::steady_clock;
+
+static const double DEFAULT_SECONDS = 10;
+static const double DEFAULT_INTERVAL = 1;
+static const double DEFAULT_RATE = 60;
+static const float DEFAULT_DENSITY = 500;
+static const int DEFAULT_DEADLINE_US = 2000;
+// Player of the simulated clients, a hit circle with the speeds of a typical shot type
+static const float SIM_RADIUS = 2.f;
+static const float SIM_SPEED = 4.5f;
+static const float SIM_FOCUSED_SPEED = 2.f;
+// Frames the planner looks ahead for the simulated clients, as VO_HORIZON
+static const float SIM_HORIZON = 600.f;
+// Latencies kept per client
+static const size_t LATENCY_SAMPLES = 1 << 20;
+// Milliseconds between checks for interrupts
+static const int POLL_MS = 50;
+
+struct options
+{
+	std::string name = planner::DEFAULT_NAME;
+	uint32_t slots = planner::DEFAULT_SLOTS;
+	unsigned workers = 0;
+	unsigned clients = 0;
+	bool service = true;
+	double seconds = DEFAULT_SECONDS;
+	double interval = DEFAULT_INTERVAL;
+	double rate = DEFAULT_RATE;
+	float density = DEFAULT_DENSITY;
+	bool lasers = false;
+	int deadlineUs = DEFAULT_DEADLINE_US;
+	kernels::predictor predictor = kernels::Continuous;
+	uint64_t seed = 1;
+};
+
+struct client_report
+{
+	bool connected = false;
+	uint64_t ticks = 0;
+	uint64_t answered = 0;
+	// Requests not answered by their deadline
+	uint64_t missed = 0;
+	// Ticks without a request, as the slot was still being planned or the service was gone
+	uint64_t skipped = 0;
+	// Ticks on which the player touched an obstacle
+	uint64_t contacts = 0;
+	uint64_t objects = 0;
+	// Microseconds from publishing a request to reading its response
+	std::vector<float> latency;
+};
+
+static std::atomic<bool> interrupted{ false };
+
+static void onSignal(int)
+{
+	interrupted = true;
+}
+
+static double secondsSince(clock_type::time_point start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// Whether the player circle overlaps an obstacle, approximated as the planner does
+static bool touches(const vec2& center, const th_recording::object_record& o)
+{
+	if (o.shape == entity::Circle)
+		return (vec2(o.x, o.y) - center).len() < SIM_RADIUS + o.w / 2;
+	return std::abs(o.x - center.x) < SIM_RADIUS + o.w / 2
+		&& std::abs(o.y - center.y) < SIM_RADIUS + o.h / 2;
+}
+
+/**
+ * \brief A field like danmaku::field::mixed, without lasers unless asked for:
+ * the planner only sees their bounding boxes, which cover the player for most
+ * of their lifetime and would dominate the contacts
+ */
+static danmaku::field simulatedField(const vec2& size, uint64_t seed, float density, bool lasers)
+{
+	if (lasers)
+		return danmaku::field::mixed(size, seed, density);
+
+	danmaku::field f(size, seed);
+	const float share = density / (danmaku::ArchetypeCount - 2);
+	for (int i = 0; i < danmaku::ArchetypeCount; ++i)
+	{
+		const danmaku::archetype type = (danmaku::archetype)i;
+		if (type == danmaku::StaticLaser || type == danmaku::RotatingLaser)
+			continue;
+		const vec2 origin = type == danmaku::Wall ? vec2(size.x / 2, 0)
+			: vec2(size.x * (i + 1) / (danmaku::ArchetypeCount + 1), size.y / 5);
+		f.add(danmaku::preset(type, origin, share, size));
+	}
+	return f;
+}
+
+/**
+ * \brief One simulated bot: a field of danmaku, and a player moved by the planner
+ */
+static void simulate(const options& o, unsigned index, const std::atomic<bool>& stop, client_report& out)
+{
+	planner::client c;
+	out.connected = c.connect(o.name);
+	if (!out.connected)
+		return;
+	out.latency.reserve(std::min<size_t>(LATENCY_SAMPLES, (size_t)(o.seconds * o.rate) + 1));
+
+	const vec2 fieldSize(th_param.GAME_WIDTH, th_param.GAME_HEIGHT);
+	danmaku::field f = simulatedField(fieldSize, o.seed + index, o.density, o.lasers);
+	vec2 position(fieldSize.x / 2, fieldSize.y * 7 / 8);
+	std::vector<bullet> bullets;
+	std::vector<laser> lasers;
+	std::vector<th_recording::object_record> objects;
+
+	const auto period = std::chrono::duration_cast<clock_type::duration>(
+		std::chrono::duration<double>(o.rate > 0 ? 1 / o.rate : 0));
+	auto next = clock_type::now();
+	while (!stop.load(std::memory_order_relaxed))
+	{
+		f.tick(position);
+		bullets.clear();
+		lasers.clear();
+		f.collect(bullets, lasers);
+		objects.clear();
+		for (const bullet& b : bullets)
+			objects.push_back(th_recording::encode(b, 0));
+		for (const laser& l : lasers)
+			objects.push_back(th_recording::encode(l, 0));
+		++out.ticks;
+		out.objects += objects.size();
+
+		vec2 velocity;
+		if (planner::request* r = c.begin())
+		{
+			r->gameTick = f.elapsed();
+			r->horizon = SIM_HORIZON;
+			r->predictor = o.predictor;
+			r->width = fieldSize.x;
+			r->height = fieldSize.y;
+			r->moves = control::Movement::MaxValue;
+			for (int dir = 0; dir < control::Movement::MaxValue; ++dir)
+			{
+				const vec2 v = control::kMovementVelocity[dir]
+					* (control::kMovementFocused[dir] ? SIM_FOCUSED_SPEED : SIM_SPEED);
+				r->velocity[dir][0] = v.x;
+				r->velocity[dir][1] = v.y;
+			}
+			r->player = {};
+			r->player.x = position.x;
+			r->player.y = position.y;
+			r->player.w = r->player.h = 2 * SIM_RADIUS;
+			r->player.shape = entity::Circle;
+			r->objectCount = (uint32_t)std::min<size_t>(objects.size(), planner::MAX_OBJECTS);
+			std::copy_n(objects.begin(), r->objectCount, r->objects);
+
+			const int64_t published = planner::now();
+			r->deadline = published + o.deadlineUs;
+			c.submit();
+			planner::response resp;
+			if (c.wait(resp))
+			{
+				++out.answered;
+				if (out.latency.size() < LATENCY_SAMPLES)
+					out.latency.push_back((float)(planner::now() - published));
+				velocity = control::kMovementVelocity[resp.move]
+					* (control::kMovementFocused[resp.move] ? SIM_FOCUSED_SPEED : SIM_SPEED);
+			}
+			else
+			{
+				++out.missed;
+			}
+		}
+		else
+		{
+			++out.skipped;
+		}
+
+		// the player holds position without an answer
+		position += velocity;
+		position.x = std::min(std::max(position.x, SIM_RADIUS), fieldSize.x - SIM_RADIUS);
+		position.y = std::min(std::max(position.y, SIM_RADIUS), fieldSize.y - SIM_RADIUS);
+		for (th_recording::object_record& obj : objects)
+		{
+			obj.x += obj.vx;
+			obj.y += obj.vy;
+			if (touches(position, obj))
+			{
+				++out.contacts;
+				break;
+			}
+		}
+
+		if (o.rate > 0)
+		{
+			next += period;
+			std::this_thread::sleep_until(next);
+		}
+	}
+}
+
+static void printService(const planner_service& service)
+{
+	const auto& s = service.stats();
+	char line[200];
+	snprintf(line, sizeof(line), "  service: %llu answered in %llu batches (%.2f per batch, largest %u), "
+		"%llu late, %llu abandoned",
+		(unsigned long long)s.answered, (unsigned long long)s.batches,
+		s.batches ? (double)s.answered / s.batches : 0., s.largestBatch,
+		(unsigned long long)s.late, (unsigned long long)s.abandoned);
+	std::cout << line << std::endl;
+}
+
+static void printClients(const std::vector<client_report>& reports, double elapsed)
+{
+	client_report total;
+	rolling_percentiles latency(LATENCY_SAMPLES);
+	unsigned connected = 0;
+	for (const client_report& r : reports)
+	{
+		connected += r.connected;
+		total.ticks += r.ticks;
+		total.answered += r.answered;
+		total.missed += r.missed;
+		total.skipped += r.skipped;
+		total.contacts += r.contacts;
+		total.objects += r.objects;
+		for (float l : r.latency)
+			latency.add(l);
+	}
+
+	char line[200];
+	snprintf(line, sizeof(line), "  clients: %u of %u connected, %llu ticks (%.0f/s), %.0f objects per tick",
+		connected, (unsigned)reports.size(), (unsigned long long)total.ticks, total.ticks / elapsed,
+		total.ticks ? (double)total.objects / total.ticks : 0.);
+	std::cout << line << std::endl;
+	snprintf(line, sizeof(line), "  requests: %llu answered, %llu missed the deadline, %llu skipped, %llu contacts",
+		(unsigned long long)total.answered, (unsigned long long)total.missed,
+		(unsigned long long)total.skipped, (unsigned long long)total.contacts);
+	std::cout << line << std::endl;
+	snprintf(line, sizeof(line), "  latency us: p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  max %.0f",
+		latency.percentile(50), latency.percentile(90), latency.percentile(99),
+		latency.percentile(99.9f), latency.percentile(100));
+	std::cout << line << std::endl;
+}
+
+int main(const int argc, const char* argv[])
+{
+	options o;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			o.slots = (uint32_t)std::stoul(argv[++i]);
+		else if (arg == "-j" && i + 1 < argc)
+			o.workers = (unsigned)std::stoul(argv[++i]);
+		else if (arg == "-c" && i + 1 < argc)
+			o.clients = (unsigned)std::stoul(argv[++i]);
+		else if (arg == "-x")
+			o.service = false;
+		else if (arg == "-t" && i + 1 < argc)
+			o.seconds = std::stod(argv[++i]);
+		else if (arg == "-i" && i + 1 < argc)
+			o.interval = std::stod(argv[++i]);
+		else if (arg == "-r" && i + 1 < argc)
+			o.rate = std::stod(argv[++i]);
+		else if (arg == "-d" && i + 1 < argc)
+			o.density = std::stof(argv[++i]);
+		else if (arg == "-l")
+			o.lasers = true;
+		else if (arg == "-D" && i + 1 < argc)
+			o.deadlineUs = std::stoi(argv[++i]);
+		else if (arg == "-p" && i + 1 < argc && kernels::parse(argv[i + 1], o.predictor))
+			++i;
+		else if (arg == "-s" && i + 1 < argc)
+			o.seed = std::stoull(argv[++i]);
+		else if (arg[0] != '-')
+			o.name = arg;
+		else
+		{
+			std::cerr << "usage: thplanner [name] [-n slots] [-j workers] [-i seconds]\n"
+				"       thplanner [name] -c clients [-x] [-t seconds] [-r ticks/s] [-d bullets] "
+				"[-l] [-D deadline us] [-p continuous|discrete] [-s seed]" << std::endl;
+			return 1;
+		}
+	}
+	if (!o.service && o.clients == 0)
+	{
+		std::cerr << "thplanner: -x needs simulated clients (-c)" << std::endl;
+		return 1;
+	}
+
+	planner::block slots;
+	std::unique_ptr<planner_service> service;
+	std::atomic<bool> stopService{ false };
+	std::thread serviceThread;
+	if (o.service)
+	{
+		if (!slots.create(o.name, o.slots))
+		{
+			std::cerr << "thplanner: could not create planner '" << o.name << "', is a service "
+				"running under this name? Simulated clients use it with -x" << std::endl;
+			return 1;
+		}
+		service = std::make_unique<planner_service>(slots, o.workers);
+		std::cout << "thplanner: planner '" << o.name << "' with " << o.slots << " slots, "
+			<< service->workers() << " workers, " << kernels::name(kernels::detect()) << " kernels" << std::endl;
+		serviceThread = std::thread([&] { service->run(stopService); });
+	}
+
+	// interrupted services remove their block, so clients do not claim a dead one
+	std::signal(SIGINT, onSignal);
+	std::signal(SIGTERM, onSignal);
+
+	if (o.clients == 0)
+	{
+		auto next = clock_type::now();
+		const auto period = std::chrono::duration_cast<clock_type::duration>(
+			std::chrono::duration<double>(o.interval));
+		while (!interrupted)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+			if (clock_type::now() >= next + period)
+			{
+				next += period;
+				printService(*service);
+			}
+		}
+		stopService = true;
+		serviceThread.join();
+		printService(*service);
+		return 0;
+	}
+
+	std::cout << "thplanner: " << o.clients << " simulated clients, " << o.rate << " ticks/s, "
+		<< o.density << " bullets, " << kernels::name(o.predictor) << " predictor, "
+		<< o.deadlineUs << " us deadline, " << o.seconds << " s" << std::endl;
+	const auto start = clock_type::now();
+	std::atomic<bool> stopClients{ false };
+	std::vector<client_report> reports(o.clients);
+	std::vector<std::thread> clients;
+	for (unsigned i = 0; i < o.clients; ++i)
+		clients.emplace_back(simulate, std::cref(o), i, std::cref(stopClients), std::ref(reports[i]));
+	while (!interrupted && secondsSince(start) < o.seconds)
+		std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+	stopClients = true;
+	for (auto& c : clients)
+		c.join();
+	const double elapsed = secondsSince(start);
+
+	printClients(reports, elapsed);
+	if (service)
+	{
+		stopService = true;
+		serviceThread.join();
+		printService(*service);
+	}
+	return 0;
+}
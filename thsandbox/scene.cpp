@@ -1,5 +1,7 @@
 #include "scene.h"
 
+#include <cmath>
+
 
 
 scene::scene()
@@ -48,79 +50,288 @@ static void draw_circle(SDL_Renderer *renderer, int _x, int _y, int radius)
 	}
 }
 
-static void draw_entity(SDL_Renderer *renderer,
-	const std::shared_ptr<entity> &e)
+static void draw_entity(SDL_Renderer *renderer, const entity &e)
 {
-	switch (e->type)
+	switch (e.type)
 	{
 	case entity::Circle: {
-		auto a = std::dynamic_pointer_cast<circle>(e);
-		draw_circle(renderer, a->center.x, a->center.y, a->radius);
+		const auto& a = static_cast<const circle&>(e);
+		draw_circle(renderer, a.center.x, a.center.y, a.radius);
 		break;
 	}
 	case entity::AABB: {
-		auto a = std::dynamic_pointer_cast<aabb>(e);
-		SDL_Rect outlineRect = { (int)a->position.x, (int)a->position.y,
-			(int)a->size.w,(int)a->size.h };
+		const auto& a = static_cast<const aabb&>(e);
+		SDL_Rect outlineRect = { (int)a.position.x, (int)a.position.y,
+			(int)a.size.w,(int)a.size.h };
 		SDL_RenderDrawRect(renderer, &outlineRect);
 		break;
 	}
 	case entity::Polygon: {
-		auto a = std::dynamic_pointer_cast<polygon>(e);
-		for (size_t i = 0; i < a->points.size(); i++)
+		const auto& a = static_cast<const polygon&>(e);
+		for (size_t i = 0; i < a.points.size(); i++)
 		{
-			vec2 p1 = a->points[i];
-			vec2 p2 = a->points[(i + a->points.size() + 1) % a->points.size()];
+			vec2 p1 = a.points[i];
+			vec2 p2 = a.points[(i + a.points.size() + 1) % a.points.size()];
 			SDL_RenderDrawLine(renderer, (int)p1.x, (int)p1.y, (int)p2.x, (int)p2.y);
 		}
 		break;
 	}
+	case entity::CapsuleChain: {
+		const auto& a = static_cast<const capsule_chain&>(e);
+		const auto& pts = a.getPoints();
+		for (size_t i = 1; i < pts.size(); i++)
+		{
+			SDL_RenderDrawLine(renderer, (int)pts[i - 1].x, (int)pts[i - 1].y,
+				(int)pts[i].x, (int)pts[i].y);
+		}
+		break;
+	}
+	}
+}
+
+uint32_t scene::add(std::shared_ptr<entity> e)
+{
+	uint32_t i;
+	if (!freeIndices.empty())
+	{
+		i = freeIndices.back();
+		freeIndices.pop_back();
 	}
+	else
+	{
+		i = (uint32_t)entities.size();
+		entities.emplace_back();
+		bodies.emplace_back();
+		// sorted into place by the next collide()
+		order.push_back({ 0.f, 0.f, 0.f, 0.f, i });
+	}
+	set(i, std::move(e));
+	return i;
+}
+
+void scene::set(uint32_t i, std::shared_ptr<entity> e)
+{
+	// predictions made up to now are stale from the next tick on
+	const auto box = e->boundingBox();
+	bodies[i] = { box->position, box->position + box->size, e->velocity, frame + 1 };
+
+	// a rotating box may reach anywhere around its pivot within the horizon
+	const auto r = e->type == entity::Polygon ? dynamic_cast<const obb*>(e.get()) : nullptr;
+	if (r && r->isRotating())
+	{
+		const float reach = std::max(r->length, r->lengthAt(horizon)) + r->radius;
+		bodies[i].min = r->position - vec2(reach);
+		bodies[i].max = r->position + vec2(reach);
+	}
+	entities[i] = std::move(e);
+}
+
+void scene::remove(uint32_t i)
+{
+	entities[i].reset();
+	if (i < pairCache.size())
+		pairCache[i].clear();
+	freeIndices.push_back(i);
+}
+
+void scene::clear()
+{
+	entities.clear();
+	bodies.clear();
+	freeIndices.clear();
+	order.clear();
+	pairCache.clear();
+	nextPairs.clear();
+	hits.clear();
 }
+
 void scene::render(SDL_Renderer *renderer)
 {
 	SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-	for (auto e : entities)
-		draw_entity(renderer, e);
+	for (const auto& e : entities)
+	{
+		if (e)
+			draw_entity(renderer, *e);
+	}
 
+	for (const hit& h : hits)
+	{
+		const auto& e1 = entities[h.a];
+		const auto& e2 = entities[h.b];
+		if (!e1 || !e2)
+			continue;
+		auto et1 = e1->translate(e1->velocity * h.t);
+		auto et2 = e2->translate(e2->velocity * h.t);
+		if (h.t == 0)
+			SDL_SetRenderDrawColor(renderer, 0xFF, 0x40, 0x40, 0xFF);
+		else
+			SDL_SetRenderDrawColor(renderer, 0x40, 0x40, 0x40, 0xFF);
+		draw_entity(renderer, *et1);
+		draw_entity(renderer, *et2);
+		SDL_SetRenderDrawColor(renderer, 0x80, 0xFF, 0x80, 0xFF);
+		auto c1 = e1->com();
+		auto c2 = e2->com();
+		SDL_RenderDrawLine(renderer, (int)c1.x, (int)c1.y,
+			(int)c2.x, (int)c2.y);
+		SDL_SetRenderDrawColor(renderer, 0x30, 0x30, 0x30, 0xFF);
+		auto ct1 = et1->com();
+		auto ct2 = et2->com();
+		SDL_RenderDrawLine(renderer, (int)c1.x, (int)c1.y,
+			(int)ct1.x, (int)ct1.y);
+		SDL_RenderDrawLine(renderer, (int)c2.x, (int)c2.y,
+			(int)ct2.x, (int)ct2.y);
+	}
+}
+
+void scene::tick()
+{
+	++frame;
+	const bool wrap = bounds.x > 0 && bounds.y > 0;
 	for (size_t i = 0; i < entities.size(); ++i)
 	{
-		for (size_t j = i + 1; j < entities.size(); ++j)
+		if (!entities[i])
+			continue;
+		body& b = bodies[i];
+		vec2 delta = b.velocity;
+
+		// entities which left the area entirely reenter at the opposite edge
+		if (wrap)
 		{
-			auto e1 = entities[i];
-			auto e2 = entities[j];
-			float t = e1->willCollideWith(*e2);
-			if (t >= 0)
+			vec2 jump;
+			if (b.max.x + delta.x < 0)
+				jump.x = bounds.x - b.min.x - delta.x;
+			else if (b.min.x + delta.x > bounds.x)
+				jump.x = -b.max.x - delta.x;
+			if (b.max.y + delta.y < 0)
+				jump.y = bounds.y - b.min.y - delta.y;
+			else if (b.min.y + delta.y > bounds.y)
+				jump.y = -b.max.y - delta.y;
+			if (jump.x != 0 || jump.y != 0)
 			{
-				auto et1 = e1->translate(e1->velocity * t);
-				auto et2 = e2->translate(e2->velocity * t);
-				if (t == 0)
-					SDL_SetRenderDrawColor(renderer, 0xFF, 0x40, 0x40, 0xFF);
-				else
-					SDL_SetRenderDrawColor(renderer, 0x40, 0x40, 0x40, 0xFF);
-				draw_entity(renderer, et1);
-				draw_entity(renderer, et2);
-				SDL_SetRenderDrawColor(renderer, 0x80, 0xFF, 0x80, 0xFF);
-				auto c1 = e1->com();
-				auto c2 = e2->com();
-				SDL_RenderDrawLine(renderer, (int)c1.x, (int)c1.y,
-					(int)c2.x, (int)c2.y);
-				SDL_SetRenderDrawColor(renderer, 0x30, 0x30, 0x30, 0xFF);
-				auto ct1 = et1->com();
-				auto ct2 = et2->com();
-				SDL_RenderDrawLine(renderer, (int)c1.x, (int)c1.y,
-					(int)ct1.x, (int)ct1.y);
-				SDL_RenderDrawLine(renderer, (int)c2.x, (int)c2.y,
-					(int)ct2.x, (int)ct2.y);
+				delta += jump;
+				b.changed = frame;
 			}
 		}
+
+		b.min += delta;
+		b.max += delta;
+		entities[i]->move(delta);
 	}
 }
 
-void scene::tick()
+// Frames a cached time of collision may differ from a fresh one by
+static const float CACHE_TOLERANCE = 1e-3f;
+
+float scene::predict(uint32_t a, uint32_t b, const std::vector<cached_pair>& cached, size_t& cursor)
 {
-	std::vector<std::shared_ptr<entity>> newEntities;
-	for (const auto& e : entities)
-		newEntities.push_back(e->translate(e->velocity));
-	entities = newEntities;
+	if (!cachePairs)
+	{
+		++predictions;
+		return entities[a]->willCollideWith(*entities[b]);
+	}
+
+	// candidates are mostly found in the same order as on the previous tick
+	const cached_pair* c = nullptr;
+	if (cursor < cached.size() && cached[cursor].other == b)
+		c = &cached[cursor++];
+	else
+	{
+		for (size_t i = 0; i < cached.size(); ++i)
+		{
+			if (cached[i].other == b)
+			{
+				c = &cached[i];
+				cursor = i + 1;
+				break;
+			}
+		}
+	}
+
+	// both entities moved linearly since the prediction, so it only counts down
+	if (c && c->predicted >= bodies[a].changed && c->predicted >= bodies[b].changed)
+	{
+		const float t = c->t < 0 ? -1 : c->t - (frame - c->predicted);
+		// pairs about to collide may touch, graze or separate, predict them again
+		if (c->t < 0 || t >= 1)
+		{
+			nextPairs.push_back(*c);
+			if (checkCache)
+			{
+				const float fresh = entities[a]->willCollideWith(*entities[b]);
+				const bool hit = t >= 0 && t <= horizon;
+				if (hit != (fresh >= 0 && fresh <= horizon)
+					|| (hit && std::abs(fresh - t) > CACHE_TOLERANCE))
+					++divergent;
+			}
+			return t;
+		}
+	}
+
+	++predictions;
+	const float t = entities[a]->willCollideWith(*entities[b]);
+	nextPairs.push_back({ b, frame, t });
+	return t;
+}
+
+void scene::collide()
+{
+	hits.clear();
+	candidates = 0;
+	predictions = 0;
+	divergent = 0;
+
+	// the order barely changes between ticks, so insertion sort is close to linear
+	for (endpoint& e : order)
+	{
+		// free indices sort to the end and overlap nothing
+		if (!entities[e.index])
+		{
+			e.minX = e.minY = FLT_MAX;
+			e.maxX = e.maxY = -FLT_MAX;
+			continue;
+		}
+		const body& b = bodies[e.index];
+		const vec2 sweep = b.velocity * horizon;
+		e.minX = b.min.x + std::min(0.f, sweep.x);
+		e.maxX = b.max.x + std::max(0.f, sweep.x);
+		e.minY = b.min.y + std::min(0.f, sweep.y);
+		e.maxY = b.max.y + std::max(0.f, sweep.y);
+	}
+	for (size_t i = 1; i < order.size(); ++i)
+	{
+		const endpoint e = order[i];
+		size_t j = i;
+		for (; j > 0 && order[j - 1].minX > e.minX; --j)
+			order[j] = order[j - 1];
+		order[j] = e;
+	}
+
+	pairCache.resize(entities.size());
+	if (!cachePairs)
+	{
+		for (auto& c : pairCache)
+			c.clear();
+	}
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const endpoint& ea = order[i];
+		const uint32_t a = ea.index;
+
+		// pairs which are no longer candidates are dropped from the cache
+		nextPairs.clear();
+		size_t cursor = 0;
+		for (size_t j = i + 1; j < order.size() && order[j].minX <= ea.maxX; ++j)
+		{
+			const endpoint& eb = order[j];
+			if (eb.maxY < ea.minY || eb.minY > ea.maxY)
+				continue;
+
+			++candidates;
+			const uint32_t b = eb.index;
+			const float t = predict(a, b, pairCache[a], cursor);
+			if (t >= 0 && t <= horizon)
+				hits.push_back({ a, b, t });
+		}
+		pairCache[a].swap(nextPairs);
+	}
 }
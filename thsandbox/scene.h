@@ -1,17 +1,140 @@
 #pragma once
 #include <SDL.h>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include "model/object.h"
 
+/**
+ * \brief Entities moving linearly, with every pair which will collide within the
+ * horizon found each tick.
+ *
+ * Pairs are found by sweep and prune: the x intervals swept by the bounding
+ * boxes over the horizon are kept sorted by an insertion sort, which is close
+ * to linear since the order barely changes between ticks, and only pairs whose
+ * swept boxes overlap are given to the collision predictors. The work is
+ * proportional to those pairs, so with more entities in the same area it
+ * grows with the square of their number, as the hits do.
+ *
+ * With cachePairs, predictions are reused across ticks: as entities move
+ * linearly, a time of collision only counts down, so a prediction is kept per
+ * pair until the pair is no longer a candidate or is about to collide. The
+ * predictors round differently at every position though, so a fresh
+ * prediction may find another time or no collision at all, and results with
+ * the cache differ from those without; checkCache measures by how much.
+ * Entities which accelerate, turn or change shape are set() again after they
+ * changed, which only voids their own predictions.
+ */
 class scene
 {
 public:
+	struct hit
+	{
+		uint32_t a, b;
+		// Frames until collision
+		float t;
+	};
+
+	// By index, nullptr for removed entities whose index is free
 	std::vector<std::shared_ptr<entity>> entities;
+	// Pairs colliding within the horizon, found by collide()
+	std::vector<hit> hits;
+
+	// Frames to look ahead for collisions
+	float horizon = 600.f;
+	// Entities which leave this area wrap around to the other side
+	vec2 bounds;
+	// Reuse predictions of earlier ticks, which is faster but not exact
+	bool cachePairs = false;
+	// Also predict the pairs whose cached prediction is reused, and count
+	// those which differ in divergent
+	bool checkCache = false;
+
+	// Statistics of the last collide()
+	size_t candidates = 0;
+	size_t predictions = 0;
+	// Pairs whose cached prediction differs from a fresh one, if checkCache
+	size_t divergent = 0;
 
 	scene();
 	~scene();
 
+	/**
+	 * \brief Add an entity, which keeps its index for its lifetime
+	 * \param e The entity
+	 * \return Index of the entity
+	 */
+	uint32_t add(std::shared_ptr<entity> e);
+	/**
+	 * \brief Replace an entity whose velocity or shape changed other than by
+	 * tick(), between collide() and the next tick()
+	 * \param i Index of the entity
+	 * \param e The changed entity, which may be the same object
+	 */
+	void set(uint32_t i, std::shared_ptr<entity> e);
+	void remove(uint32_t i);
+	void clear();
+	size_t size() const { return entities.size() - freeIndices.size(); }
+
 	void render(SDL_Renderer *renderer);
+	/**
+	 * \brief Advance all entities by their velocity, in place
+	 */
 	void tick();
-};
+	/**
+	 * \brief Find the pairs colliding within the horizon
+	 */
+	void collide();
+
+private:
+	struct body
+	{
+		// Bounding box at the current tick, or the area a rotating box can reach
+		// within the horizon
+		vec2 min, max;
+		// Velocity of the entity when last set, which is assumed to stay constant
+		vec2 velocity;
+		// First tick after the entity last changed or wrapped around, predictions
+		// made before it are stale
+		uint32_t changed;
+	};
 
+	struct cached_pair
+	{
+		// Index of the other entity
+		uint32_t other;
+		// Tick the prediction was made on
+		uint32_t predicted;
+		// Frames until collision when predicted, or -1
+		float t;
+	};
+
+	// Box swept over the horizon, kept next to the sort key for the sweep
+	struct endpoint
+	{
+		float minX, maxX, minY, maxY;
+		uint32_t index;
+	};
+
+	std::vector<body> bodies;
+	std::vector<uint32_t> freeIndices;
+	// Entities sorted by the lower end of their swept x interval
+	std::vector<endpoint> order;
+	// Predictions by the entity first in the sweep, in the order its candidates
+	// were found, which rarely changes between ticks
+	std::vector<std::vector<cached_pair>> pairCache;
+	std::vector<cached_pair> nextPairs;
+	uint32_t frame = 0;
+
+
+	/**
+	 * \brief Predict the collision of a candidate pair, reusing the prediction of
+	 * the previous tick if there is one and cachePairs is set
+	 * \param a Entity first in the sweep
+	 * \param b The other entity
+	 * \param cached Predictions of a from the previous tick
+	 * \param cursor Position in cached where the pair is expected
+	 * \return Frames until collision, or -1
+	 */
+	float predict(uint32_t a, uint32_t b, const std::vector<cached_pair>& cached, size_t& cursor);
+};
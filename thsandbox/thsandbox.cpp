@@ -4,8 +4,12 @@
 #include <util/vec2.h>
 #include "scene.h"
 #include "model/object.h"
+#include "sim/danmaku.h"
+#include <chrono>
+#include <cmath>
 #include <ctime>
 #include <iostream>
+#include <map>
 #include <string>
 
 const int SCREEN_WIDTH = 1280;
@@ -42,19 +46,102 @@ std::shared_ptr<obb> randomobb()
 
 scene sc;
 
+// Frames to look ahead in benchmark scenes, short enough for the swept
+// intervals to stay narrow
+const float BENCHMARK_HORIZON = 30.f;
+// Frames averaged per collision time sample
+const int SAMPLE_FRAMES = 60;
+
+// Bullets kept alive by the benchmark patterns, changed with the arrow keys, or 0
+// for the demo
+size_t benchmarkSize = 0;
+// Average milliseconds of tick and collide by number of entities
+std::map<size_t, float> collisionTimes;
+
 void initScene()
 {
-	sc = scene();
-	sc.entities.push_back(
-		std::make_shared<circle>(vec2(50, 50), vec2(1, 1), 50));
-	sc.entities.push_back(
-		std::make_shared<circle>(vec2(1000, 50), vec2(-1, .7), 150));
+	sc.clear();
+	sc.horizon = 600.f;
+	sc.bounds = vec2(SCREEN_WIDTH, SCREEN_HEIGHT);
+	sc.add(std::make_shared<circle>(vec2(50, 50), vec2(1, 1), 50));
+	sc.add(std::make_shared<circle>(vec2(1000, 50), vec2(-1, .7), 150));
+}
+
+// Seed of the benchmark patterns, fixed so every run measures the same load
+const uint64_t BENCHMARK_SEED = 1;
+
+danmaku::field patterns(vec2(), BENCHMARK_SEED);
+// Shot of each scene index, by the index
+std::vector<danmaku::shot> shots;
+std::vector<danmaku::shot> fired;
+
+// One emitter of each danmaku archetype, keeping about n bullets on the screen
+void initBenchmark(size_t n)
+{
+	sc.clear();
+	sc.horizon = BENCHMARK_HORIZON;
+	// shots leave the screen rather than wrap around
+	sc.bounds = vec2();
+	shots.clear();
+	patterns = danmaku::field::mixed(vec2(SCREEN_WIDTH, SCREEN_HEIGHT), BENCHMARK_SEED, (float)n);
+}
+
+// Advance the benchmark patterns by a tick, before the scene moves the shots
+void tickBenchmark()
+{
+	const vec2 screen(SCREEN_WIDTH, SCREEN_HEIGHT);
+	for (size_t i = 0; i < shots.size(); ++i)
+	{
+		if (!sc.entities[i])
+			continue;
+		danmaku::shot& s = shots[i];
+		if (s.ttl > 0)
+			--s.ttl;
+		if (danmaku::field::expired(s, screen))
+		{
+			sc.remove((uint32_t)i);
+			continue;
+		}
+		if (danmaku::steer(s))
+			sc.set((uint32_t)i, s.shape);
+	}
+
+	// emitters aim at where the player would be
+	fired.clear();
+	patterns.emit(vec2(SCREEN_WIDTH / 2, SCREEN_HEIGHT - 40), fired);
+	for (danmaku::shot& s : fired)
+	{
+		const uint32_t i = sc.add(s.shape);
+		if (i >= shots.size())
+			shots.resize(i + 1);
+		shots[i] = std::move(s);
+	}
+}
+
+// Plot of collision time against the number of entities, on a log2 scale
+void renderTimes()
+{
+	const int x0 = 10, y0 = SCREEN_HEIGHT - 10, w = 300, h = 150;
+	const float maxMs = 16.7f;
+	SDL_SetRenderDrawColor(gRenderer, 0x60, 0x60, 0x60, 0xFF);
+	SDL_RenderDrawLine(gRenderer, x0, y0, x0 + w, y0);
+	SDL_RenderDrawLine(gRenderer, x0, y0, x0, y0 - h);
+	SDL_SetRenderDrawColor(gRenderer, 0x40, 0xC0, 0xFF, 0xFF);
+	for (const auto& kv : collisionTimes)
+	{
+		const int x = x0 + (int)(std::log2((float)kv.first) / 17 * w);
+		const int y = y0 - (int)(std::min(kv.second / maxMs, 1.f) * h);
+		SDL_Rect r = { x - 2, y - 2, 5, 5 };
+		SDL_RenderFillRect(gRenderer, &r);
+	}
 }
 
 void loop()
 {
 	bool quit = false;
 	SDL_Event e;
+	float sampleMs = 0;
+	int sampleFrames = 0;
 
 	while (!quit)
 	{
@@ -69,9 +156,27 @@ void loop()
 				switch (e.key.keysym.sym)
 				{
 				case SDLK_r:
+					benchmarkSize = 0;
 					initScene();
 					break;
+				case SDLK_c:
+					sc.cachePairs = !sc.cachePairs;
+					collisionTimes.clear();
+					break;
+				case SDLK_UP:
+					benchmarkSize = benchmarkSize ? benchmarkSize * 2 : 1000;
+					initBenchmark(benchmarkSize);
+					break;
+				case SDLK_DOWN:
+					if (benchmarkSize > 100)
+					{
+						benchmarkSize /= 2;
+						initBenchmark(benchmarkSize);
+					}
+					break;
 				}
+				sampleMs = 0;
+				sampleFrames = 0;
 			}
 		}
 
@@ -79,7 +184,44 @@ void loop()
 		SDL_RenderClear(gRenderer);
 
 		sc.render(gRenderer);
+		renderTimes();
+
+		if (benchmarkSize)
+			tickBenchmark();
+
+		// the last frame of a sample checks the cached predictions, and is not timed
+		const bool check = sc.cachePairs && sampleFrames == SAMPLE_FRAMES - 1;
+		sc.checkCache = check;
+		auto start = std::chrono::high_resolution_clock::now();
 		sc.tick();
+		sc.collide();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		if (!check)
+			sampleMs += std::chrono::duration<float, std::milli>(end - start).count();
+		if (++sampleFrames == SAMPLE_FRAMES)
+		{
+			const float ms = sampleMs / (check ? SAMPLE_FRAMES - 1 : SAMPLE_FRAMES);
+			collisionTimes[sc.size()] = ms;
+			std::string title = "Twinject Sandbox - " + std::to_string(sc.size())
+				+ " entities, " + std::to_string(ms) + " ms, "
+				+ std::to_string(sc.candidates) + " candidate pairs, "
+				+ std::to_string(sc.predictions) + " predictions, "
+				+ std::to_string(sc.hits.size()) + " hits";
+			std::string cache = "no pair cache";
+			if (sc.cachePairs)
+			{
+				cache = "pair cache, " + std::to_string(sc.divergent) + " of "
+					+ std::to_string(sc.candidates) + " pairs differ from fresh predictions";
+			}
+			title += ", " + cache;
+			SDL_SetWindowTitle(gWindow, title.c_str());
+			std::cout << sc.size() << " entities: " << ms << " ms, "
+				<< sc.candidates << " candidates, " << sc.hits.size() << " hits, "
+				<< cache << std::endl;
+			sampleMs = 0;
+			sampleFrames = 0;
+		}
 
 		SDL_RenderPresent(gRenderer);
 	}
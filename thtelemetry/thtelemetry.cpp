@@ -0,0 +1,77 @@
+// Live percentiles of the telemetry twinhook exports with the twinject "telemetry" option
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ipc/telemetry_collector.h"
+#include "ipc/telemetry_stream.h"
+
+static const double DEFAULT_INTERVAL = 1;
+static const size_t READ_SIZE = 1 << 12;
+
+int main(const int argc, const char* argv[])
+{
+	std::string address = telemetry_listener::DEFAULT_ADDRESS;
+	double interval = DEFAULT_INTERVAL;
+	size_t window = telemetry_collector::DEFAULT_WINDOW;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-i" && i + 1 < argc)
+			interval = std::stod(argv[++i]);
+		else if (arg == "-w" && i + 1 < argc)
+			window = (size_t)std::stoul(argv[++i]);
+		else if (arg[0] != '-')
+			address = arg;
+		else
+		{
+			std::cerr << "usage: thtelemetry [address] [-i seconds] [-w frames]" << std::endl;
+			return 1;
+		}
+	}
+
+	telemetry_listener listener;
+	if (!listener.listen(address))
+	{
+		std::cerr << "thtelemetry: could not listen on " << telemetry_listener::endpoint(address) << std::endl;
+		return 1;
+	}
+	std::cout << "thtelemetry: listening on " << telemetry_listener::endpoint(address) << std::endl;
+
+	using clock = std::chrono::steady_clock;
+	const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(interval));
+	telemetry_collector collector(window);
+	telemetry_wire::decoder decoder;
+	std::vector<uint8_t> buf(READ_SIZE);
+	std::vector<telemetry_wire::frame_record> records;
+
+	// One exporter at a time, a restarted game connects again
+	while (listener.accept())
+	{
+		std::cout << "thtelemetry: exporter connected" << std::endl;
+		collector.clear();
+		decoder.reset();
+		auto next = clock::now() + period;
+		while (const size_t n = listener.read(buf.data(), buf.size()))
+		{
+			records.clear();
+			if (!decoder.feed(buf.data(), n, records))
+			{
+				std::cerr << "thtelemetry: not a compatible telemetry stream" << std::endl;
+				break;
+			}
+			for (const auto& r : records)
+				collector.add(r);
+			if (clock::now() >= next)
+			{
+				std::cout << collector.summary() << std::endl;
+				next = clock::now() + period;
+			}
+		}
+		listener.disconnect();
+		std::cout << "thtelemetry: exporter disconnected" << std::endl << collector.summary() << std::endl;
+	}
+	std::cerr << "thtelemetry: could not accept exporters" << std::endl;
+	return 1;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+/**
+ * \brief Minimal unit test registry for the portable parts of twinhook.
+ *
+ * A test is a function declared with TH_TEST, which registers itself before
+ * main runs. Failed checks are reported with their location and the test goes
+ * on, so one run shows every failing check.
+ */
+namespace th_test
+{
+	typedef void(*test_fn)();
+
+	struct test_case
+	{
+		const char* name;
+		test_fn fn;
+	};
+
+	std::vector<test_case>& registry();
+
+	// Count a failed check of the running test
+	void fail(const char* file, int line, const char* expr);
+
+	struct registrar
+	{
+		registrar(const char* name, test_fn fn) { registry().push_back({ name, fn }); }
+	};
+}
+
+#define TH_TEST(name) \
+	static void name(); \
+	static th_test::registrar name##_registrar(#name, name); \
+	static void name()
+
+#define CHECK(expr) \
+	do { if (!(expr)) th_test::fail(__FILE__, __LINE__, #expr); } while (0)
@@ -0,0 +1,171 @@
+// th_log formatting, binary logs, and records wrapping around the ring
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "util/async_log.h"
+
+namespace
+{
+	// Text sink keeping every message
+	struct collector
+	{
+		std::mutex mtx;
+		std::vector<std::string> lines;
+
+		void start()
+		{
+			th_log::start([this](const th_log::site&, const std::string& msg)
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				lines.push_back(msg);
+			});
+		}
+	};
+
+	// Encode arguments like th_log::write does
+	template<typename... Args>
+	std::vector<uint8_t> encode(const Args&... args)
+	{
+		std::vector<uint8_t> buf(th_log::detail::totalSize(args...));
+		th_log::detail::putAll(buf.data(), args...);
+		return buf;
+	}
+
+	template<typename... Args>
+	std::string format(const char* fmt, const Args&... args)
+	{
+		const std::vector<uint8_t> buf = encode(args...);
+		return th_log::format(fmt, buf.data(), buf.size());
+	}
+}
+
+TH_TEST(log_formats_arguments)
+{
+	CHECK(format("a {} b", 42) == "a 42 b");
+	CHECK(format("{} {}", -5, 7u) == "-5 7");
+	CHECK(format("{:.2f} {}", 3.14159f, .5) == "3.14 0.5");
+	CHECK(format("{} {}", true, false) == "true false");
+	CHECK(format("{} {}", "str", std::string("std")) == "str std");
+	CHECK(format("{{x}} {}", 1) == "{x} 1");
+	// missing arguments leave their placeholders
+	CHECK(format("{} and {}", 1) == "1 and {}");
+	CHECK(format("{}", std::string(1000, 'x')).size() == th_log::MAX_STRING_ARG);
+}
+
+TH_TEST(log_decodes_binary_logs)
+{
+	const char* const file = "thtest_log.bin";
+	CHECK(th_log::startBinary(file));
+	static const th_log::site s = th_log::makeSite(th_log::Warn, "bin {} {:.1f} {}", "f.cpp", 12);
+	th_log::write(s, 7, 2.25, "x");
+	th_log::stop();
+
+	std::ifstream in(file, std::ios::binary);
+	std::ostringstream out;
+	CHECK(th_log::decode(in, out));
+	const std::string text = out.str();
+	CHECK(text.find(" [W:f.cpp:L12] bin 7 2.2 x\n") != std::string::npos
+		|| text.find(" [W:f.cpp:L12] bin 7 2.3 x\n") != std::string::npos);
+	in.close();
+	remove(file);
+}
+
+TH_TEST(log_wraps_records_around_the_ring)
+{
+	static const th_log::site empty = th_log::makeSite(th_log::Info, "-", "", 0);
+	static const th_log::site one = th_log::makeSite(th_log::Info, "{}", "", 0);
+	collector c;
+	const uint64_t dropped = th_log::dropped();
+
+	// A new thread starts with an empty ring. Records of 16 bytes after one
+	// of 24 leave 8 bytes before the end of the ring, too few for a header.
+	std::thread([&]
+	{
+		th_log::write(one, "abcde");
+		for (size_t i = 0; i < (th_log::RING_SIZE - 32) / 16; ++i)
+			th_log::write(empty);
+		c.start();
+		th_log::stop();
+		th_log::write(one, 42);
+		c.start();
+		th_log::stop();
+	}).join();
+
+	CHECK(c.lines.size() == (th_log::RING_SIZE - 32) / 16 + 2);
+	CHECK(c.lines.front() == "abcde");
+	CHECK(c.lines.back() == "42");
+	CHECK(th_log::dropped() == dropped);
+
+	// Strings of every length wrap at every offset
+	c.lines.clear();
+	size_t written = 0;
+	bool intact = true;
+	std::thread([&]
+	{
+		for (int round = 0; round < 64; ++round)
+		{
+			for (int i = 0; i < 256; ++i, ++written)
+				th_log::write(one, std::string(written % 29, 'a' + written % 26));
+			c.start();
+			th_log::stop();
+		}
+	}).join();
+
+	CHECK(c.lines.size() == written);
+	for (size_t i = 0; i < c.lines.size() && intact; ++i)
+		intact = c.lines[i] == std::string(i % 29, 'a' + i % 26);
+	CHECK(intact);
+	CHECK(th_log::dropped() == dropped);
+}
+
+TH_TEST(log_keeps_order_of_each_thread)
+{
+	static const th_log::site s = th_log::makeSite(th_log::Debug, "{} {}", "", 0);
+	const int THREADS = 4;
+	const int RECORDS = 100000;
+
+	std::vector<int> last(THREADS, -1);
+	std::atomic<int> received{ 0 };
+	bool ordered = true;
+	th_log::start([&](const th_log::site&, const std::string& msg)
+	{
+		int t = -1, i = -1;
+		std::istringstream(msg) >> t >> i;
+		if (t < 0 || t >= THREADS || i <= last[t])
+			ordered = false;
+		else
+			last[t] = i;
+		++received;
+	});
+
+	const uint64_t dropped = th_log::dropped();
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.emplace_back([t, RECORDS]
+		{
+			for (int i = 0; i < RECORDS; ++i)
+				th_log::write(s, t, i);
+		});
+	}
+	for (std::thread& t : threads)
+		t.join();
+	const double ns = std::chrono::duration<double, std::nano>(
+		std::chrono::steady_clock::now() - start).count() / (THREADS * RECORDS);
+	th_log::stop();
+
+	// a full ring drops records rather than blocking
+	CHECK(ordered);
+	CHECK(received + (th_log::dropped() - dropped) == (uint64_t)THREADS * RECORDS);
+	printf("  %.1f ns per record, %d of %d dropped\n", ns,
+		(int)(th_log::dropped() - dropped), THREADS * RECORDS);
+}
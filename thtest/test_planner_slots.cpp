@@ -0,0 +1,107 @@
+// planner::block creation next to running and crashed services, on the POSIX backend
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "test.h"
+#include "ipc/planner_slots.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Unique among concurrent test runs
+	std::string testName(const char* suffix)
+	{
+#ifdef _WIN32
+		const uint32_t pid = GetCurrentProcessId();
+#else
+		const uint32_t pid = (uint32_t)getpid();
+#endif
+		return std::string("thtest_planner_") + std::to_string(pid) + "_" + suffix;
+	}
+
+	// Stands in for planner_service::run, which only needs to beat here
+	class heartbeat
+	{
+		std::atomic<bool> stop{ false };
+		std::thread beater;
+
+	public:
+		explicit heartbeat(planner::block& slots) : beater([this, &slots]
+		{
+			while (!stop)
+			{
+				slots.header().heartbeat.fetch_add(1, std::memory_order_relaxed);
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		})
+		{
+		}
+
+		~heartbeat()
+		{
+			stop = true;
+			beater.join();
+		}
+	};
+}
+
+TH_TEST(planner_refuses_running_service)
+{
+	const std::string name = testName("running");
+	planner::block service;
+	CHECK(service.create(name, 2));
+	heartbeat beat(service);
+
+	planner::client c;
+	CHECK(c.connect(name));
+	CHECK(service.at(0).state.load() == planner::Idle);
+
+	// a second service would free the slot under the client's feet
+	planner::block second;
+	CHECK(!second.create(name, 2));
+	CHECK(service.at(0).state.load() == planner::Idle);
+	CHECK(c.begin() != nullptr);
+}
+
+#ifndef _WIN32
+TH_TEST(planner_replaces_crashed_service)
+{
+	const std::string name = testName("crashed");
+
+	// a service which dies without closing leaves its name behind
+	const pid_t child = fork();
+	if (child == 0)
+	{
+		planner::block crashed;
+		_exit(crashed.create(name, 2) ? 0 : 1);
+	}
+	int status = 0;
+	CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	planner::block stale;
+	CHECK(stale.open(name));
+
+	planner::block service;
+	CHECK(service.create(name, 4));
+	CHECK(service.slotCount() == 4);
+	heartbeat beat(service);
+
+	// the new block is found by name, the stale one is left to its mappers
+	planner::client c;
+	CHECK(c.connect(name));
+	CHECK(service.at(0).state.load() == planner::Idle);
+	CHECK(stale.slotCount() == 2 && stale.at(0).state.load() == planner::Free);
+
+	// and the name disappears with the service which replaced the crashed one
+	service.close();
+	CHECK(!stale.open(name));
+}
+#endif
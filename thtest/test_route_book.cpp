@@ -0,0 +1,106 @@
+// route_book keys, saving and probing of damaged books
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "algo/route_book.h"
+
+namespace
+{
+	th_recording::object_record at(float x, float y)
+	{
+		th_recording::object_record o = {};
+		o.x = x;
+		o.y = y;
+		return o;
+	}
+
+	route_book::route makeRoute(uint64_t key, int8_t move, float margin)
+	{
+		route_book::route r = {};
+		r.key = key;
+		r.stage = 1;
+		r.move = move;
+		r.runs = 1;
+		r.margin = margin;
+		return r;
+	}
+}
+
+TH_TEST(route_keys_match_exact_cells_in_pool_order)
+{
+	const th_recording::object_record player = at(100, 300);
+	const std::vector<th_recording::object_record> bullets = { at(10, 10), at(50, 20) };
+	const uint64_t k = route_book::key(1, player, bullets.data(), bullets.size());
+	CHECK(k != 0);
+
+	// within the same cells
+	const std::vector<th_recording::object_record> nudged = { at(11.5f, 10), at(50, 23.9f) };
+	CHECK(route_book::key(1, player, nudged.data(), nudged.size()) == k);
+
+	// a bullet crossing a cell border, another order, stage or bullet count
+	const std::vector<th_recording::object_record> crossed = { at(10, 10), at(50, 24) };
+	const std::vector<th_recording::object_record> swapped = { bullets[1], bullets[0] };
+	CHECK(route_book::key(1, player, crossed.data(), crossed.size()) != k);
+	CHECK(route_book::key(1, player, swapped.data(), swapped.size()) != k);
+	CHECK(route_book::key(2, player, bullets.data(), bullets.size()) != k);
+	CHECK(route_book::key(1, player, bullets.data(), 1) != k);
+}
+
+TH_TEST(route_book_saves_and_merges)
+{
+	const std::string file = "thtest_routes.thrb";
+	remove(file.c_str());
+	{
+		route_book book;
+		CHECK(book.open(file));
+		CHECK(book.size() == 0);
+		for (uint64_t k = 1; k <= 3000; ++k)
+			book.add(makeRoute(k * 0x9E3779B97F4A7C15ull, 1, 5.f));
+		CHECK(book.save());
+		CHECK(book.size() == 3000);
+	}
+
+	route_book book;
+	CHECK(book.open(file));
+	CHECK(book.size() == 3000);
+	const uint64_t k = 7 * 0x9E3779B97F4A7C15ull;
+	CHECK(book.find(k) && book.find(k)->move == 1);
+	CHECK(!book.find(12345));
+
+	// the route with the larger margin wins, and runs add up
+	book.add(makeRoute(k, 2, 9.f));
+	book.add(makeRoute(k, 3, 1.f));
+	CHECK(book.save());
+	const route_book::route* r = book.find(k);
+	CHECK(r && r->move == 2 && r->runs == 3);
+	CHECK(book.size() == 3000);
+	remove(file.c_str());
+}
+
+TH_TEST(route_book_probes_full_table_once)
+{
+	// a damaged book whose table has no empty slot, claiming to be empty
+	const std::string file = "thtest_full.thrb";
+	route_book::header h = {};
+	h.magic = route_book::MAGIC;
+	h.version = route_book::VERSION;
+	h.capacity = route_book::MIN_CAPACITY;
+	h.count = 0;
+	std::vector<route_book::route> table(h.capacity);
+	for (uint32_t i = 0; i < h.capacity; ++i)
+		table[i] = makeRoute(i + 1, 0, 0);
+	{
+		std::ofstream f(file, std::ios::binary | std::ios::trunc);
+		f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		f.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(route_book::route));
+	}
+
+	route_book book;
+	CHECK(book.open(file));
+	CHECK(book.find(5) != nullptr);
+	CHECK(book.find(h.capacity + 100) == nullptr);
+	remove(file.c_str());
+}
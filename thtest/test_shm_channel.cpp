@@ -0,0 +1,165 @@
+// shm_channel on the POSIX backend, and its throughput between two threads
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "ipc/shm_channel.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Unique among concurrent test runs
+	std::string testName(const char* suffix)
+	{
+#ifdef _WIN32
+		const uint32_t pid = GetCurrentProcessId();
+#else
+		const uint32_t pid = (uint32_t)getpid();
+#endif
+		return shm_channel::launchName(pid) + "_" + suffix;
+	}
+}
+
+TH_TEST(channel_passes_messages_between_ends)
+{
+	const std::string name = testName("pass");
+	shm_channel injector, hook;
+	CHECK(!hook.open(name));
+	CHECK(injector.create(name, 1 << 12));
+	CHECK(hook.open(name));
+
+	shm_msg::config_msg cfg = {};
+	memcpy(cfg.key, "algo", 5);
+	memcpy(cfg.value, "vo", 3);
+	CHECK(injector.ring(shm_channel::ConfigRing).write(shm_msg::Config, &cfg, sizeof(cfg)));
+
+	uint16_t type;
+	std::vector<uint8_t> payload;
+	CHECK(hook.ring(shm_channel::ConfigRing).read(type, payload));
+	CHECK(type == shm_msg::Config && payload.size() == sizeof(cfg));
+	CHECK(payload.size() == sizeof(cfg) && memcmp(payload.data(), &cfg, sizeof(cfg)) == 0);
+	CHECK(!hook.ring(shm_channel::ConfigRing).read(type, payload));
+
+	const shm_msg::log_msg log = { 3 };
+	CHECK(hook.ring(shm_channel::LogRing).write(shm_msg::Log, &log, sizeof(log), "text", 4));
+	CHECK(injector.ring(shm_channel::LogRing).read(type, payload));
+	CHECK(type == shm_msg::Log && payload.size() == 5);
+	CHECK(payload.size() == 5 && payload[0] == 3 && memcmp(&payload[1], "text", 4) == 0);
+
+	// the name disappears with the end which created it
+	injector.close();
+	hook.close();
+	CHECK(!hook.open(name));
+}
+
+TH_TEST(channel_refuses_existing_name)
+{
+	const std::string name = testName("exists");
+	shm_channel first, second, hook;
+	CHECK(first.create(name, 1 << 12));
+	first.ring(shm_channel::ConfigRing).write(shm_msg::Config, "x", 1);
+
+	// creating it again would reset the rings under the first pair's feet
+	CHECK(!second.create(name, 1 << 12));
+	CHECK(hook.open(name));
+	uint16_t type;
+	std::vector<uint8_t> payload;
+	CHECK(hook.ring(shm_channel::ConfigRing).read(type, payload));
+	CHECK(!second.create(name, 3000));
+}
+
+TH_TEST(channel_wraps_and_drops_when_full)
+{
+	const std::string name = testName("wrap");
+	shm_channel a, b;
+	CHECK(a.create(name, 256));
+	CHECK(b.open(name));
+	shm_ring& w = a.ring(shm_channel::TelemetryRing);
+	shm_ring& r = b.ring(shm_channel::TelemetryRing);
+
+	uint16_t type;
+	std::vector<uint8_t> payload;
+	uint8_t bytes[128];
+	for (int i = 0; i < (int)sizeof(bytes); ++i)
+		bytes[i] = (uint8_t)i;
+
+	// payloads of every size up to half the ring, each read before the next
+	bool intact = true;
+	for (size_t len = 0; len <= 124; ++len)
+	{
+		for (int rep = 0; rep < 3; ++rep)
+		{
+			intact &= w.write(shm_msg::Decision, bytes, len);
+			intact &= r.read(type, payload) && type == shm_msg::Decision
+				&& payload.size() == len && memcmp(payload.data(), bytes, len) == 0;
+		}
+	}
+	CHECK(intact);
+	CHECK(w.dropped() == 0);
+
+	// too large for the ring
+	CHECK(!w.write(shm_msg::Decision, bytes, 128));
+	int written = 0;
+	while (w.write(shm_msg::Decision, bytes, 28))
+		++written;
+	CHECK(written == 256 / 32);
+	CHECK(w.dropped() == 2);
+	int read = 0;
+	while (r.read(type, payload))
+		++read;
+	CHECK(read == written);
+}
+
+TH_TEST(channel_throughput)
+{
+	const std::string name = testName("bench");
+	shm_channel a, b;
+	CHECK(a.create(name));
+	CHECK(b.open(name));
+	const int MESSAGES = 1000000;
+
+	shm_msg::frame_stats_msg msg = {};
+	const auto start = std::chrono::steady_clock::now();
+	std::thread producer([&]
+	{
+		shm_ring& w = a.ring(shm_channel::TelemetryRing);
+		for (int i = 0; i < MESSAGES; )
+		{
+			msg.gameTick = (uint32_t)i;
+			if (w.write(shm_msg::FrameStats, &msg, sizeof(msg)))
+				++i;
+			else
+				std::this_thread::yield();
+		}
+	});
+
+	shm_ring& r = b.ring(shm_channel::TelemetryRing);
+	uint16_t type;
+	std::vector<uint8_t> payload;
+	bool ordered = true;
+	for (int i = 0; i < MESSAGES; )
+	{
+		if (!r.read(type, payload))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		shm_msg::frame_stats_msg got;
+		memcpy(&got, payload.data(), sizeof(got));
+		ordered &= type == shm_msg::FrameStats && got.gameTick == (uint32_t)i;
+		++i;
+	}
+	producer.join();
+	const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	CHECK(ordered);
+	printf("  %.1f M messages/s, %.0f ns per message\n", MESSAGES / s / 1e6, s * 1e9 / MESSAGES);
+}
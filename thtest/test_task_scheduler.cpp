@@ -0,0 +1,147 @@
+// task_scheduler driven by a mock clock, which each step advances by a fixed cost
+#include <memory>
+#include <string>
+
+#include "test.h"
+#include "util/task_scheduler.h"
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace
+{
+	struct mock_clock
+	{
+		task_scheduler::duration now{ 0 };
+
+		task_scheduler::clock_fn fn() { return [this] { return now; }; }
+	};
+
+	// Appends its name to a log on every step, and is done after `steps` steps
+	std::unique_ptr<task> logged(mock_clock& clock, std::string& log, char name,
+		int steps, microseconds cost = microseconds(100))
+	{
+		auto left = std::make_shared<int>(steps);
+		return std::make_unique<function_task>([&clock, &log, name, left, cost]
+		{
+			log += name;
+			clock.now += cost;
+			return --*left == 0;
+		});
+	}
+}
+
+TH_TEST(scheduler_runs_higher_priority_first)
+{
+	mock_clock clock;
+	task_scheduler s(clock.fn());
+	std::string log;
+	s.add(logged(clock, log, 'a', 2), 0);
+	s.add(logged(clock, log, 'b', 2), 5);
+	s.add(logged(clock, log, 'c', 2), 1);
+
+	CHECK(s.run(milliseconds(10)) == 6);
+	CHECK(log == "bbccaa");
+	CHECK(s.size() == 0);
+	CHECK(s.completed() == 3);
+}
+
+TH_TEST(scheduler_runs_earliest_deadline_first_within_priority)
+{
+	mock_clock clock;
+	task_scheduler s(clock.fn());
+	std::string log;
+	s.add(logged(clock, log, 'a', 1));
+	s.add(logged(clock, log, 'b', 1), 0, milliseconds(5));
+	s.add(logged(clock, log, 'c', 1), 0, milliseconds(2));
+	s.add(logged(clock, log, 'd', 1));
+
+	s.run(milliseconds(10));
+	// tasks without a deadline keep the order they were added in
+	CHECK(log == "cbad");
+}
+
+TH_TEST(scheduler_stops_when_slice_is_used)
+{
+	mock_clock clock;
+	task_scheduler s(clock.fn());
+	std::string log;
+	s.add(logged(clock, log, 'a', 100, microseconds(300)));
+
+	// the step which crosses the end of the slice still completes
+	CHECK(s.run(milliseconds(1)) == 4);
+	CHECK(s.run(task_scheduler::duration::zero()) == 0);
+	CHECK(s.run(microseconds(-5)) == 0);
+	CHECK(s.run(microseconds(600)) == 2);
+	CHECK(log.size() == 6);
+	CHECK(s.size() == 1);
+	CHECK(s.completed() == 0);
+}
+
+TH_TEST(scheduler_resumes_tasks_across_slices)
+{
+	mock_clock clock;
+	task_scheduler s(clock.fn());
+	std::string log;
+	s.add(logged(clock, log, 'a', 10, microseconds(500)), 0, milliseconds(20));
+
+	int frames = 0;
+	while (s.size() > 0)
+	{
+		s.run(milliseconds(1));
+		// the game's own work between the slices
+		clock.now += milliseconds(15);
+		++frames;
+	}
+	CHECK(frames == 5);
+	CHECK(log == "aaaaaaaaaa");
+	// done at 5 * 1 + 4 * 15 ms, after its deadline
+	CHECK(s.completed() == 1);
+	CHECK(s.missedDeadlines() == 1);
+}
+
+TH_TEST(scheduler_counts_only_late_tasks)
+{
+	mock_clock clock;
+	task_scheduler s(clock.fn());
+	std::string log;
+	s.add(logged(clock, log, 'a', 2), 0, microseconds(250));
+	s.add(logged(clock, log, 'b', 2), 0, microseconds(300));
+
+	// a is done at 200 us, b at 400 us
+	s.run(milliseconds(1));
+	CHECK(s.completed() == 2);
+	CHECK(s.missedDeadlines() == 1);
+}
+
+TH_TEST(scheduler_cancels_tasks)
+{
+	mock_clock clock;
+	task_scheduler s(clock.fn());
+	std::string log;
+	const task_scheduler::task_id a = s.add(logged(clock, log, 'a', 1));
+	const task_scheduler::task_id b = s.add(logged(clock, log, 'b', 1));
+	CHECK(a != task_scheduler::INVALID_TASK);
+	CHECK(a != b);
+
+	CHECK(s.cancel(a));
+	CHECK(!s.cancel(a));
+	s.run(milliseconds(1));
+	CHECK(log == "b");
+	CHECK(!s.cancel(b));
+	CHECK(s.completed() == 1);
+}
+
+TH_TEST(scheduler_saturates_far_deadlines)
+{
+	mock_clock clock;
+	clock.now = std::chrono::hours(1000);
+	task_scheduler s(clock.fn());
+	std::string log;
+	s.add(logged(clock, log, 'a', 1), 0, task_scheduler::duration::max() - microseconds(1));
+	s.add(logged(clock, log, 'b', 1), 0, milliseconds(1));
+
+	s.run(milliseconds(1));
+	CHECK(log == "ba");
+	CHECK(s.missedDeadlines() == 0);
+}
@@ -0,0 +1,115 @@
+// telemetry_exporter against a local listener, on the POSIX backend
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "ipc/telemetry_stream.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Unique among concurrent test runs
+	std::string testAddress(const char* suffix)
+	{
+#ifdef _WIN32
+		const uint32_t pid = GetCurrentProcessId();
+#else
+		const uint32_t pid = (uint32_t)getpid();
+#endif
+		return std::string("thtest_telemetry_") + std::to_string(pid) + "_" + suffix;
+	}
+
+	telemetry_wire::frame_record record(uint32_t tick)
+	{
+		telemetry_wire::frame_record r = {};
+		r.gameTick = tick;
+		r.risk = (float)tick;
+		r.danger = tick / 2.f;
+		r.move = -1;
+		return r;
+	}
+
+	// Wait until the worker connected, at most a second
+	bool waitConnected(const telemetry_exporter& exporter)
+	{
+		for (int i = 0; i < 200 && !exporter.connected(); ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		return exporter.connected();
+	}
+}
+
+TH_TEST(telemetry_records_reach_listener)
+{
+	telemetry_listener listener;
+	CHECK(listener.listen(testAddress("pass")));
+
+	std::vector<telemetry_wire::frame_record> received;
+	bool decoded = true;
+	std::thread collector([&]
+	{
+		if (!listener.accept())
+			return;
+		telemetry_wire::decoder decoder;
+		uint8_t buf[4096];
+		while (size_t n = listener.read(buf, sizeof(buf)))
+			decoded = decoder.feed(buf, n, received) && decoded;
+	});
+
+	telemetry_exporter exporter;
+	exporter.open(testAddress("pass"));
+	CHECK(waitConnected(exporter));
+
+	const uint32_t COUNT = 500;
+	for (uint32_t i = 0; i < COUNT; ++i)
+		CHECK(exporter.push(record(i)));
+	exporter.close();
+	collector.join();
+
+	CHECK(decoded);
+	CHECK(received.size() == COUNT);
+	for (uint32_t i = 0; i < received.size() && i < COUNT; ++i)
+		CHECK(received[i].gameTick == i && received[i].risk == i && received[i].danger == i / 2.f);
+}
+
+TH_TEST(telemetry_drops_stalled_listener)
+{
+	telemetry_listener listener;
+	CHECK(listener.listen(testAddress("stall")));
+
+	// accepts, then never reads
+	std::thread collector([&] { listener.accept(); });
+
+	telemetry_exporter exporter;
+	exporter.open(testAddress("stall"));
+	CHECK(waitConnected(exporter));
+	collector.join();
+
+	// fill the socket buffer until a write runs into the deadline
+	const auto start = std::chrono::steady_clock::now();
+	uint32_t tick = 0;
+	while (exporter.connected() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+	{
+		for (int i = 0; i < 256; ++i)
+			exporter.push(record(tick++));
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(!exporter.connected());
+
+	// a full queue is discarded rather than sent while nobody listens
+	for (uint32_t i = 0; i < telemetry_exporter::QUEUE_SIZE; ++i)
+		exporter.push(record(tick++));
+	const auto closing = std::chrono::steady_clock::now();
+	exporter.close();
+	const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - closing).count();
+	printf("    dropped after %u records, close took %lld ms\n", tick, (long long)ms);
+	CHECK(ms < telemetry_exporter::SEND_TIMEOUT_MS * 2 + telemetry_exporter::POLL_MS);
+}
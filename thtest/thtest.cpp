@@ -0,0 +1,46 @@
+// Runs the unit tests of the portable parts of twinhook
+#include <cstdio>
+#include <cstring>
+
+#include "test.h"
+
+static int failedChecks = 0;
+
+std::vector<th_test::test_case>& th_test::registry()
+{
+	static std::vector<test_case> tests;
+	return tests;
+}
+
+void th_test::fail(const char* file, int line, const char* expr)
+{
+	printf("  %s:%d: CHECK(%s) failed\n", file, line, expr);
+	++failedChecks;
+}
+
+int main(int argc, char* argv[])
+{
+	// optional substring of the names of the tests to run
+	const char* filter = argc > 1 ? argv[1] : "";
+
+	int run = 0, failed = 0;
+	for (const th_test::test_case& t : th_test::registry())
+	{
+		if (!strstr(t.name, filter))
+			continue;
+		const int before = failedChecks;
+		t.fn();
+		++run;
+		if (failedChecks != before)
+		{
+			++failed;
+			printf("FAIL %s\n", t.name);
+		}
+		else
+		{
+			printf("ok   %s\n", t.name);
+		}
+	}
+	printf("%d of %d tests passed\n", run - failed, run);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "laser_tracker.h"
+
+#include <algorithm>
+
+static float wrapPi(float a)
+{
+	while (a > (float)M_PI) a -= 2.f * (float)M_PI;
+	while (a < -(float)M_PI) a += 2.f * (float)M_PI;
+	return a;
+}
+
+void laser_tracker::match(const std::vector<laser>& lasers, unsigned int gameTick)
+{
+	candidates.clear();
+	matchOf.assign(lasers.size(), -1);
+	taken.assign(tracks.size(), false);
+
+	for (size_t i = 0; i < lasers.size(); ++i)
+	{
+		const auto box = dynamic_cast<const obb*>(lasers[i].obj.get());
+		if (!box)
+			continue;
+		const vec2 tip = box->position + vec2(box->length, 0).rotate(box->angle);
+
+		for (size_t j = 0; j < tracks.size(); ++j)
+		{
+			// Predict the track to the current tick with its own estimates
+			const track& tr = tracks[j];
+			const float dt = (float)(gameTick - tr.tick);
+			const float angle = tr.angle + tr.angularVelocity * dt;
+			if (abs(wrapPi(box->angle - angle)) > ANGLE_GATE)
+				continue;
+			const vec2 pos = tr.position + tr.velocity * dt;
+			const vec2 trTip = pos + vec2(std::max(0.f, tr.length + tr.lengthVelocity * dt), 0).rotate(angle);
+			const float dPos = (box->position - pos).len();
+			const float dTip = (tip - trTip).len();
+			if (dPos > MATCH_GATE || dTip > MATCH_GATE)
+				continue;
+			candidates.push_back({ dPos + dTip, (int)i, (int)j });
+		}
+	}
+
+	// Greedily assign the closest pairs first
+	std::sort(candidates.begin(), candidates.end(),
+		[](const candidate& a, const candidate& b) { return a.cost < b.cost; });
+	for (const candidate& c : candidates)
+	{
+		if (matchOf[c.laser] >= 0 || taken[c.track])
+			continue;
+		matchOf[c.laser] = c.track;
+		taken[c.track] = true;
+	}
+}
+
+void laser_tracker::update(std::vector<laser>& lasers, unsigned int gameTick, bool advanced)
+{
+	if (advanced)
+		match(lasers, gameTick);
+
+	nextTracks.clear();
+	for (size_t i = 0; i < lasers.size(); ++i)
+	{
+		const auto box = dynamic_cast<const obb*>(lasers[i].obj.get());
+		if (!box)
+			continue;
+
+		track tr = { box->position, box->length, box->radius, box->angle,
+			box->velocity, 0, 0, gameTick };
+		if (advanced)
+		{
+			if (matchOf[i] >= 0)
+			{
+				const track& prev = tracks[matchOf[i]];
+				const float dt = (float)std::max(1u, gameTick - prev.tick);
+				tr.angularVelocity = wrapPi(tr.angle - prev.angle) / dt;
+				tr.lengthVelocity = (tr.length - prev.length) / dt;
+				if (tr.velocity.zero())
+					tr.velocity = (tr.position - prev.position) / dt;
+			}
+			nextTracks.push_back(tr);
+		}
+		else if (matchOf.size() == lasers.size() && matchOf[i] >= 0)
+		{
+			// The game has not advanced, so reuse the estimates of this tick
+			const track& cur = tracks[matchOf[i]];
+			tr.velocity = cur.velocity;
+			tr.angularVelocity = cur.angularVelocity;
+			tr.lengthVelocity = cur.lengthVelocity;
+		}
+
+		lasers[i].obj = std::make_shared<obb>(tr.position, tr.length, tr.radius, tr.angle,
+			tr.velocity, tr.angularVelocity, tr.lengthVelocity);
+	}
+
+	if (advanced)
+	{
+		std::swap(tracks, nextTracks);
+		// Map lasers to the tracks they just created, for the stale frames to come
+		int k = 0;
+		for (size_t i = 0; i < lasers.size(); ++i)
+			matchOf[i] = dynamic_cast<const obb*>(lasers[i].obj.get()) ? k++ : -1;
+	}
+}
+
+void laser_tracker::reset()
+{
+	tracks.clear();
+	matchOf.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include "util/vec2.h"
+#include "model/game_object.h"
+
+/**
+ * \brief Matches straight lasers across game ticks to estimate how they move.
+ *
+ * Games only expose the current pivot, length and angle of a laser, so a
+ * sweeping laser looks like a static wall in any single frame. Each laser is
+ * matched to the laser of the previous tick whose predicted endpoints are
+ * closest, and the differences give its angular velocity, length growth and,
+ * if the game does not provide it, its linear velocity. Game coordinates are
+ * exact, so the estimates are plain finite differences.
+ */
+class laser_tracker
+{
+public:
+	// Maximum distance of either predicted endpoint for a match, in pixels
+	static constexpr float MATCH_GATE = 32.f;
+	// Maximum difference of the predicted angle for a match, in radians
+	static constexpr float ANGLE_GATE = 0.5f;
+
+	/**
+	 * \brief Match lasers to the previous tick and annotate their boxes with the
+	 * estimated motion. Lasers which are not oriented boxes are left alone.
+	 * \param lasers Lasers captured this frame, updated in place
+	 * \param gameTick Current game tick
+	 * \param advanced Whether the game advanced since the last call; if not, the
+	 * estimates of the last tick are reapplied without updating the tracks
+	 */
+	void update(std::vector<laser>& lasers, unsigned int gameTick, bool advanced);
+
+	/**
+	 * \brief Forget all tracks, e.g. on a stage transition
+	 */
+	void reset();
+
+	size_t size() const { return tracks.size(); }
+
+private:
+	struct track
+	{
+		vec2 position;
+		float length;
+		float radius;
+		float angle;
+		vec2 velocity;
+		float angularVelocity;
+		float lengthVelocity;
+		unsigned int tick;
+	};
+
+	struct candidate
+	{
+		float cost;
+		int laser;
+		int track;
+	};
+
+	std::vector<track> tracks;
+	std::vector<track> nextTracks;
+	std::vector<candidate> candidates;
+	std::vector<int> matchOf;
+	std::vector<bool> taken;
+
+	void match(const std::vector<laser>& lasers, unsigned int gameTick);
+};
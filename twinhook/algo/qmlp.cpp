@@ -0,0 +1,150 @@
+#include "stdafx.h"
+#include "qmlp.h"
+
+#include <fstream>
+
+#include "util/simd.h"
+
+static int padTo16(int n)
+{
+	return (n + 15) & ~15;
+}
+
+int32_t qmlp::dot(const int8_t* a, const int8_t* b, int n)
+{
+#ifdef TH_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_setzero_si128();
+	for (int i = 0; i < n; i += 16)
+	{
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+
+		// sign extend int8 to int16, SSE2 has no pmovsx
+		__m128i sa = _mm_cmpgt_epi8(zero, va);
+		__m128i sb = _mm_cmpgt_epi8(zero, vb);
+
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(va, sa), _mm_unpacklo_epi8(vb, sb)));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(va, sa), _mm_unpackhi_epi8(vb, sb)));
+	}
+	// horizontal sum of the four int32 lanes
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(acc);
+#else
+	int32_t acc = 0;
+	for (int i = 0; i < n; ++i)
+		acc += (int32_t)a[i] * (int32_t)b[i];
+	return acc;
+#endif
+}
+
+bool qmlp::load(const std::string& filename)
+{
+	layers.clear();
+
+	std::ifstream in(filename, std::ios::binary | std::ios::ate);
+	if (!in)
+		return false;
+	const uint64_t fileSize = (uint64_t)in.tellg();
+	in.seekg(0);
+
+	char magic[4];
+	uint32_t version, count;
+	in.read(magic, 4);
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	in.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if (!in || memcmp(magic, "TQNN", 4) != 0 || version != VERSION || count == 0 || count > MAX_LAYERS)
+	{
+		SPDLOG_ERROR("qmlp: {} is not a valid network file", filename);
+		return false;
+	}
+
+	std::vector<layer> loaded(count);
+	int width = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		layer& l = loaded[i];
+		uint32_t inputs, outputs;
+		in.read(reinterpret_cast<char*>(&inputs), sizeof(inputs));
+		in.read(reinterpret_cast<char*>(&outputs), sizeof(outputs));
+		if (!in || inputs == 0 || outputs == 0 || inputs > MAX_WIDTH || outputs > MAX_WIDTH
+			|| (i > 0 && inputs != (uint32_t)loaded[i - 1].outputs))
+		{
+			SPDLOG_ERROR("qmlp: layer {} of {} has invalid dimensions", i, filename);
+			return false;
+		}
+		// scale, bias and weights must be in the file before they are allocated
+		const uint64_t layerSize = (uint64_t)outputs * (2 * sizeof(float) + inputs);
+		if ((uint64_t)in.tellg() + layerSize > fileSize)
+		{
+			SPDLOG_ERROR("qmlp: {} is truncated", filename);
+			return false;
+		}
+
+		l.inputs = inputs;
+		l.outputs = outputs;
+		l.stride = padTo16(inputs);
+		l.scale.resize(outputs);
+		l.bias.resize(outputs);
+		l.weights.assign((size_t)outputs * l.stride, 0);
+
+		in.read(reinterpret_cast<char*>(l.scale.data()), outputs * sizeof(float));
+		in.read(reinterpret_cast<char*>(l.bias.data()), outputs * sizeof(float));
+		for (uint32_t r = 0; r < outputs; ++r)
+			in.read(reinterpret_cast<char*>(&l.weights[(size_t)r * l.stride]), inputs);
+		if (!in)
+		{
+			SPDLOG_ERROR("qmlp: {} is truncated", filename);
+			return false;
+		}
+
+		width = std::max(width, std::max(l.stride, padTo16(outputs)));
+	}
+
+	layers = std::move(loaded);
+	maxWidth = width;
+	return true;
+}
+
+void qmlp::evaluate(const float* input, float* output, workspace& ws) const
+{
+	if ((int)ws.act.size() < maxWidth)
+	{
+		ws.act.assign(maxWidth, 0);
+		ws.next.assign(maxWidth, 0);
+		ws.qact.assign(maxWidth, 0);
+	}
+	auto& act = ws.act;
+	auto& next = ws.next;
+	auto& qact = ws.qact;
+
+	std::copy_n(input, inputs(), act.begin());
+
+	for (size_t i = 0; i < layers.size(); ++i)
+	{
+		const layer& l = layers[i];
+		const bool hidden = i + 1 < layers.size();
+
+		// symmetric per-layer quantization of the activations
+		float amax = 0;
+		for (int j = 0; j < l.inputs; ++j)
+			amax = std::max(amax, std::abs(act[j]));
+		const float qscale = amax > 0 ? amax / 127.f : 1.f;
+		const float qinv = 1.f / qscale;
+		for (int j = 0; j < l.inputs; ++j)
+			qact[j] = (int8_t)std::lround(act[j] * qinv);
+		std::fill(qact.begin() + l.inputs, qact.begin() + l.stride, 0);
+
+		float* dst = hidden ? next.data() : output;
+		for (int r = 0; r < l.outputs; ++r)
+		{
+			int32_t acc = dot(&l.weights[(size_t)r * l.stride], qact.data(), l.stride);
+			float y = acc * l.scale[r] * qscale + l.bias[r];
+			dst[r] = hidden ? std::max(y, 0.f) : y;
+		}
+
+		if (hidden)
+			act.swap(next);
+	}
+}
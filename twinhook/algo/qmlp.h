@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Quantized multilayer perceptron, evaluated on the CPU.
+ *
+ * Weights are stored as int8 with one scale per output row. Activations are
+ * quantized to int8 per layer before each GEMV, and the products accumulate
+ * in int32 using SSE2. Hidden layers use ReLU, the output layer is linear.
+ *
+ * File format (little endian):
+ *   char[4]	magic "TQNN"
+ *   uint32		version (1)
+ *   uint32		number of layers
+ *   per layer:
+ *     uint32	inputs
+ *     uint32	outputs
+ *     float	scale[outputs]
+ *     float	bias[outputs]
+ *     int8		weights[outputs][inputs]
+ */
+class qmlp
+{
+	struct layer
+	{
+		int inputs;
+		int outputs;
+		// Row stride of weights, padded to a multiple of 16
+		int stride;
+		std::vector<int8_t> weights;
+		std::vector<float> scale;
+		std::vector<float> bias;
+	};
+
+	std::vector<layer> layers;
+	// Widest padded layer, the size of the workspace buffers
+	int maxWidth = 0;
+
+	/**
+	 * \brief Dot product of two int8 vectors
+	 * \param a First vector, 16-byte padded
+	 * \param b Second vector, 16-byte padded
+	 * \param n Padded length, a multiple of 16
+	 * \return The dot product
+	 */
+	static int32_t dot(const int8_t* a, const int8_t* b, int n);
+
+public:
+	static const uint32_t VERSION = 1;
+	// Limits of files accepted by load(), far above any network the bot runs
+	static const uint32_t MAX_LAYERS = 64;
+	static const uint32_t MAX_WIDTH = 4096;
+
+	/**
+	 * \brief Scratch buffers for evaluation, one per concurrent caller, so
+	 * evaluation neither allocates nor mutates the network
+	 */
+	struct workspace
+	{
+		std::vector<float> act;
+		std::vector<float> next;
+		std::vector<int8_t> qact;
+	};
+
+	/**
+	 * \brief Load network from file. Files exceeding MAX_LAYERS or MAX_WIDTH,
+	 * or shorter than their dimensions imply, are rejected before allocating.
+	 * \param filename Path of network file
+	 * \return Whether the network was loaded successfully
+	 */
+	bool load(const std::string& filename);
+
+	bool loaded() const { return !layers.empty(); }
+	int inputs() const { return layers.empty() ? 0 : layers.front().inputs; }
+	int outputs() const { return layers.empty() ? 0 : layers.back().outputs; }
+
+	/**
+	 * \brief Evaluate the network
+	 * \param input Input vector of size inputs()
+	 * \param output Output vector of size outputs()
+	 * \param ws Scratch buffers, grown on first use
+	 */
+	void evaluate(const float* input, float* output, workspace& ws) const;
+};
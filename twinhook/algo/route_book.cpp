@@ -0,0 +1,177 @@
+#include "algo/route_book.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	// splitmix64 finalizer, so the low bits of keys index the table well
+	uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 30;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 27;
+		h *= 0x94D049BB133111EBull;
+		h ^= h >> 31;
+		return h;
+	}
+
+	uint64_t cell(const th_recording::object_record& o)
+	{
+		const int32_t cx = (int32_t)std::floor(o.x / route_book::GRID);
+		const int32_t cy = (int32_t)std::floor(o.y / route_book::GRID);
+		return (uint64_t)(uint32_t)cx << 32 | (uint32_t)cy;
+	}
+
+	uint32_t capacityFor(size_t routes)
+	{
+		// keep the load factor at most 1/2, so probe sequences stay short
+		uint32_t c = route_book::MIN_CAPACITY;
+		while (c < routes * 2)
+			c *= 2;
+		return c;
+	}
+
+	void insert(std::vector<route_book::route>& table, const route_book::route& r)
+	{
+		const size_t mask = table.size() - 1;
+		size_t i = r.key & mask;
+		while (table[i].key != 0)
+			i = (i + 1) & mask;
+		table[i] = r;
+	}
+}
+
+uint64_t route_book::key(uint32_t stage, const th_recording::object_record& player,
+	const th_recording::object_record* bullets, size_t count)
+{
+	uint64_t h = mix(stage ^ (uint64_t)count << 32);
+	h = mix(h ^ cell(player));
+	for (size_t i = 0; i < count; ++i)
+		h = mix(h ^ cell(bullets[i]));
+	return h ? h : 1;
+}
+
+void route_book::merge(route& into, const route& r)
+{
+	const uint16_t runs = (uint16_t)std::min(0xFFFF, (int)into.runs + r.runs);
+	if (r.margin > into.margin)
+		into = r;
+	into.runs = runs;
+}
+
+bool route_book::open(const std::string& path)
+{
+	filename = path;
+	file.close();
+	table = nullptr;
+	capacity = count = 0;
+
+	std::error_code ec;
+	if (!std::filesystem::exists(path, ec))
+		return true;
+	if (!file.open(path, false) || file.size() < sizeof(header))
+		return false;
+
+	header h;
+	memcpy(&h, file.data(), sizeof(h));
+	if (h.magic != MAGIC || h.version != VERSION
+		|| h.capacity == 0 || (h.capacity & (h.capacity - 1)) != 0 || h.count >= h.capacity
+		|| file.size() != sizeof(header) + (size_t)h.capacity * sizeof(route))
+	{
+		file.close();
+		return false;
+	}
+
+	// the header keeps the table 8 byte aligned within the page aligned mapping
+	table = reinterpret_cast<const route*>(file.data() + sizeof(header));
+	capacity = h.capacity;
+	count = h.count;
+	return true;
+}
+
+const route_book::route* route_book::find(uint64_t key) const
+{
+	if (!table)
+		return nullptr;
+
+	// save() never fills the table, but a damaged file may have no empty
+	// slot to end the probe sequence, so it visits each slot at most once
+	const uint32_t mask = capacity - 1;
+	uint32_t i = (uint32_t)key & mask;
+	for (uint32_t n = 0; n < capacity; ++n, i = (i + 1) & mask)
+	{
+		if (table[i].key == key)
+			return &table[i];
+		if (table[i].key == 0)
+			return nullptr;
+	}
+	return nullptr;
+}
+
+void route_book::add(const route& r)
+{
+	auto it = added.find(r.key);
+	if (it == added.end())
+		added.emplace(r.key, r);
+	else
+		merge(it->second, r);
+}
+
+bool route_book::save()
+{
+	if (filename.empty())
+		return false;
+
+	std::unordered_map<uint64_t, route> routes = added;
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		if (table[i].key == 0)
+			continue;
+		auto it = routes.find(table[i].key);
+		if (it == routes.end())
+			routes.emplace(table[i].key, table[i]);
+		else
+			merge(it->second, table[i]);
+	}
+
+	std::vector<route> out(capacityFor(routes.size()));
+	for (const auto& kv : routes)
+		insert(out, kv.second);
+
+	header h = {};
+	h.magic = MAGIC;
+	h.version = VERSION;
+	h.capacity = (uint32_t)out.size();
+	h.count = (uint32_t)routes.size();
+
+	// the mapping has to be closed before the file can be replaced on Windows
+	file.close();
+	table = nullptr;
+
+	const std::string tmp = filename + ".tmp";
+	{
+		std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+		f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		f.write(reinterpret_cast<const char*>(out.data()), out.size() * sizeof(route));
+		if (!f.good())
+		{
+			f.close();
+			std::error_code ec;
+			std::filesystem::remove(tmp, ec);
+			open(filename);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp, filename, ec);
+	const bool ok = !ec && open(filename);
+	if (ok)
+		added.clear();
+	return ok;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "algo/th_recording.h"
+#include "util/mapped_file.h"
+
+/**
+ * \brief Decisions remembered by the world they were taken in.
+ *
+ * Touhou patterns are deterministic for a stage and difficulty, so a world seen
+ * in an earlier run is likely to be seen again, and the decision which survived
+ * it can be taken again. A route is keyed by the stage and a hash of the player
+ * and bullet positions, quantized to GRID pixels, in pool order. Keys match
+ * exactly, not within a distance: a world is only found if every object lies
+ * in the same cell and the pool holds them in the same order, so a single
+ * bullet crossing a cell border, or a pool slot reused differently, misses the
+ * route. A match is only a hint: algorithms validate a route against the
+ * current world before following it.
+ *
+ * On disk, the book is a header followed by an open addressing hash table with
+ * linear probing. The file is memory mapped and probed in place, so lookups are
+ * O(1) and never allocate. Routes added while playing, or by thanalytics from
+ * recordings, are kept aside and merged into the table by save(), where the
+ * route with the larger margin wins.
+ *
+ * Like th_recording, this only depends on records and not on the game model,
+ * so offline tools can build books.
+ */
+class route_book
+{
+public:
+	static const uint32_t MAGIC = 0x42524854;	// "THRB"
+	static const uint16_t VERSION = 1;
+	// Cell size positions are quantized to when hashing a world
+	static constexpr float GRID = 4.f;
+	// Smallest table written, in routes
+	static const uint32_t MIN_CAPACITY = 1024;
+
+	struct header
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t reserved;
+		// Slots of the table, a power of two
+		uint32_t capacity;
+		// Occupied slots
+		uint32_t count;
+	};
+
+	struct route
+	{
+		// See key(), 0 marks an empty slot
+		uint64_t key;
+		uint32_t stage;
+		// Game tick the route was taken on, which is only informative since
+		// ticks of the same world differ between runs
+		uint32_t gameTick;
+		// Movement direction (see control::Movement)
+		int8_t move;
+		// Combination of th_recording::frame_flags
+		uint8_t flags;
+		// Number of times the route was taken
+		uint16_t runs;
+		// Frames until collision of the move, see decision::risk
+		float margin;
+	};
+
+	/**
+	 * \brief Key a world
+	 * \param stage Stage being played
+	 * \param player The player
+	 * \param bullets Bullets in pool order
+	 * \param count Number of bullets
+	 * \return Key of the world, never 0
+	 */
+	static uint64_t key(uint32_t stage, const th_recording::object_record& player,
+		const th_recording::object_record* bullets, size_t count);
+
+	/**
+	 * \brief Combine two routes taken in the same world
+	 * \param into Route to update
+	 * \param r Route to merge, replacing the move of into if its margin is larger
+	 */
+	static void merge(route& into, const route& r);
+
+	route_book() = default;
+
+	route_book(const route_book& other) = delete;
+	route_book& operator=(const route_book& other) = delete;
+
+	/**
+	 * \brief Map a book. A missing file is an empty book, created by save().
+	 * \param path File of the book
+	 * \return Whether the file is missing or a valid book
+	 */
+	bool open(const std::string& path);
+
+	/**
+	 * \brief Find the route taken in a world. Safe to call from any thread,
+	 * as long as save() is not running.
+	 * \param key Key of the world
+	 * \return The route, or nullptr if the world is not in the mapped book
+	 */
+	const route* find(uint64_t key) const;
+
+	/**
+	 * \brief Remember a route until the next save()
+	 * \param r The route
+	 */
+	void add(const route& r);
+
+	/**
+	 * \brief Merge the added routes into the file and map it again. The file is
+	 * replaced atomically, so a failed save leaves the previous book intact.
+	 * \return Whether the book could be written
+	 */
+	bool save();
+
+	const std::string& path() const { return filename; }
+	// Routes in the mapped book
+	size_t size() const { return capacity ? count : 0; }
+	// Routes added since the last save()
+	size_t pending() const { return added.size(); }
+
+private:
+	std::string filename;
+	mapped_file file;
+	const route* table = nullptr;
+	uint32_t capacity = 0;
+	uint32_t count = 0;
+
+	std::unordered_map<uint64_t, route> added;
+};
@@ -0,0 +1,85 @@
+#include "stdafx.h"
+#include "target_field.h"
+
+#include <algorithm>
+
+#include "control/movement.h"
+#include "util/counters.h"
+
+void target_field::build(const entity& plyr, const std::vector<powerup>& powerups,
+	const std::vector<enemy>& enemies, float maxPlayerSpeed, float horizon)
+{
+	this->horizon = horizon;
+
+	/*
+	 * Powerups tend to be attracted towards the player, so the linear model of
+	 * the velocity obstacles is lax but good enough
+	 */
+	collectable.clear();
+	for (const powerup& p : powerups)
+	{
+		// Filter out unwanted powerups
+		if (p.meta == 0 && p.obj->com().y > POWERUP_MIN_Y)
+			collectable.push_back(&p);
+	}
+	TH_COUNT_N(Powerups, powerups.size());
+	TH_COUNT_N(PowerupsCollectable, collectable.size());
+	powerupField.build(plyr, collectable, maxPlayerSpeed, horizon);
+
+	const vec2 pc = plyr.com();
+	enemyX.clear();
+	for (const enemy& e : enemies)
+	{
+		const vec2 ec = e.obj->com();
+		if (ec.y < pc.y)
+			enemyX.push_back(ec.x - pc.x);
+	}
+	std::sort(enemyX.begin(), enemyX.end());
+}
+
+void target_field::addRing(float speed)
+{
+	powerupField.addRing(speed);
+}
+
+float target_field::timeToPowerup(const vec2& v) const
+{
+	const float t = powerupField.timeToCollision(v);
+	return t >= 0 ? t : FLT_MAX;
+}
+
+float target_field::timeToEnemy(const vec2& v, int dir) const
+{
+	if ((dir != control::Movement::Left && dir != control::Movement::Right) || v.x == 0)
+		return FLT_MAX;
+
+	// Nearest enemy in the direction of travel
+	float xDist;
+	if (v.x > 0)
+	{
+		auto it = std::lower_bound(enemyX.begin(), enemyX.end(), 0.f);
+		if (it == enemyX.end())
+			return FLT_MAX;
+		xDist = *it;
+	}
+	else
+	{
+		auto it = std::upper_bound(enemyX.begin(), enemyX.end(), 0.f);
+		if (it == enemyX.begin())
+			return FLT_MAX;
+		xDist = *(it - 1);
+	}
+
+	const float t = xDist / v.x;
+	return t <= horizon ? t : FLT_MAX;
+}
+
+float target_field::cost(const vec2& v, int dir, float& t) const
+{
+	const float tp = timeToPowerup(v);
+	const float te = timeToEnemy(v, dir);
+	const float cp = tp == FLT_MAX ? FLT_MAX : tp * POWERUP_WEIGHT;
+	const float ce = te == FLT_MAX ? FLT_MAX : te * ENEMY_WEIGHT;
+	t = cp <= ce ? tp : te;
+	return std::min(cp, ce);
+}
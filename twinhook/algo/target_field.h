@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include "util/vec2.h"
+#include "model/game_object.h"
+#include "algo/vo_field.h"
+
+/**
+ * \brief Cost of steering towards targets, i.e. powerups and enemies.
+ *
+ * Collectable powerups are indexed as velocity obstacles in their own
+ * vo_field, so the nearest powerup reached by a candidate velocity is a
+ * stabbing query over the sorted arcs of that velocity's ring rather than a
+ * swept test against every powerup. Enemies above the player are kept as
+ * sorted x offsets, so the nearest enemy to align with horizontally is a
+ * binary search.
+ *
+ * Both are combined into a weighted cost, in frames, which the algorithm
+ * compares against the time until collision of each candidate velocity.
+ */
+class target_field
+{
+public:
+	// Only powerups below this height are collected
+	static constexpr float POWERUP_MIN_Y = 200.f;
+	// Cost per frame spent reaching a powerup
+	static constexpr float POWERUP_WEIGHT = 1.f;
+	// Cost per frame spent aligning with an enemy, higher to prefer powerups
+	static constexpr float ENEMY_WEIGHT = 1.5f;
+
+	/**
+	 * \brief Index the targets of a frame
+	 * \param plyr Player entity
+	 * \param powerups Powerups of the frame
+	 * \param enemies Enemies of the frame
+	 * \param maxPlayerSpeed Maximum speed the player can achieve
+	 * \param horizon Number of frames to look ahead
+	 */
+	void build(const entity& plyr, const std::vector<powerup>& powerups,
+		const std::vector<enemy>& enemies, float maxPlayerSpeed, float horizon);
+
+	/**
+	 * \brief Precompute the powerups reached by all velocities of some speed
+	 * \param speed The speed of the ring
+	 */
+	void addRing(float speed);
+
+	/**
+	 * \brief Time until the nearest powerup is collected when moving at a velocity
+	 * \param v Player velocity
+	 * \return Frames until collection, or FLT_MAX if none is reached
+	 */
+	float timeToPowerup(const vec2& v) const;
+
+	/**
+	 * \brief Time until the player is below the nearest enemy when moving
+	 * Left or Right. Focused sideways moves are not scored, so approaching an
+	 * enemy does not make them attractive.
+	 * \param v Player velocity
+	 * \param dir Direction index of v, see control::Movement
+	 * \return Frames until alignment, or FLT_MAX if dir is not Left or Right or
+	 * no enemy lies ahead
+	 */
+	float timeToEnemy(const vec2& v, int dir) const;
+
+	/**
+	 * \brief Weighted cost of the nearest target when moving at a velocity
+	 * \param v Player velocity
+	 * \param dir Direction index of v, see control::Movement
+	 * \param t Returned frames until the target is reached, or FLT_MAX
+	 * \return The cost, or FLT_MAX if no target is reached
+	 */
+	float cost(const vec2& v, int dir, float& t) const;
+
+	size_t powerupCount() const { return powerupField.size(); }
+	size_t enemyCount() const { return enemyX.size(); }
+
+private:
+	vo_field powerupField;
+	std::vector<const game_object*> collectable;
+	// Sorted x offsets of enemies above the player, relative to the player
+	std::vector<float> enemyX;
+	float horizon = 6000.f;
+};
@@ -0,0 +1,147 @@
+#include "stdafx.h"
+#include "algo/th_algorithm.h"
+
+#include <chrono>
+
+#include "algo/route_book.h"
+#include "algo/th_recording.h"
+#include "algo/th_shadow.h"
+#include "control/movement_keys.h"
+#include "control/th_player.h"
+#include "hook/th_di8_hook.h"
+#include "ipc/th_telemetry.h"
+#include "util/counters.h"
+
+// Key a world from the same records that recordings hold, so books built
+// offline by thanalytics match the worlds seen while playing
+static uint64_t routeKey(const world_snapshot& world)
+{
+	std::vector<th_recording::object_record> bullets;
+	bullets.reserve(world.bullets.size());
+	for (const bullet& b : world.bullets)
+		bullets.push_back(th_recording::encode(b, 0));
+	return route_book::key(world.stage, th_recording::encode(*world.plyr, 0),
+		bullets.data(), bullets.size());
+}
+
+void th_algorithm::onBegin()
+{
+	state = createState();
+	hasLastDecision = false;
+	if (shadow)
+		shadow->reset();
+}
+
+void th_algorithm::onTick()
+{
+	if (!state)
+		state = createState();
+
+	if (!player->enabled)
+	{
+		releaseControl();
+		hasLastDecision = false;
+		if (player->tickAdvanced)
+		{
+			world_snapshot world = world_snapshot::capture(*player);
+			if (recorder)
+				recorder->record(world, nullptr);
+			observe(world, *state);
+		}
+		report(*state, nullptr);
+		return;
+	}
+
+	// the world is unchanged, so the previous decision still holds
+	if (player->tickAdvanced || !hasLastDecision)
+	{
+		world_snapshot world = world_snapshot::capture(*player);
+		if (routes)
+			world.routeKey = routeKey(world);
+		auto start = std::chrono::high_resolution_clock::now();
+		lastDecision = decide(world, *state);
+		auto end = std::chrono::high_resolution_clock::now();
+		hasLastDecision = true;
+		th_telemetry::sendDecision(player->gameTick, lastDecision);
+		if (recorder)
+			recorder->record(world, &lastDecision);
+
+		// bombs mark worlds which were not survived, so they make no route
+		if (routes && lastDecision.move >= 0 && !lastDecision.bomb && lastDecision.risk >= 0)
+		{
+			route_book::route r = {};
+			r.key = world.routeKey;
+			r.stage = world.stage;
+			r.gameTick = world.gameTick;
+			r.move = (int8_t)lastDecision.move;
+			r.flags = (lastDecision.fire ? th_recording::Fire : 0)
+				| (lastDecision.skip ? th_recording::Skip : 0);
+			r.runs = 1;
+			r.margin = lastDecision.risk;
+			routes->add(r);
+		}
+
+		if (shadow)
+			shadow->post(std::move(world), lastDecision,
+				std::chrono::duration<float, std::micro>(end - start).count());
+	}
+	apply(lastDecision);
+	TH_GAUGE(ChosenMargin, lastDecision.risk);
+	report(*state, &lastDecision);
+	if (shadow)
+		shadow->report();
+}
+
+void th_algorithm::apply(const decision& d)
+{
+	auto di8 = th_di8_hook::inst();
+
+	if (d.fire)
+		di8->setVkState(DIK_Z, DIK_KEY_DOWN);
+	if (d.skip)
+		di8->setVkState(DIK_LCONTROL, DIK_KEY_DOWN);
+
+	if (d.move >= 0 && d.move < control::Movement::MaxValue)
+	{
+		// release all control keys
+		for (int x : control::kControlKeys)
+			di8->resetVkState(x);
+
+		// press required keys for moving in desired direction
+		for (int i = 0; i < 3; ++i) {
+			if (control::kMovementToInput[d.move][i])
+				di8->setVkState(control::kMovementToInput[d.move][i], DIK_KEY_DOWN);
+		}
+	}
+
+	if (d.bomb)
+		di8->setVkState(DIK_X, DIK_KEY_DOWN);
+
+	for (const auto& k : d.keys)
+	{
+		switch (k.action)
+		{
+		case decision::key_override::Press:
+			di8->setVkState(k.vk, DIK_KEY_DOWN);
+			break;
+		case decision::key_override::Lift:
+			di8->setVkState(k.vk, DIK_KEY_UP);
+			break;
+		case decision::key_override::Release:
+			di8->resetVkState(k.vk);
+			break;
+		}
+	}
+}
+
+void th_algorithm::releaseControl()
+{
+	auto di8 = th_di8_hook::inst();
+	di8->resetVkState(DIK_LEFT);
+	di8->resetVkState(DIK_RIGHT);
+	di8->resetVkState(DIK_UP);
+	di8->resetVkState(DIK_DOWN);
+	di8->resetVkState(DIK_Z);
+	di8->resetVkState(DIK_LSHIFT);
+	di8->resetVkState(DIK_LCONTROL);
+}
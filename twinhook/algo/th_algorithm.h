@@ -1,10 +1,24 @@
 #pragma once
 
+#include "algo/th_decision.h"
+
 class th_player;
+class th_shadow;
+class th_recorder;
+class route_book;
 
 /**
- * \brief A player control algorithm, which determines an action to perform based on 
+ * \brief A player control algorithm, which determines an action to perform based on
  * current game state.
+ *
+ * Algorithms implement decide(), which is a pure function of a world snapshot
+ * and the algorithm's own state, and must not touch hooks or ImGui. This allows
+ * a single algorithm object to evaluate many snapshots concurrently (see
+ * th_batch.h). onTick() is the adapter between decide() and the game: it captures
+ * the snapshot from the player controller, applies the decision to DirectInput,
+ * and lets the algorithm report to the overlay. decide() and observe() are only
+ * called once per game tick, so algorithm state advances with the game rather
+ * than with the Direct3D frame rate.
  */
 class th_algorithm
 {
@@ -13,21 +27,106 @@ protected:
 	 * \brief Pointer to game specific player controller
 	 */
 	th_player *player;
+
+	/**
+	 * \brief State of the instance driving the game
+	 */
+	std::unique_ptr<algo_state> state;
+
+	/**
+	 * \brief Decision of the last game tick, reused while the game has not advanced
+	 */
+	decision lastDecision;
+	bool hasLastDecision = false;
+
+	/**
+	 * \brief Algorithm evaluated on the same frames without driving the game, or nullptr
+	 */
+	th_shadow *shadow = nullptr;
+
+	/**
+	 * \brief Recorder of every decided or observed game tick, or nullptr
+	 */
+	th_recorder *recorder = nullptr;
+
+	/**
+	 * \brief Book of routes taken in earlier runs, or nullptr. Decisions are added
+	 * to it, and algorithms may follow its routes.
+	 */
+	route_book *routes = nullptr;
+
+	/**
+	 * \brief Called every game tick the bot is disabled, e.g. to record the human player
+	 * \param world Snapshot of the current frame
+	 * \param state State of the instance driving the game
+	 */
+	virtual void observe(const world_snapshot& world, algo_state& state) {}
+
+	/**
+	 * \brief Report algorithm status to the overlay, called every frame
+	 * \param state State of the instance driving the game
+	 * \param d Decision of this frame, or nullptr if the bot is disabled
+	 */
+	virtual void report(const algo_state& state, const decision* d) {}
+
+	/**
+	 * \brief Apply a decision to the game's input
+	 * \param d Decision to apply
+	 */
+	static void apply(const decision& d);
+
+	/**
+	 * \brief Give control of all keys used by algorithms back to the user
+	 */
+	static void releaseControl();
 public:
 	/**
 	 * \brief Create a th_algorithm
 	 * \param player Pointer to player controller
 	 */
 	th_algorithm(th_player *player) : player(player) {}
-	
+	virtual ~th_algorithm() = default;
+
+	/**
+	 * \brief Evaluate another algorithm on every frame this algorithm decides on
+	 * \param shadow The shadow, or nullptr to stop shadowing
+	 */
+	void setShadow(th_shadow *shadow) { this->shadow = shadow; }
+
+	/**
+	 * \brief Record every game tick to a file, see th_recording
+	 * \param recorder The recorder, or nullptr to stop recording
+	 */
+	void setRecorder(th_recorder *recorder) { this->recorder = recorder; }
+
+	/**
+	 * \brief Key every decided world in a route book, and add the decisions to it
+	 * \param routes The book, or nullptr to stop using it
+	 */
+	void setRouteBook(route_book *routes) { this->routes = routes; }
+
+	/**
+	 * \brief Create the initial state of an instance of this algorithm
+	 * \return The initial state
+	 */
+	virtual std::unique_ptr<algo_state> createState() const = 0;
+
+	/**
+	 * \brief Decide on an action. Must be reentrant: all mutable data lives in state.
+	 * \param world Snapshot of the game state
+	 * \param state State of the instance deciding, updated by the decision
+	 * \return The action to perform
+	 */
+	virtual decision decide(const world_snapshot& world, algo_state& state) const = 0;
+
 	/**
 	 * \brief Called when the algorithm is initialized by the player controller
 	 */
-	virtual void onBegin() {};
+	virtual void onBegin();
 	/**
 	 * \brief Called every Direct3D frame
 	 */
-	virtual void onTick() = 0;
+	virtual void onTick();
 	/**
 	 * \brief Visualize algorithm functionality by drawing to framebuffer
 	 * \param d3dDev Pointer to game's Direct3DDevice
@@ -0,0 +1,32 @@
+#include "stdafx.h"
+#include "th_algorithm_registry.h"
+#include "algo/th_ann_algo.h"
+#include "algo/th_planner_algo.h"
+#include "algo/th_vo_algo.h"
+
+template<typename T>
+static std::shared_ptr<th_algorithm> make(th_player *player)
+{
+	return std::make_shared<T>(player);
+}
+
+std::unordered_map<std::string, th_registry::algorithm_factory_t> th_registry::mapAlgorithm{
+	{ "vo",  make<th_vo_algo> },
+	{ "vo_circle", [](th_player *player) -> std::shared_ptr<th_algorithm> {
+		return std::make_shared<th_vo_algo>(player, true);
+	} },
+	{ "ann", make<th_ann_algo> },
+	{ "planner", make<th_planner_algo> }
+};
+
+std::shared_ptr<th_algorithm> th_registry::createAlgorithm(const std::string& algoName, th_player* player)
+{
+	auto it = mapAlgorithm.find(algoName);
+	if (it == mapAlgorithm.end())
+	{
+		SPDLOG_ERROR("unknown algorithm {}", algoName);
+		return nullptr;
+	}
+	SPDLOG_INFO("create algorithm {}", algoName);
+	return it->second(player);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "algo/th_algorithm.h"
+
+namespace th_registry {
+	typedef std::shared_ptr<th_algorithm>(*algorithm_factory_t)(th_player *player);
+
+	extern std::unordered_map<std::string, algorithm_factory_t> mapAlgorithm;
+
+	/**
+	 * \brief Create an algorithm by name
+	 * \param algoName Name of the algorithm, e.g. "vo"
+	 * \param player Player controller to bind to
+	 * \return The algorithm, or nullptr if the name is unknown
+	 */
+	std::shared_ptr<th_algorithm> createAlgorithm(const std::string &algoName, th_player *player);
+}
@@ -0,0 +1,205 @@
+#include "stdafx.h"
+#include "algo/th_ann_algo.h"
+
+#include <chrono>
+
+#include <imgui.h>
+
+#include "config/th_config.h"
+#include "control/movement.h"
+#include "gfx/imgui_mixins.h"
+
+std::unique_ptr<algo_state> th_ann_algo::createState() const
+{
+	return std::make_unique<ann_state>();
+}
+
+void th_ann_algo::onBegin()
+{
+	th_algorithm::onBegin();
+	if (!network.loaded())
+		loadNetwork();
+}
+
+decision th_ann_algo::decide(const world_snapshot& world, algo_state& state) const
+{
+	auto& s = static_cast<ann_state&>(state);
+	decision d;
+	if (!network.loaded())
+		return d;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	extractFeatures(world, s);
+	network.evaluate(s.features, s.logits, s.workspace);
+	s.lastMove = (int)(std::max_element(s.logits, s.logits + control::Movement::MaxValue) - s.logits);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	s.inferenceMicros = std::chrono::duration<float, std::micro>(end - start).count();
+
+	d.fire = true;		// fire continuously
+	d.skip = true;		// skip dialogue continuously
+	d.move = s.lastMove;
+	return d;
+}
+
+void th_ann_algo::observe(const world_snapshot& world, algo_state& state)
+{
+	if (!sampling)
+		return;
+
+	auto& s = static_cast<ann_state&>(state);
+	extractFeatures(world, s);
+	recordSample(world, s);
+}
+
+void th_ann_algo::report(const algo_state& state, const decision* d)
+{
+	const auto& s = static_cast<const ann_state&>(state);
+
+	/* IMGUI Integration */
+	using namespace ImGui;
+	Begin("th_ann_algo");
+	Text("Learned Dodging Policy");
+	if (CollapsingHeader("Info", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		Text("network: %s", network.loaded() ? ANN_NETWORK_FILE : "not loaded");
+		SameLine(); ShowHelpMarker("Quantized network used for inference,\n"
+			"press K to reload it from disk");
+
+		Text("sampling: %s, %d samples, %d bytes", sampling ? "true" : "false",
+			(int)sampleCount, (int)sampleWriter.bytesWritten());
+		SameLine(); ShowHelpMarker("Samples are recorded while the bot is disabled,\n"
+			"press J to toggle sampling");
+
+		Text("inference: %.1f us", s.inferenceMicros);
+		SameLine(); ShowHelpMarker("Time spent extracting features and evaluating\n"
+			"the network in the last frame");
+	}
+
+	if (d && d->move < 0)
+		Text("no network, bot idle");
+	else if (d)
+	{
+		Text("move: %d", d->move);
+		PlotHistogram("logits", s.logits, control::Movement::MaxValue, 0, "",
+			FLT_MAX, FLT_MAX, ImVec2(0, 80));
+		SameLine(); ShowHelpMarker("Network output for each movement direction");
+	}
+
+	End();
+}
+
+void th_ann_algo::extractFeatures(const world_snapshot& world, ann_state& s)
+{
+	const auto& plyr = *world.plyr;
+
+	// sensors are rays at unit speed, so frames until collision equals distance
+	s.sensorField.build(*plyr.obj, world.dangerObjects(), 1.f, ANN_SENSOR_RANGE);
+	s.sensorField.addRing(1.f);
+
+	auto sensor = [](float t) {
+		// closer obstacles give a stronger response
+		return t < 0 ? 0.f : 1.f - std::min(t, ANN_SENSOR_RANGE) / ANN_SENSOR_RANGE;
+	};
+
+	for (int i = 0; i < ANN_RAY_COUNT; ++i)
+	{
+		float theta = 2.f * (float)M_PI * i / ANN_RAY_COUNT;
+		s.features[i] = sensor(s.sensorField.timeToCollision(vec2(cos(theta), sin(theta))));
+	}
+	s.features[ANN_RAY_COUNT] = sensor(s.sensorField.timeToCollision(vec2()));
+
+	vec2 com = plyr.obj->com();
+	float* walls = s.features + ANN_RAY_COUNT + 1;
+	walls[0] = std::max(0.f, std::min(1.f, com.x / th_param.GAME_WIDTH));
+	walls[1] = std::max(0.f, std::min(1.f, (th_param.GAME_WIDTH - com.x) / th_param.GAME_WIDTH));
+	walls[2] = std::max(0.f, std::min(1.f, com.y / th_param.GAME_HEIGHT));
+	walls[3] = std::max(0.f, std::min(1.f, (th_param.GAME_HEIGHT - com.y) / th_param.GAME_HEIGHT));
+}
+
+bool th_ann_algo::loadNetwork()
+{
+	if (!network.load(ANN_NETWORK_FILE))
+	{
+		SPDLOG_ERROR("could not load network {}", ANN_NETWORK_FILE);
+		return false;
+	}
+	if (network.inputs() != ANN_FEATURE_COUNT || network.outputs() != control::Movement::MaxValue)
+	{
+		SPDLOG_ERROR("network {} has shape {}->{}, expected {}->{}", ANN_NETWORK_FILE,
+			network.inputs(), network.outputs(), ANN_FEATURE_COUNT, (int)control::Movement::MaxValue);
+		network = qmlp();
+		return false;
+	}
+	SPDLOG_INFO("loaded network {}", ANN_NETWORK_FILE);
+	return true;
+}
+
+void th_ann_algo::recordSample(const world_snapshot& world, const ann_state& s)
+{
+	const th_kbd_state& kbd = world.kbd;
+
+	sample smp;
+	for (int i = 0; i < ANN_FEATURE_COUNT; ++i)
+		smp.features[i] = (uint8_t)std::lround(s.features[i] * 255.f);
+	smp.movement = (uint8_t)control::movementFromKeys(kbd.up, kbd.down, kbd.left, kbd.right, kbd.slow);
+	smp.keys = 0;
+	for (int i = 0; i < 8; ++i)
+		smp.keys |= (uint8_t)kbd.keys[i] << i;
+
+	sampleWriter.write(&smp, sizeof(smp));
+	++sampleCount;
+}
+
+void th_ann_algo::setSampling(bool sampling)
+{
+	if (sampling == this->sampling)
+		return;
+
+	if (sampling)
+	{
+		if (!sampleWriter.open(ANN_SAMPLE_FILE))
+		{
+			SPDLOG_ERROR("could not open sample file {}", ANN_SAMPLE_FILE);
+			return;
+		}
+		const uint32_t header[] = { SAMPLE_VERSION, ANN_FEATURE_COUNT };
+		sampleWriter.write("TWSP", 4);
+		sampleWriter.write(header, sizeof(header));
+		sampleCount = 0;
+		SPDLOG_INFO("recording samples to {}", ANN_SAMPLE_FILE);
+	}
+	else
+	{
+		sampleWriter.close();
+		SPDLOG_INFO("recorded {} samples", sampleCount);
+	}
+	this->sampling = sampling;
+}
+
+void th_ann_algo::handleInput(const BYTE diKeys[256], const BYTE press[256])
+{
+	if (press[DIK_J])
+		setSampling(!sampling);
+	if (press[DIK_K])
+		loadNetwork();
+}
+
+void th_ann_algo::visualize(IDirect3DDevice9* d3dDev)
+{
+	if (player->render)
+	{
+		auto plyr = player->getPlayerEntity();
+
+		for (const laser& l : player->lasers)
+			l.render();
+		for (const bullet& b : player->bullets)
+			b.render();
+		for (const enemy& e : player->enemies)
+			e.render();
+		for (const powerup& p : player->powerups)
+			p.render();
+		plyr.render();
+	}
+}
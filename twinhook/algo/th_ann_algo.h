@@ -0,0 +1,125 @@
+#pragma once
+#include "control/th_player.h"
+#include "control/movement.h"
+#include "algo/qmlp.h"
+#include "algo/vo_field.h"
+#include "util/async_file_writer.h"
+
+/* Feature Constants */
+static const int ANN_RAY_COUNT = 16;			// number of distance sensors around the player
+static const float ANN_SENSOR_RANGE = 200.f;	// pixels (frames at unit speed) a sensor can see
+// rays, holding position, distances to the four walls
+static const int ANN_FEATURE_COUNT = ANN_RAY_COUNT + 1 + 4;
+
+static const char* const ANN_NETWORK_FILE = "twinject_policy.qnn";
+static const char* const ANN_SAMPLE_FILE = "twinject_samples.bin";
+
+/**
+ * \brief Implementation of a learned dodging policy
+ *
+ * Overview:
+ * A small multilayer perceptron maps features of the current game state to
+ * one of the movement directions. The network is trained offline on samples
+ * of a human playing, which this algorithm records.
+ *
+ * Features:
+ * Distance sensors are cast in ANN_RAY_COUNT directions around the player. Each
+ * sensor is the time until collision when moving at unit speed in its direction,
+ * which is the distance to the nearest obstacle along the ray, accounting for
+ * obstacle motion. The sensors are evaluated with a vo_field, so the cost does not
+ * depend on the number of bullets on screen. The time until collision when holding
+ * position and the distances to the walls of the playfield complete the features.
+ * All features are normalized to [0, 1].
+ *
+ * Inference:
+ * The network is a qmlp, evaluated with int8 weights and activations. At the
+ * sizes this is intended for (a few hidden layers of width 64), inference takes
+ * a few microseconds; the overlay shows the measured time.
+ *
+ * Sampling:
+ * While sampling is enabled (toggled with J) and the bot is disabled, the
+ * features and the movement direction of the human player are appended to
+ * ANN_SAMPLE_FILE every frame. Disk I/O is done on a background thread.
+ *
+ * Sample file format (little endian):
+ *   char[4]	magic "TWSP"
+ *   uint32		version (1)
+ *   uint32		feature count
+ *   sample[]	records until the end of file, see sample
+ */
+class th_ann_algo : public th_algorithm
+{
+public:
+#pragma pack(push, 1)
+	struct sample
+	{
+		// Features quantized from [0, 1] to [0, 255]
+		uint8_t features[ANN_FEATURE_COUNT];
+		// Movement direction chosen by the player, see control::Movement
+		uint8_t movement;
+		// Raw keyboard state bits, see th_kbd_state
+		uint8_t keys;
+	};
+#pragma pack(pop)
+
+	static const uint32_t SAMPLE_VERSION = 1;
+
+	struct ann_state : algo_state
+	{
+		/* Features */
+		vo_field sensorField;
+		float features[ANN_FEATURE_COUNT] = { 0 };
+
+		/* Inference */
+		qmlp::workspace workspace;
+		float logits[control::Movement::MaxValue] = { 0 };
+		int lastMove = 0;
+		float inferenceMicros = 0;
+
+		std::unique_ptr<algo_state> clone() const override
+		{
+			return std::make_unique<ann_state>(*this);
+		}
+	};
+
+private:
+	qmlp network;
+
+	/**
+	 * \brief Compute the features of a snapshot into the state
+	 * \param world Snapshot of the current frame
+	 * \param s State to store the features in
+	 */
+	static void extractFeatures(const world_snapshot &world, ann_state &s);
+
+	bool loadNetwork();
+
+	/* Sampling */
+	bool sampling = false;
+	size_t sampleCount = 0;
+	async_file_writer sampleWriter;
+
+	void recordSample(const world_snapshot &world, const ann_state &s);
+
+protected:
+	void observe(const world_snapshot &world, algo_state &state) override;
+	void report(const algo_state &state, const decision *d) override;
+
+public:
+	th_ann_algo(th_player *player) : th_algorithm(player) {}
+
+	~th_ann_algo() = default;
+
+	std::unique_ptr<algo_state> createState() const override;
+	decision decide(const world_snapshot &world, algo_state &state) const override;
+
+	void onBegin() override;
+	void visualize(IDirect3DDevice9 *d3dDev) override;
+	void handleInput(const BYTE diKeys[256], const BYTE press[256]) override;
+
+	/**
+	 * \brief Start or stop recording samples to ANN_SAMPLE_FILE
+	 * \param sampling Whether to record samples
+	 */
+	void setSampling(bool sampling);
+};
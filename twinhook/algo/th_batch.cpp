@@ -0,0 +1,43 @@
+#include "stdafx.h"
+#include "algo/th_batch.h"
+
+#include <atomic>
+#include <thread>
+
+std::vector<decision> decideBatch(
+	const th_algorithm& algo,
+	const std::vector<world_snapshot>& worlds,
+	const algo_state& initial,
+	unsigned threads)
+{
+	std::vector<decision> decisions(worlds.size());
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = (unsigned)std::min<size_t>(threads, worlds.size());
+
+	// workers pull small chunks of snapshots, so uneven frames balance out
+	const size_t chunk = 16;
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]()
+	{
+		for (size_t begin = next.fetch_add(chunk); begin < worlds.size(); begin = next.fetch_add(chunk))
+		{
+			size_t end = std::min(begin + chunk, worlds.size());
+			for (size_t i = begin; i < end; ++i)
+			{
+				auto state = initial.clone();
+				decisions[i] = algo.decide(worlds[i], *state);
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads; ++i)
+		pool.emplace_back(worker);
+	worker();
+	for (auto& t : pool)
+		t.join();
+
+	return decisions;
+}
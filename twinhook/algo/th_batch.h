@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "algo/th_algorithm.h"
+
+/**
+ * \brief Evaluate an algorithm on many snapshots in parallel, e.g. recorded
+ * frames for regression testing and parameter tuning.
+ *
+ * Every snapshot is decided with a fresh copy of the initial state, so results
+ * do not depend on the order or thread in which snapshots are evaluated.
+ * \param algo Algorithm to evaluate, only decide() and createState() are used
+ * \param worlds Snapshots to decide on
+ * \param initial State to start each decision from, e.g. a calibrated state
+ * \param threads Number of worker threads, or 0 to use all hardware threads
+ * \return Decisions, in the same order as worlds
+ */
+std::vector<decision> decideBatch(
+	const th_algorithm &algo,
+	const std::vector<world_snapshot> &worlds,
+	const algo_state &initial,
+	unsigned threads = 0);
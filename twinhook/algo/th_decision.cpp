@@ -0,0 +1,38 @@
+#include "stdafx.h"
+#include "algo/th_decision.h"
+
+#include "control/th_player.h"
+#include "control/th10_player.h"
+#include "control/th11_player.h"
+#include "control/th15_player.h"
+
+world_snapshot world_snapshot::capture(th_player& p)
+{
+	world_snapshot world;
+	world.plyr = std::make_shared<player>(p.getPlayerEntity());
+	world.bullets = p.bullets;
+	world.enemies = p.enemies;
+	world.powerups = p.powerups;
+	world.lasers = p.lasers;
+	world.gameTick = p.gameTick;
+	world.stage = p.getStage();
+	world.kbd = p.getKeyboardState();
+	world.quality = p.governor.quality();
+	world.calibForward = dynamic_cast<th15_player*>(&p)
+		|| dynamic_cast<th10_player*>(&p)
+		|| dynamic_cast<th11_player*>(&p);
+	return world;
+}
+
+std::vector<const game_object*> world_snapshot::dangerObjects() const
+{
+	std::vector<const game_object*> objs;
+	objs.reserve(lasers.size() + bullets.size() + enemies.size());
+	for (const laser& l : lasers)
+		objs.push_back(&l);
+	for (const bullet& b : bullets)
+		objs.push_back(&b);
+	for (const enemy& e : enemies)
+		objs.push_back(&e);
+	return objs;
+}
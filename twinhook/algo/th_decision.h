@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "control/kbd_state.h"
+#include "model/game_object.h"
+
+class th_player;
+
+/**
+ * \brief Immutable copy of the game state an algorithm decides on.
+ *
+ * Snapshots own their objects, so they stay valid after the player controller
+ * clears its vectors, and can be recorded and evaluated on any thread.
+ */
+struct world_snapshot
+{
+	std::shared_ptr<player> plyr;
+	std::vector<bullet> bullets;
+	std::vector<enemy> enemies;
+	std::vector<powerup> powerups;
+	std::vector<laser> lasers;
+
+	// Game tick the snapshot was taken on, see th_player::detectTick
+	unsigned int gameTick = 0;
+
+	// Stage being played, or 0 if unknown, see th_player::getStage
+	unsigned int stage = 0;
+
+	// Key of the world in the route book, or 0 if no book is used, see route_book
+	uint64_t routeKey = 0;
+
+	// Keyboard state of the game when the snapshot was taken
+	th_kbd_state kbd = {};
+
+	// Quality level chosen by the frame governor, see quality_knob
+	float quality = 1.f;
+
+	// BUG why do MoF and LoLK do this differently
+	// Whether the player moves in the direction of the pressed key during calibration
+	bool calibForward = false;
+
+	/**
+	 * \brief Copy the current game state from a player controller
+	 * \param p Player controller which has polled the game
+	 * \return The snapshot
+	 */
+	static world_snapshot capture(th_player& p);
+
+	/**
+	 * \brief Get all objects which should be avoided
+	 * \return Pointers to lasers, bullets and enemies of this snapshot
+	 */
+	std::vector<const game_object*> dangerObjects() const;
+};
+
+/**
+ * \brief Mutable state of one algorithm instance, carried between decisions.
+ *
+ * Each algorithm derives its own state (calibration, histories, scratch
+ * buffers), so one algorithm object can drive several independent instances.
+ */
+struct algo_state
+{
+	virtual ~algo_state() = default;
+
+	/**
+	 * \brief Deep copy this state
+	 * \return The copy
+	 */
+	virtual std::unique_ptr<algo_state> clone() const = 0;
+};
+
+/**
+ * \brief Action decided by an algorithm for one frame.
+ */
+struct decision
+{
+	struct key_override
+	{
+		enum action_type
+		{
+			Press,		// hold the key down
+			Lift,		// hold the key up, ignoring the user
+			Release		// give control of the key back to the user
+		};
+
+		uint8_t vk;
+		action_type action;
+	};
+
+	// Movement direction (see control::Movement), or -1 to leave the movement keys alone
+	int move = -1;
+	bool fire = false;
+	bool bomb = false;
+	bool skip = false;
+
+	// Raw key overrides applied after the movement, e.g. for calibration sequences
+	std::vector<key_override> keys;
+
+	// Frames until collision of the chosen action, or -1 if unknown
+	float risk = -1;
+	// Frames until collision of the most threatened candidate move, i.e. the
+	// nearest threat whichever move is chosen, or -1 if unknown
+	float danger = -1;
+};
@@ -0,0 +1,136 @@
+#include "stdafx.h"
+#include "algo/th_planner_algo.h"
+
+#include <imgui.h>
+
+#include "algo/route_book.h"
+#include "config/th_config.h"
+#include "gfx/imgui_mixins.h"
+
+th_planner_algo::th_planner_algo(th_player* player) : th_vo_algo(player)
+{
+	// optional name of the planner's block, if it is not the default
+	size_t len;
+	char buf[256] = { 0 };
+	getenv_s(&len, buf, sizeof(buf), "planner");
+	blockName = len > 0 ? buf : planner::DEFAULT_NAME;
+}
+
+std::unique_ptr<algo_state> th_planner_algo::createState() const
+{
+	auto s = std::make_unique<planner_state>();
+	s->client = std::make_shared<planner::client>();
+	if (s->client->connect(blockName))
+	{
+		SPDLOG_INFO("Connected to planner '{}'", blockName);
+	}
+	else
+	{
+		// the client retries until a service with a free slot runs
+		SPDLOG_WARN("No planner '{}' or no free slot, deciding locally", blockName);
+	}
+	return s;
+}
+
+decision th_planner_algo::decide(const world_snapshot& world, algo_state& state) const
+{
+	auto& s = static_cast<planner_state&>(state);
+
+	// calibration and routes are handled by th_vo_algo
+	const bool onRoute = routes && world.routeKey && routes->find(world.routeKey);
+	if (s.isCalibrated && s.client && !onRoute)
+	{
+		decision d;
+		if (requestPlan(world, s, d))
+		{
+			++s.planned;
+			return d;
+		}
+		++s.missed;
+	}
+	++s.local;
+	return th_vo_algo::decide(world, state);
+}
+
+bool th_planner_algo::requestPlan(const world_snapshot& world, planner_state& s, decision& d) const
+{
+	planner::request* r = s.client->begin();
+	if (!r)
+		return false;
+
+	const auto& plyr = *world.plyr;
+	const int candidates = std::min((int)CANDIDATES_KNOB.at(world.quality), planner::MAX_MOVES);
+
+	r->gameTick = world.gameTick;
+	r->horizon = HORIZON_KNOB.at(world.quality);
+	r->predictor = kernels::activePredictor();
+	r->width = th_param.GAME_WIDTH;
+	r->height = th_param.GAME_HEIGHT;
+	r->moves = candidates;
+	for (int dir = 0; dir < candidates; ++dir)
+	{
+		const vec2 v = getPlayerMovement(s, dir);
+		r->velocity[dir][0] = v.x;
+		r->velocity[dir][1] = v.y;
+	}
+	r->player = th_recording::encode(plyr, 0);
+
+	// keep the obstacles nearest to the player if there are too many
+	auto dangers = world.dangerObjects();
+	if (dangers.size() > planner::MAX_OBJECTS)
+	{
+		const vec2 center = plyr.obj->com();
+		std::nth_element(dangers.begin(), dangers.begin() + planner::MAX_OBJECTS, dangers.end(),
+			[&](const game_object* a, const game_object* b)
+		{
+			return (a->obj->com() - center).lensq() < (b->obj->com() - center).lensq();
+		});
+		dangers.resize(planner::MAX_OBJECTS);
+	}
+	for (size_t i = 0; i < dangers.size(); ++i)
+		r->objects[i] = th_recording::encode(*dangers[i], 0);
+	r->objectCount = (uint32_t)dangers.size();
+
+	r->deadline = planner::now() + PLANNER_DEADLINE_US;
+	s.client->submit();
+
+	planner::response resp;
+	if (!s.client->wait(resp) || resp.move < 0 || resp.move >= candidates)
+		return false;
+
+	d.fire = true;		// fire continuously
+	d.skip = true;		// skip dialogue continuously
+	d.move = resp.move;
+	d.risk = resp.risk;
+	d.danger = *std::min_element(resp.ticks, resp.ticks + candidates);
+	d.bomb = resp.bomb != 0;
+
+	s.lastBatch = resp.batch;
+	for (int i = 1; i < vo_state::RISK_HISTORY_SIZE; ++i)
+		s.riskHistory[i - 1] = s.riskHistory[i];
+	s.riskHistory[vo_state::RISK_HISTORY_SIZE - 1] = d.danger;
+	return true;
+}
+
+void th_planner_algo::report(const algo_state& state, const decision* d)
+{
+	th_vo_algo::report(state, d);
+
+	const auto& s = static_cast<const planner_state&>(state);
+
+	/* IMGUI Integration */
+	using namespace ImGui;
+	Begin("th_planner_algo");
+	Text("planner: %s", blockName.c_str());
+	Text("slot: %s", s.client && s.client->connected() ? "connected" : "none");
+	SameLine(); ShowHelpMarker("Without a slot, every frame is decided locally");
+
+	Text("frames: %u planned, %u missed, %u local", s.planned, s.missed, s.local);
+	SameLine(); ShowHelpMarker("Missed frames were not answered in time\n"
+		"and are decided locally as well");
+
+	Text("batch: %u requests", s.lastBatch);
+	SameLine(); ShowHelpMarker("Requests the service planned together\n"
+		"with the last answer");
+	End();
+}
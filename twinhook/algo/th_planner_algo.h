@@ -0,0 +1,70 @@
+#pragma once
+
+#include "algo/th_vo_algo.h"
+#include "ipc/planner_slots.h"
+
+/* Planner Constants */
+static const int PLANNER_DEADLINE_US = 2000;	// microseconds to wait for the service per game tick
+
+/**
+ * \brief Velocity obstacle algorithm which leaves dodging to a shared planner
+ *
+ * Overview:
+ * Several games, each with a bot, can share one planner service (see thplanner)
+ * which batches the requests of all of them on a worker pool. Every game tick
+ * the obstacles and the velocities of the candidate moves are published to this
+ * instance's slot, and the planner's move is applied if it arrives within
+ * PLANNER_DEADLINE_US. The service plans with the batch collision kernels on
+ * bounding boxes or circles, see planner::request, and picks the move with the
+ * longest time until collision like th_vo_algo does without a target.
+ *
+ * Calibration, route following and frames without an answer (no service, all
+ * slots taken, deadline missed) are decided locally by th_vo_algo, so the bot
+ * keeps playing when the service is slow or goes away.
+ */
+class th_planner_algo : public th_vo_algo
+{
+public:
+	struct planner_state : vo_state
+	{
+		// Slot of this instance, or nullptr if there was none
+		std::shared_ptr<planner::client> client;
+
+		/* IMGUI Integration */
+		unsigned int planned = 0;
+		unsigned int missed = 0;
+		unsigned int local = 0;
+		unsigned int lastBatch = 0;
+
+		std::unique_ptr<algo_state> clone() const override
+		{
+			// a slot serves one instance, clones decide locally
+			auto c = std::make_unique<planner_state>(*this);
+			c->client.reset();
+			return c;
+		}
+	};
+
+private:
+	// Name of the service's block of slots
+	std::string blockName;
+
+	/**
+	 * \brief Ask the service for a decision
+	 * \param world Snapshot of the current frame
+	 * \param s Calibrated state, connected to the service
+	 * \param d Decision to fill with the service's move
+	 * \return Whether the service answered in time
+	 */
+	bool requestPlan(const world_snapshot &world, planner_state &s, decision &d) const;
+
+protected:
+	void report(const algo_state &state, const decision *d) override;
+
+public:
+	th_planner_algo(th_player *player);
+	~th_planner_algo() = default;
+
+	std::unique_ptr<algo_state> createState() const override;
+	decision decide(const world_snapshot &world, algo_state &state) const override;
+};
@@ -0,0 +1,139 @@
+#include "algo/th_recording.h"
+
+#include <cstring>
+
+#include "algo/th_decision.h"
+#include "model/object.h"
+
+th_recording::object_record th_recording::encode(const game_object& o, uint32_t meta)
+{
+	const entity& e = *o.obj;
+	object_record r = {};
+	r.vx = e.velocity.x;
+	r.vy = e.velocity.y;
+	r.meta = meta;
+	r.shape = (uint8_t)e.type;
+
+	switch (e.type)
+	{
+	case entity::AABB: {
+		const auto& a = static_cast<const aabb&>(e);
+		r.x = a.position.x + a.size.x / 2;
+		r.y = a.position.y + a.size.y / 2;
+		r.w = a.size.x;
+		r.h = a.size.y;
+		break;
+	}
+	case entity::Circle: {
+		const auto& c = static_cast<const circle&>(e);
+		r.x = c.center.x;
+		r.y = c.center.y;
+		r.w = r.h = 2 * c.radius;
+		break;
+	}
+	default: {
+		const auto box = e.boundingBox();
+		r.x = box->position.x + box->size.x / 2;
+		r.y = box->position.y + box->size.y / 2;
+		r.w = box->size.x;
+		r.h = box->size.y;
+		break;
+	}
+	}
+	return r;
+}
+
+bool th_recorder::open(const std::string& filename, const std::string& game)
+{
+	close();
+	if (!out.open(filename))
+		return false;
+
+	th_recording::file_header h = {};
+	h.magic = th_recording::FILE_MAGIC;
+	h.version = th_recording::VERSION;
+	memcpy(h.game, game.data(), std::min(game.size(), sizeof(h.game)));
+	out.write(&h, sizeof(h));
+
+	chunk.clear();
+	chunk.resize(sizeof(th_recording::chunk_header));
+	chunkFrames = 0;
+	frames = 0;
+	return true;
+}
+
+void th_recorder::record(const world_snapshot& world, const decision* d)
+{
+	if (!out.isOpen())
+		return;
+
+	using namespace th_recording;
+	frame_record f = {};
+	f.gameTick = world.gameTick;
+	f.stage = (uint16_t)world.stage;
+	f.bullets = (uint16_t)std::min<size_t>(world.bullets.size(), 0xFFFF);
+	f.enemies = (uint16_t)std::min<size_t>(world.enemies.size(), 0xFFFF);
+	f.powerups = (uint16_t)std::min<size_t>(world.powerups.size(), 0xFFFF);
+	f.lasers = (uint16_t)std::min<size_t>(world.lasers.size(), 0xFFFF);
+	if (d)
+	{
+		f.move = (int8_t)d->move;
+		f.flags = (d->fire ? Fire : 0) | (d->bomb ? Bomb : 0) | (d->skip ? Skip : 0);
+		f.risk = d->risk;
+	}
+	else
+	{
+		f.move = -1;
+		f.flags = Observed;
+		f.risk = -1;
+	}
+	f.player = encode(*world.plyr, 0);
+
+	size_t pos = chunk.size();
+	chunk.resize(pos + sizeof(f) + f.objectCount() * sizeof(object_record));
+	memcpy(&chunk[pos], &f, sizeof(f));
+	pos += sizeof(f);
+
+	auto put = [&](const game_object& o, uint32_t meta)
+	{
+		const object_record r = encode(o, meta);
+		memcpy(&chunk[pos], &r, sizeof(r));
+		pos += sizeof(r);
+	};
+	for (size_t i = 0; i < f.bullets; ++i)
+		put(world.bullets[i], (uint32_t)world.bullets[i].meta);
+	for (size_t i = 0; i < f.enemies; ++i)
+		put(world.enemies[i], 0);
+	for (size_t i = 0; i < f.powerups; ++i)
+		put(world.powerups[i], (uint32_t)world.powerups[i].meta);
+	for (size_t i = 0; i < f.lasers; ++i)
+		put(world.lasers[i], 0);
+
+	++frames;
+	if (++chunkFrames == CHUNK_FRAMES)
+		flushChunk();
+}
+
+void th_recorder::flushChunk()
+{
+	if (chunkFrames == 0)
+		return;
+
+	th_recording::chunk_header h = {};
+	h.magic = th_recording::CHUNK_MAGIC;
+	h.frames = chunkFrames;
+	h.bytes = (uint32_t)(chunk.size() - sizeof(h));
+	memcpy(chunk.data(), &h, sizeof(h));
+	out.write(chunk.data(), chunk.size());
+
+	chunk.resize(sizeof(th_recording::chunk_header));
+	chunkFrames = 0;
+}
+
+void th_recorder::close()
+{
+	if (!out.isOpen())
+		return;
+	flushChunk();
+	out.close();
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "util/async_file_writer.h"
+
+struct world_snapshot;
+struct decision;
+class game_object;
+
+/**
+ * \brief Compact binary recordings of the frames an algorithm decided on.
+ *
+ * A recording is a file_header followed by chunks of CHUNK_FRAMES frames. Each
+ * chunk starts with a chunk_header holding its size, so readers can index a
+ * memory mapped file by hopping over chunks and then decode chunks in parallel.
+ * Within a chunk, every frame is a frame_record followed by its bullets,
+ * enemies, powerups and lasers as object_records. All fields are little endian
+ * and 4 byte aligned, so records can be read in place.
+ *
+ * Readers only need this header, see thanalytics.
+ */
+namespace th_recording
+{
+	static const uint32_t FILE_MAGIC = 0x43524854;		// "THRC"
+	static const uint32_t CHUNK_MAGIC = 0x4B4E4843;	// "CHNK"
+	static const uint16_t VERSION = 1;
+	static const uint32_t CHUNK_FRAMES = 256;
+
+	struct file_header
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t reserved;
+		// Game the recording was made in, e.g. "th10", null padded
+		char game[8];
+	};
+
+	struct chunk_header
+	{
+		uint32_t magic;
+		uint32_t frames;
+		// Bytes of frames following this header
+		uint32_t bytes;
+		uint32_t reserved;
+	};
+
+	enum frame_flags : uint8_t
+	{
+		Fire = 1,
+		Bomb = 2,
+		Skip = 4,
+		// The player controller was disabled, the decision was not applied
+		Observed = 8
+	};
+
+	/**
+	 * \brief A game object, reduced to its bounding box and velocity
+	 */
+	struct object_record
+	{
+		// Center of mass
+		float x, y;
+		float vx, vy;
+		// Bounding box size, the diameter for circles
+		float w, h;
+		// Game specific type of bullets and powerups, 0 otherwise
+		uint32_t meta;
+		// entity::entity_type of the original shape
+		uint8_t shape;
+		uint8_t reserved[3];
+	};
+
+	struct frame_record
+	{
+		uint32_t gameTick;
+		uint16_t stage;
+		uint16_t bullets;
+		uint16_t enemies;
+		uint16_t powerups;
+		uint16_t lasers;
+		// Movement direction (see control::Movement), or -1
+		int8_t move;
+		// Combination of frame_flags
+		uint8_t flags;
+		// Frames until collision of the chosen move, see decision::risk
+		float risk;
+		object_record player;
+
+		uint32_t objectCount() const { return (uint32_t)bullets + enemies + powerups + lasers; }
+		const object_record* objects() const { return reinterpret_cast<const object_record*>(this + 1); }
+		const frame_record* next() const
+		{
+			return reinterpret_cast<const frame_record*>(objects() + objectCount());
+		}
+	};
+
+	/**
+	 * \brief Reduce a game object to a record
+	 */
+	object_record encode(const game_object& o, uint32_t meta);
+
+	/**
+	 * \brief Check a file header
+	 * \param data Start of the file
+	 * \param size Size of the file
+	 * \return Whether the file is a recording of this version
+	 */
+	inline bool validHeader(const uint8_t* data, size_t size)
+	{
+		if (size < sizeof(file_header))
+			return false;
+		file_header h;
+		memcpy(&h, data, sizeof(h));
+		return h.magic == FILE_MAGIC && h.version == VERSION;
+	}
+
+	/**
+	 * \brief Find the chunks of a recording, stopping at the first truncated or
+	 * corrupt chunk, e.g. at the end of a recording which was cut off
+	 * \param data Start of the file
+	 * \param size Size of the file
+	 * \return Offsets of the chunk headers
+	 */
+	inline std::vector<size_t> indexChunks(const uint8_t* data, size_t size)
+	{
+		std::vector<size_t> chunks;
+		if (!validHeader(data, size))
+			return chunks;
+
+		size_t offset = sizeof(file_header);
+		while (size - offset >= sizeof(chunk_header))
+		{
+			chunk_header h;
+			memcpy(&h, data + offset, sizeof(h));
+			if (h.magic != CHUNK_MAGIC || h.bytes > size - offset - sizeof(chunk_header))
+				break;
+			chunks.push_back(offset);
+			offset += sizeof(chunk_header) + h.bytes;
+		}
+		return chunks;
+	}
+}
+
+/**
+ * \brief Records every decided frame to a file, see th_recording.
+ *
+ * Frames are encoded into a chunk buffer on the game thread and handed to an
+ * async_file_writer once the chunk is full, so the disk is never touched on
+ * the game thread.
+ */
+class th_recorder
+{
+	async_file_writer out;
+	std::vector<uint8_t> chunk;
+	uint32_t chunkFrames = 0;
+	uint64_t frames = 0;
+
+	void flushChunk();
+
+public:
+	th_recorder() = default;
+	~th_recorder() { close(); }
+
+	th_recorder(const th_recorder& other) = delete;
+	th_recorder& operator=(const th_recorder& other) = delete;
+
+	/**
+	 * \brief Start a recording, truncating the file
+	 * \param filename File to write
+	 * \param game Game identifier stored in the header, e.g. "th10"
+	 * \return Whether the file could be opened
+	 */
+	bool open(const std::string& filename, const std::string& game);
+
+	/**
+	 * \brief Append a frame
+	 * \param world Snapshot decided on
+	 * \param d Decision taken, or nullptr if the algorithm only observed
+	 */
+	void record(const world_snapshot& world, const decision* d);
+
+	/**
+	 * \brief Write the last partial chunk and close the file
+	 */
+	void close();
+
+	bool isOpen() const { return out.isOpen(); }
+	uint64_t recordedFrames() const { return frames; }
+};
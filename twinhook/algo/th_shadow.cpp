@@ -0,0 +1,145 @@
+#include "stdafx.h"
+#include "algo/th_shadow.h"
+
+#include <chrono>
+#include <cmath>
+#include <string>
+
+#include <imgui.h>
+
+#include "gfx/imgui_mixins.h"
+
+void latency_histogram::add(float micros)
+{
+	int b = micros < 1.f ? 0 : 1 + (int)std::log2(micros);
+	buckets[std::min(b, BUCKETS - 1)] += 1;
+	++count;
+	maxMicros = std::max(maxMicros, micros);
+}
+
+float latency_histogram::percentile(float p) const
+{
+	const float target = p * count;
+	float sum = 0;
+	for (int b = 0; b < BUCKETS; ++b)
+	{
+		sum += buckets[b];
+		if (sum >= target && sum > 0)
+			return (float)(1 << b);
+	}
+	return maxMicros;
+}
+
+th_shadow::th_shadow(std::string name, std::shared_ptr<th_algorithm> algo)
+	: name(std::move(name)), algo(std::move(algo))
+{
+	state = this->algo->createState();
+	if (log.open(SHADOW_LOG_FILE))
+	{
+		const std::string header = "tick,primary_move,shadow_move,primary_us,shadow_us\n";
+		log.write(header.data(), header.size());
+	}
+	else
+	{
+		SPDLOG_ERROR("could not open shadow log {}", SHADOW_LOG_FILE);
+	}
+	worker = std::thread(&th_shadow::run, this);
+	SPDLOG_INFO("shadowing with algorithm {}", this->name);
+}
+
+th_shadow::~th_shadow()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	cv.notify_all();
+	worker.join();
+	log.close();
+}
+
+void th_shadow::reset()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	cv.wait(lock, [this] { return !busy; });
+	hasPending = false;
+	// The worker is idle and cannot pick up a frame while we hold the lock
+	algo->onBegin();
+	state = algo->createState();
+}
+
+void th_shadow::post(world_snapshot&& world, const decision& d, float micros)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (hasPending)
+			++dropped;
+		pendingWorld = std::move(world);
+		pendingDecision = d;
+		pendingMicros = micros;
+		hasPending = true;
+	}
+	cv.notify_all();
+}
+
+void th_shadow::run()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true)
+	{
+		cv.wait(lock, [this] { return stopping || hasPending; });
+		if (stopping)
+			break;
+
+		world_snapshot world = std::move(pendingWorld);
+		const decision primary = pendingDecision;
+		const float primaryMicros = pendingMicros;
+		hasPending = false;
+		busy = true;
+		lock.unlock();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		const decision d = algo->decide(world, *state);
+		auto end = std::chrono::high_resolution_clock::now();
+		const float micros = std::chrono::duration<float, std::micro>(end - start).count();
+
+		const std::string line = std::to_string(world.gameTick) + ","
+			+ std::to_string(primary.move) + "," + std::to_string(d.move) + ","
+			+ std::to_string(primaryMicros) + "," + std::to_string(micros) + "\n";
+		log.write(line.data(), line.size());
+
+		lock.lock();
+		busy = false;
+		++frames;
+		if (d.move == primary.move && d.bomb == primary.bomb)
+			++agreements;
+		primaryLatency.add(primaryMicros);
+		shadowLatency.add(micros);
+		cv.notify_all();
+	}
+}
+
+void th_shadow::report()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+
+	/* IMGUI Integration */
+	using namespace ImGui;
+	Begin("th_shadow");
+	Text("shadow: %s", name.c_str());
+	Text("agreement: %.1f%% of %d frames", frames ? 100.f * agreements / frames : 0.f, (int)frames);
+	SameLine(); ShowHelpMarker("Frames where the shadow chose the same movement\n"
+		"and bomb as the driving algorithm");
+	Text("dropped: %d frames", (int)dropped);
+	SameLine(); ShowHelpMarker("Frames skipped because the shadow was still busy");
+
+	Text("primary: p50 %.0f us, p99 %.0f us, max %.0f us", primaryLatency.percentile(0.5f),
+		primaryLatency.percentile(0.99f), primaryLatency.maxMicros);
+	PlotHistogram("primary us", primaryLatency.buckets, latency_histogram::BUCKETS, 0, "log2",
+		0, FLT_MAX, ImVec2(0, 60));
+	Text("shadow: p50 %.0f us, p99 %.0f us, max %.0f us", shadowLatency.percentile(0.5f),
+		shadowLatency.percentile(0.99f), shadowLatency.maxMicros);
+	PlotHistogram("shadow us", shadowLatency.buckets, latency_histogram::BUCKETS, 0, "log2",
+		0, FLT_MAX, ImVec2(0, 60));
+	End();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "algo/th_algorithm.h"
+#include "util/async_file_writer.h"
+
+#define SHADOW_LOG_FILE "twinject_shadow.csv"
+
+/**
+ * \brief Histogram of compute latencies, with power of two microsecond buckets.
+ */
+struct latency_histogram
+{
+	// Bucket i counts latencies within [2^(i-1), 2^i) us, bucket 0 those below 1 us
+	static const int BUCKETS = 16;
+
+	float buckets[BUCKETS] = { 0 };
+	uint32_t count = 0;
+	float maxMicros = 0;
+
+	void add(float micros);
+
+	/**
+	 * \brief Upper bound of the bucket containing a percentile
+	 * \param p Percentile within [0, 1]
+	 * \return Latency in microseconds
+	 */
+	float percentile(float p) const;
+};
+
+/**
+ * \brief Runs a second algorithm in the shadow of the one driving the game.
+ *
+ * The driving algorithm posts each snapshot it decided on, together with its
+ * decision and latency. A worker thread decides on the same snapshot with the
+ * shadow algorithm, whose decisions are never applied to the game. Per-frame
+ * agreement of the two, and the latency of both, are collected for the overlay
+ * and every frame is logged to SHADOW_LOG_FILE.
+ *
+ * There is a single slot for pending snapshots, so the shadow never queues
+ * work behind the game: frames posted while the worker is busy are dropped and
+ * counted. Shadows which calibrate by moving the player (th_vo_algo) only
+ * calibrate correctly behind a driving algorithm which calibrates the same way.
+ */
+class th_shadow
+{
+public:
+	/**
+	 * \brief Start a shadow
+	 * \param name Name of the shadow algorithm, for display
+	 * \param algo Shadow algorithm, only decide() and createState() are called
+	 * on the worker thread
+	 */
+	th_shadow(std::string name, std::shared_ptr<th_algorithm> algo);
+	~th_shadow();
+
+	th_shadow(const th_shadow& other) = delete;
+	th_shadow& operator=(const th_shadow& other) = delete;
+
+	/**
+	 * \brief Restart the shadow algorithm along with the driving algorithm,
+	 * waiting for the frame in progress
+	 */
+	void reset();
+
+	/**
+	 * \brief Hand a decided frame to the shadow
+	 * \param world Snapshot the driving algorithm decided on
+	 * \param d Decision of the driving algorithm
+	 * \param micros Compute latency of the driving algorithm
+	 */
+	void post(world_snapshot&& world, const decision& d, float micros);
+
+	/**
+	 * \brief Report agreement and latencies to the overlay
+	 */
+	void report();
+
+private:
+	std::string name;
+	std::shared_ptr<th_algorithm> algo;
+	std::unique_ptr<algo_state> state;
+
+	std::thread worker;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool stopping = false;
+	bool busy = false;
+
+	// Pending frame, guarded by mtx
+	bool hasPending = false;
+	world_snapshot pendingWorld;
+	decision pendingDecision;
+	float pendingMicros = 0;
+
+	// Statistics, guarded by mtx
+	uint32_t frames = 0;
+	uint32_t agreements = 0;
+	uint32_t dropped = 0;
+	latency_histogram primaryLatency;
+	latency_histogram shadowLatency;
+
+	async_file_writer log;
+
+	void run();
+};
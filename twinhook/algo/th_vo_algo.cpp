@@ -4,65 +4,56 @@
 
 #include <imgui.h>
 
+#include "algo/route_book.h"
 #include "config/th_config.h"
 #include "control/movement.h"
 #include "control/th_player.h"
-#include "control/th11_player.h"
-#include "control/th15_player.h"
-#include "control/th10_player.h"
 #include "gfx/imgui_mixins.h"
-#include "hook/th_di8_hook.h"
 #include "util/cdraw.h"
 #include "util/color.h"
+#include "util/counters.h"
 
-void th_vo_algo::onBegin()
+const quality_knob th_vo_algo::HORIZON_KNOB = { "vo horizon", VO_HORIZON, VO_MIN_HORIZON, false };
+const quality_knob th_vo_algo::CANDIDATES_KNOB = { "vo candidates",
+	control::Movement::MaxValue, control::Movement::FocusUp, true };
+const quality_knob th_vo_algo::VIZ_RESOLUTION_KNOB = { "viz resolution",
+	VEC_FIELD_MIN_RESOLUTION, VEC_FIELD_MAX_RESOLUTION, false };
+
+std::unique_ptr<algo_state> th_vo_algo::createState() const
 {
-	calibInit();
+	return std::make_unique<vo_state>();
 }
 
-void th_vo_algo::onTick()
+void th_vo_algo::onBegin()
 {
-	/* IMGUI Integration */
-	using namespace ImGui;
-	Begin("th_vo_algo");
-	Text("Constrained Velocity Obstacle Algorithm");
-	if (CollapsingHeader("Info", ImGuiTreeNodeFlags_DefaultOpen))
-	{
-		Text("calib: %s", isCalibrated ? "true" : "false");
-		SameLine(); ShowHelpMarker("Algorithm player speed calibration");
-
-		Text("calib vel: norm %.2f, foc %.2f", playerVel, playerFocVel);
-		SameLine(); ShowHelpMarker("Calibrated velocities in normal and focused mode");
-
-		Text("col test: %s", hitCircle ? "hit circle" : "hit box");
-		SameLine(); ShowHelpMarker("Collision test used");
-	}
-
-	auto di8 = th_di8_hook::inst();
+	th_algorithm::onBegin();
+	player->governor.addKnob(&HORIZON_KNOB);
+	player->governor.addKnob(&CANDIDATES_KNOB);
+	player->governor.addKnob(&VIZ_RESOLUTION_KNOB);
+}
 
-	if (!player->enabled) {
-		di8->resetVkState(DIK_LEFT);
-		di8->resetVkState(DIK_RIGHT);
-		di8->resetVkState(DIK_UP);
-		di8->resetVkState(DIK_DOWN);
-		di8->resetVkState(DIK_Z);
-		di8->resetVkState(DIK_LSHIFT);
-		di8->resetVkState(DIK_LCONTROL);
-		End();
-		return;
-	}
+decision th_vo_algo::decide(const world_snapshot& world, algo_state& state) const
+{
+	auto& s = static_cast<vo_state&>(state);
+	decision d;
 
-	if (!isCalibrated)
+	if (!s.isCalibrated)
 	{
-		isCalibrated = calibTick();
-		if (isCalibrated) {
-			SPDLOG_INFO("calibrated plyr vel: {} {}", playerVel, playerFocVel);
+		s.isCalibrated = calibTick(world, s, d);
+		if (s.isCalibrated) {
+			SPDLOG_INFO("calibrated plyr vel: {} {}", s.playerVel, s.playerFocVel);
 		}
-		End();
-		return;
+		return d;
 	}
 
-	auto plyr = player->getPlayerEntity();
+	if (routes && world.routeKey && followRoute(world, s, d))
+		return d;
+
+	const auto& plyr = *world.plyr;
+
+	// Quality knobs, scaled down by the frame governor under budget pressure
+	const float horizon = HORIZON_KNOB.at(world.quality);
+	const int candidates = (int)CANDIDATES_KNOB.at(world.quality);
 
 	/*
 	 * Ticks until collision whilst moving in this direction
@@ -74,114 +65,59 @@ void th_vo_algo::onTick()
 	bool bounded = true;
 
 	std::shared_ptr<entity> pseudoPlayers[control::Movement::MaxValue];
-	for (int dir = 0; dir < control::Movement::MaxValue; ++dir)
+	for (int dir = 0; dir < candidates; ++dir)
 	{
-		vec2 pvel = this->getPlayerMovement(dir);
+		vec2 pvel = getPlayerMovement(s, dir);
 		pseudoPlayers[dir] = plyr.obj->withVelocity(pvel);
 	}
 
-	// Bullet collision frame calculations
-	for (auto b = player->bullets.begin(); b != player->bullets.end(); ++b)
-	{
-		for (int dir = 0; dir < control::Movement::MaxValue; ++dir)
-		{
-			const auto pseudoPlayer = pseudoPlayers[dir];
-			float colTick = pseudoPlayer->willCollideWith(*b->obj);
-
-			if (colTick >= 0) {
-				collisionTicks[dir] = std::min(colTick, collisionTicks[dir]);
-				bounded = false;
-			}
-		}
-	}
-
-	for (auto b = player->enemies.begin(); b != player->enemies.end(); ++b)
+	// Bullet, enemy and laser collision frame calculations
+	float maxSpeed = 0;
+	for (int dir = 0; dir < candidates; ++dir)
+		maxSpeed = std::max(maxSpeed, getPlayerMovement(s, dir).len());
+
+	const auto dangers = world.dangerObjects();
+	s.voField.setPredictor(kernels::activePredictor());
+	s.voField.build(*plyr.obj, dangers, maxSpeed, horizon);
+	TH_COUNT_N(Obstacles, dangers.size());
+	TH_COUNT_N(ObstaclesCulled, s.voField.culled());
+	TH_COUNT_N(ObstaclesOverlapping, s.voField.overlapping());
+	TH_COUNT_N(ObstaclesClustered, s.voField.clustered());
+	for (int dir = 1; dir < candidates; ++dir)
+		s.voField.addRing(getPlayerMovement(s, dir).len());
+
+	for (int dir = 0; dir < candidates; ++dir)
 	{
-		for (int dir = 0; dir < control::Movement::MaxValue; ++dir)
-		{
-			const auto pseudoPlayer = pseudoPlayers[dir];
-			float colTick = pseudoPlayer->willCollideWith(*b->obj);
+		float colTick = s.voField.timeToCollision(getPlayerMovement(s, dir));
 
-			if (colTick >= 0) {
-				collisionTicks[dir] = std::min(colTick, collisionTicks[dir]);
-				bounded = false;
-			}
+		if (colTick >= 0) {
+			collisionTicks[dir] = colTick;
+			bounded = false;
 		}
 	}
 
-	for (laser l : player->lasers)
-	{
-		for (int dir = 0; dir < control::Movement::MaxValue; ++dir)
-		{
-			const auto pseudoPlayer = pseudoPlayers[dir];
-			float colTick = pseudoPlayer->willCollideWith(*l.obj);
-
-			if (colTick >= 0) {
-				collisionTicks[dir] = std::min(colTick, collisionTicks[dir]);
-				bounded = false;
-			}
-		}
-	}
+	// Continuous alternatives at normal speed, i.e. directions with no velocity obstacle
+	s.voField.freeArcs(s.playerVel, s.freeArcs);
 
 	/*
-	 * Powerup collision frame calculations
+	 * Target calculations
 	 * Note: Powerups do not move linearly so using a linear model might be poor.
 	 */
 
-	 // Ticks until collision with target whilst moving in this direction
+	// Ticks until reaching the nearest target whilst moving in this direction,
+	// and the weighted cost of that target
 	float targetTicks[control::Movement::MaxValue];
-	std::fill_n(targetTicks, control::Movement::MaxValue, FLT_MAX);
-
-	for (const auto& powerup : player->powerups)
-	{
-		// Filter out unwanted powerups
-		if (powerup.meta == 0 && powerup.obj->com().y > 200) {
-			for (int dir = 0; dir < control::Movement::MaxValue; ++dir)
-			{
-				const auto pseudoPlayer = pseudoPlayers[dir];
-
-				/*
-				 * Powerups tend to be attracted towards the player, so we can be
-				 * very lax with the collision predictor and use the AABB model
-				 * all the time
-				 */
-				 /*float colTick = vec2::willCollideAABB(
-						 plyr.position - plyr.size / 2, powerup.position - powerup.size / 2, plyr.size, powerup.size, pvel, powerup.velocity);
-				 */
-				float colTick = pseudoPlayer->willCollideWith(*powerup.obj);
-				if (colTick >= 0) {
-					targetTicks[dir] = std::min(colTick, targetTicks[dir]);
-				}
-			}
-		}
-	}
+	float targetCost[control::Movement::MaxValue];
 
-	// We should probably prioritize larger enemies over smaller ones, 
-	// and prioritize powerup gathering over enemies
-	for (const auto& enemy : player->enemies)
-	{
-		const vec2 enemyCom = enemy.obj->com();
-		const vec2 playerCom = plyr.obj->com();
-		if (enemyCom.y < playerCom.y) {
-			for (int dir : {control::Movement::Left, control::Movement::Right})
-			{
-				const vec2 pvel = this->getPlayerMovement(dir);
-
-				// Calculate x-distance to y-aligned axis of the enemy
-				float xDist = enemyCom.x - playerCom.x;
-				float colTick = xDist / pvel.x;
-				// Filter out impossible values
-				if (colTick >= 0 && colTick <= 6000)
-				{
-					targetTicks[dir] = std::min(colTick, targetTicks[dir]);
-				}
-			}
-		}
-	}
+	s.targetField.build(*plyr.obj, world.powerups, world.enemies, maxSpeed, TARGET_HORIZON);
+	for (int dir = 1; dir < candidates; ++dir)
+		s.targetField.addRing(getPlayerMovement(s, dir).len());
+	for (int dir = 0; dir < candidates; ++dir)
+		targetCost[dir] = s.targetField.cost(getPlayerMovement(s, dir), dir, targetTicks[dir]);
 
 	aabb gameBounds{ vec2(), vec2(), vec2(th_param.GAME_WIDTH, th_param.GAME_HEIGHT) };
 	// Wall collision frame calculations
-	for (int dir = 1; dir < control::Movement::MaxValue; ++dir)
+	for (int dir = 1; dir < candidates; ++dir)
 	{
 		const auto pseudoPlayer = pseudoPlayers[dir];
 
@@ -197,19 +133,19 @@ void th_vo_algo::onTick()
 	}
 	// Look for best viable target, aka targeting will not result in collision
 	int tarIdx = -1;
-	float min_collision_tick = *std::min_element(collisionTicks + control::Movement::Up, collisionTicks + control::Movement::MaxValue);
-	float max_collision_tick = *std::max_element(collisionTicks, collisionTicks + control::Movement::MaxValue);
+	float min_collision_tick = *std::min_element(collisionTicks + control::Movement::Up, collisionTicks + candidates);
+	float max_collision_tick = *std::max_element(collisionTicks, collisionTicks + candidates);
 	if (min_collision_tick > 1.f && max_collision_tick > 100.f)
 	{
-		for (int dir = 0; dir < control::Movement::MaxValue; ++dir)
+		for (int dir = 0; dir < candidates; ++dir)
 		{
 			if (targetTicks[dir] < collisionTicks[dir]
-				&& (tarIdx == -1 || targetTicks[dir] < targetTicks[tarIdx]))
+				&& (tarIdx == -1 || targetCost[dir] < targetCost[tarIdx]))
 				tarIdx = dir;
 		}
 	}
 
-	Text("target found: %s", (tarIdx == -1) ? "false" : "true");
+	s.targetFound = tarIdx != -1;
 
 	bool powerupTarget = true;
 	// check if we could find a targetable powerup
@@ -235,7 +171,7 @@ void th_vo_algo::onTick()
 			maxIdx = 0;
 		}
 
-		for (int dir = 1; dir < control::Movement::MaxValue; ++dir)
+		for (int dir = 1; dir < candidates; ++dir)
 		{
 			if (collisionTicks[dir] != FLT_MAX &&
 				collisionTicks[dir] > collisionTicks[maxIdx])
@@ -246,20 +182,15 @@ void th_vo_algo::onTick()
 		tarIdx = maxIdx;
 	}
 
-	/* IMGUI Integration */
 	int minTimeIdx = 0;
-	for (int dir = 1; dir < control::Movement::MaxValue; ++dir)
+	for (int dir = 1; dir < candidates; ++dir)
 	{
 		if (collisionTicks[dir] < collisionTicks[minTimeIdx])
 			minTimeIdx = dir;
 	}
-	for (int i = 1; i < RISK_HISTORY_SIZE; ++i)
-		riskHistory[i - 1] = riskHistory[i];
-	riskHistory[RISK_HISTORY_SIZE - 1] = collisionTicks[minTimeIdx];
-	PlotLines("danger hist", riskHistory, IM_ARRAYSIZE(riskHistory), 0, "",
-		0.f, 30.f, ImVec2(0, 80));
-	SameLine(); ShowHelpMarker("frames until collision of the best move,\n"
-		"maximization parameter");
+	for (int i = 1; i < vo_state::RISK_HISTORY_SIZE; ++i)
+		s.riskHistory[i - 1] = s.riskHistory[i];
+	s.riskHistory[vo_state::RISK_HISTORY_SIZE - 1] = collisionTicks[minTimeIdx];
 
 	/*LOG("C[%d] | H:%.0f U:%.0f D:%.0f L:%.0f R:%.0f UL:%.0f UR:%.0f DL:%.0f DR:%.0f",
 		tarIdx,
@@ -268,43 +199,151 @@ void th_vo_algo::onTick()
 		collisionTicks[5], collisionTicks[6], collisionTicks[7], collisionTicks[8]
 	);*/
 
-	di8->setVkState(DIK_Z, DIK_KEY_DOWN);			// fire continuously
-	di8->setVkState(DIK_LCONTROL, DIK_KEY_DOWN);	// skip dialogue continuously
+	d.fire = true;		// fire continuously
+	d.skip = true;		// skip dialogue continuously
+	d.move = tarIdx;
+	d.risk = collisionTicks[tarIdx];
+	d.danger = collisionTicks[minTimeIdx];
 
-	// release all control keys
-	for (int x : control::kControlKeys)
-		di8->resetVkState(x);
+	// deathbomb if the bot is going to die in the next frame, which whole
+	// frame prediction reports as 1
+	// this is very dependent on the collision predictor being very accurate
+	d.bomb = kernels::activePredictor() == kernels::Discrete
+		? collisionTicks[tarIdx] <= 1 : collisionTicks[tarIdx] < 0.5f;
 
-	// press required keys for moving in desired direction
-	for (int i = 0; i < 3; ++i) {
-		if (control::kMovementToInput[tarIdx][i])
-			di8->setVkState(control::kMovementToInput[tarIdx][i], DIK_KEY_DOWN);
-	}
+	return d;
+}
 
-	// deathbomb if the bot is going to die in the next frame
-	// this is very dependent on the collision predictor being very accurate
-	if (collisionTicks[tarIdx] < 0.5f)
+bool th_vo_algo::followRoute(const world_snapshot& world, vo_state& s, decision& d) const
+{
+	const route_book::route* r = routes->find(world.routeKey);
+	if (!r)
+		return false;
+	if (r->move < 0 || r->move >= control::Movement::MaxValue)
 	{
-		di8->setVkState(DIK_X, DIK_KEY_DOWN);
+		TH_COUNT(RouteRejected);
+		return false;
 	}
 
-	Checkbox("Show Vector Field", &this->renderVectorField);
+	// frames until collision of the route's move, up to the validation horizon
+	const auto pseudoPlayer = world.plyr->obj->withVelocity(getPlayerMovement(s, r->move));
+	const entity::entity_type shape = pseudoPlayer->type;
+	const bool batched = shape == entity::Circle || shape == entity::AABB;
+	float margin = ROUTE_HORIZON;
+	s.routeShapes.clear();
+	for (const game_object* o : world.dangerObjects())
+	{
+		// most bullets have the player's shape and are predicted by the kernels
+		if (batched && o->obj->type == shape)
+		{
+			if (shape == entity::Circle)
+			{
+				const auto& c = static_cast<const circle&>(*o->obj);
+				s.routeShapes.addCircle(c.center, c.radius, c.velocity);
+			}
+			else
+			{
+				const auto& a = static_cast<const aabb&>(*o->obj);
+				s.routeShapes.addBox(a.position, a.size, a.velocity);
+			}
+			continue;
+		}
+		const float t = pseudoPlayer->willCollideWith(*o->obj);
+		if (t >= 0 && t < margin)
+			margin = t;
+	}
+	if (s.routeShapes.size() > 0)
+	{
+		s.routeTimes.resize(s.routeShapes.size());
+		if (shape == entity::Circle)
+		{
+			const auto& c = static_cast<const circle&>(*pseudoPlayer);
+			kernels::circles(c.center, c.radius, c.velocity, s.routeShapes, s.routeTimes.data(), ROUTE_HORIZON);
+		}
+		else
+		{
+			const auto& a = static_cast<const aabb&>(*pseudoPlayer);
+			kernels::boxes(a.position, a.size, a.velocity, s.routeShapes, s.routeTimes.data(), ROUTE_HORIZON);
+		}
+		const float t = kernels::earliest(s.routeTimes.data(), s.routeTimes.size());
+		if (t >= 0 && t < margin)
+			margin = t;
+	}
+	if (r->move != control::Movement::Hold)
+	{
+		const aabb gameBounds{ vec2(), vec2(), vec2(th_param.GAME_WIDTH, th_param.GAME_HEIGHT) };
+		const float t = pseudoPlayer->willExit(gameBounds);
+		if (t >= 0 && t < margin)
+			margin = t;
+	}
 
-	End();
+	// the world only matches within the grid, so the route must be as safe as
+	// when it was taken, and never so unsafe that a deathbomb could be needed
+	if (margin < std::min(r->margin, ROUTE_HORIZON) || margin < MIN_SAFETY_TICK)
+	{
+		TH_COUNT(RouteRejected);
+		return false;
+	}
 
+	TH_COUNT(RouteHits);
+	d.fire = (r->flags & th_recording::Fire) != 0;
+	d.skip = (r->flags & th_recording::Skip) != 0;
+	d.move = r->move;
+	d.risk = margin;
+	return true;
 }
 
-void th_vo_algo::calibInit()
+void th_vo_algo::report(const algo_state& state, const decision* d)
 {
-	isCalibrated = false;
-	calibFrames = 0;
-	calibStartX = -1;
-	playerVel = 0;
+	const auto& s = static_cast<const vo_state&>(state);
+
+	/* IMGUI Integration */
+	using namespace ImGui;
+	Begin("th_vo_algo");
+	Text("Constrained Velocity Obstacle Algorithm");
+	if (CollapsingHeader("Info", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		Text("calib: %s", s.isCalibrated ? "true" : "false");
+		SameLine(); ShowHelpMarker("Algorithm player speed calibration");
+
+		Text("calib vel: norm %.2f, foc %.2f", s.playerVel, s.playerFocVel);
+		SameLine(); ShowHelpMarker("Calibrated velocities in normal and focused mode");
+
+		Text("col test: %s", hitCircle ? "hit circle" : "hit box");
+		SameLine(); ShowHelpMarker("Collision test used");
+	}
+
+	if (!d || d->move < 0)
+	{
+		End();
+		return;
+	}
+
+	Text("vo: %d obstacles, %d free arcs", (int)s.voField.size(), (int)s.freeArcs.size());
+	SameLine(); ShowHelpMarker("Obstacles within the horizon, and unobstructed\n"
+		"ranges of directions at normal speed");
+
+	Text("clusters: %d of %d far bullets", (int)s.voField.clusters(), (int)s.voField.clustered());
+	SameLine(); ShowHelpMarker("Groups of far bullets with similar velocities,\n"
+		"each counted as one of the obstacles above");
+
+	Text("target found: %s", s.targetFound ? "true" : "false");
+	Text("targets: %d powerups, %d enemies", (int)s.targetField.powerupCount(), (int)s.targetField.enemyCount());
+
+	PlotLines("danger hist", s.riskHistory, IM_ARRAYSIZE(s.riskHistory), 0, "",
+		0.f, 30.f, ImVec2(0, 80));
+	SameLine(); ShowHelpMarker("frames until collision of the best move,\n"
+		"maximization parameter");
+
+	Checkbox("Show Vector Field", &this->renderVectorField);
+
+	End();
+
 }
 
-vec2 th_vo_algo::getPlayerMovement(int dir)
+vec2 th_vo_algo::getPlayerMovement(const vo_state& s, int dir)
 {
-	return control::kMovementVelocity[dir] * (control::kMovementFocused[dir] ? playerFocVel : playerVel);
+	return control::kMovementVelocity[dir] * (control::kMovementFocused[dir] ? s.playerFocVel : s.playerVel);
 }
 
 float th_vo_algo::minStaticCollideTick(
@@ -330,7 +369,8 @@ float th_vo_algo::minStaticCollideTick(
 void th_vo_algo::vizPotentialQuadtree(
 	const std::vector<const game_object*>& bullets,
 	const aabb& area,
-	float minRes) const
+	float minRes,
+	std::vector<viz_cell>& cells) const
 {
 	/*cdraw::rect(
 		th_param.GAME_X_OFFSET + p.x, th_param.GAME_Y_OFFSET + p.y,
@@ -369,19 +409,17 @@ void th_vo_algo::vizPotentialQuadtree(
 				float fadeCoeff = std::max(0.0f, std::min(1.0f, 1.0f / (colTick / MAX_FRAMES_TILL_COLLISION)));
 				hsv col_hsv = { 0, fadeCoeff,  fadeCoeff };
 				rgb col_rgb = hsv2rgb(col_hsv);
-				cdraw::fillRect(
-					th_param.GAME_X_OFFSET + colDomains[i].x,
-					th_param.GAME_Y_OFFSET + colDomains[i].y,
-					sqsz.x, sqsz.y,
+				cells.push_back({
+					colDomains[i], sqsz.x,
 					D3DCOLOR_ARGB((int)(fadeCoeff * 128),
 					(int)(col_rgb.r * 255), (int)(col_rgb.g * 255), (int)(col_rgb.b * 255))
-				);
+				});
 			}
 			else {
 				vizPotentialQuadtree(
 					collided,
 					aabb{ colDomains[i], vec2(), vec2(sqsz) },
-					minRes);
+					minRes, cells);
 			}
 		}
 	}
@@ -408,11 +446,23 @@ void th_vo_algo::visualize(IDirect3DDevice9* d3dDev)
 
 		if (this->renderVectorField)
 		{
-			// draw vector field (laggy)
-			vizPotentialQuadtree(
-				constructDangerObjectUnion(),
-				aabb{ vec2(), vec2(), vec2(th_param.GAME_WIDTH, th_param.GAME_HEIGHT) },
-				VEC_FIELD_MIN_RESOLUTION);
+			// compute vector field (laggy), only once per game tick
+			if (vizTick != player->gameTick)
+			{
+				vizCells.clear();
+				vizPotentialQuadtree(
+					constructDangerObjectUnion(),
+					aabb{ vec2(), vec2(), vec2(th_param.GAME_WIDTH, th_param.GAME_HEIGHT) },
+					VIZ_RESOLUTION_KNOB.at(player->governor.quality()), vizCells);
+				vizTick = player->gameTick;
+			}
+			for (const viz_cell& c : vizCells)
+			{
+				cdraw::fillRect(
+					th_param.GAME_X_OFFSET + c.pos.x,
+					th_param.GAME_Y_OFFSET + c.pos.y,
+					c.size, c.size, c.color);
+			}
 		}
 		for (const laser& l : player->lasers)
 			l.render();
@@ -427,77 +477,71 @@ void th_vo_algo::visualize(IDirect3DDevice9* d3dDev)
 	}
 }
 
-bool th_vo_algo::calibTick()
+bool th_vo_algo::calibTick(const world_snapshot& world, vo_state& s, decision& d)
 {
-	auto plyr = player->getPlayerEntity();
+	const auto& plyr = *world.plyr;
+	auto key = [&d](uint8_t vk, decision::key_override::action_type action) {
+		d.keys.push_back({ vk, action });
+	};
+	using k = decision::key_override;
 
-	switch (calibFrames)
+	switch (s.calibFrames)
 	{
 	case 0:
 		// do not allow player interaction during calibration
-		th_di8_hook::inst()->setVkState(DIK_LEFT, DIK_KEY_DOWN);
-		th_di8_hook::inst()->setVkState(DIK_RIGHT, DIK_KEY_UP);
-		th_di8_hook::inst()->setVkState(DIK_UP, DIK_KEY_UP);
-		th_di8_hook::inst()->setVkState(DIK_DOWN, DIK_KEY_UP);
+		key(DIK_LEFT, k::Press);
+		key(DIK_RIGHT, k::Lift);
+		key(DIK_UP, k::Lift);
+		key(DIK_DOWN, k::Lift);
 		break;
 	case 1:
-		th_di8_hook::inst()->setVkState(DIK_LEFT, DIK_KEY_UP);
-		calibStartX = plyr.obj->com().x;
+		key(DIK_LEFT, k::Lift);
+		s.calibStartX = plyr.obj->com().x;
 		break;
 	case 2:
-		th_di8_hook::inst()->setVkState(DIK_RIGHT, DIK_KEY_DOWN);
+		key(DIK_RIGHT, k::Press);
 		break;
 	case 3:
-		th_di8_hook::inst()->resetVkState(DIK_LEFT);
-		th_di8_hook::inst()->resetVkState(DIK_RIGHT);
-		th_di8_hook::inst()->resetVkState(DIK_UP);
-		th_di8_hook::inst()->resetVkState(DIK_DOWN);
+		key(DIK_LEFT, k::Release);
+		key(DIK_RIGHT, k::Release);
+		key(DIK_UP, k::Release);
+		key(DIK_DOWN, k::Release);
 
 		// BUG why does LoLK do this differently
-		if (dynamic_cast<th15_player*>(player)
-			|| dynamic_cast<th10_player*>(player)
-			|| dynamic_cast<th11_player*>(player))
-			playerVel = plyr.obj->com().x - calibStartX;
+		if (world.calibForward)
+			s.playerVel = plyr.obj->com().x - s.calibStartX;
 		else
-			playerVel = calibStartX - plyr.obj->com().x;
+			s.playerVel = s.calibStartX - plyr.obj->com().x;
 		break;
 	case 4:
 		// do not allow player interaction during calibration
-		th_di8_hook::inst()->setVkState(DIK_LEFT, DIK_KEY_DOWN);
-		th_di8_hook::inst()->setVkState(DIK_RIGHT, DIK_KEY_UP);
-		th_di8_hook::inst()->setVkState(DIK_UP, DIK_KEY_UP);
-		th_di8_hook::inst()->setVkState(DIK_DOWN, DIK_KEY_UP);
-		th_di8_hook::inst()->setVkState(DIK_LSHIFT, DIK_KEY_DOWN);
+		key(DIK_LEFT, k::Press);
+		key(DIK_RIGHT, k::Lift);
+		key(DIK_UP, k::Lift);
+		key(DIK_DOWN, k::Lift);
+		key(DIK_LSHIFT, k::Press);
 		break;
 	case 5:
-		th_di8_hook::inst()->setVkState(DIK_LEFT, DIK_KEY_UP);
-		calibStartX = plyr.obj->com().x;
+		key(DIK_LEFT, k::Lift);
+		s.calibStartX = plyr.obj->com().x;
 		break;
 	case 6:
-		th_di8_hook::inst()->setVkState(DIK_RIGHT, DIK_KEY_DOWN);
+		key(DIK_RIGHT, k::Press);
 		break;
 	case 7:
-		isCalibrated = true;
-		th_di8_hook::inst()->resetVkState(DIK_LEFT);
-		th_di8_hook::inst()->resetVkState(DIK_RIGHT);
-		th_di8_hook::inst()->resetVkState(DIK_UP);
-		th_di8_hook::inst()->resetVkState(DIK_DOWN);
-		th_di8_hook::inst()->resetVkState(DIK_LSHIFT);
+		key(DIK_LEFT, k::Release);
+		key(DIK_RIGHT, k::Release);
+		key(DIK_UP, k::Release);
+		key(DIK_DOWN, k::Release);
+		key(DIK_LSHIFT, k::Release);
 
 		// BUG why do MoF and LoLK do this differently
-		if (dynamic_cast<th15_player*>(player)
-			|| dynamic_cast<th10_player*>(player)
-			|| dynamic_cast<th11_player*>(player))
-			playerFocVel = plyr.obj->com().x - calibStartX;
+		if (world.calibForward)
+			s.playerFocVel = plyr.obj->com().x - s.calibStartX;
 		else
-			playerFocVel = calibStartX - plyr.obj->com().x;
+			s.playerFocVel = s.calibStartX - plyr.obj->com().x;
 		return true;
 	}
-	++calibFrames;
+	++s.calibFrames;
 	return false;
 }
-
-
-
-
-
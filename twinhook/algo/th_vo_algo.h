@@ -1,13 +1,23 @@
 #pragma once
+#include <climits>
+
 #include "control/th_player.h"
+#include "algo/vo_field.h"
+#include "algo/target_field.h"
+#include "util/kernels.h"
 
 /* Visualization Constants */
 static const float VEC_FIELD_MIN_RESOLUTION = 8.f;
+static const float VEC_FIELD_MAX_RESOLUTION = 32.f;	// coarsest resolution under budget pressure
 static const float MAX_FRAMES_TILL_COLLISION = 10.f;	// used for coloring vector field
 
 /* Algorithmic Constants */
 static const float SQRT_2 = sqrt(2.f);
 static const float MIN_SAFETY_TICK = 10.0f;
+static const float VO_HORIZON = 600.f;			// frames to look ahead for obstacles
+static const float VO_MIN_HORIZON = 150.f;		// shortest lookahead under budget pressure
+static const float TARGET_HORIZON = 6000.f;		// frames to look ahead for targets
+static const float ROUTE_HORIZON = 30.f;		// frames a route is validated for before following it
 
 
 /**
@@ -17,8 +27,10 @@ static const float MIN_SAFETY_TICK = 10.0f;
  * Implementation of constrained linear velocity obstacle algorithm 
  * using a linear approximation of bullet trajectories.
  * 
- * Uses an AABB predictor for bullet hitboxes, OBB SAT predictor for lasers, 
- * and circle predictor for hitcircles. Ideally we want to use a predictor that 
+ * Each obstacle is converted into an exact velocity obstacle, i.e. the Minkowski 
+ * sum of the obstacle and player shapes (box, disc or convex hull for lasers, and
+ * an exact sweep for curvy lasers) 
+ * in velocity space, see vo_field. Ideally we want to use a predictor that 
  * corresponds to the collision algorithm used by the games, but some of them 
  * cannot be projected easily.
  * 
@@ -30,7 +42,9 @@ static const float MIN_SAFETY_TICK = 10.0f;
  * Note that targeting is also difficult, since there is no simple way to weight 
  * targets and obstacles in a reasonable way. Currently the algorithm only targets 
  * powerups will be no obstacles blocking the way which should work in theory, 
- * but causes the bot to collide with obstacles more often.
+ * but causes the bot to collide with obstacles more often. Powerups and enemies 
+ * are indexed once per frame in a target_field, and the reachable target with the 
+ * lowest weighted cost wins.
  * 
  * This algorithm implements near perfect deathbombing by detecting if it will collide 
  * with an obstacle very soon, and has no recourse for avoidance. However, this is 
@@ -40,39 +54,101 @@ static const float MIN_SAFETY_TICK = 10.0f;
  * First we must calibrate the algorithm by determining the player velocity, by
  * frame division.
  *
- * Each velocity state then projected for collisions with obstacles. The state that
- * results in a collision being the furthest away (greedy) is the desired action.
+ * The velocity obstacles are intersected with the rings of reachable velocities 
+ * once per frame, after which the time until collision of each velocity state is 
+ * an analytic lookup. The state that results in a collision being the furthest 
+ * away (greedy) is the desired action.
+ *
+ * If a route book is bound and has a route for the current world, the route's
+ * move is checked with the collision predictors over a short horizon instead,
+ * and followed if it is as safe as when it was taken, skipping the solve.
  */
 class th_vo_algo : public th_algorithm
 {
+public:
+	struct vo_state : algo_state
+	{
+		/* Calibration Parameters */
+		bool isCalibrated = false;
+		// Number of frames spent calibrating so far
+		int calibFrames = 0;
+		// Starting x position when beginning calibration
+		float calibStartX = -1;
+		float playerVel = 0;
+		float playerFocVel = 0;
+
+		/* Velocity Obstacles */
+		vo_field voField;
+		std::vector<std::pair<float, float>> freeArcs;
+
+		/* Targets */
+		target_field targetField;
+
+		/* Route Validation */
+		// Obstacles of the player's shape, predicted in one batch
+		kernels::columns routeShapes;
+		std::vector<float> routeTimes;
+
+		/* IMGUI Integration */
+		static const int RISK_HISTORY_SIZE = 90;
+		float riskHistory[RISK_HISTORY_SIZE] = { 0 };
+		bool targetFound = false;
+
+		std::unique_ptr<algo_state> clone() const override
+		{
+			return std::make_unique<vo_state>(*this);
+		}
+	};
+
+protected:
+	/* Quality Knobs, see frame_governor */
+	// Frames to look ahead for obstacles
+	static const quality_knob HORIZON_KNOB;
+	// Number of candidate movements evaluated, dropping focused movements first
+	static const quality_knob CANDIDATES_KNOB;
+	// Minimum cell size of the vector field visualization
+	static const quality_knob VIZ_RESOLUTION_KNOB;
+
 	/* Adaptibility Parameters */
 	// Should we use hitcircles instead of hitboxes
 	bool hitCircle = false;
 
-	/* Calibration Parameters */
-	bool isCalibrated = false;
-	// Number of frames spent calibrating so far
-	int calibFrames = 0;
-	// Starting x position when beginning calibration
-	float calibStartX = -1;
-	float playerVel = 0;
-	float playerFocVel = 0;
-
-	void calibInit();
-
 	// Get player's movement vector when moving in this direction
-	vec2 getPlayerMovement(int dir);
+	static vec2 getPlayerMovement(const vo_state &s, int dir);
 
+private:
 	/**
 	* \brief Do one tick of calibration
+	* \param world Snapshot of the current frame
+	* \param s State being calibrated
+	* \param d Decision to add calibration key presses to
 	* \return Whether calibration is complete or not
 	*/
-	bool calibTick();
+	static bool calibTick(const world_snapshot &world, vo_state &s, decision &d);
+
+	/**
+	 * \brief Validate a route of the route book against the current world
+	 * \param world Snapshot of the current frame, with a route key
+	 * \param s Calibrated state
+	 * \param d Decision to fill with the route
+	 * \return Whether the route is safe to follow
+	 */
+	bool followRoute(const world_snapshot &world, vo_state &s, decision &d) const;
 
 	/* Visualization Parameters*/
 
 	bool renderVectorField = false;
 
+	struct viz_cell
+	{
+		vec2 pos;
+		float size;
+		D3DCOLOR color;
+	};
+	// Cells of the vector field, reused while the game has not advanced
+	std::vector<viz_cell> vizCells;
+	unsigned int vizTick = UINT_MAX;
+
 	/**
 	 * \brief Find the minimum collision tick of a static AABB
 	 * \param bullets The bullets to check collision against
@@ -91,16 +167,18 @@ class th_vo_algo : public th_algorithm
 	 * \param p Position of AABB containing visualization boundary
 	 * \param s Size of AABB containing visualization boundary
 	 * \param minRes Minimum allowable resolution for visualization
+	 * \param cells Cells to draw are added to this vector
 	 */
 	void vizPotentialQuadtree(
 		const std::vector<const game_object*> &bullets,
 		const aabb &area,
-		float minRes) const;
+		float minRes,
+		std::vector<viz_cell> &cells) const;
 
 	std::vector<const game_object*> constructDangerObjectUnion();
-	/* IMGUI Integration */
-	static const int RISK_HISTORY_SIZE = 90;
-	float riskHistory[RISK_HISTORY_SIZE] = {0};
+
+protected:
+	void report(const algo_state &state, const decision *d) override;
 
 public:
 	th_vo_algo(th_player *player) : th_algorithm(player) {}
@@ -108,7 +186,8 @@ public:
 
 	~th_vo_algo() = default;
 
+	std::unique_ptr<algo_state> createState() const override;
 	void onBegin() override;
-	void onTick() override;
+	decision decide(const world_snapshot &world, algo_state &state) const override;
 	void visualize(IDirect3DDevice9 *d3dDev) override;
 };
@@ -0,0 +1,671 @@
+#include "stdafx.h"
+#include "vo_field.h"
+
+#include "util/counters.h"
+
+static const float TWO_PI = float(2 * M_PI);
+// Relative error of positions advanced frame by frame, see firstInside
+static const float DISCRETE_SLACK = 1e-4f;
+
+/* Level of Detail */
+static const float LOD_DISTANCE = 64.f;		// bullets nearer to the player are never clustered
+static const float LOD_CELL = 32.f;			// pixels per grid cell of a cluster
+static const float LOD_DRIFT = 16.f;		// pixels by which clusters may grow until the horizon
+static const size_t LOD_MIN_MEMBERS = 4;	// smaller groups keep a region per bullet
+static const float LOD_SLACK = 1.f;			// pixels added to clusters for rounding
+
+static float wrapAngle(float a)
+{
+	a = fmod(a, TWO_PI);
+	if (a < 0)
+		a += TWO_PI;
+	return a;
+}
+
+static float wrapPi(float a)
+{
+	a = wrapAngle(a + float(M_PI));
+	return a - float(M_PI);
+}
+
+static float cross(const vec2& a, const vec2& b)
+{
+	return a.x * b.y - a.y * b.x;
+}
+
+/**
+ * \brief Convex hull of a point cloud, via monotone chain
+ * \param pts Point cloud, which is sorted in place
+ * \param hull Returned CCW vertices of the convex hull
+ */
+static void convexHull(std::vector<vec2>& pts, std::vector<vec2>& hull)
+{
+	std::sort(pts.begin(), pts.end());
+	hull.resize(2 * pts.size());
+	size_t k = 0;
+	for (size_t i = 0; i < pts.size(); ++i)
+	{
+		while (k >= 2 && cross(hull[k - 1] - hull[k - 2], pts[i] - hull[k - 2]) <= 0)
+			--k;
+		hull[k++] = pts[i];
+	}
+	for (size_t i = pts.size() - 1, t = k + 1; i > 0; --i)
+	{
+		while (k >= t && cross(hull[k - 1] - hull[k - 2], pts[i - 1] - hull[k - 2]) <= 0)
+			--k;
+		hull[k++] = pts[i - 1];
+	}
+	hull.resize(k > 1 ? k - 1 : k);
+}
+
+// Half extents of the box approximation of an entity
+static vec2 halfExtents(const entity& e)
+{
+	switch (e.type)
+	{
+	case entity::AABB:
+		return static_cast<const aabb&>(e).size / 2;
+	case entity::Circle:
+		return vec2(static_cast<const circle&>(e).radius);
+	default:
+		return e.boundingBox()->size / 2;
+	}
+}
+
+// First time in [tmin, tmax] the ray is inside a region: at once, or at the
+// first whole frame, which may be after it left. The games advance objects a
+// frame at a time, so their positions drift from the ray by rounding; frames
+// within that drift of the region count as hits.
+static float firstInside(float tmin, float tmax, kernels::predictor p)
+{
+	if (p == kernels::Continuous)
+		return tmin;
+	const float frame = std::ceil(tmin);
+	return frame <= tmax + DISCRETE_SLACK * frame ? frame : -1;
+}
+
+float vo_region::rayCast(const vec2& relVel, float horizon, kernels::predictor p) const
+{
+	if (containsOrigin)
+		return 0;
+
+	switch (type)
+	{
+	case Box:
+	case Cluster: {
+		float tmin = 0, tmax = FLT_MAX;
+		const float c[] = { center.x, center.y };
+		const float e[] = { extent.x, extent.y };
+		const float w[] = { relVel.x, relVel.y };
+		for (int i = 0; i < 2; ++i)
+		{
+			if (w[i] == 0)
+			{
+				if (abs(c[i]) > e[i])
+					return -1;
+				continue;
+			}
+			float t0 = (c[i] - e[i]) / w[i];
+			float t1 = (c[i] + e[i]) / w[i];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tmin = std::max(tmin, t0);
+			tmax = std::min(tmax, t1);
+			if (tmin > tmax)
+				return -1;
+		}
+		// a cluster bounds its members, so it must not skip frames they hit
+		return firstInside(tmin, tmax, type == Cluster ? kernels::Continuous : p);
+	}
+	case Disc: {
+		float x1, x2;
+		int rts = vec2::quadraticSolve(relVel.lensq(), -2 * vec2::dot(relVel, center),
+			center.lensq() - radius * radius, x1, x2);
+		if (rts == 0)
+			return -1;
+		if (rts == 1)
+			x2 = x1;
+		else if (x1 > x2)
+			std::swap(x1, x2);
+		return x1 >= 0 ? firstInside(x1, x2, p) : -1;
+	}
+	case Hull: {
+		float tmin = 0, tmax = FLT_MAX;
+		const size_t n = hull.size();
+		for (size_t i = 0; i < n; ++i)
+		{
+			const vec2& a = hull[i];
+			const vec2 e = hull[(i + 1) % n] - a;
+			// outward normal of a CCW edge
+			const vec2 nrm(e.y, -e.x);
+			const float num = vec2::dot(nrm, a);
+			const float den = vec2::dot(nrm, relVel);
+			if (den == 0)
+			{
+				if (num < 0)
+					return -1;
+				continue;
+			}
+			const float t = num / den;
+			if (den > 0)
+				tmax = std::min(tmax, t);
+			else
+				tmin = std::max(tmin, t);
+			if (tmin > tmax)
+				return -1;
+		}
+		return firstInside(tmin, tmax, p);
+	}
+	case Chain:
+		return chain->sweep(origin, relVel, inflate);
+	case Rotor:
+		return rotor->timeOfImpact(origin, relVel, inflate, horizon);
+	}
+	return -1;
+}
+
+bool vo_region::inCone(const vec2& v) const
+{
+	if (containsOrigin)
+		return true;
+	const vec2 w = v - velocity;
+	if (w.zero())
+		return false;
+	return wrapAngle(atan2(w.y, w.x) - coneMin) <= coneMax - coneMin;
+}
+
+void vo_field::buildShape(vo_region& r, const entity& plyr, const entity& obj) const
+{
+	const vec2 pc = plyr.com();
+	r.velocity = obj.velocity;
+	r.hull.clear();
+
+	const obb* rotor = obj.type == entity::Polygon ? dynamic_cast<const obb*>(&obj) : nullptr;
+	if (rotor && rotor->isRotating())
+	{
+		// The box may sweep over any point within its reach of the pivot
+		const float len = std::max(rotor->lengthAt(0), rotor->lengthAt(horizon));
+		const float reach = sqrt(len * len + rotor->radius * rotor->radius);
+		r.type = vo_region::Rotor;
+		r.rotor = rotor;
+		r.origin = pc;
+		r.inflate = plyr.type == entity::Circle ? static_cast<const circle&>(plyr).radius
+			: halfExtents(plyr).len();
+		r.center = rotor->position - pc;
+		r.extent = vec2(reach + r.inflate, reach + r.inflate);
+	}
+	else if (obj.type == entity::Polygon)
+	{
+		// Minkowski sum of the obstacle and the (symmetric) player box
+		const auto& poly = static_cast<const polygon&>(obj);
+		const vec2 ph = halfExtents(plyr);
+		const vec2 corners[] = {
+			vec2(-ph.x, -ph.y), vec2(ph.x, -ph.y), vec2(ph.x, ph.y), vec2(-ph.x, ph.y)
+		};
+		std::vector<vec2> pts;
+		pts.reserve(poly.points.size() * 4);
+		for (const vec2& p : poly.points)
+			for (const vec2& q : corners)
+				pts.push_back(p - pc + q);
+		convexHull(pts, r.hull);
+		r.type = vo_region::Hull;
+		r.center = vec2::minv(r.hull) / 2 + vec2::maxv(r.hull) / 2;
+	}
+	else if (obj.type == entity::CapsuleChain)
+	{
+		// Curvy lasers are not convex, so they are swept directly
+		const auto& c = static_cast<const capsule_chain&>(obj);
+		const auto box = c.boundingBox();
+		r.type = vo_region::Chain;
+		r.chain = &c;
+		r.origin = pc;
+		r.inflate = plyr.type == entity::Circle ? static_cast<const circle&>(plyr).radius
+			: halfExtents(plyr).len();
+		r.center = box->com() - pc;
+		r.extent = box->size / 2 + vec2(r.inflate, r.inflate);
+	}
+	else if (obj.type == entity::Circle && plyr.type == entity::Circle)
+	{
+		r.type = vo_region::Disc;
+		r.center = obj.com() - pc;
+		r.radius = static_cast<const circle&>(obj).radius
+			+ static_cast<const circle&>(plyr).radius;
+	}
+	else
+	{
+		// Mixed box and circle pairs conservatively use the bounding box of the circle
+		r.type = vo_region::Box;
+		r.center = obj.com() - pc;
+		r.extent = halfExtents(obj) + halfExtents(plyr);
+	}
+}
+
+void vo_field::buildCone(vo_region& r)
+{
+	// Determine the cone of relative velocity directions which hit the region
+	const float base = atan2(r.center.y, r.center.x);
+	float lo = 0, hi = 0;
+	bool fullCone = false;
+	switch (r.type)
+	{
+	case vo_region::Box:
+	case vo_region::Chain:
+	case vo_region::Rotor:
+	case vo_region::Cluster:
+		fullCone = abs(r.center.x) <= r.extent.x && abs(r.center.y) <= r.extent.y;
+		if (r.type == vo_region::Box || r.type == vo_region::Cluster)
+			r.containsOrigin = fullCone;
+		else if (r.type == vo_region::Chain)
+			r.containsOrigin = r.chain->sweep(r.origin, vec2(), r.inflate) == 0;
+		else
+			r.containsOrigin = r.rotor->distanceAt(r.origin, 0) <= r.inflate;
+		if (!fullCone)
+		{
+			lo = FLT_MAX; hi = -FLT_MAX;
+			for (int sx = -1; sx <= 1; sx += 2)
+			{
+				for (int sy = -1; sy <= 1; sy += 2)
+				{
+					vec2 p = r.center + vec2(sx * r.extent.x, sy * r.extent.y);
+					float d = wrapPi(atan2(p.y, p.x) - base);
+					lo = std::min(lo, d);
+					hi = std::max(hi, d);
+				}
+			}
+		}
+		break;
+	case vo_region::Disc: {
+		const float dist = r.center.len();
+		r.containsOrigin = dist <= r.radius;
+		if (!r.containsOrigin)
+		{
+			hi = asin(r.radius / dist);
+			lo = -hi;
+		}
+		break;
+	}
+	case vo_region::Hull: {
+		const size_t n = r.hull.size();
+		r.containsOrigin = n >= 3;
+		for (size_t i = 0; i < n && r.containsOrigin; ++i)
+		{
+			if (cross(r.hull[(i + 1) % n] - r.hull[i], vec2() - r.hull[i]) < 0)
+				r.containsOrigin = false;
+		}
+		if (!r.containsOrigin)
+		{
+			lo = FLT_MAX; hi = -FLT_MAX;
+			for (const vec2& p : r.hull)
+			{
+				float d = wrapPi(atan2(p.y, p.x) - base);
+				lo = std::min(lo, d);
+				hi = std::max(hi, d);
+			}
+		}
+		break;
+	}
+	}
+
+	if (r.containsOrigin || fullCone)
+	{
+		r.coneMin = 0;
+		r.coneMax = TWO_PI;
+	}
+	else
+	{
+		r.coneMin = base + lo;
+		r.coneMax = base + hi;
+	}
+}
+
+// Grid cell of a far bullet, by position and velocity
+static uint64_t clusterKey(const entity& obj, float velocityCell)
+{
+	const vec2 p = obj.com();
+	const float cells[] = { p.x / LOD_CELL, p.y / LOD_CELL,
+		obj.velocity.x / velocityCell, obj.velocity.y / velocityCell };
+	uint64_t key = 0;
+	for (float c : cells)
+	{
+		// cells beyond the range share the outermost one, which is still conservative
+		const float clamped = std::min(std::max(std::floor(c), -32768.f), 32767.f);
+		key = key << 16 | (uint16_t)(int)clamped;
+	}
+	return key;
+}
+
+vo_region& vo_field::nextRegion()
+{
+	if (regionCount == regions.size())
+		regions.emplace_back();
+	return regions[regionCount];
+}
+
+bool vo_field::reachable(const vo_region& r) const
+{
+	if (r.containsOrigin)
+		return true;
+
+	float dist;
+	switch (r.type)
+	{
+	case vo_region::Disc:
+		dist = r.center.len() - r.radius;
+		break;
+	case vo_region::Box:
+	case vo_region::Chain:
+	case vo_region::Rotor:
+	case vo_region::Cluster:
+		dist = vec2::maxv(vec2(abs(r.center.x), abs(r.center.y)) - r.extent, vec2()).len();
+		break;
+	default: {
+		vec2 lo = vec2::minv(r.hull), hi = vec2::maxv(r.hull);
+		dist = vec2::maxv(vec2::maxv(lo, -1 * hi), vec2()).len();
+		break;
+	}
+	}
+	return dist <= (maxSpeed + r.velocity.len()) * horizon;
+}
+
+void vo_field::retain()
+{
+	// Cull obstacles which cannot be reached within the horizon
+	const vo_region& r = regions[regionCount];
+	if (!reachable(r))
+	{
+		++culledCount;
+		return;
+	}
+	if (r.containsOrigin)
+		++overlapCount;
+	++regionCount;
+}
+
+void vo_field::build(const entity& plyr, const std::vector<const game_object*>& objs,
+	float maxPlayerSpeed, float horizon)
+{
+	this->horizon = horizon;
+	this->maxSpeed = maxPlayerSpeed;
+	regionCount = 0;
+	overlapCount = 0;
+	culledCount = 0;
+	ringCount = 0;
+	memberCount = 0;
+	clusterCount = 0;
+	lodKeys.clear();
+
+	// Clusters are boxes, which bound the regions of boxes and circles only.
+	// Members of a cell drift apart by less than a cell's velocity times the
+	// horizon, so longer horizons only cluster more similar velocities.
+	const vec2 pc = plyr.com();
+	const bool lod = clustering && (plyr.type == entity::AABB || plyr.type == entity::Circle);
+	const float velocityCell = LOD_DRIFT / std::max(horizon, 1.f);
+	size_t farCount = 0;
+	for (const game_object* o : objs)
+	{
+		const entity& obj = *o->obj;
+		if (lod && (obj.type == entity::AABB || obj.type == entity::Circle)
+			&& (obj.com() - pc).lensq() > LOD_DISTANCE * LOD_DISTANCE)
+		{
+			if (farCount == farRegions.size())
+				farRegions.emplace_back();
+			vo_region& r = farRegions[farCount];
+			buildShape(r, plyr, obj);
+			r.containsOrigin = r.type == vo_region::Disc ? r.center.len() <= r.radius
+				: abs(r.center.x) <= r.extent.x && abs(r.center.y) <= r.extent.y;
+			if (!reachable(r))
+				++culledCount;
+			else
+				lodKeys.emplace_back(clusterKey(obj, velocityCell), (uint32_t)farCount++);
+			continue;
+		}
+		vo_region& r = nextRegion();
+		buildShape(r, plyr, obj);
+		buildCone(r);
+		retain();
+	}
+
+	// Far bullets sharing a cell form a cluster if there are enough of them
+	std::sort(lodKeys.begin(), lodKeys.end());
+	for (size_t i = 0, j; i < lodKeys.size(); i = j)
+	{
+		for (j = i + 1; j < lodKeys.size() && lodKeys[j].first == lodKeys[i].first; ++j)
+			;
+		if (j - i >= LOD_MIN_MEMBERS)
+		{
+			buildCluster(i, j);
+			continue;
+		}
+		for (size_t k = i; k < j; ++k)
+		{
+			vo_region& r = nextRegion();
+			r = farRegions[lodKeys[k].second];
+			buildCone(r);
+			retain();
+		}
+	}
+}
+
+void vo_field::buildCluster(size_t begin, size_t end)
+{
+	vo_region& c = nextRegion();
+	c.type = vo_region::Cluster;
+	c.hull.clear();
+	c.firstMember = memberCount;
+	c.memberCount = end - begin;
+
+	vec2 lo(FLT_MAX), hi(-FLT_MAX);
+	vec2 vlo(FLT_MAX), vhi(-FLT_MAX);
+	for (size_t k = begin; k < end; ++k)
+	{
+		if (memberCount == members.size())
+			members.emplace_back();
+		vo_region& m = members[memberCount++];
+		m = farRegions[lodKeys[k].second];
+
+		const vec2 e = m.type == vo_region::Disc ? vec2(m.radius) : m.extent;
+		lo = vec2::minv(lo, m.center - e);
+		hi = vec2::maxv(hi, m.center + e);
+		vlo = vec2::minv(vlo, m.velocity);
+		vhi = vec2::maxv(vhi, m.velocity);
+	}
+
+	// Relative to the mean velocity, a member drifts by at most the spread
+	// per frame, so the box grown by the drift until the horizon holds it
+	const vec2 spread = (vhi - vlo) / 2;
+	c.velocity = (vlo + vhi) / 2;
+	c.center = (lo + hi) / 2;
+	c.extent = (hi - lo) / 2 + spread * horizon + vec2(LOD_SLACK);
+	buildCone(c);
+
+	// the members are reachable, so the cluster holding them is as well
+	++regionCount;
+	++clusterCount;
+	if (c.containsOrigin)
+		++overlapCount;
+}
+
+void vo_field::buildRing(ring& rg) const
+{
+	rg.arcs.clear();
+	rg.maxEnd.clear();
+	rg.blocked.clear();
+
+	const float s = rg.speed;
+	if (s <= 0)
+		return;
+
+	for (size_t i = 0; i < regionCount; ++i)
+	{
+		const vo_region& r = regions[i];
+		if (r.containsOrigin)
+		{
+			rg.arcs.push_back({ 0, TWO_PI, int(i) });
+			continue;
+		}
+
+		// Intersect the cone boundary rays (apex at obstacle velocity) with the ring
+		float cuts[4];
+		int nCuts = 0;
+		const float c = r.velocity.lensq() - s * s;
+		for (float a : { r.coneMin, r.coneMax })
+		{
+			const vec2 u(cos(a), sin(a));
+			const float b = vec2::dot(r.velocity, u);
+			const float disc = b * b - c;
+			if (disc < 0)
+				continue;
+			const float rt = sqrt(disc);
+			for (float lambda : { -b - rt, -b + rt })
+			{
+				if (lambda < 0)
+					continue;
+				const vec2 p = r.velocity + lambda * u;
+				cuts[nCuts++] = wrapAngle(atan2(p.y, p.x));
+			}
+		}
+
+		if (nCuts == 0)
+		{
+			// Either the whole ring is inside the cone, or none of it is
+			if (r.inCone(vec2(s, 0)))
+				rg.arcs.push_back({ 0, TWO_PI, int(i) });
+			continue;
+		}
+
+		std::sort(cuts, cuts + nCuts);
+		for (int k = 0; k < nCuts; ++k)
+		{
+			const float a = cuts[k];
+			const float b = k + 1 < nCuts ? cuts[k + 1] : cuts[0] + TWO_PI;
+			const float mid = (a + b) / 2;
+			if (b - a <= 0 || !r.inCone(s * vec2(cos(mid), sin(mid))))
+				continue;
+			if (b > TWO_PI)
+			{
+				rg.arcs.push_back({ a, TWO_PI, int(i) });
+				rg.arcs.push_back({ 0, b - TWO_PI, int(i) });
+			}
+			else
+			{
+				rg.arcs.push_back({ a, b, int(i) });
+			}
+		}
+	}
+
+	std::sort(rg.arcs.begin(), rg.arcs.end(),
+		[](const arc& a, const arc& b) { return a.begin < b.begin; });
+
+	// Sweep the sorted arcs to compute the running maximum and the union
+	float runMax = -FLT_MAX;
+	for (const arc& a : rg.arcs)
+	{
+		runMax = std::max(runMax, a.end);
+		rg.maxEnd.push_back(runMax);
+
+		if (!rg.blocked.empty() && a.begin <= rg.blocked.back().second)
+			rg.blocked.back().second = std::max(rg.blocked.back().second, a.end);
+		else
+			rg.blocked.emplace_back(a.begin, a.end);
+	}
+}
+
+void vo_field::addRing(float speed)
+{
+	if (findRing(speed))
+		return;
+	if (ringCount == rings.size())
+		rings.emplace_back();
+	ring& rg = rings[ringCount++];
+	rg.speed = speed;
+	buildRing(rg);
+}
+
+const vo_field::ring* vo_field::findRing(float speed) const
+{
+	for (size_t i = 0; i < ringCount; ++i)
+	{
+		if (abs(rings[i].speed - speed) <= 1e-4f * std::max(1.f, speed))
+			return &rings[i];
+	}
+	return nullptr;
+}
+
+float vo_field::timeToCollision(const vec2& v) const
+{
+	float minT = FLT_MAX;
+	const float s = v.len();
+	const ring* rg = s > 0 ? findRing(s) : nullptr;
+
+	if (rg)
+	{
+		// Stab the sorted arcs; no arc before j can contain theta once maxEnd < theta
+		const float theta = wrapAngle(atan2(v.y, v.x));
+		auto it = std::upper_bound(rg->arcs.begin(), rg->arcs.end(), theta,
+			[](float t, const arc& a) { return t < a.begin; });
+		for (ptrdiff_t j = it - rg->arcs.begin() - 1; j >= 0 && rg->maxEnd[j] >= theta; --j)
+		{
+			const arc& a = rg->arcs[j];
+			if (a.end < theta)
+				continue;
+			float t = regionTime(regions[a.region], v, minT);
+			if (t >= 0)
+				minT = std::min(minT, t);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < regionCount; ++i)
+		{
+			float t = regionTime(regions[i], v, minT);
+			if (t >= 0)
+				minT = std::min(minT, t);
+		}
+	}
+
+	if (minT != FLT_MAX && minT < horizon)
+		return minT;
+	return -1;
+}
+
+float vo_field::regionTime(const vo_region& r, const vec2& v, float earliest) const
+{
+	const float t = r.rayCast(v - r.velocity, horizon, predictor);
+	if (r.type != vo_region::Cluster || t < 0)
+		return t;
+	// members collide no earlier than their cluster, so none within the horizon
+	// or before the earliest collision found so far
+	if (t >= horizon)
+		return -1;
+	if (t >= earliest)
+		return t;
+
+	TH_COUNT(ClustersExpanded);
+	float minT = -1;
+	for (size_t i = r.firstMember; i < r.firstMember + r.memberCount; ++i)
+	{
+		const vo_region& m = members[i];
+		const float mt = m.rayCast(v - m.velocity, horizon, predictor);
+		if (mt >= 0 && (minT < 0 || mt < minT))
+			minT = mt;
+	}
+	return minT;
+}
+
+void vo_field::freeArcs(float speed, std::vector<std::pair<float, float>>& free) const
+{
+	free.clear();
+	const ring* rg = findRing(speed);
+	if (!rg)
+		return;
+
+	float last = 0;
+	for (const auto& b : rg->blocked)
+	{
+		if (b.first > last)
+			free.emplace_back(last, b.first);
+		last = std::max(last, b.second);
+	}
+	if (last < TWO_PI)
+		free.emplace_back(last, TWO_PI);
+}
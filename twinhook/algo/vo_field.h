@@ -0,0 +1,221 @@
+#pragma once
+
+#include <vector>
+
+#include "util/kernels.h"
+#include "util/vec2.h"
+#include "model/game_object.h"
+
+/**
+ * \brief Velocity obstacle induced on the player by a single obstacle.
+ *
+ * The region is the Minkowski sum of the obstacle shape and the reflected
+ * player shape, expressed relative to the player's center of mass. A candidate
+ * player velocity v collides with the obstacle at the first t >= 0 where
+ * (v - velocity) * t lies inside the region.
+ */
+struct vo_region
+{
+	enum region_type
+	{
+		Box,		// axis-aligned box, described by center and half extents
+		Disc,		// disc, described by center and radius
+		Hull,		// convex polygon, described by CCW vertices
+		Chain,		// capsule chain, swept exactly; center and extent bound it
+		Rotor,		// rotating or extending box, swept conservatively; center and extent bound it
+		Cluster		// far bullets with similar velocities, bounded by a box; see vo_field
+	};
+
+	region_type type = Box;
+	vec2 center;
+	vec2 extent;
+	float radius = 0;
+	std::vector<vec2> hull;
+
+	// Chain and Rotor regions sweep the player (a circle of radius inflate at
+	// origin) against the obstacle itself, which must outlive the field
+	const capsule_chain* chain = nullptr;
+	const obb* rotor = nullptr;
+	vec2 origin;
+	float inflate = 0;
+
+	// Cluster regions bound the regions of the field's members [firstMember,
+	// firstMember + memberCount) until the horizon
+	size_t firstMember = 0;
+	size_t memberCount = 0;
+
+	// Obstacle velocity, which is the apex of the velocity obstacle cone
+	vec2 velocity;
+
+	// Relative velocity directions hitting the region lie in [coneMin, coneMax]
+	float coneMin = 0;
+	float coneMax = 0;
+	// The player is already inside the region, so every velocity collides
+	bool containsOrigin = false;
+
+	/**
+	 * \brief Time until a relative ray from the player enters this region
+	 * \param relVel Player velocity relative to the obstacle
+	 * \param horizon Frames to look ahead; Rotor regions search no further,
+	 * other regions may report later collisions
+	 * \param p Discrete to report the first whole frame inside Box, Disc and
+	 * Hull regions like the games test them; the others, whose sweeps bound
+	 * their members or the true shape, always report the time of impact
+	 * \return 0 if already collided, -1 if no collision, otherwise frames until collision
+	 */
+	float rayCast(const vec2& relVel, float horizon,
+		kernels::predictor p = kernels::Continuous) const;
+
+	/**
+	 * \brief Determine if a player velocity lies inside the (infinite horizon) cone
+	 * \param v Player velocity
+	 * \return Whether v is inside the velocity obstacle cone
+	 */
+	bool inCone(const vec2& v) const;
+};
+
+/**
+ * \brief Exact velocity obstacle field over a set of obstacles.
+ *
+ * Each obstacle is turned into a vo_region once per frame. Candidate velocities
+ * of a fixed speed lie on a ring in velocity space; for every ring the cone of
+ * each region is intersected with the ring, giving at most two arcs per
+ * obstacle. The arcs are sorted by angle (O(n log n)), and a sweep over them
+ * produces the union of blocked arcs. Querying a velocity on a ring then only
+ * stabs the sorted arcs and evaluates the analytic time of impact of the
+ * obstacles actually covering that direction, so the cost of a query does not
+ * depend on the total number of obstacles or candidate moves.
+ *
+ * Obstacles which cannot reach the reachable velocity set of the player within
+ * the horizon are culled when the field is built.
+ *
+ * Bullets far from the player are grouped by a grid over position and velocity,
+ * and a group of several bullets becomes one Cluster region: a box around the
+ * members' regions, moving at their mean velocity and grown by the spread of
+ * their velocities times the horizon. Within the horizon every member lies
+ * inside it, so no member collides earlier than the cluster; the members are
+ * only ray cast if the cluster is hit before the earliest collision found so
+ * far. Times until collision are therefore exact, while the rings and free
+ * arcs treat a cluster as a whole and are conservative.
+ */
+class vo_field
+{
+public:
+	struct arc
+	{
+		float begin;
+		float end;
+		int region;
+	};
+
+	struct ring
+	{
+		float speed;
+		// Arcs sorted by begin angle, within [0, 2pi)
+		std::vector<arc> arcs;
+		// Running maximum of arc end, used to stop stabbing queries early
+		std::vector<float> maxEnd;
+		// Union of blocked arcs, sorted and disjoint
+		std::vector<std::pair<float, float>> blocked;
+	};
+
+private:
+	std::vector<vo_region> regions;
+	size_t regionCount = 0;
+	// Retained regions which already contain the origin, i.e. overlap the player
+	size_t overlapCount = 0;
+	// Obstacles out of reach within the horizon
+	size_t culledCount = 0;
+
+	/* Level of Detail */
+	bool clustering = true;
+	// Regions of the members of all clusters, without cones
+	std::vector<vo_region> members;
+	size_t memberCount = 0;
+	size_t clusterCount = 0;
+	// Regions of the reachable far bullets of the current build
+	std::vector<vo_region> farRegions;
+	// Grid cell and far region of each far bullet, grouped by sorting
+	std::vector<std::pair<uint64_t, uint32_t>> lodKeys;
+
+	std::vector<ring> rings;
+	size_t ringCount = 0;
+
+	float horizon = 6000.f;
+	float maxSpeed = 0;
+	kernels::predictor predictor = kernels::Continuous;
+
+	void buildShape(vo_region& r, const entity& plyr, const entity& obj) const;
+	static void buildCone(vo_region& r);
+	void buildCluster(size_t begin, size_t end);
+	void buildRing(ring& rg) const;
+	const ring* findRing(float speed) const;
+
+	vo_region& nextRegion();
+	bool reachable(const vo_region& r) const;
+
+	/**
+	 * \brief Keep the next region unless it is out of reach within the horizon
+	 */
+	void retain();
+
+	/**
+	 * \brief Time until collision with a region, testing the members of a
+	 * cluster if they might collide before earliest and within the horizon.
+	 * A cluster out of reach within the horizon counts as a miss.
+	 */
+	float regionTime(const vo_region& r, const vec2& v, float earliest) const;
+
+public:
+	/**
+	 * \brief Build velocity obstacles for every obstacle against the player
+	 * \param plyr Player entity
+	 * \param objs Obstacles to avoid
+	 * \param maxPlayerSpeed Maximum speed the player can achieve
+	 * \param horizon Number of frames to look ahead
+	 */
+	void build(const entity& plyr, const std::vector<const game_object*>& objs,
+		float maxPlayerSpeed, float horizon);
+
+	/**
+	 * \brief Precompute the blocked arcs for all candidate velocities of some speed
+	 * \param speed The speed of the ring
+	 */
+	void addRing(float speed);
+
+	/**
+	 * \brief Minimum time until collision with any obstacle when moving at a velocity.
+	 * Velocities on a ring use the sorted arcs, any other velocity falls back to
+	 * a scan over all retained obstacles.
+	 * \param v Player velocity
+	 * \return 0 if already collided, -1 if no collision, otherwise frames until collision
+	 */
+	float timeToCollision(const vec2& v) const;
+
+	/**
+	 * \brief Get the directions which are not blocked by any velocity obstacle
+	 * \param speed Speed of a previously added ring
+	 * \param free Sorted free arcs of directions, in radians within [0, 2pi)
+	 */
+	void freeArcs(float speed, std::vector<std::pair<float, float>>& free) const;
+
+	/**
+	 * \brief Group far bullets into clusters from the next build on, which is
+	 * the default. Without clustering every obstacle has its own region.
+	 */
+	void setClustering(bool enabled) { clustering = enabled; }
+
+	/**
+	 * \brief Predict collisions at whole frames like the games (Discrete), or
+	 * at the time of impact (Continuous, the default). Swept chains and
+	 * rotating lasers are always predicted continuously, which is conservative.
+	 */
+	void setPredictor(kernels::predictor p) { predictor = p; }
+
+	size_t size() const { return regionCount; }
+	size_t overlapping() const { return overlapCount; }
+	size_t culled() const { return culledCount; }
+	size_t clusters() const { return clusterCount; }
+	// Obstacles in retained clusters
+	size_t clustered() const { return memberCount; }
+};
@@ -0,0 +1,97 @@
+#include "stdafx.h"
+#include "frame_governor.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <imgui.h>
+
+#include "util/async_log.h"
+
+float quality_knob::at(float quality) const
+{
+	const float v = worst + (best - worst) * quality;
+	return integral ? std::round(v) : v;
+}
+
+void frame_governor::setBudget(float share)
+{
+	budget = std::max(0.01f, std::min(1.f, share));
+	SPDLOG_INFO("frame budget {:.0f}%", budget * 100);
+}
+
+void frame_governor::addKnob(const quality_knob* knob)
+{
+	if (std::find(knobs.begin(), knobs.end(), knob) == knobs.end())
+		knobs.push_back(knob);
+}
+
+void frame_governor::beginWork()
+{
+	workStart = clock::now();
+}
+
+void frame_governor::endWork()
+{
+	frameWork += std::chrono::duration<float, std::milli>(clock::now() - workStart).count();
+}
+
+void frame_governor::endFrame()
+{
+	const auto now = clock::now();
+	if (!started)
+	{
+		started = true;
+		lastFrame = now;
+		frameWork = 0;
+		return;
+	}
+
+	const float frame = std::chrono::duration<float, std::milli>(now - lastFrame).count();
+	lastFrame = now;
+	frameMs += SMOOTHING * (frame - frameMs);
+	workMs += SMOOTHING * (frameWork - workMs);
+	frameWork = 0;
+
+	if (++framesSinceAdjust < ADJUST_INTERVAL)
+		return;
+	framesSinceAdjust = 0;
+
+	if (share() > budget)
+		adjust(std::max(MIN_QUALITY, level * DECREASE));
+	else if (share() < budget * HEADROOM)
+		adjust(std::min(1.f, level + INCREASE));
+}
+
+void frame_governor::adjust(float newLevel)
+{
+	if (newLevel == level)
+		return;
+
+	// Only log when a knob actually changes value
+	bool changed = false;
+	std::ostringstream ss;
+	for (const quality_knob* k : knobs)
+	{
+		const float v = k->at(newLevel);
+		if (v != k->at(level))
+			changed = true;
+		ss << " " << k->name << "=" << v;
+	}
+	if (changed)
+	{
+		TH_LOG_INFO("quality {:.2f} -> {:.2f} (bot {:.1f} of {:.1f} ms):{}",
+			level, newLevel, workMs, frameMs, ss.str());
+	}
+	level = newLevel;
+}
+
+void frame_governor::render() const
+{
+	using namespace ImGui;
+	Text("frame: %.1f ms, bot %.1f ms (%.0f%% of %.0f%%)",
+		frameMs, workMs, share() * 100, budget * 100);
+	Text("quality: %.2f", level);
+	for (const quality_knob* k : knobs)
+		Text("  %s: %g", k->name, k->at(level));
+}
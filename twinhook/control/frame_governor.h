@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+/**
+ * \brief A quality setting which trades accuracy for time, e.g. a lookahead
+ * horizon or a visualization resolution.
+ *
+ * Knobs interpolate linearly between their value at full quality and their
+ * value at the lowest quality the governor may choose.
+ */
+struct quality_knob
+{
+	const char* name;
+	// Value at quality 1
+	float best;
+	// Value at quality 0
+	float worst;
+	// Round the value to an integer, e.g. for counts
+	bool integral;
+
+	/**
+	 * \brief Value of this knob at a quality level
+	 * \param quality Quality level within [0, 1]
+	 * \return The value
+	 */
+	float at(float quality) const;
+};
+
+/**
+ * \brief Keeps the bot's share of each frame below a budget.
+ *
+ * The governor measures the interval between Direct3D frames and the time the
+ * hook spends inside them (polling, deciding, drawing). Both are smoothed, and
+ * if the bot's share exceeds the budget the quality level is decreased
+ * multiplicatively; it is only increased again, slowly, once the share is well
+ * below the budget. Algorithms read the quality level from their world snapshot
+ * and map it to their registered knobs.
+ */
+class frame_governor
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	// Default share of the frame the bot may use
+	static constexpr float DEFAULT_BUDGET = 0.25f;
+	// Weight of the newest frame in the smoothed timings
+	static constexpr float SMOOTHING = 0.1f;
+	// Quality is increased only while the share is below this fraction of the budget
+	static constexpr float HEADROOM = 0.7f;
+	// Quality multiplier when over budget, and increment when under budget
+	static constexpr float DECREASE = 0.8f;
+	static constexpr float INCREASE = 0.02f;
+	static constexpr float MIN_QUALITY = 0.f;
+	// Frames between adjustments, so the smoothed timings settle
+	static const int ADJUST_INTERVAL = 10;
+
+	/**
+	 * \brief Set the share of the frame the bot may use
+	 * \param share Budget within (0, 1]
+	 */
+	void setBudget(float share);
+	float getBudget() const { return budget; }
+
+	/**
+	 * \brief Register a knob for logging and display. Registering twice is a no-op.
+	 * \param knob Knob with static storage duration
+	 */
+	void addKnob(const quality_knob* knob);
+
+	/**
+	 * \brief Mark the beginning of work done by the bot within the current frame
+	 */
+	void beginWork();
+
+	/**
+	 * \brief Mark the end of work done by the bot within the current frame
+	 */
+	void endWork();
+
+	/**
+	 * \brief Close the current frame, updating the timings and the quality level
+	 */
+	void endFrame();
+
+	float quality() const { return level; }
+	float frameMillis() const { return frameMs; }
+	float workMillis() const { return workMs; }
+	float share() const { return frameMs > 0 ? workMs / frameMs : 0; }
+
+	/**
+	 * \brief Time left in the budget of the current frame after the work so far
+	 * \return Milliseconds available for background work
+	 */
+	float idleMillis() const { return std::max(0.f, budget * frameMs - frameWork); }
+
+	/**
+	 * \brief Draw the timings and knob values to the current ImGui window
+	 */
+	void render() const;
+
+private:
+	float budget = DEFAULT_BUDGET;
+	float level = 1.f;
+
+	float frameMs = 0;
+	float workMs = 0;
+	float frameWork = 0;
+	int framesSinceAdjust = 0;
+
+	bool started = false;
+	clock::time_point lastFrame;
+	clock::time_point workStart;
+
+	std::vector<const quality_knob*> knobs;
+
+	void adjust(float newLevel);
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * \brief Keyboard state as seen by the game, read from game memory
+ */
+union th_kbd_state
+{
+	struct {
+		bool shot;		// 0
+		bool bomb;		// 1
+		bool slow;		// 2
+		bool skip;		// 3
+		bool up;		// 4
+		bool left;		// 5
+		bool down;		// 6
+		bool right;		// 7
+	};
+	bool keys[8];
+};
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cmath>
+#ifdef _MSC_VER
+// M_SQRT2, also where stdafx.h is not included
+#include <corecrt_math_defines.h>
+#endif
+
 #include "util/vec2.h"
 
 namespace control
@@ -50,29 +56,32 @@ namespace control
 		true,true,true,true,true,true,true,true
 	};
 
-	// Keys to press in order to move in a certain direction
-	constexpr uint8_t kMovementToInput[][3] = {
-			{ DIK_LSHIFT,	NULL,			NULL },	// focus by default
-			{ DIK_UP,		NULL,			NULL },
-			{ DIK_DOWN,		NULL,			NULL },
-			{ DIK_LEFT,		NULL,			NULL },
-			{ DIK_RIGHT,	NULL,			NULL },
-			{ DIK_UP,		DIK_LEFT,		NULL },
-			{ DIK_UP,		DIK_RIGHT,		NULL },
-			{ DIK_DOWN,		DIK_LEFT,		NULL },
-			{ DIK_DOWN,		DIK_RIGHT,		NULL },
-			{ DIK_UP,		NULL,			DIK_LSHIFT },
-			{ DIK_DOWN,		NULL,			DIK_LSHIFT },
-			{ DIK_LEFT,		NULL,			DIK_LSHIFT },
-			{ DIK_RIGHT,	NULL,			DIK_LSHIFT },
-			{ DIK_UP,		DIK_LEFT,		DIK_LSHIFT },
-			{ DIK_UP,		DIK_RIGHT,		DIK_LSHIFT },
-			{ DIK_DOWN,		DIK_LEFT,		DIK_LSHIFT },
-			{ DIK_DOWN,		DIK_RIGHT,		DIK_LSHIFT }
-	};
-
-	// Key presses which should be reset each frame
-	constexpr uint8_t kControlKeys[] = { DIK_UP, DIK_DOWN, DIK_LEFT, DIK_RIGHT, DIK_LSHIFT, DIK_X };
+	/**
+	 * \brief Get the direction index corresponding to a set of held keys
+	 * \param up Up held
+	 * \param down Down held
+	 * \param left Left held
+	 * \param right Right held
+	 * \param focus Focus (slow) held
+	 * \return Direction index, opposing keys cancel out
+	 */
+	inline Movement movementFromKeys(bool up, bool down, bool left, bool right, bool focus)
+	{
+		// indexed by [dy + 1][dx + 1]
+		constexpr Movement kNormal[3][3] = {
+			{ TopLeft, Up, TopRight },
+			{ Left, Hold, Right },
+			{ BottomLeft, Down, BottomRight }
+		};
+		constexpr Movement kFocused[3][3] = {
+			{ FocusTopLeft, FocusUp, FocusTopRight },
+			{ FocusLeft, Hold, FocusRight },
+			{ FocusBottomLeft, FocusDown, FocusBottomRight }
+		};
+		int dx = (int)right - (int)left;
+		int dy = (int)down - (int)up;
+		return focus ? kFocused[dy + 1][dx + 1] : kNormal[dy + 1][dx + 1];
+	}
 
 }
 
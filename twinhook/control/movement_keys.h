@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include <dinput.h>
+
+#include "control/movement.h"
+
+/**
+ * DirectInput keys of the movement directions, for the hooks which press them.
+ * Kept apart from movement.h, which tools outside the game build as well.
+ */
+namespace control
+{
+	// Keys to press in order to move in a certain direction
+	constexpr uint8_t kMovementToInput[][3] = {
+			{ DIK_LSHIFT,	NULL,			NULL },	// focus by default
+			{ DIK_UP,		NULL,			NULL },
+			{ DIK_DOWN,		NULL,			NULL },
+			{ DIK_LEFT,		NULL,			NULL },
+			{ DIK_RIGHT,	NULL,			NULL },
+			{ DIK_UP,		DIK_LEFT,		NULL },
+			{ DIK_UP,		DIK_RIGHT,		NULL },
+			{ DIK_DOWN,		DIK_LEFT,		NULL },
+			{ DIK_DOWN,		DIK_RIGHT,		NULL },
+			{ DIK_UP,		NULL,			DIK_LSHIFT },
+			{ DIK_DOWN,		NULL,			DIK_LSHIFT },
+			{ DIK_LEFT,		NULL,			DIK_LSHIFT },
+			{ DIK_RIGHT,	NULL,			DIK_LSHIFT },
+			{ DIK_UP,		DIK_LEFT,		DIK_LSHIFT },
+			{ DIK_UP,		DIK_RIGHT,		DIK_LSHIFT },
+			{ DIK_DOWN,		DIK_LEFT,		DIK_LSHIFT },
+			{ DIK_DOWN,		DIK_RIGHT,		DIK_LSHIFT }
+	};
+
+	// Key presses which should be reset each frame
+	constexpr uint8_t kControlKeys[] = { DIK_UP, DIK_DOWN, DIK_LEFT, DIK_RIGHT, DIK_LSHIFT, DIK_X };
+
+}
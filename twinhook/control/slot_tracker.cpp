@@ -0,0 +1,39 @@
+#include "stdafx.h"
+#include "slot_tracker.h"
+
+#include <algorithm>
+
+#include <imgui.h>
+
+#include "gfx/imgui_mixins.h"
+#include "util/counters.h"
+
+slot_tracker::slot_tracker(uint32_t slots) : slotCount(slots), window(slots)
+{
+	inUse.reserve(slots);
+	previous.reserve(slots);
+	setLatency(DEFAULT_LATENCY);
+}
+
+void slot_tracker::setLatency(unsigned int polls)
+{
+	// the windows of the last `polls` polls cover every slot
+	const uint32_t n = std::max(1u, polls);
+	window = (slotCount + n - 1) / n;
+}
+
+void slot_tracker::endPoll()
+{
+	sweepIn = sweepIn == 0 ? SWEEP_INTERVAL - 1 : sweepIn - 1;
+	TH_COUNT_N(PollSlotsRead, readCount);
+	TH_COUNT_N(PollSlotsSkipped, slotCount - readCount);
+}
+
+void slot_tracker::render(const char* name) const
+{
+	using namespace ImGui;
+	Text("%s: %u of %u slots read, %u in use", name, readCount, slotCount, active());
+	SameLine(); ShowHelpMarker("Slots in use are read every frame, free slots\n"
+		"only when the rolling window passes them");
+	Text("  %.0f KB skipped", (slotCount - readCount) * SLOT_TEST_BYTES / 1024.f);
+}
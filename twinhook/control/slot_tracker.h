@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Remembers which slots of a game's fixed-size object pool are in use,
+ * so a poller reads only part of the pool each frame.
+ *
+ * Every poll reads the slots which were in use at the previous poll, plus a
+ * window over the other slots which moves on with every poll and wraps around.
+ * The window covers the whole pool within the latency, so an object appearing
+ * in a free slot is seen at most that many polls late, while objects in slots
+ * already in use are seen every poll. The whole pool is read every
+ * SWEEP_INTERVAL polls and after reset().
+ *
+ * Slots are visited in increasing order, so objects are emitted in the same
+ * order as by a scan of the whole pool.
+ */
+class slot_tracker
+{
+public:
+	// Polls between reads of the whole pool
+	static const unsigned int SWEEP_INTERVAL = 60;
+	// Polls until an object in a previously free slot is seen. Longer
+	// latencies save reads but hide new bullets from the dodging algorithm
+	// for up to latency - 1 frames, so the whole pool is read by default
+	static const unsigned int DEFAULT_LATENCY = 1;
+	// Bytes read to test whether a slot is in use, about one cache line
+	static const unsigned int SLOT_TEST_BYTES = 64;
+
+	/**
+	 * \param slots Size of the pool
+	 */
+	explicit slot_tracker(uint32_t slots);
+
+	/**
+	 * \brief Set how many polls may pass until an object in a previously
+	 * free slot is seen
+	 * \param polls Latency, where 1 reads the whole pool on every poll
+	 */
+	void setLatency(unsigned int polls);
+
+	/**
+	 * \brief Read the whole pool on the next poll, e.g. after the pool moved
+	 */
+	void reset() { sweepIn = 0; }
+
+	/**
+	 * \brief Read the slots due this poll
+	 * \param read Called with each slot due, in increasing order, and returns
+	 * whether the slot is in use
+	 */
+	template <typename F>
+	void poll(F read);
+
+	uint32_t size() const { return slotCount; }
+	// Slots in use at the last poll
+	uint32_t active() const { return (uint32_t)inUse.size(); }
+	// Slots read by the last poll
+	uint32_t lastRead() const { return readCount; }
+
+	void render(const char* name) const;
+
+private:
+	uint32_t slotCount;
+	// Slots read per poll besides those in use
+	uint32_t window;
+	// First slot of the next window
+	uint32_t cursor = 0;
+	unsigned int sweepIn = 0;
+	uint32_t readCount = 0;
+
+	// Slots in use at the last poll and the one before, in increasing order
+	std::vector<uint32_t> inUse;
+	std::vector<uint32_t> previous;
+
+	void endPoll();
+};
+
+template <typename F>
+void slot_tracker::poll(F read)
+{
+	inUse.swap(previous);
+	inUse.clear();
+	readCount = 0;
+
+	// Slots of the window are read once, whether they were in use or not
+	size_t p = 0;
+	auto readInUse = [&](uint32_t limit)
+	{
+		for (; p < previous.size() && previous[p] < limit; ++p)
+		{
+			++readCount;
+			if (read(previous[p]))
+				inUse.push_back(previous[p]);
+		}
+	};
+	auto readRange = [&](uint32_t begin, uint32_t end)
+	{
+		readInUse(begin);
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			++readCount;
+			if (read(i))
+				inUse.push_back(i);
+		}
+		for (; p < previous.size() && previous[p] < end; ++p)
+			;
+	};
+
+	if (sweepIn == 0 || window >= slotCount)
+	{
+		readRange(0, slotCount);
+	}
+	else
+	{
+		const uint32_t end = cursor + window;
+		readRange(0, end > slotCount ? end - slotCount : 0);
+		readRange(cursor, end < slotCount ? end : slotCount);
+		readInUse(slotCount);
+		cursor = end % slotCount;
+	}
+	endPoll();
+}
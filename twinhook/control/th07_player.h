@@ -5,7 +5,7 @@ class th07_player : public th_player
 {
 public:
 
-	th07_player() : th_player(gs_addr{ (uint8_t*)0x4BDCA0, (uint8_t*)0x4B9E50 }) {}
+	th07_player() : th_player(gs_addr{ (uint8_t*)0x4BDCA0, (uint8_t*)0x4B9E50 }, true) {}
 	~th07_player() = default;
 
 	void onInit() override;
@@ -8,6 +8,7 @@
 #include "../gfx/di8_input_overlay.h"
 #include "../algo/th_algorithm.h"
 #include "../hook/th_d3d9_hook.h"
+#include "../hook/th08_bullet_proc_hook.h"
 #include "gfx/th_info_overlay.h"
 #include "patch/th_patch_registry.h"
 
@@ -33,6 +34,7 @@ void th08_player::onInit()
 
 void th08_player::onTick()
 {
+	th08_bullet_proc_hook::inst()->materialize();
 	th_player::onTick();
 }
 
@@ -5,7 +5,7 @@
 class th08_player : public th_player
 {
 public:
-	th08_player() : th_player(gs_addr{ (uint8_t*)0x017D6110, (uint8_t*)0x164D52C }) {}
+	th08_player() : th_player(gs_addr{ (uint8_t*)0x017D6110, (uint8_t*)0x164D52C }, true) {}
 	~th08_player() = default;
 
 	void onInit() override;
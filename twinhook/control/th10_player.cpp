@@ -1,12 +1,18 @@
 #include "stdafx.h"
 #include "th10_player.h"
+
+#include <imgui.h>
+
 #include "config/th_config.h"
 #include "hook/th_di8_hook.h"
+#include "util/counters.h"
 
 
 void th10_player::onInit()
 {
 	th_player::onInit();
+	bulletSlots.setLatency(pollLatency);
+	powerupSlots.setLatency(pollLatency);
 }
 
 void th10_player::onTick()
@@ -31,6 +37,15 @@ void th10_player::onAfterTick()
 void th10_player::draw(IDirect3DDevice9* d3dDev)
 {
 	th_player::draw(d3dDev);
+
+	using namespace ImGui;
+	Begin("twinject (netdex)");
+	if (CollapsingHeader("Object Pools"))
+	{
+		bulletSlots.render("bullets");
+		powerupSlots.render("powerups");
+	}
+	End();
 }
 
 void th10_player::handleInput(const BYTE diKeys[256], const BYTE press[256])
@@ -51,39 +66,43 @@ void th10_player::doBulletPoll()
 
 	int base = *(int*)0x004776F0;
 	if (!base) return;
+	if (base != bulletBase)
+	{
+		bulletBase = base;
+		bulletSlots.reset();
+	}
 
-	int ebx = base + 0x60;
-	for (int i = 0; i < 2000; i++)
+	int eax = *(int*)0x477810;
+	const bool collidable = eax && !(*(int*)(eax + 0x58) & 0x00000400);
+
+	// only slots in use and a window of the free ones are read, see slot_tracker
+	bulletSlots.poll([&](uint32_t i)
 	{
+		int ebx = base + 0x60 + i * 0x7F0;
 		int edi = ebx + 0x400;
 		int bp = *(int*)(edi + 0x46) & 0x0000FFFF;
-		if (bp)
-		{
-			int eax = *(int*)0x477810;
-			if (eax)
-			{
-				eax = *(int*)(eax + 0x58);
-				if (!(eax & 0x00000400)) {
-					float dx = *(float*)(ebx + 0x3C0);
-					float dy = *(float*)(ebx + 0x3C4);
-					float x = *(float*)(ebx + 0x3B4);
-					float y = *(float*)(ebx + 0x3B8);
-					float w = *(float*)(ebx + 0x3F0);
-					float h = *(float*)(ebx + 0x3F4);
-
-					vec2 sz = vec2(w, h);
-					aabb a{
-						vec2(x + th_param.GAME_WIDTH / 2, y) - sz / 2,
-						vec2(dx,dy),
-						sz
-					};
-					bullet b{ a };
-					bullets.push_back(b);
-				}
-			}
+		if (!bp)
+			return false;
+		if (collidable) {
+			float dx = *(float*)(ebx + 0x3C0);
+			float dy = *(float*)(ebx + 0x3C4);
+			float x = *(float*)(ebx + 0x3B4);
+			float y = *(float*)(ebx + 0x3B8);
+			float w = *(float*)(ebx + 0x3F0);
+			float h = *(float*)(ebx + 0x3F4);
+
+			vec2 sz = vec2(w, h);
+			aabb a{
+				vec2(x + th_param.GAME_WIDTH / 2, y) - sz / 2,
+				vec2(dx,dy),
+				sz
+			};
+			bullet b{ a };
+			bullets.push_back(b);
+			TH_COUNT(PolledBullets);
 		}
-		ebx += 0x7F0;
-	}
+		return true;
+	});
 }
 
 void th10_player::doEnemyPoll()
@@ -123,6 +142,7 @@ void th10_player::doEnemyPoll()
 					};
 					enemy e{ a };
 					enemies.push_back(e);
+					TH_COUNT(PolledEnemies);
 				}
 			}
 			objBase = objNext;
@@ -138,31 +158,37 @@ void th10_player::doPowerupPoll()
 
 	int base = *(int*)0x00477818;
 	if (!base) return;
+	if (base != powerupBase)
+	{
+		powerupBase = base;
+		powerupSlots.reset();
+	}
 	int esi = base + 0x14;
-	int ebp = esi + 0x3b0;
 
-	for (int i = 0; i < 2000; i++)
+	powerupSlots.poll([&](uint32_t i)
 	{
+		int ebp = esi + 0x3b0 + i * 0x3f0;
 		int eax = *(int*)(ebp + 0x2c);
-		if (eax == 1)
-		{
-			float x = *(float*)(ebp - 0x4);
-			float y = *(float*)ebp;
-			float dx = *(float*)(ebp - 0x4 + 0xc);
-			float dy = *(float*)(ebp + 0xc);
+		if (eax != 1)
+			return false;
 
-			vec2 sz(6, 6);
+		float x = *(float*)(ebp - 0x4);
+		float y = *(float*)ebp;
+		float dx = *(float*)(ebp - 0x4 + 0xc);
+		float dy = *(float*)(ebp + 0xc);
 
-			aabb a{
-				vec2(x + th_param.GAME_WIDTH / 2, y) - sz / 2,
-				vec2(dx, dy),
-				sz
-			};
-			powerup p{ a };
-			powerups.push_back(p);
-		}
-		ebp += 0x3f0;
-	}
+		vec2 sz(6, 6);
+
+		aabb a{
+			vec2(x + th_param.GAME_WIDTH / 2, y) - sz / 2,
+			vec2(dx, dy),
+			sz
+		};
+		powerup p{ a };
+		powerups.push_back(p);
+		TH_COUNT(PolledPowerups);
+		return true;
+	});
 }
 
 void th10_player::doLaserPoll()
@@ -194,6 +220,7 @@ void th10_player::doLaserPoll()
 			};
 			laser l{ a };
 			lasers.push_back(l);
+			TH_COUNT(PolledLasers);
 			esi = ebx;
 		} while (ebx);
 	}
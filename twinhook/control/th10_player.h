@@ -17,6 +17,12 @@ public:
 	void onEnableChanged(bool enable) override;
 
 private:
+	// Object pools of 2000 slots each, and the address they were last seen at
+	slot_tracker bulletSlots{ 2000 };
+	slot_tracker powerupSlots{ 2000 };
+	int bulletBase = 0;
+	int powerupBase = 0;
+
 	void doBulletPoll();
 	void doEnemyPoll();
 	void doPowerupPoll();
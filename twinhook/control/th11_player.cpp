@@ -1,12 +1,17 @@
 #include "stdafx.h"
 #include "th11_player.h"
+
+#include <imgui.h>
+
 #include "config/th_config.h"
 #include "hook/th_di8_hook.h"
+#include "util/counters.h"
 
 
 void th11_player::onInit()
 {
 	th_player::onInit();
+	bulletSlots.setLatency(pollLatency);
 }
 
 void th11_player::onTick()
@@ -31,6 +36,12 @@ void th11_player::onAfterTick()
 void th11_player::draw(IDirect3DDevice9* d3dDev)
 {
 	th_player::draw(d3dDev);
+
+	using namespace ImGui;
+	Begin("twinject (netdex)");
+	if (CollapsingHeader("Object Pools"))
+		bulletSlots.render("bullets");
+	End();
 }
 
 void th11_player::handleInput(const BYTE diKeys[256], const BYTE press[256])
@@ -50,33 +61,38 @@ void th11_player::doBulletPoll()
 	if (!*(int*)dword_4A8D68)
 		return;
 
-	char *pBase = (char*)*dword_4A8D68 + 100;
-	int i = 2000;
-	do
+	if (*dword_4A8D68 != bulletBase)
 	{
-		if (*pBase & 1)
-		{
-			if (*((WORD *)pBase + 601) == 1) {
-				float w = *((float *)pBase + 279);
-				float x = *((float *)pBase + 271);
-				float h = *((float *)pBase + 280);
-				float y = *((float *)pBase + 272);
-				float dx = *((float *)pBase + 274);
-				float dy = *((float *)pBase + 275);
-				vec2 sz(w, h);
-				aabb a{
-					vec2(x + th_param.GAME_WIDTH / 2,y) - sz / 2,
-					vec2(dx,dy),
-					sz
-				};
-				bullet b{ a };
-				bullets.push_back(b);
-			}
-		}
-		pBase += 2320;
-		--i;
-	} while (i);
+		bulletBase = *dword_4A8D68;
+		bulletSlots.reset();
+	}
 
+	// only slots in use and a window of the free ones are read, see slot_tracker
+	char *pFirst = (char*)*dword_4A8D68 + 100;
+	bulletSlots.poll([&](uint32_t i)
+	{
+		char *pBase = pFirst + i * 2320;
+		if (!(*pBase & 1))
+			return false;
+		if (*((WORD *)pBase + 601) == 1) {
+			float w = *((float *)pBase + 279);
+			float x = *((float *)pBase + 271);
+			float h = *((float *)pBase + 280);
+			float y = *((float *)pBase + 272);
+			float dx = *((float *)pBase + 274);
+			float dy = *((float *)pBase + 275);
+			vec2 sz(w, h);
+			aabb a{
+				vec2(x + th_param.GAME_WIDTH / 2,y) - sz / 2,
+				vec2(dx,dy),
+				sz
+			};
+			bullet b{ a };
+			bullets.push_back(b);
+			TH_COUNT(PolledBullets);
+		}
+		return true;
+	});
 }
 
 void th11_player::doEnemyPoll()
@@ -18,6 +18,10 @@ public:
 	void onEnableChanged(bool enable) override;
 
 private:
+	// Bullet pool of 2000 slots, and the address it was last seen at
+	slot_tracker bulletSlots{ 2000 };
+	int bulletBase = 0;
+
 	void doBulletPoll();
 	void doEnemyPoll();
 	void doPowerupPoll();
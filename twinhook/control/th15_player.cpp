@@ -8,6 +8,7 @@
 #include "../algo/th_algorithm.h"
 #include "../patch/th15_patch_autobomb.h"
 #include "../hook/th_d3d9_hook.h"
+#include "../hook/th15_bullet_proc_hook.h"
 #include "gfx/th_info_overlay.h"
 #include "patch/th_patch_registry.h"
 
@@ -19,6 +20,7 @@ void th15_player::onInit()
 
 void th15_player::onTick()
 {
+	th15_bullet_proc_hook::inst()->materialize();
 	th_player::onTick();
 }
 
@@ -11,10 +11,94 @@
 
 #include "gfx/di8_input_overlay.h"
 #include "gfx/imgui_window.h"
+#include "ipc/th_telemetry.h"
+#include "util/counters.h"
+#include "util/kernels.h"
 
 void th_player::onInit()
 {
 	ASSERT(("Could not initialize IMGUI window", imgui_window_init()));
+
+	// optional share of the frame the bot may use, in percent
+	size_t len;
+	char buf[16] = { 0 };
+	getenv_s(&len, buf, sizeof(buf), "budget");
+	if (len > 0)
+		governor.setBudget((float)atof(buf) / 100.f);
+
+	// optional, "csv" or "binary" to export the algorithm counters of every frame
+	getenv_s(&len, buf, sizeof(buf), "counters");
+	if (strcmp(buf, "csv") == 0)
+		th_counters::startExport("twinject_counters.csv", false);
+	else if (strcmp(buf, "binary") == 0)
+		th_counters::startExport("twinject_counters.bin", true);
+
+	// optional frames a new object may go unseen by pollers of object pools,
+	// trading reads for late reactions to bullets spawned into free slots
+	getenv_s(&len, buf, sizeof(buf), "poll_latency");
+	if (len > 0)
+		pollLatency = std::max(1, atoi(buf));
+
+	// optional pipe or socket of a telemetry collector, e.g. thtelemetry
+	char address[256] = { 0 };
+	getenv_s(&len, address, sizeof(address), "telemetry");
+	if (len > 0)
+		th_telemetry::startExport(address);
+
+	// optional instruction set of the batch collision kernels, e.g. "scalar"
+	// to compare against older machines, otherwise the best one is detected
+	kernels::isa level = kernels::detect();
+	getenv_s(&len, buf, sizeof(buf), "simd");
+	if (len > 0 && !kernels::parse(buf, level))
+		SPDLOG_WARN("Unknown instruction set '{}'", buf);
+	if (!kernels::select(level))
+	{
+		SPDLOG_WARN("Instruction set '{}' is not supported by this CPU", kernels::name(level));
+		level = kernels::detect();
+		kernels::select(level);
+	}
+	// the kernels must agree with vec2 exactly, distrust them otherwise
+	if (const size_t mismatches = kernels::conformance(level, 0, 1024))
+	{
+		SPDLOG_WARN("{} kernels differ from scalar on {} shapes", kernels::name(level), mismatches);
+		level = kernels::Scalar;
+		kernels::select(level);
+	}
+	SPDLOG_INFO("Using {} collision kernels", kernels::name(level));
+	if (level != kernels::Scalar)
+		scheduleConformance(level);
+
+	// optional "discrete" to predict collisions at whole frames like the game
+	// tests them, otherwise times of impact are predicted; read by the batch
+	// kernels and, through activePredictor, by the velocity obstacle field
+	kernels::predictor predictor = kernels::Continuous;
+	getenv_s(&len, buf, sizeof(buf), "predictor");
+	if (len > 0 && !kernels::parse(buf, predictor))
+		SPDLOG_WARN("Unknown predictor '{}'", buf);
+	kernels::usePredictor(predictor);
+	SPDLOG_INFO("Using {} collision prediction", kernels::name(predictor));
+}
+
+void th_player::scheduleConformance(kernels::isa level)
+{
+	// the kernels go on being compared on new shapes in the background, so a
+	// rare mismatch the check at startup missed still demotes them
+	unsigned int batch = 0;
+	scheduler.add(std::make_unique<function_task>([level, batch]() mutable
+	{
+		if (kernels::conformance(level, ++batch, CONFORMANCE_BATCH_SHAPES) > 0)
+		{
+			SPDLOG_WARN("{} kernels differ from scalar in batch {}, using scalar",
+				kernels::name(level), batch);
+			kernels::select(kernels::Scalar);
+			return true;
+		}
+		if (batch < CONFORMANCE_BATCHES)
+			return false;
+		SPDLOG_INFO("{} kernels agree with scalar on {} more shapes", kernels::name(level),
+			CONFORMANCE_BATCHES * CONFORMANCE_BATCH_SHAPES);
+		return true;
+	}), -1);
 }
 
 void th_player::onBeginTick()
@@ -36,10 +120,66 @@ void th_player::onTick()
 		this->handleInput(diKeys, press);
 	}
 
+	detectTick();
+	laserTracker.update(lasers, gameTick, tickAdvanced);
+
 	if (algorithm)
 		algorithm->onTick();
 }
 
+// 64-bit FNV-1a
+static void hashBytes(uint64_t& h, const void* data, size_t len)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < len; ++i)
+	{
+		h ^= bytes[i];
+		h *= 0x100000001b3ull;
+	}
+}
+
+template<typename T>
+static void hashObjects(uint64_t& h, const std::vector<T>& objs)
+{
+	size_t count = objs.size();
+	hashBytes(h, &count, sizeof(count));
+	for (const T& o : objs)
+	{
+		vec2 c = o.obj->com();
+		hashBytes(h, &c.x, sizeof(c.x));
+		hashBytes(h, &c.y, sizeof(c.y));
+	}
+}
+
+void th_player::detectTick()
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	vec2 c = getPlayerEntity().obj->com();
+	hashBytes(h, &c.x, sizeof(c.x));
+	hashBytes(h, &c.y, sizeof(c.y));
+
+	if (hookedObjects)
+	{
+		const bool hooksFired = !bullets.empty() || !enemies.empty()
+			|| !powerups.empty() || !lasers.empty();
+		tickAdvanced = hooksFired || h != worldHash;
+	}
+	else
+	{
+		hashObjects(h, bullets);
+		hashObjects(h, enemies);
+		hashObjects(h, powerups);
+		hashObjects(h, lasers);
+		tickAdvanced = h != worldHash || ++staleFrames >= MAX_STALE_FRAMES;
+	}
+	if (tickAdvanced)
+	{
+		++gameTick;
+		staleFrames = 0;
+	}
+	worldHash = h;
+}
+
 void th_player::onAfterTick()
 {
 	bullets.clear();
@@ -50,6 +190,12 @@ void th_player::onAfterTick()
 	imgui_window_render();
 }
 
+void th_player::onIdle()
+{
+	const std::chrono::duration<float, std::milli> slice(governor.idleMillis());
+	scheduler.run(std::chrono::duration_cast<task_scheduler::duration>(slice));
+}
+
 void th_player::draw(IDirect3DDevice9* d3dDev)
 {
 	if (algorithm)
@@ -61,6 +207,8 @@ void th_player::draw(IDirect3DDevice9* d3dDev)
 	using namespace ImGui;
 	Begin("twinject (netdex)");
 	Text("b e p l #: %d %d %d %d", bullets.size(), enemies.size(), powerups.size(), lasers.size());
+	Text("game tick: %d%s", gameTick, tickAdvanced ? "" : " (stale)");
+	Text("tracked lasers: %d", laserTracker.size());
 	Text("bot state: %s", enabled ? "ENABLED" : "DISABLED");
 	Text("viz state: %s", render ? "DETAILED" : "NONE");
 
@@ -70,6 +218,13 @@ void th_player::draw(IDirect3DDevice9* d3dDev)
 	if (Button("Toggle Debug"))
 		render = !render;
 	Checkbox("Show IMGUI demo", &imguiShowDemoWindow);
+	if (CollapsingHeader("Frame Budget"))
+	{
+		governor.render();
+		Text("tasks: %d pending, %d done, %d late", (int)scheduler.size(),
+			(int)scheduler.completed(), (int)scheduler.missedDeadlines());
+	}
+	th_counters::render();
 	End();
 
 	if (imguiShowDemoWindow)	ShowDemoWindow();
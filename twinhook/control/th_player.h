@@ -1,7 +1,13 @@
 #pragma once
 
 #include "util/vec2.h"
+#include "control/kbd_state.h"
+#include "control/frame_governor.h"
+#include "control/slot_tracker.h"
+#include "util/kernels.h"
+#include "util/task_scheduler.h"
 #include "algo/th_algorithm.h"
+#include "algo/laser_tracker.h"
 #include "info/keypress_detect.h"
 #include "gfx/imgui_controller.h"
 
@@ -14,20 +20,13 @@ struct gs_addr
 	uint8_t *kbd_state;
 };
 
-union th_kbd_state
-{
-	struct {
-		bool shot;		// 0
-		bool bomb;		// 1
-		bool slow;		// 2
-		bool skip;		// 3
-		bool up;		// 4
-		bool left;		// 5
-		bool down;		// 6
-		bool right;		// 7
-	};
-	bool keys[8];
-};
+// Shapes per kernel compared by each step of the background conformance check
+static const unsigned int CONFORMANCE_BATCH_SHAPES = 64;
+// Steps of the background conformance check
+static const unsigned int CONFORMANCE_BATCHES = 256;
+
+// Maximum number of frames an unchanged polled world is considered to be the same tick
+static const int MAX_STALE_FRAMES = 30;
 
 /**
  * \brief Object representing a human player.
@@ -41,6 +40,13 @@ protected:
 
 	// game specific pointers
 	gs_addr gs_ptr;
+
+	// Polls until pollers of object pools see a new object, see slot_tracker
+	unsigned int pollLatency = slot_tracker::DEFAULT_LATENCY;
+
+	// Objects are captured by hooks inside the game logic rather than polled,
+	// so they are only seen on frames on which the logic ran
+	bool hookedObjects;
 public:
 	std::vector<bullet> bullets;
 	std::vector<enemy> enemies;
@@ -50,7 +56,17 @@ public:
 	bool enabled = false;
 	bool render = false;
 
-	th_player(gs_addr gsa) : gs_ptr(gsa) {}
+	// Number of game ticks observed, see detectTick()
+	unsigned int gameTick = 0;
+	// Whether the game advanced since the previous Direct3D frame
+	bool tickAdvanced = true;
+
+	// Scales algorithm quality to keep the bot within its frame budget
+	frame_governor governor;
+	// Background work, run in the frame budget left over after each tick
+	task_scheduler scheduler;
+
+	th_player(gs_addr gsa, bool hookedObjects = false) : gs_ptr(gsa), hookedObjects(hookedObjects) {}
 	virtual ~th_player()
 	{
 		if (imguictl)	delete imguictl;
@@ -76,6 +92,12 @@ public:
 	 */
 	virtual void onAfterTick();
 
+	/**
+	 * \brief Called after a tick is completed, to run background tasks in the
+	 * remaining frame budget.
+	 */
+	virtual void onIdle();
+
 	/**
 	 * \brief Draw debugging information and visualizations to the game device.
 	 * \param d3dDev D3D9 wrapper device
@@ -109,6 +131,12 @@ public:
 	 */
 	virtual player getPlayerEntity() = 0;
 
+	/**
+	 * \brief Get the stage being played
+	 * \return The stage, or 0 if the controller cannot tell
+	 */
+	virtual unsigned int getStage() { return 0; }
+
 	/*
 	 * Memory addresses and values borrowed from
 	 * https://www.shrinemaiden.org/forum/index.php?topic=16024.0
@@ -116,6 +144,41 @@ public:
 	 */
 	th_kbd_state getKeyboardState() const;
 private:
+	/* Tick Detection */
+	// Hash of the captured world in the previous frame
+	uint64_t worldHash = 0;
+	// Frames since the world last changed
+	int staleFrames = 0;
+
+	/**
+	 * \brief Detect whether the game simulation advanced since the last frame.
+	 * The game logic rate is not tied to the Direct3D frame rate (slowdown, pauses,
+	 * dialogue, frame skip), and none of the supported games has a known frame
+	 * counter, so the captured world is hashed and compared to the previous frame.
+	 *
+	 * Games with hookedObjects only see objects on frames on which the logic ran,
+	 * so captured objects are taken as a tick and only the player is hashed; a
+	 * frame without objects is not a change of the world. The logic running
+	 * without any objects is only seen once the player moves.
+	 *
+	 * Limitation: games which poll their objects treat a world which stays
+	 * identical for MAX_STALE_FRAMES frames as advanced, so a stationary player
+	 * on an empty screen cannot stall calibration. Paused games therefore count
+	 * a tick every MAX_STALE_FRAMES frames, decided on the unchanged world.
+	 */
+	void detectTick();
+
+	/**
+	 * \brief Keep comparing the selected kernels against the scalar ones as a
+	 * background task, and fall back to the scalar kernels on a mismatch
+	 * \param level Selected instruction set
+	 */
+	void scheduleConformance(kernels::isa level);
+
+	/* Laser Tracking */
+	// Estimates rotation and growth of lasers across game ticks
+	laser_tracker laserTracker;
+
 	/* IMGUI display variables */
 
 	bool imguiShowDemoWindow = false;
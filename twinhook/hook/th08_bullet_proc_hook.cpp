@@ -2,6 +2,7 @@
 #include "th08_bullet_proc_hook.h"
 #include "../util/detour.h"
 #include "../control/th08_player.h"
+#include "../util/counters.h"
 
 th08_bullet_proc_hook* th08_bullet_proc_hook::instance = nullptr;
 
@@ -60,40 +61,78 @@ static void Hook_TH08_sub_410A70()
 		SPDLOG_ERROR("Detours: Failed to hook sub_410A70");
 }
 
+// callers of sub_410A70
+static const int BULLET_UPDATE_RET = 0x004314B3;
+static const int POWERUP_UPDATE_RET = 0x0044095B;
+
 void th08_bullet_proc_hook::vectorUpdateHook(int retaddr, int a1, int a2, int a3)
 {
-	// HACK this might cause performance problems, also are we guaranteed a th08_player?
-	th_player *player = inst()->player;
-	ASSERT(("wrong player type bound to hook", player));
-	std::vector<bullet> &TH08_Bullets = player->bullets;
-	std::vector<powerup> &TH08_Powerups = player->powerups;
+	// This runs for every object inside the game's update loops, so the values
+	// are only copied and decoded by materialize
+	if (retaddr != BULLET_UPDATE_RET && retaddr != POWERUP_UPDATE_RET)
+		return;
+	object_record *r = inst()->hooked.append();
+	if (!r)
+		return;
 
-	// routine from bullet update
-	if (retaddr == 0x004314B3)
+	r->retaddr = retaddr;
+	r->x = *(float*)(a1 + 0);
+	r->y = *(float*)(a1 + 4);
+	r->vx = *(float*)(a3 + 0);
+	r->vy = *(float*)(a3 + 4);
+	if (retaddr == BULLET_UPDATE_RET)
 	{
-		vec2 sz(*(float*)(a2 + 3380), *((float*)(a2 + 3380) + 1));
-		aabb a{
-			vec2(*(float*)(a1 + 0), *(float*)(a1 + 4)) - sz / 2,
-			vec2(*(float*)(a3 + 0),*(float*)(a3 + 4)),
-			sz
-		};
-		bullet b{ a };
-		// find log2 of bullet action binary flag
-		if (!_BitScanReverse((DWORD*)&b.meta, *((DWORD*)a2 + 875)))
-			b.meta = 0;
-
-		TH08_Bullets.push_back(b);
+		r->w = *(float*)(a2 + 3380);
+		r->h = *((float*)(a2 + 3380) + 1);
+		r->flags = *((DWORD*)a2 + 875);
 	}
-	else if (retaddr == 0x0044095B)
+	else
 	{
-		vec2 sz(10, 10);
-		aabb a{
-			vec2(*(float*)(a1 + 0), *(float*)(a1 + 4)) - sz / 2,
-			vec2(*(float*)(a3 + 0), *(float*)(a3 + 4)),
-			sz
-		};
-		powerup p{ a,  *(BYTE*)(a1 - 676 + 727) };
-
-		TH08_Powerups.push_back(p);
+		r->flags = *(BYTE*)(a1 - 676 + 727);
 	}
-}
\ No newline at end of file
+}
+
+void th08_bullet_proc_hook::materialize()
+{
+	std::vector<bullet> &TH08_Bullets = player->bullets;
+	std::vector<powerup> &TH08_Powerups = player->powerups;
+	TH08_Bullets.reserve(TH08_Bullets.size() + hooked.size());
+
+	size_t bulletCount = 0;
+	for (const object_record &r : hooked)
+	{
+		if (r.retaddr == BULLET_UPDATE_RET)
+		{
+			vec2 sz(r.w, r.h);
+			aabb a{
+				vec2(r.x, r.y) - sz / 2,
+				vec2(r.vx, r.vy),
+				sz
+			};
+			bullet b{ a };
+			// find log2 of bullet action binary flag
+			DWORD flags = r.flags;
+			if (!_BitScanReverse((DWORD*)&b.meta, flags))
+				b.meta = 0;
+
+			TH08_Bullets.push_back(b);
+			++bulletCount;
+		}
+		else
+		{
+			vec2 sz(10, 10);
+			aabb a{
+				vec2(r.x, r.y) - sz / 2,
+				vec2(r.vx, r.vy),
+				sz
+			};
+			powerup p{ a, (BYTE)r.flags };
+
+			TH08_Powerups.push_back(p);
+		}
+	}
+	TH_COUNT_N(HookedBullets, bulletCount);
+	TH_COUNT_N(HookedPowerups, hooked.size() - bulletCount);
+	if (const size_t dropped = hooked.clear())
+		TH_COUNT_N(HookedDropped, dropped);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "th_hook.h"
 #include "../control/th08_player.h"
+#include "../util/record_buffer.h"
 
 typedef int(__fastcall *sub_410A70_t)(int a1, int a2, int a3);
 int __fastcall sub_410A70_Hook(int a1, int a2, int a3);
@@ -10,10 +11,34 @@ class th08_bullet_proc_hook : public th_hook
 {
 	static th08_bullet_proc_hook *instance;
 public:
+	// Bullet or powerup as seen by sub_410A70, told apart by the caller
+	struct object_record
+	{
+		int retaddr;
+		float x, y;
+		float vx, vy;
+		// bullet size, unused for powerups
+		float w, h;
+		// bullet action flags, or powerup type
+		DWORD flags;
+	};
+
+	// More than the game's bullet and powerup pools together
+	static const size_t MAX_HOOKED_OBJECTS = 4096;
+
+	// Objects hooked since the last tick
+	record_buffer<object_record, MAX_HOOKED_OBJECTS> hooked;
+
 	th08_bullet_proc_hook(th08_player *player) : th_hook(player) {}
 
 	static void bind(th08_player *player);
 	static th08_bullet_proc_hook *inst();
 	
 	static void vectorUpdateHook(int retaddr, int a1, int a2, int a3);
+
+	/**
+	 * \brief Decode the hooked objects into the player's bullets and powerups
+	 * and clear them
+	 */
+	void materialize();
 };
@@ -2,6 +2,7 @@
 #include "th15_bullet_proc_hook.h"
 #include "../util/detour.h"
 #include "../config/th_config.h"
+#include "../util/counters.h"
 #include <emmintrin.h>
 
 th15_bullet_proc_hook* th15_bullet_proc_hook::instance = nullptr;
@@ -25,14 +26,35 @@ static sub_455D00_t sub_455D00_Original = (sub_455D00_t)0x00455D00;
 static void sub_455D00_add(int pPos, float fRadius)
 {
 	// HACK we need to do this because SEH is enabled and we can't 
-	// create temp objects in a naked fcn with SEH enabled
-	circle a{
-			vec2(*(float*)pPos + th_param.GAME_WIDTH / 2, *(float*)(pPos + 4)) ,
-			vec2(*(float*)(pPos + (3140 - 3128)), *(float*)(pPos + (3144 - 3128))),
-			fRadius
-	};
-	bullet b{ a };
-	th15_bullet_proc_hook::inst()->player->bullets.push_back(b);
+	// create temp objects in a naked fcn with SEH enabled.
+	// This runs for every bullet inside the game's collision loop, so the
+	// values are only copied; the bullet may be gone by the time of onTick
+	th15_bullet_proc_hook::bullet_record *r = th15_bullet_proc_hook::inst()->hooked.append();
+	if (!r)
+		return;
+	r->x = *(float*)pPos;
+	r->y = *(float*)(pPos + 4);
+	r->vx = *(float*)(pPos + (3140 - 3128));
+	r->vy = *(float*)(pPos + (3144 - 3128));
+	r->radius = fRadius;
+}
+
+void th15_bullet_proc_hook::materialize()
+{
+	std::vector<bullet> &bullets = player->bullets;
+	bullets.reserve(bullets.size() + hooked.size());
+	for (const bullet_record &r : hooked)
+	{
+		circle a{
+			vec2(r.x + th_param.GAME_WIDTH / 2, r.y),
+			vec2(r.vx, r.vy),
+			r.radius
+		};
+		bullets.emplace_back(a);
+	}
+	TH_COUNT_N(HookedBullets, hooked.size());
+	if (const size_t dropped = hooked.clear())
+		TH_COUNT_N(HookedDropped, dropped);
 }
 
 // signed int __userpurge _col_chk@<eax>(float fRadius@<xmm2>, int pPos, int a3)
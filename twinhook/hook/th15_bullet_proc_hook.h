@@ -1,6 +1,7 @@
 #pragma once
 #include "th_hook.h"
 #include "../control/th15_player.h"
+#include "../util/record_buffer.h"
 
 
 typedef signed int (__stdcall *sub_455D00_t)(int a1, int a2, int a3);
@@ -19,8 +20,27 @@ class th15_bullet_proc_hook : public th_hook
 {
 	static th15_bullet_proc_hook *instance;
 public:
+	// Bullet as seen by the game's collision check, in game coordinates
+	struct bullet_record
+	{
+		float x, y;
+		float vx, vy;
+		float radius;
+	};
+
+	// More than the game's bullet pool
+	static const size_t MAX_HOOKED_BULLETS = 4096;
+
+	// Bullets hooked since the last tick
+	record_buffer<bullet_record, MAX_HOOKED_BULLETS> hooked;
+
 	th15_bullet_proc_hook(th15_player *player) : th_hook(player) {}
 
 	static void bind(th15_player *player);
 	static th15_bullet_proc_hook *inst();
+
+	/**
+	 * \brief Decode the hooked bullets into the player's bullets and clear them
+	 */
+	void materialize();
 };
@@ -4,6 +4,8 @@
 #include "../util/cdraw.h"
 #include "../util/detour.h"
 #include "config/th_config.h"
+#include "ipc/th_telemetry.h"
+#include "util/counters.h"
 
 th_d3d9_hook* th_d3d9_hook::instance = nullptr;
 static Direct3D9Hook d3d9_hook;
@@ -50,16 +52,27 @@ void th_d3d9_hook::d3d9InitHook(IDirect3DDevice9 *d3dDev)
 
 void th_d3d9_hook::d3d9BeginHook(IDirect3DDevice9 *d3dDev)
 {
+	frame_governor& governor = inst()->player->governor;
+	governor.beginWork();
 	inst()->player->onBeginTick();
+	governor.endWork();
 }
 
 void th_d3d9_hook::d3d9EndHook(IDirect3DDevice9 *d3dDev)
 {
+	frame_governor& governor = inst()->player->governor;
+	governor.beginWork();
 	inst()->player->onTick();
 	cdraw::begin();
 	inst()->player->draw(d3dDev);
 	cdraw::end();
 	inst()->player->onAfterTick();
+	governor.endWork();
+	// Background work uses the remaining budget, and is not counted as bot work
+	inst()->player->onIdle();
+	governor.endFrame();
+	th_counters::endFrame(inst()->player->gameTick);
+	th_telemetry::sendFrame(*inst()->player);
 }
 
 static Direct3DCreate9_t Direct3DCreate9_Original = Direct3DCreate9;
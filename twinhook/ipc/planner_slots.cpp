@@ -0,0 +1,195 @@
+#include "planner_slots.h"
+
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Polls of a slot before a waiting client starts yielding its time slice
+	const int SPIN_POLLS = 256;
+
+	uint32_t processId()
+	{
+#ifdef _WIN32
+		return GetCurrentProcessId();
+#else
+		return (uint32_t)getpid();
+#endif
+	}
+}
+
+int64_t planner::now()
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+size_t planner::block::totalSize(uint32_t slots)
+{
+	return sizeof(planner::header) + (size_t)slots * sizeof(slot);
+}
+
+bool planner::block::create(const std::string& name, uint32_t slots)
+{
+	if (slots == 0)
+		return false;
+	// a block in use is left alone, as resetting it would free the slots of
+	// its clients; a crashed service's block is replaced, and its clients
+	// reconnect to the new one once they see its heartbeat stalled
+	if (!memory.create(name, totalSize(slots))
+		&& (!abandoned(name) || !shared_memory::remove(name) || !memory.create(name, totalSize(slots))))
+		return false;
+
+	planner::header* h = new (memory.data()) planner::header;
+	h->magic = MAGIC;
+	h->version = VERSION;
+	h->slotCount = slots;
+	h->objectCapacity = MAX_OBJECTS;
+	h->heartbeat = 0;
+	h->answered = 0;
+	h->late = 0;
+	for (uint32_t i = 0; i < slots; ++i)
+		new (&at(i).state) std::atomic<uint32_t>(Free);
+	return true;
+}
+
+bool planner::block::abandoned(const std::string& name)
+{
+	block existing;
+	if (!existing.open(name))
+		return false;
+	const uint32_t beat = existing.header().heartbeat.load(std::memory_order_relaxed);
+	std::this_thread::sleep_for(std::chrono::milliseconds(client::STALE_MS));
+	return existing.header().heartbeat.load(std::memory_order_relaxed) == beat;
+}
+
+bool planner::block::open(const std::string& name)
+{
+	if (!memory.open(name))
+		return false;
+
+	const planner::header& h = header();
+	if (memory.size() < sizeof(planner::header) || h.magic != MAGIC || h.version != VERSION
+		|| h.objectCapacity != MAX_OBJECTS || memory.size() < totalSize(h.slotCount))
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+planner::slot& planner::block::at(uint32_t i) const
+{
+	uint8_t* base = static_cast<uint8_t*>(memory.data()) + sizeof(planner::header);
+	return reinterpret_cast<slot*>(base)[i];
+}
+
+bool planner::client::connect(const std::string& name)
+{
+	disconnect();
+	this->name = name;
+	nextAttempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(RECONNECT_MS);
+	if (!slots.open(name))
+		return false;
+
+	for (uint32_t i = 0; i < slots.slotCount(); ++i)
+	{
+		uint32_t expected = Free;
+		if (slots.at(i).state.compare_exchange_strong(expected, Idle))
+		{
+			s = &slots.at(i);
+			s->owner = processId();
+			lastHeartbeat = slots.header().heartbeat.load(std::memory_order_relaxed);
+			lastBeat = std::chrono::steady_clock::now();
+			return true;
+		}
+	}
+	slots.close();
+	return false;
+}
+
+void planner::client::disconnect()
+{
+	// a service still planning for this slot fails to answer, and leaves it free
+	if (s)
+		s->state.store(Free, std::memory_order_release);
+	s = nullptr;
+	slots.close();
+}
+
+bool planner::client::serviceAlive()
+{
+	const auto t = std::chrono::steady_clock::now();
+	const uint32_t beat = slots.header().heartbeat.load(std::memory_order_relaxed);
+	if (beat != lastHeartbeat)
+	{
+		lastHeartbeat = beat;
+		lastBeat = t;
+	}
+	return t - lastBeat < std::chrono::milliseconds(STALE_MS);
+}
+
+planner::request* planner::client::begin()
+{
+	if (!s || !serviceAlive())
+	{
+		const auto t = std::chrono::steady_clock::now();
+		if (t < nextAttempt || name.empty())
+			return nullptr;
+		const std::string n = name;
+		if (!connect(n))
+			return nullptr;
+	}
+
+	// Answered means a response arrived after its deadline, which is discarded
+	const uint32_t state = s->state.load(std::memory_order_acquire);
+	if (state != Idle && state != Answered)
+		return nullptr;
+	s->state.store(Idle, std::memory_order_relaxed);
+	return &s->req;
+}
+
+void planner::client::submit()
+{
+	s->req.sequence = ++sequence;
+	s->state.store(Requested, std::memory_order_release);
+}
+
+bool planner::client::wait(response& out)
+{
+	const int64_t deadline = s->req.deadline;
+	for (int polls = 0;; ++polls)
+	{
+		if (s->state.load(std::memory_order_acquire) == Answered)
+		{
+			if (s->resp.sequence != sequence)
+				return false;
+			out = s->resp;
+			s->state.store(Idle, std::memory_order_relaxed);
+			return true;
+		}
+		if (now() >= deadline)
+			break;
+		if (polls >= SPIN_POLLS)
+			std::this_thread::yield();
+	}
+
+	// Withdraw the request, unless the service took it in the meantime; then
+	// its response is discarded by the next begin()
+	uint32_t expected = Requested;
+	if (s->state.compare_exchange_strong(expected, Idle, std::memory_order_acq_rel))
+		return false;
+	if (expected == Answered && s->resp.sequence == sequence)
+	{
+		out = s->resp;
+		s->state.store(Idle, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
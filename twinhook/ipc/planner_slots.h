@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "algo/th_recording.h"
+#include "ipc/shared_memory.h"
+
+/**
+ * \brief Slots of a shared planner, which decides for several bot instances.
+ *
+ * The planner service creates a named block of slots; every twinhook instance
+ * claims one slot and publishes a request per game tick: the player and the
+ * obstacles as th_recording::object_records, and the player velocity of every
+ * candidate move. The service batches all pending requests, plans them on a
+ * worker pool and writes a response into the same slot.
+ *
+ * Each slot is a small state machine on one atomic:
+ *
+ *   Free -> Idle          client claims the slot
+ *   Idle -> Requested     client published a request
+ *   Requested -> Planning service took the request
+ *   Planning -> Answered  service wrote the response
+ *   Answered -> Idle      client read the response
+ *   Requested -> Idle     client gave up waiting before the service took it
+ *
+ * Both ends change states with compare-and-swap, so a request is planned at
+ * most once and a client which gave up never sees a late response as its own:
+ * responses carry the sequence number of their request.
+ */
+namespace planner
+{
+	const uint32_t MAGIC = 0x4C505754;	// "TWPL"
+	const uint32_t VERSION = 2;
+	const uint32_t DEFAULT_SLOTS = 16;
+	// Objects per request, further objects are dropped by the client
+	const uint32_t MAX_OBJECTS = 4096;
+	// Candidate moves per request, see control::Movement
+	const int MAX_MOVES = 17;
+	static constexpr const char* DEFAULT_NAME = "twinject_planner";
+
+	enum slot_state : uint32_t
+	{
+		Free,
+		Idle,
+		Requested,
+		Planning,
+		Answered
+	};
+
+	struct request
+	{
+		uint32_t sequence;
+		uint32_t gameTick;
+		// Microseconds on the steady clock by which the client needs the response
+		int64_t deadline;
+		// Frames to look ahead for obstacles
+		float horizon;
+		// kernels::predictor chosen for the client's game
+		uint32_t predictor;
+		// Size of the game area, which the player may not leave
+		float width, height;
+		// Number of candidate moves, and the player velocity of each
+		uint32_t moves;
+		float velocity[MAX_MOVES][2];
+		th_recording::object_record player;
+		uint32_t objectCount;
+		th_recording::object_record objects[MAX_OBJECTS];
+	};
+
+	struct response
+	{
+		uint32_t sequence;
+		// Chosen direction, see control::Movement
+		int32_t move;
+		// Frames until collision of the chosen move, FLT_MAX if none
+		float risk;
+		uint32_t bomb;
+		// Frames until collision of every candidate move
+		float ticks[MAX_MOVES];
+		// Requests planned in the same batch
+		uint32_t batch;
+	};
+
+	struct slot
+	{
+		std::atomic<uint32_t> state;
+		// Process of the client which claimed the slot
+		uint32_t owner;
+		request req;
+		response resp;
+	};
+
+	struct header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount;
+		uint32_t objectCapacity;
+		// Advanced by the service while it runs, so clients notice it is gone
+		std::atomic<uint32_t> heartbeat;
+		// Requests answered, and those answered after their deadline
+		std::atomic<uint64_t> answered;
+		std::atomic<uint64_t> late;
+	};
+
+	// Microseconds on the steady clock, which all processes of a machine share
+	int64_t now();
+
+	/**
+	 * \brief The shared block of slots, as mapped by either end
+	 */
+	class block
+	{
+		shared_memory memory;
+
+		static size_t totalSize(uint32_t slots);
+		// Whether a compatible block of the name exists whose heartbeat stalled
+		static bool abandoned(const std::string& name);
+
+	public:
+		block() = default;
+
+		/**
+		 * \brief Create the slots. Fails while a service runs under the same
+		 * name; the block of a service which crashed (on POSIX, where its name
+		 * outlives it) is replaced once its heartbeat stalled for client::STALE_MS.
+		 * \param name Name of the shared memory block
+		 * \param slots Number of slots, i.e. of clients served at once
+		 * \return Whether the block could be created
+		 */
+		bool create(const std::string& name, uint32_t slots = DEFAULT_SLOTS);
+
+		/**
+		 * \brief Map the slots of a running service
+		 * \param name Name of the shared memory block
+		 * \return Whether the block exists and is compatible
+		 */
+		bool open(const std::string& name);
+
+		void close() { memory.close(); }
+		bool isOpen() const { return memory.isOpen(); }
+
+		planner::header& header() const { return *static_cast<planner::header*>(memory.data()); }
+		slot& at(uint32_t i) const;
+		uint32_t slotCount() const { return isOpen() ? header().slotCount : 0; }
+	};
+
+	/**
+	 * \brief One bot instance's end of the planner.
+	 *
+	 * A client waits for a response by spinning on its slot until the deadline
+	 * of the request, then withdraws the request so the caller can decide
+	 * locally. A client which finds the service gone (heartbeat stalled for
+	 * STALE_MS) stops publishing and retries connecting every RECONNECT_MS,
+	 * e.g. to a restarted service.
+	 */
+	class client
+	{
+	public:
+		static const int STALE_MS = 250;
+		static const int RECONNECT_MS = 1000;
+
+		client() = default;
+		~client() { disconnect(); }
+
+		client(const client& other) = delete;
+		client& operator=(const client& other) = delete;
+
+		/**
+		 * \brief Claim a slot of a running service
+		 * \param name Name of the service's block
+		 * \return Whether a slot was free
+		 */
+		bool connect(const std::string& name);
+
+		/**
+		 * \brief Release the slot
+		 */
+		void disconnect();
+
+		/**
+		 * \brief Get the request to fill, reconnecting if the service went away
+		 * \return The request, or nullptr if there is no live service or the
+		 * service is still planning an abandoned request of this slot
+		 */
+		request* begin();
+
+		/**
+		 * \brief Publish the request returned by begin()
+		 */
+		void submit();
+
+		/**
+		 * \brief Wait for the response to the published request
+		 * \param out Set to the response
+		 * \return Whether it arrived before the request's deadline
+		 */
+		bool wait(response& out);
+
+		bool connected() const { return s != nullptr; }
+
+	private:
+		std::string name;
+		block slots;
+		slot* s = nullptr;
+		uint32_t sequence = 0;
+
+		uint32_t lastHeartbeat = 0;
+		std::chrono::steady_clock::time_point lastBeat;
+		std::chrono::steady_clock::time_point nextAttempt;
+
+		bool serviceAlive();
+	};
+}
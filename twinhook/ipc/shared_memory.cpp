@@ -0,0 +1,171 @@
+#include "shared_memory.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+	// POSIX shared memory names start with a slash
+	std::string posixName(const std::string& name)
+	{
+		return name[0] == '/' ? name : "/" + name;
+	}
+#endif
+}
+
+bool shared_memory::create(const std::string& name, size_t size)
+{
+	close();
+	this->name = name;
+	length = size;
+	if (!map(true))
+		return false;
+	owner = true;
+	return true;
+}
+
+bool shared_memory::open(const std::string& name)
+{
+	close();
+	this->name = name;
+	length = 0;
+	return map(false);
+}
+
+#ifdef _WIN32
+
+bool shared_memory::map(bool create)
+{
+	HANDLE h;
+	if (create)
+	{
+		h = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			(DWORD)((uint64_t)length >> 32), (DWORD)length, name.c_str());
+		// An existing mapping is returned as is, with its contents
+		if (h && GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			CloseHandle(h);
+			return false;
+		}
+	}
+	else
+	{
+		h = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+	}
+	if (!h)
+		return false;
+
+	base = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, create ? length : 0);
+	if (!base)
+	{
+		CloseHandle(h);
+		return false;
+	}
+	if (!create)
+	{
+		MEMORY_BASIC_INFORMATION info;
+		VirtualQuery(base, &info, sizeof(info));
+		length = info.RegionSize;
+	}
+	handle = (intptr_t)h;
+	return true;
+}
+
+bool shared_memory::remove(const std::string&)
+{
+	return false;
+}
+
+void shared_memory::close()
+{
+	if (base)
+		UnmapViewOfFile(base);
+	if (handle != -1)
+		CloseHandle((HANDLE)handle);
+	// The mapping disappears with its last handle, regardless of the owner
+	base = nullptr;
+	handle = -1;
+	owner = false;
+}
+
+#else
+
+bool shared_memory::map(bool create)
+{
+	const std::string path = posixName(name);
+	int fd;
+	if (create)
+	{
+		fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0)
+			return false;
+		if (ftruncate(fd, (off_t)length) != 0)
+		{
+			::close(fd);
+			shm_unlink(path.c_str());
+			return false;
+		}
+	}
+	else
+	{
+		fd = shm_open(path.c_str(), O_RDWR, 0600);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+		length = (size_t)st.st_size;
+	}
+
+	void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		::close(fd);
+		if (create)
+			shm_unlink(path.c_str());
+		return false;
+	}
+	base = p;
+	handle = fd;
+	return true;
+}
+
+void shared_memory::close()
+{
+	if (base)
+		munmap(base, length);
+	// the name may have been taken over by remove() and a new block since
+	if (owner && handle != -1)
+	{
+		const std::string path = posixName(name);
+		struct stat mine, named;
+		const int fd = shm_open(path.c_str(), O_RDONLY, 0);
+		if (fd >= 0 && fstat((int)handle, &mine) == 0 && fstat(fd, &named) == 0
+			&& mine.st_dev == named.st_dev && mine.st_ino == named.st_ino)
+			shm_unlink(path.c_str());
+		if (fd >= 0)
+			::close(fd);
+	}
+	if (handle != -1)
+		::close((int)handle);
+	base = nullptr;
+	handle = -1;
+	owner = false;
+}
+
+bool shared_memory::remove(const std::string& name)
+{
+	return shm_unlink(posixName(name).c_str()) == 0;
+}
+
+#endif
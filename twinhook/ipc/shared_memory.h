@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Named block of memory shared between processes.
+ *
+ * The Win32 backend uses a named file mapping, the POSIX backend shm_open.
+ * On POSIX the name is removed when the end which created the block closes
+ * it; on Win32 the block disappears with its last handle.
+ */
+class shared_memory
+{
+	std::string name;
+	bool owner = false;
+	void* base = nullptr;
+	size_t length = 0;
+	// Mapping handle (Win32) or file descriptor (POSIX)
+	intptr_t handle = -1;
+
+	bool map(bool create);
+
+public:
+	shared_memory() = default;
+	~shared_memory() { close(); }
+
+	shared_memory(const shared_memory& other) = delete;
+	shared_memory& operator=(const shared_memory& other) = delete;
+
+	/**
+	 * \brief Create and map a new zeroed block. Fails if a block of the same
+	 * name exists, since resetting it would break the processes using it.
+	 * \param name Name of the block
+	 * \param size Bytes to map
+	 * \return Whether the block could be created
+	 */
+	bool create(const std::string& name, size_t size);
+
+	/**
+	 * \brief Map an existing block
+	 * \param name Name of the block
+	 * \return Whether the block exists
+	 */
+	bool open(const std::string& name);
+
+	/**
+	 * \brief Unmap the block, removing the name if this end created it
+	 */
+	void close();
+
+	/**
+	 * \brief Remove the name of a block whose creator died without closing it
+	 * (POSIX). Processes which mapped it keep their mapping, and a new block of
+	 * the name can be created. Win32 blocks disappear with their last handle.
+	 * \return Whether the name was removed
+	 */
+	static bool remove(const std::string& name);
+
+	bool isOpen() const { return base != nullptr; }
+	void* data() const { return base; }
+	size_t size() const { return length; }
+};
@@ -0,0 +1,157 @@
+#include "shm_channel.h"
+
+#include <cstring>
+#include <new>
+
+namespace
+{
+	const uint16_t PADDING = 0xFFFF;
+
+	struct record_header
+	{
+		uint16_t type;
+		uint16_t len;
+	};
+
+	uint32_t align4(uint32_t n)
+	{
+		return (n + 3) & ~3u;
+	}
+}
+
+bool shm_ring::write(uint16_t type, const void* payload, size_t len)
+{
+	return write(type, payload, len, nullptr, 0);
+}
+
+bool shm_ring::write(uint16_t type, const void* a, size_t lenA, const void* b, size_t lenB)
+{
+	const size_t len = lenA + lenB;
+	const uint32_t cap = ctl->capacity;
+	const uint32_t size = align4((uint32_t)(sizeof(record_header) + len));
+	if (len > 0xFFFF || size > cap / 2)
+	{
+		ctl->dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint32_t head = ctl->head.load(std::memory_order_relaxed);
+	const uint32_t tail = ctl->tail.load(std::memory_order_acquire);
+	const uint32_t offset = head & (cap - 1);
+	const uint32_t pad = offset + size > cap ? cap - offset : 0;
+	if (head + pad + size - tail > cap)
+	{
+		ctl->dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	if (pad)
+	{
+		const record_header padding = { PADDING, (uint16_t)(pad - sizeof(record_header)) };
+		memcpy(data + offset, &padding, sizeof(padding));
+		head += pad;
+	}
+
+	uint8_t* p = data + (head & (cap - 1));
+	const record_header hdr = { type, (uint16_t)len };
+	memcpy(p, &hdr, sizeof(hdr));
+	if (lenA)
+		memcpy(p + sizeof(hdr), a, lenA);
+	if (lenB)
+		memcpy(p + sizeof(hdr) + lenA, b, lenB);
+	ctl->head.store(head + size, std::memory_order_release);
+	return true;
+}
+
+bool shm_ring::read(uint16_t& type, std::vector<uint8_t>& payload)
+{
+	const uint32_t cap = ctl->capacity;
+	uint32_t tail = ctl->tail.load(std::memory_order_relaxed);
+	const uint32_t head = ctl->head.load(std::memory_order_acquire);
+
+	while (tail != head)
+	{
+		record_header hdr;
+		const uint8_t* p = data + (tail & (cap - 1));
+		memcpy(&hdr, p, sizeof(hdr));
+		const uint32_t size = align4((uint32_t)(sizeof(hdr) + hdr.len));
+		if (hdr.type == PADDING)
+		{
+			tail += size;
+			continue;
+		}
+
+		type = hdr.type;
+		payload.assign(p + sizeof(hdr), p + sizeof(hdr) + hdr.len);
+		ctl->tail.store(tail + size, std::memory_order_release);
+		return true;
+	}
+	ctl->tail.store(tail, std::memory_order_release);
+	return false;
+}
+
+size_t shm_channel::totalSize(uint32_t capacity)
+{
+	return sizeof(header) + (size_t)capacity * RingCount;
+}
+
+std::string shm_channel::launchName(uint32_t launchId)
+{
+	return std::string(NAME_VARIABLE) + "_" + std::to_string(launchId);
+}
+
+bool shm_channel::create(const std::string& name, uint32_t capacity)
+{
+	close();
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		return false;
+	if (!memory.create(name, totalSize(capacity)))
+		return false;
+
+	header* h = new (memory.data()) header;
+	h->magic = MAGIC;
+	h->version = VERSION;
+	h->capacity = capacity;
+	h->ringCount = RingCount;
+	for (auto& c : h->controls)
+	{
+		c.head.store(0);
+		c.tail.store(0);
+		c.capacity = capacity;
+		c.dropped.store(0);
+	}
+	attachRings();
+	return true;
+}
+
+bool shm_channel::open(const std::string& name)
+{
+	close();
+	if (!memory.open(name))
+		return false;
+
+	const header* h = static_cast<const header*>(memory.data());
+	if (memory.size() < sizeof(header) || h->magic != MAGIC || h->version != VERSION
+		|| h->ringCount != RingCount || memory.size() < totalSize(h->capacity))
+	{
+		close();
+		return false;
+	}
+	attachRings();
+	return true;
+}
+
+void shm_channel::close()
+{
+	memory.close();
+	for (auto& r : rings)
+		r = shm_ring();
+}
+
+void shm_channel::attachRings()
+{
+	header* h = static_cast<header*>(memory.data());
+	uint8_t* data = static_cast<uint8_t*>(memory.data()) + sizeof(header);
+	for (int i = 0; i < RingCount; ++i)
+		rings[i] = shm_ring(&h->controls[i], data + (size_t)h->capacity * i);
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "shared_memory.h"
+
+/**
+ * \brief Typed messages exchanged between twinhook and twinject.
+ *
+ * Payloads are plain structs with fixed layouts, since both ends are built
+ * for the same platform.
+ */
+namespace shm_msg
+{
+	enum type : uint16_t
+	{
+		Log = 1,		// log_msg followed by the text
+		FrameStats,		// frame_stats_msg
+		Decision,		// decision_msg
+		Config			// config_msg
+	};
+
+	struct log_msg
+	{
+		uint8_t level;
+	};
+
+	struct frame_stats_msg
+	{
+		uint32_t gameTick;
+		float frameMs;
+		float workMs;
+		float quality;
+		uint16_t bullets;
+		uint16_t enemies;
+		uint16_t powerups;
+		uint16_t lasers;
+	};
+
+	struct decision_msg
+	{
+		uint32_t gameTick;
+		int8_t move;
+		uint8_t fire : 1;
+		uint8_t bomb : 1;
+		uint8_t skip : 1;
+		float risk;
+	};
+
+	struct config_msg
+	{
+		char key[32];
+		char value[224];
+	};
+}
+
+/**
+ * \brief Single-producer single-consumer message ring living in shared memory.
+ *
+ * Messages are a header (type, payload size) followed by the payload, aligned
+ * to 4 bytes and never split across the end of the ring. The positions are
+ * lock-free atomics inside the shared block, so either process may be the
+ * producer as long as there is exactly one of each.
+ */
+class shm_ring
+{
+public:
+	struct control
+	{
+		std::atomic<uint32_t> head;
+		std::atomic<uint32_t> tail;
+		uint32_t capacity;
+		// Messages which did not fit and were dropped by the producer
+		std::atomic<uint32_t> dropped;
+	};
+
+	shm_ring() = default;
+	shm_ring(control* ctl, uint8_t* data) : ctl(ctl), data(data) {}
+
+	/**
+	 * \brief Append a message, dropping it if the ring is full
+	 * \param type Message type
+	 * \param payload Payload bytes
+	 * \param len Payload size
+	 * \return Whether the message was written
+	 */
+	bool write(uint16_t type, const void* payload, size_t len);
+
+	/**
+	 * \brief Append a message with a payload split in two parts, e.g. a header and text
+	 */
+	bool write(uint16_t type, const void* a, size_t lenA, const void* b, size_t lenB);
+
+	/**
+	 * \brief Take the oldest message
+	 * \param type Returned message type
+	 * \param payload Returned payload bytes
+	 * \return Whether there was a message
+	 */
+	bool read(uint16_t& type, std::vector<uint8_t>& payload);
+
+	uint32_t dropped() const { return ctl ? ctl->dropped.load() : 0; }
+	bool valid() const { return ctl != nullptr; }
+
+private:
+	control* ctl = nullptr;
+	uint8_t* data = nullptr;
+};
+
+/**
+ * \brief Named shared-memory block holding a fixed set of message rings.
+ *
+ * The injector creates the channel before launching the game, fills the
+ * Config ring, and drains the others; the hook opens it by name during
+ * attach. Every launch uses its own name (see launchName()), which the
+ * injector passes to the game in the NAME_VARIABLE environment variable, so
+ * concurrent launches never share a channel. See shared_memory for the
+ * backends.
+ */
+class shm_channel
+{
+public:
+	enum ring_id
+	{
+		ConfigRing,		// twinject -> twinhook
+		LogRing,		// twinhook logging thread -> twinject
+		TelemetryRing,	// twinhook game thread -> twinject
+
+		RingCount
+	};
+
+	static const uint32_t MAGIC = 0x43485754;	// "TWHC"
+	static const uint32_t VERSION = 1;
+	static const uint32_t DEFAULT_CAPACITY = 1 << 18;
+	// Environment variable holding the name of the launch's channel
+	static constexpr const char* NAME_VARIABLE = "twinject_channel";
+
+	shm_channel() = default;
+	~shm_channel() { close(); }
+
+	shm_channel(const shm_channel& other) = delete;
+	shm_channel& operator=(const shm_channel& other) = delete;
+
+	/**
+	 * \brief Name of the channel of one launch
+	 * \param launchId Identifies the launch among those running, e.g. the
+	 * injector's process id
+	 */
+	static std::string launchName(uint32_t launchId);
+
+	/**
+	 * \brief Create and map a new channel, failing if one of the same name exists
+	 * \param name Name of the shared memory block
+	 * \param capacity Bytes per ring, a power of two
+	 * \return Whether the channel could be created
+	 */
+	bool create(const std::string& name, uint32_t capacity = DEFAULT_CAPACITY);
+
+	/**
+	 * \brief Map an existing channel
+	 * \param name Name of the shared memory block
+	 * \return Whether the channel exists and is compatible
+	 */
+	bool open(const std::string& name);
+
+	/**
+	 * \brief Unmap the channel, removing the name if this end created it
+	 */
+	void close();
+
+	bool isOpen() const { return memory.isOpen(); }
+
+	shm_ring& ring(ring_id id) { return rings[id]; }
+
+private:
+	struct header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t capacity;
+		uint32_t ringCount;
+		shm_ring::control controls[RingCount];
+	};
+
+	shared_memory memory;
+	shm_ring rings[RingCount];
+
+	void attachRings();
+	static size_t totalSize(uint32_t capacity);
+};
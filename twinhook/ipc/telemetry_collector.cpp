@@ -0,0 +1,144 @@
+#include "telemetry_collector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	const char* const MOVE_NAMES[telemetry_collector::MOVE_SLOTS] = {
+		"H", "U", "D", "L", "R", "UL", "UR", "DL", "DR",
+		"fU", "fD", "fL", "fR", "fUL", "fUR", "fDL", "fDR", "-" };
+
+	const float PERCENTILES[] = { 50, 90, 99, 100 };
+
+	int moveSlot(int8_t move)
+	{
+		return move >= 0 && move < telemetry_collector::MOVE_SLOTS - 1
+			? move : telemetry_collector::MOVE_SLOTS - 1;
+	}
+
+	void appendRow(std::string& out, const char* name, const rolling_percentiles& p)
+	{
+		char line[128];
+		int n = snprintf(line, sizeof(line), "%-10s", name);
+		for (float q : PERCENTILES)
+			n += snprintf(line + n, sizeof(line) - n, " %9.2f", p.percentile(q));
+		out += line;
+		out += '\n';
+	}
+}
+
+void rolling_percentiles::add(float v)
+{
+	if (samples.size() < window)
+	{
+		samples.push_back(v);
+		return;
+	}
+	samples[next] = v;
+	next = (next + 1) % window;
+}
+
+void rolling_percentiles::clear()
+{
+	samples.clear();
+	next = 0;
+}
+
+float rolling_percentiles::percentile(float p) const
+{
+	if (samples.empty())
+		return NAN;
+	scratch = samples;
+	const size_t rank = (size_t)std::ceil(p / 100.f * scratch.size());
+	const size_t k = std::min(scratch.size() - 1, rank > 0 ? rank - 1 : 0);
+	std::nth_element(scratch.begin(), scratch.begin() + k, scratch.end());
+	return scratch[k];
+}
+
+telemetry_collector::telemetry_collector(size_t window)
+	: frameMs(window), workMs(window), objects(window), risk(window), danger(window),
+	window(window)
+{
+}
+
+void telemetry_collector::add(const telemetry_wire::frame_record& r)
+{
+	++frames;
+	dropped += r.dropped;
+	lastTick = r.gameTick;
+	frameMs.add(r.frameMs);
+	workMs.add(r.workMs);
+	objects.add((float)r.bullets + r.enemies + r.powerups + r.lasers);
+
+	const int8_t move = r.flags & telemetry_wire::Decided ? r.move : -1;
+	if (r.flags & telemetry_wire::Decided && r.risk >= 0)
+		risk.add(std::min(r.risk, RISK_CAP));
+	if (r.flags & telemetry_wire::Decided && r.danger >= 0)
+		danger.add(std::min(r.danger, RISK_CAP));
+	++moves[moveSlot(move)];
+	moveHistory.push_back(move);
+	if (moveHistory.size() > window)
+	{
+		--moves[moveSlot(moveHistory.front())];
+		moveHistory.pop_front();
+	}
+
+	if (r.flags & telemetry_wire::Bomb)
+	{
+		++deathbombs;
+		recentDeathbombs.push_back(r.gameTick);
+		if (recentDeathbombs.size() > DEATHBOMB_HISTORY)
+			recentDeathbombs.pop_front();
+	}
+}
+
+void telemetry_collector::clear()
+{
+	frameMs.clear();
+	workMs.clear();
+	objects.clear();
+	risk.clear();
+	danger.clear();
+	frames = dropped = deathbombs = 0;
+	lastTick = 0;
+	std::fill_n(moves, MOVE_SLOTS, 0);
+	moveHistory.clear();
+	recentDeathbombs.clear();
+}
+
+std::string telemetry_collector::summary() const
+{
+	char line[128];
+	snprintf(line, sizeof(line), "tick %u, %llu frames, %llu dropped, %llu deathbombs\n",
+		lastTick, (unsigned long long)frames, (unsigned long long)dropped,
+		(unsigned long long)deathbombs);
+	std::string out = line;
+
+	out += "                 p50       p90       p99       max\n";
+	appendRow(out, "frame ms", frameMs);
+	appendRow(out, "bot ms", workMs);
+	appendRow(out, "objects", objects);
+	appendRow(out, "risk", risk);
+	appendRow(out, "danger", danger);
+
+	out += "moves";
+	for (int i = 0; i < MOVE_SLOTS; ++i)
+	{
+		if (moves[i] == 0)
+			continue;
+		snprintf(line, sizeof(line), " %s:%u", MOVE_NAMES[i], moves[i]);
+		out += line;
+	}
+	out += '\n';
+
+	if (!recentDeathbombs.empty())
+	{
+		out += "deathbombs at";
+		for (uint32_t tick : recentDeathbombs)
+			out += " " + std::to_string(tick);
+		out += '\n';
+	}
+	return out;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "ipc/telemetry_stream.h"
+
+/**
+ * \brief Percentiles over the most recent samples of a metric.
+ *
+ * Samples live in a ring of the window size; percentile() selects from a copy
+ * of the ring, which is cheap for windows of a few thousand frames.
+ */
+class rolling_percentiles
+{
+	std::vector<float> samples;
+	size_t window;
+	size_t next = 0;
+	mutable std::vector<float> scratch;
+
+public:
+	explicit rolling_percentiles(size_t window) : window(window) {}
+
+	void add(float v);
+	void clear();
+	size_t size() const { return samples.size(); }
+
+	/**
+	 * \brief Nearest-rank percentile of the window
+	 * \param p Percentile in [0, 100]
+	 * \return The sample, or NaN if there are none
+	 */
+	float percentile(float p) const;
+};
+
+/**
+ * \brief Aggregates the frame records of a telemetry stream into rolling
+ * percentiles and event counts, for dashboards or the console.
+ */
+class telemetry_collector
+{
+public:
+	// 10 seconds at 60 frames per second
+	static const size_t DEFAULT_WINDOW = 600;
+	// Deathbombs listed by summary()
+	static const size_t DEATHBOMB_HISTORY = 8;
+	// Directions of control::Movement, and a last slot for frames without a move
+	static const int MOVE_SLOTS = 18;
+	// Risk and danger of moves which never collide (FLT_MAX) count as the predictor horizon
+	static constexpr float RISK_CAP = 6000;
+
+	explicit telemetry_collector(size_t window = DEFAULT_WINDOW);
+
+	void add(const telemetry_wire::frame_record& r);
+
+	/**
+	 * \brief Forget everything, e.g. when a new exporter connects
+	 */
+	void clear();
+
+	/**
+	 * \brief Percentiles of the window, totals and recent deathbombs as text
+	 */
+	std::string summary() const;
+
+	rolling_percentiles frameMs, workMs, objects, risk, danger;
+
+	uint64_t frames = 0;
+	uint64_t dropped = 0;
+	uint64_t deathbombs = 0;
+	uint32_t lastTick = 0;
+	// Frames per direction over the window
+	uint32_t moves[MOVE_SLOTS] = {};
+	// Game ticks of the most recent deathbombs
+	std::deque<uint32_t> recentDeathbombs;
+
+private:
+	size_t window;
+	std::deque<int8_t> moveHistory;
+};
@@ -0,0 +1,488 @@
+#include "telemetry_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Records encoded per write
+	const uint32_t SEND_BATCH = 64;
+
+	uint8_t* put16(uint8_t* p, uint16_t v)
+	{
+		p[0] = (uint8_t)v;
+		p[1] = (uint8_t)(v >> 8);
+		return p + 2;
+	}
+
+	uint8_t* put32(uint8_t* p, uint32_t v)
+	{
+		for (int i = 0; i < 4; ++i)
+			p[i] = (uint8_t)(v >> (8 * i));
+		return p + 4;
+	}
+
+	uint8_t* putFloat(uint8_t* p, float f)
+	{
+		uint32_t v;
+		memcpy(&v, &f, sizeof(v));
+		return put32(p, v);
+	}
+
+	uint16_t get16(const uint8_t*& p)
+	{
+		const uint16_t v = (uint16_t)(p[0] | p[1] << 8);
+		p += 2;
+		return v;
+	}
+
+	uint32_t get32(const uint8_t*& p)
+	{
+		uint32_t v = 0;
+		for (int i = 0; i < 4; ++i)
+			v |= (uint32_t)p[i] << (8 * i);
+		p += 4;
+		return v;
+	}
+
+	float getFloat(const uint8_t*& p)
+	{
+		const uint32_t v = get32(p);
+		float f;
+		memcpy(&f, &v, sizeof(f));
+		return f;
+	}
+
+	using send_clock = std::chrono::steady_clock;
+
+	// Milliseconds left until a deadline, at least 0
+	int remainingMs(send_clock::time_point deadline)
+	{
+		const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+			deadline - send_clock::now()).count();
+		return (int)std::max<long long>(0, left);
+	}
+
+#ifdef _WIN32
+	intptr_t connectEndpoint(const std::string& path)
+	{
+		// overlapped, so writes can give up on a collector which stopped reading
+		HANDLE h = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+			FILE_FLAG_OVERLAPPED, nullptr);
+		return h == INVALID_HANDLE_VALUE ? -1 : (intptr_t)h;
+	}
+
+	bool sendAll(intptr_t link, const uint8_t* data, size_t len)
+	{
+		const auto deadline = send_clock::now()
+			+ std::chrono::milliseconds(telemetry_exporter::SEND_TIMEOUT_MS);
+		OVERLAPPED ov = {};
+		ov.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		if (!ov.hEvent)
+			return false;
+
+		bool ok = true;
+		while (ok && len > 0)
+		{
+			DWORD written = 0;
+			ResetEvent(ov.hEvent);
+			if (!WriteFile((HANDLE)link, data, (DWORD)len, nullptr, &ov))
+			{
+				if (GetLastError() != ERROR_IO_PENDING)
+				{
+					ok = false;
+					break;
+				}
+				if (WaitForSingleObject(ov.hEvent, remainingMs(deadline)) != WAIT_OBJECT_0)
+				{
+					// the write must be finished before ov and data go away
+					CancelIo((HANDLE)link);
+					GetOverlappedResult((HANDLE)link, &ov, &written, TRUE);
+					ok = false;
+					break;
+				}
+			}
+			ok = GetOverlappedResult((HANDLE)link, &ov, &written, FALSE) != 0;
+			data += written;
+			len -= written;
+		}
+		CloseHandle(ov.hEvent);
+		return ok;
+	}
+
+	void closeEndpoint(intptr_t link)
+	{
+		CloseHandle((HANDLE)link);
+	}
+#else
+	bool socketAddress(const std::string& path, sockaddr_un& addr)
+	{
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(addr.sun_path))
+			return false;
+		memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+
+	intptr_t connectEndpoint(const std::string& path)
+	{
+		sockaddr_un addr;
+		if (!socketAddress(path, addr))
+			return -1;
+		const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+		// non-blocking, so writes can give up on a collector which stopped
+		// reading; a collector with a full backlog is retried later
+		if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0
+			|| connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0)
+		{
+			::close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	bool sendAll(intptr_t link, const uint8_t* data, size_t len)
+	{
+		const auto deadline = send_clock::now()
+			+ std::chrono::milliseconds(telemetry_exporter::SEND_TIMEOUT_MS);
+		while (len > 0)
+		{
+			// a collector which went away must not kill the game with SIGPIPE
+			const ssize_t n = send((int)link, data, len, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				pollfd p = { (int)link, POLLOUT, 0 };
+				const int ms = remainingMs(deadline);
+				if (ms == 0 || (poll(&p, 1, ms) <= 0 && errno != EINTR))
+					return false;
+				continue;
+			}
+			if (n <= 0)
+				return false;
+			data += n;
+			len -= (size_t)n;
+		}
+		return true;
+	}
+
+	void closeEndpoint(intptr_t link)
+	{
+		::close((int)link);
+	}
+#endif
+}
+
+void telemetry_wire::encodeHello(uint8_t* out)
+{
+	out = put32(out, MAGIC);
+	out = put16(out, VERSION);
+	put16(out, (uint16_t)RECORD_SIZE);
+}
+
+void telemetry_wire::encode(const frame_record& r, uint8_t* out)
+{
+	out = put32(out, r.gameTick);
+	out = putFloat(out, r.frameMs);
+	out = putFloat(out, r.workMs);
+	out = putFloat(out, r.quality);
+	out = putFloat(out, r.risk);
+	out = putFloat(out, r.danger);
+	out = put16(out, r.bullets);
+	out = put16(out, r.enemies);
+	out = put16(out, r.powerups);
+	out = put16(out, r.lasers);
+	*out++ = (uint8_t)r.move;
+	*out++ = r.flags;
+	put16(out, r.dropped);
+}
+
+telemetry_wire::frame_record telemetry_wire::decode(const uint8_t* in)
+{
+	frame_record r;
+	r.gameTick = get32(in);
+	r.frameMs = getFloat(in);
+	r.workMs = getFloat(in);
+	r.quality = getFloat(in);
+	r.risk = getFloat(in);
+	r.danger = getFloat(in);
+	r.bullets = get16(in);
+	r.enemies = get16(in);
+	r.powerups = get16(in);
+	r.lasers = get16(in);
+	r.move = (int8_t)*in++;
+	r.flags = *in++;
+	r.dropped = get16(in);
+	return r;
+}
+
+bool telemetry_wire::decoder::feed(const uint8_t* data, size_t len, std::vector<frame_record>& out)
+{
+	if (failed)
+		return false;
+	buffer.insert(buffer.end(), data, data + len);
+
+	size_t offset = 0;
+	if (!greeted)
+	{
+		if (buffer.size() < HELLO_SIZE)
+			return true;
+		const uint8_t* p = buffer.data();
+		const uint32_t magic = get32(p);
+		const uint16_t version = get16(p);
+		const uint16_t recordSize = get16(p);
+		if (magic != MAGIC || version != VERSION || recordSize != RECORD_SIZE)
+		{
+			failed = true;
+			return false;
+		}
+		greeted = true;
+		offset = HELLO_SIZE;
+	}
+
+	for (; offset + RECORD_SIZE <= buffer.size(); offset += RECORD_SIZE)
+		out.push_back(decode(buffer.data() + offset));
+	buffer.erase(buffer.begin(), buffer.begin() + offset);
+	return true;
+}
+
+void telemetry_wire::decoder::reset()
+{
+	buffer.clear();
+	greeted = false;
+	failed = false;
+}
+
+void telemetry_exporter::open(const std::string& address)
+{
+	close();
+	this->address = telemetry_listener::endpoint(address);
+	stopping = false;
+	worker = std::thread(&telemetry_exporter::run, this);
+}
+
+void telemetry_exporter::close()
+{
+	if (!worker.joinable())
+		return;
+	stopping = true;
+	worker.join();
+}
+
+bool telemetry_exporter::push(const telemetry_wire::frame_record& r)
+{
+	const uint32_t h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) >= QUEUE_SIZE)
+	{
+		droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	queue[h & (QUEUE_SIZE - 1)] = r;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+void telemetry_exporter::drain(uint64_t& reported)
+{
+	uint8_t buf[SEND_BATCH * telemetry_wire::RECORD_SIZE];
+	uint32_t t = tail.load(std::memory_order_relaxed);
+	const uint32_t h = head.load(std::memory_order_acquire);
+	while (t != h)
+	{
+		const uint32_t n = std::min(h - t, SEND_BATCH);
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			telemetry_wire::frame_record r = queue[(t + i) & (QUEUE_SIZE - 1)];
+			// drops are reported with the next record which makes it
+			const uint64_t dropped = droppedCount.load(std::memory_order_relaxed);
+			r.dropped = (uint16_t)std::min<uint64_t>(dropped - reported, 0xFFFF);
+			reported += r.dropped;
+			telemetry_wire::encode(r, buf + i * telemetry_wire::RECORD_SIZE);
+		}
+		t += n;
+		tail.store(t, std::memory_order_release);
+
+		const intptr_t l = link.load(std::memory_order_relaxed);
+		if (l == -1)
+			continue;
+		if (sendAll(l, buf, n * telemetry_wire::RECORD_SIZE))
+		{
+			sentCount.fetch_add(n, std::memory_order_relaxed);
+		}
+		else
+		{
+			closeEndpoint(l);
+			link = -1;
+		}
+	}
+}
+
+void telemetry_exporter::run()
+{
+	using clock = std::chrono::steady_clock;
+	auto nextAttempt = clock::now();
+	uint64_t reported = droppedCount.load();
+	while (!stopping.load(std::memory_order_relaxed))
+	{
+		if (link == -1 && clock::now() >= nextAttempt)
+		{
+			nextAttempt = clock::now() + std::chrono::milliseconds(RECONNECT_MS);
+			const intptr_t l = connectEndpoint(address);
+			uint8_t hello[telemetry_wire::HELLO_SIZE];
+			telemetry_wire::encodeHello(hello);
+			if (l != -1 && sendAll(l, hello, sizeof(hello)))
+				link = l;
+			else if (l != -1)
+				closeEndpoint(l);
+		}
+		drain(reported);
+		std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+	}
+	drain(reported);
+	if (link != -1)
+	{
+		closeEndpoint(link);
+		link = -1;
+	}
+}
+
+#ifdef _WIN32
+
+std::string telemetry_listener::endpoint(const std::string& address)
+{
+	return address.compare(0, 2, "\\\\") == 0 ? address : "\\\\.\\pipe\\" + address;
+}
+
+bool telemetry_listener::listen(const std::string& address)
+{
+	close();
+	path = endpoint(address);
+	HANDLE h = CreateNamedPipeA(path.c_str(), PIPE_ACCESS_INBOUND,
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, 1, 0, 1 << 16, 0, nullptr);
+	if (h == INVALID_HANDLE_VALUE)
+		return false;
+	server = (intptr_t)h;
+	return true;
+}
+
+bool telemetry_listener::accept()
+{
+	if (server == -1)
+		return false;
+	// the exporter may have connected between CreateNamedPipe and ConnectNamedPipe
+	accepted = ConnectNamedPipe((HANDLE)server, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED;
+	return accepted;
+}
+
+size_t telemetry_listener::read(uint8_t* buf, size_t len)
+{
+	DWORD n;
+	if (!accepted || !ReadFile((HANDLE)server, buf, (DWORD)len, &n, nullptr))
+		return 0;
+	return n;
+}
+
+void telemetry_listener::disconnect()
+{
+	if (accepted)
+		DisconnectNamedPipe((HANDLE)server);
+	accepted = false;
+}
+
+void telemetry_listener::close()
+{
+	disconnect();
+	if (server != -1)
+		CloseHandle((HANDLE)server);
+	server = -1;
+}
+
+#else
+
+std::string telemetry_listener::endpoint(const std::string& address)
+{
+	return address.find('/') != std::string::npos ? address : "/tmp/" + address + ".sock";
+}
+
+bool telemetry_listener::listen(const std::string& address)
+{
+	close();
+	path = endpoint(address);
+	sockaddr_un addr;
+	if (!socketAddress(path, addr))
+		return false;
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+	// a collector which did not exit cleanly leaves its socket behind
+	unlink(path.c_str());
+	if (bind(fd, (const sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, 1) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	server = fd;
+	return true;
+}
+
+bool telemetry_listener::accept()
+{
+	if (server == -1)
+		return false;
+	disconnect();
+	int fd;
+	do
+		fd = ::accept((int)server, nullptr, nullptr);
+	while (fd < 0 && errno == EINTR);
+	client = fd;
+	accepted = fd >= 0;
+	return accepted;
+}
+
+size_t telemetry_listener::read(uint8_t* buf, size_t len)
+{
+	if (!accepted)
+		return 0;
+	ssize_t n;
+	do
+		n = recv((int)client, buf, len, 0);
+	while (n < 0 && errno == EINTR);
+	return n > 0 ? (size_t)n : 0;
+}
+
+void telemetry_listener::disconnect()
+{
+	if (client != -1)
+		::close((int)client);
+	client = -1;
+	accepted = false;
+}
+
+void telemetry_listener::close()
+{
+	disconnect();
+	if (server != -1)
+	{
+		::close((int)server);
+		unlink(path.c_str());
+	}
+	server = -1;
+}
+
+#endif
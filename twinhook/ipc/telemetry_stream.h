@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Wire format of the telemetry stream.
+ *
+ * A stream starts with a hello (magic, version, record size), followed by one
+ * fixed-size record per frame. Fields are written little-endian one by one, so
+ * a collector built for another platform decodes the stream as well.
+ */
+namespace telemetry_wire
+{
+	const uint32_t MAGIC = 0x53544854;	// "THTS"
+	const uint16_t VERSION = 2;
+	const size_t HELLO_SIZE = 8;
+	const size_t RECORD_SIZE = 36;
+
+	enum flag : uint8_t
+	{
+		Decided = 1 << 0,	// an algorithm decided on this frame, move, risk and danger are set
+		Fire = 1 << 1,
+		Bomb = 1 << 2,		// deathbomb
+		Skip = 1 << 3
+	};
+
+	struct frame_record
+	{
+		uint32_t gameTick;
+		// Smoothed frame and bot times, see frame_governor
+		float frameMs;
+		float workMs;
+		float quality;
+		// Frames until collision of the chosen move, or -1 if unknown
+		float risk;
+		// Frames until collision of the most threatened candidate move, the
+		// nearest threat whichever move was chosen, or -1 if unknown
+		float danger;
+		uint16_t bullets;
+		uint16_t enemies;
+		uint16_t powerups;
+		uint16_t lasers;
+		// Chosen direction (see control::Movement), or -1
+		int8_t move;
+		uint8_t flags;
+		// Records the exporter dropped since the previous record
+		uint16_t dropped;
+	};
+
+	void encodeHello(uint8_t* out);
+	void encode(const frame_record& r, uint8_t* out);
+	frame_record decode(const uint8_t* in);
+
+	/**
+	 * \brief Splits a byte stream into records, whatever the sizes of the reads
+	 */
+	class decoder
+	{
+		std::vector<uint8_t> buffer;
+		bool greeted = false;
+		bool failed = false;
+
+	public:
+		/**
+		 * \brief Decode bytes read from the stream
+		 * \param data Bytes read
+		 * \param len Number of bytes
+		 * \param out Receives every record completed by these bytes
+		 * \return False if the stream does not start with a compatible hello
+		 */
+		bool feed(const uint8_t* data, size_t len, std::vector<frame_record>& out);
+
+		// Expect a new stream
+		void reset();
+	};
+}
+
+/**
+ * \brief Streams frame records to a local collector from a background thread.
+ *
+ * The game thread pushes records into a lock-free single-producer ring and
+ * never waits: if the ring is full, the record is dropped and counted. The
+ * worker thread drains the ring into a named pipe (Win32) or Unix domain
+ * socket (POSIX). While no collector is listening, records are discarded and
+ * the worker retries connecting every RECONNECT_MS. Writes never block for
+ * longer than SEND_TIMEOUT_MS: a collector which stops reading is dropped like
+ * one which went away, so close() always returns promptly.
+ */
+class telemetry_exporter
+{
+public:
+	// Records held for the worker, a power of two
+	static const uint32_t QUEUE_SIZE = 1024;
+	static const int POLL_MS = 4;
+	static const int RECONNECT_MS = 1000;
+	// Time a write may wait for the collector to read, before it is dropped
+	static const int SEND_TIMEOUT_MS = 250;
+
+	telemetry_exporter() = default;
+	~telemetry_exporter() { close(); }
+
+	telemetry_exporter(const telemetry_exporter& other) = delete;
+	telemetry_exporter& operator=(const telemetry_exporter& other) = delete;
+
+	/**
+	 * \brief Start the worker thread, which connects on its own
+	 * \param address Pipe or socket name, see telemetry_listener::listen
+	 */
+	void open(const std::string& address);
+
+	/**
+	 * \brief Send the queued records and stop the worker thread. Joins the
+	 * worker, so it must not be called from DllMain.
+	 */
+	void close();
+
+	/**
+	 * \brief Queue a record. Only called from one thread.
+	 * \return Whether the record was queued, rather than dropped
+	 */
+	bool push(const telemetry_wire::frame_record& r);
+
+	bool isOpen() const { return worker.joinable(); }
+	bool connected() const { return link != -1; }
+	uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+	uint64_t sent() const { return sentCount.load(std::memory_order_relaxed); }
+
+private:
+	std::string address;
+	std::thread worker;
+	std::atomic<bool> stopping{ false };
+
+	telemetry_wire::frame_record queue[QUEUE_SIZE];
+	std::atomic<uint32_t> head{ 0 };
+	std::atomic<uint32_t> tail{ 0 };
+	std::atomic<uint64_t> droppedCount{ 0 };
+	std::atomic<uint64_t> sentCount{ 0 };
+
+	// Pipe handle (Win32) or socket (POSIX) of the worker, -1 if disconnected
+	std::atomic<intptr_t> link{ -1 };
+
+	void run();
+	// Send the queued records, or discard them if disconnected
+	void drain(uint64_t& reported);
+};
+
+/**
+ * \brief Collector side of the telemetry stream, accepting one exporter at a time.
+ */
+class telemetry_listener
+{
+	std::string path;
+	// Listening socket (POSIX) or pipe instance (Win32)
+	intptr_t server = -1;
+	// Connected exporter (POSIX)
+	intptr_t client = -1;
+	bool accepted = false;
+
+public:
+	static constexpr const char* DEFAULT_ADDRESS = "twinject_telemetry";
+
+	telemetry_listener() = default;
+	~telemetry_listener() { close(); }
+
+	telemetry_listener(const telemetry_listener& other) = delete;
+	telemetry_listener& operator=(const telemetry_listener& other) = delete;
+
+	/**
+	 * \brief Listen for exporters
+	 * \param address Name of the pipe \\.\pipe\<address> (Win32); path of the
+	 * socket, or /tmp/<address>.sock if it contains no slash (POSIX)
+	 * \return Whether the pipe or socket could be created
+	 */
+	bool listen(const std::string& address);
+
+	/**
+	 * \brief Wait for an exporter to connect
+	 * \return Whether one connected
+	 */
+	bool accept();
+
+	/**
+	 * \brief Wait for bytes from the connected exporter
+	 * \return Number of bytes read, 0 once the exporter disconnected
+	 */
+	size_t read(uint8_t* buf, size_t len);
+
+	// Drop the connected exporter, so the next one can be accepted
+	void disconnect();
+
+	void close();
+
+	/**
+	 * \brief Path of the pipe or socket for an address, as used by both ends
+	 */
+	static std::string endpoint(const std::string& address);
+};
@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "ipc/th_telemetry.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "algo/th_decision.h"
+#include "control/th_player.h"
+#include "ipc/telemetry_stream.h"
+
+namespace
+{
+	shm_channel channel;
+	telemetry_exporter exporter;
+	// Decision of the current frame, completed and exported by sendFrame()
+	telemetry_wire::frame_record pending = { 0, 0, 0, 0, -1.f, -1.f, 0, 0, 0, 0, -1, 0, 0 };
+
+	uint16_t clampCount(size_t n)
+	{
+		return (uint16_t)std::min<size_t>(n, 0xFFFF);
+	}
+}
+
+bool th_telemetry::connect()
+{
+	size_t len;
+	char name[256] = { 0 };
+	getenv_s(&len, name, sizeof(name), shm_channel::NAME_VARIABLE);
+	if (len == 0 || !channel.open(name))
+		return false;
+
+	shm_ring& config = channel.ring(shm_channel::ConfigRing);
+	uint16_t type;
+	std::vector<uint8_t> payload;
+	while (config.read(type, payload))
+	{
+		if (type != shm_msg::Config || payload.size() != sizeof(shm_msg::config_msg))
+			continue;
+
+		shm_msg::config_msg msg;
+		memcpy(&msg, payload.data(), sizeof(msg));
+		msg.key[sizeof(msg.key) - 1] = '\0';
+		msg.value[sizeof(msg.value) - 1] = '\0';
+		_putenv_s(msg.key, msg.value);
+	}
+	return true;
+}
+
+void th_telemetry::disconnect()
+{
+	channel.close();
+}
+
+bool th_telemetry::connected()
+{
+	return channel.isOpen();
+}
+
+void th_telemetry::startExport(const std::string& address)
+{
+	exporter.open(address);
+}
+
+void th_telemetry::stopExport()
+{
+	exporter.close();
+}
+
+void th_telemetry::sendLog(uint8_t level, const std::string& text)
+{
+	if (!channel.isOpen())
+		return;
+
+	const shm_msg::log_msg msg = { level };
+	channel.ring(shm_channel::LogRing).write(shm_msg::Log, &msg, sizeof(msg),
+		text.data(), std::min<size_t>(text.size(), 0xFFFF - sizeof(msg)));
+}
+
+void th_telemetry::sendFrame(const th_player& player)
+{
+	if (exporter.isOpen())
+	{
+		pending.gameTick = player.gameTick;
+		pending.frameMs = player.governor.frameMillis();
+		pending.workMs = player.governor.workMillis();
+		pending.quality = player.governor.quality();
+		pending.bullets = clampCount(player.bullets.size());
+		pending.enemies = clampCount(player.enemies.size());
+		pending.powerups = clampCount(player.powerups.size());
+		pending.lasers = clampCount(player.lasers.size());
+		exporter.push(pending);
+		pending.move = -1;
+		pending.flags = 0;
+		pending.risk = -1.f;
+		pending.danger = -1.f;
+	}
+
+	if (!channel.isOpen())
+		return;
+
+	shm_msg::frame_stats_msg msg;
+	msg.gameTick = player.gameTick;
+	msg.frameMs = player.governor.frameMillis();
+	msg.workMs = player.governor.workMillis();
+	msg.quality = player.governor.quality();
+	msg.bullets = clampCount(player.bullets.size());
+	msg.enemies = clampCount(player.enemies.size());
+	msg.powerups = clampCount(player.powerups.size());
+	msg.lasers = clampCount(player.lasers.size());
+	channel.ring(shm_channel::TelemetryRing).write(shm_msg::FrameStats, &msg, sizeof(msg));
+}
+
+void th_telemetry::sendDecision(unsigned int gameTick, const decision& d)
+{
+	if (exporter.isOpen())
+	{
+		pending.move = (int8_t)d.move;
+		pending.flags = telemetry_wire::Decided
+			| (d.fire ? telemetry_wire::Fire : 0)
+			| (d.bomb ? telemetry_wire::Bomb : 0)
+			| (d.skip ? telemetry_wire::Skip : 0);
+		pending.risk = d.risk;
+		pending.danger = d.danger;
+	}
+
+	if (!channel.isOpen())
+		return;
+
+	shm_msg::decision_msg msg = {};
+	msg.gameTick = gameTick;
+	msg.move = (int8_t)d.move;
+	msg.fire = d.fire;
+	msg.bomb = d.bomb;
+	msg.skip = d.skip;
+	msg.risk = d.risk;
+	channel.ring(shm_channel::TelemetryRing).write(shm_msg::Decision, &msg, sizeof(msg));
+}
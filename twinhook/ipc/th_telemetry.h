@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+
+#include "ipc/shm_channel.h"
+
+struct decision;
+class th_player;
+
+/**
+ * \brief Hook side of the shared-memory channel to twinject.
+ *
+ * If twinject created a channel, connect() maps it and applies the
+ * configuration it contains; afterwards log lines, per-frame statistics and
+ * decisions are streamed to twinject instead of going through the debugger.
+ * Without a channel every send is a no-op, and the configuration is expected
+ * in the environment as before.
+ *
+ * Independently of the channel, frame statistics and decisions can be exported
+ * as one telemetry_wire record per frame to a local collector (thtelemetry).
+ */
+namespace th_telemetry
+{
+	/**
+	 * \brief Map the channel named by the shm_channel::NAME_VARIABLE environment
+	 * variable and copy its configuration into the environment, where the rest
+	 * of the hook reads it with getenv_s
+	 * \return Whether a channel was found
+	 */
+	bool connect();
+
+	/**
+	 * \brief Unmap the channel
+	 */
+	void disconnect();
+
+	bool connected();
+
+	/**
+	 * \brief Start exporting frame records to a collector
+	 * \param address Pipe or socket name, see telemetry_listener::listen
+	 */
+	void startExport(const std::string& address);
+
+	/**
+	 * \brief Send the queued records and stop exporting
+	 */
+	void stopExport();
+
+	/**
+	 * \brief Send a log line. Only called from the logging thread.
+	 * \param level th_log::level of the line
+	 * \param text Formatted line
+	 */
+	void sendLog(uint8_t level, const std::string& text);
+
+	/**
+	 * \brief Send the statistics of the frame which just ended. Only called from the game thread.
+	 */
+	void sendFrame(const th_player& player);
+
+	/**
+	 * \brief Send a decision taken on a game tick. Only called from the game thread.
+	 */
+	void sendDecision(unsigned int gameTick, const decision& d);
+}
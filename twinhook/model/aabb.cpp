@@ -2,6 +2,7 @@
 
 #include <sstream>
 
+#include "obb.h"
 #include "polygon.h"
 
 vec2 aabb::com() const
@@ -12,10 +13,15 @@ vec2 aabb::com() const
 std::shared_ptr<entity> aabb::translate(vec2 delta) const
 {
 	auto c = std::make_shared<aabb>(*this);
-	c->position += delta;
+	c->move(delta);
 	return c;
 }
 
+void aabb::move(vec2 delta)
+{
+	position += delta;
+}
+
 std::shared_ptr<entity> aabb::withVelocity(vec2 newVelocity) const
 {
 	auto c = std::make_shared<aabb>(*this);
@@ -52,10 +58,18 @@ float aabb::willCollideWith(const entity& o) const
 			size, a.size, velocity, a.velocity);
 	}
 	case Polygon: {
+		// Rotating lasers sweep themselves against the box
+		const auto r = dynamic_cast<const obb*>(&o);
+		if (r && r->isRotating())
+			return r->willCollideWith(*this);
 		const auto& a = dynamic_cast<const polygon&>(o);
 		const auto poly = this->toPolygon();
 		return poly.willCollideWith(a);
 	}
+	case CapsuleChain: {
+		// The opposite is already defined, so use that one
+		return o.willCollideWith(*this);
+	}
 	default: return -1.f;
 	}
 }
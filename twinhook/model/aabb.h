@@ -22,6 +22,7 @@ public:
 
 	vec2 com() const override;
 	std::shared_ptr<entity> translate(vec2 delta) const override;
+	void move(vec2 delta) override;
 	std::shared_ptr<entity> withVelocity(vec2 newVelocity) const override;
 	std::shared_ptr<aabb> boundingBox() const override;
 
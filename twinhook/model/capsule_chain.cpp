@@ -0,0 +1,328 @@
+#include "capsule_chain.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <sstream>
+
+#include "aabb.h"
+#include "circle.h"
+#include "util/counters.h"
+#include "util/simd.h"
+
+/**
+ * \brief Time of impact of a moving circle against a block of capsules
+ * \param ax, ay, bx, by Endpoints of BLOCK_SIZE segments
+ * \param p Center of the circle
+ * \param d Velocity of the circle
+ * \param r Sum of the capsule and circle radii
+ * \return 0 if already collided, FLT_MAX if no collision, otherwise frames until collision
+ */
+static float sweepBlock(const float* ax, const float* ay, const float* bx, const float* by,
+	const vec2& p, const vec2& d, float r)
+{
+#ifdef TH_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 inf = _mm_set1_ps(FLT_MAX);
+	const __m128 R = _mm_set1_ps(r);
+	const __m128 R2 = _mm_mul_ps(R, R);
+	const __m128 Px = _mm_set1_ps(p.x), Py = _mm_set1_ps(p.y);
+	const __m128 Dx = _mm_set1_ps(d.x), Dy = _mm_set1_ps(d.y);
+
+	const __m128 Ax = _mm_loadu_ps(ax), Ay = _mm_loadu_ps(ay);
+	const __m128 Bx = _mm_loadu_ps(bx), By = _mm_loadu_ps(by);
+	const __m128 Ex = _mm_sub_ps(Bx, Ax), Ey = _mm_sub_ps(By, Ay);
+	const __m128 Wx = _mm_sub_ps(Px, Ax), Wy = _mm_sub_ps(Py, Ay);
+	const __m128 L2 = _mm_add_ps(_mm_mul_ps(Ex, Ex), _mm_mul_ps(Ey, Ey));
+	const __m128 hasLen = _mm_cmpgt_ps(L2, zero);
+
+	// already overlapping: distance from the center to the segment
+	__m128 s0 = _mm_and_ps(hasLen,
+		_mm_div_ps(_mm_add_ps(_mm_mul_ps(Wx, Ex), _mm_mul_ps(Wy, Ey)), L2));
+	s0 = _mm_min_ps(_mm_max_ps(s0, zero), one);
+	const __m128 cx = _mm_sub_ps(Wx, _mm_mul_ps(s0, Ex));
+	const __m128 cy = _mm_sub_ps(Wy, _mm_mul_ps(s0, Ey));
+	const __m128 d2 = _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy));
+	if (_mm_movemask_ps(_mm_cmple_ps(d2, R2)))
+		return 0;
+
+	// side of the capsule: entering the band |cross(E, W + D t)| <= R |E|
+	const __m128 c0 = _mm_sub_ps(_mm_mul_ps(Ex, Wy), _mm_mul_ps(Ey, Wx));
+	const __m128 cd = _mm_sub_ps(_mm_mul_ps(Ex, Dy), _mm_mul_ps(Ey, Dx));
+	const __m128 RL = _mm_mul_ps(R, _mm_sqrt_ps(L2));
+	const __m128 above = _mm_cmpgt_ps(c0, zero);
+	const __m128 target = _mm_or_ps(_mm_and_ps(above, RL), _mm_andnot_ps(above, _mm_sub_ps(zero, RL)));
+	const __m128 tSide = _mm_div_ps(_mm_sub_ps(target, c0), cd);
+	const __m128 s = _mm_div_ps(_mm_add_ps(
+		_mm_mul_ps(_mm_add_ps(Wx, _mm_mul_ps(Dx, tSide)), Ex),
+		_mm_mul_ps(_mm_add_ps(Wy, _mm_mul_ps(Dy, tSide)), Ey)), L2);
+	__m128 valid = _mm_and_ps(_mm_and_ps(hasLen, _mm_cmpge_ps(tSide, zero)),
+		_mm_and_ps(_mm_cmpge_ps(s, zero), _mm_cmple_ps(s, one)));
+	__m128 best = _mm_or_ps(_mm_and_ps(valid, tSide), _mm_andnot_ps(valid, inf));
+
+	// end caps: entering the disc around either endpoint
+	const __m128 a = _mm_add_ps(_mm_mul_ps(Dx, Dx), _mm_mul_ps(Dy, Dy));
+	const __m128 hasVel = _mm_cmpgt_ps(a, zero);
+	const __m128 Cx[] = { Ax, Bx };
+	const __m128 Cy[] = { Ay, By };
+	for (int k = 0; k < 2; ++k)
+	{
+		const __m128 Qx = _mm_sub_ps(Px, Cx[k]), Qy = _mm_sub_ps(Py, Cy[k]);
+		const __m128 b = _mm_add_ps(_mm_mul_ps(Qx, Dx), _mm_mul_ps(Qy, Dy));
+		const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(Qx, Qx), _mm_mul_ps(Qy, Qy)), R2);
+		const __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+		const __m128 tCap = _mm_div_ps(
+			_mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(disc, zero))), a);
+		valid = _mm_and_ps(_mm_and_ps(hasVel, _mm_cmpge_ps(disc, zero)), _mm_cmpge_ps(tCap, zero));
+		best = _mm_min_ps(best, _mm_or_ps(_mm_and_ps(valid, tCap), _mm_andnot_ps(valid, inf)));
+	}
+
+	// horizontal minimum of the four lanes
+	best = _mm_min_ps(best, _mm_shuffle_ps(best, best, _MM_SHUFFLE(1, 0, 3, 2)));
+	best = _mm_min_ps(best, _mm_shuffle_ps(best, best, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(best);
+#else
+	float best = FLT_MAX;
+	for (int i = 0; i < capsule_chain::BLOCK_SIZE; ++i)
+	{
+		const vec2 A(ax[i], ay[i]), B(bx[i], by[i]);
+		const vec2 E = B - A, W = p - A;
+		const float L2 = E.lensq();
+
+		float s0 = L2 > 0 ? vec2::dot(W, E) / L2 : 0;
+		s0 = std::min(std::max(s0, 0.f), 1.f);
+		if ((W - s0 * E).lensq() <= r * r)
+			return 0;
+
+		if (L2 > 0)
+		{
+			const float c0 = E.x * W.y - E.y * W.x;
+			const float cd = E.x * d.y - E.y * d.x;
+			const float RL = r * sqrt(L2);
+			if (cd != 0)
+			{
+				const float t = ((c0 > 0 ? RL : -RL) - c0) / cd;
+				const float s = vec2::dot(W + d * t, E) / L2;
+				if (t >= 0 && s >= 0 && s <= 1)
+					best = std::min(best, t);
+			}
+		}
+
+		const float a = d.lensq();
+		if (a > 0)
+		{
+			for (const vec2& C : { A, B })
+			{
+				const vec2 Q = p - C;
+				const float b = vec2::dot(Q, d);
+				const float disc = b * b - a * (Q.lensq() - r * r);
+				if (disc < 0)
+					continue;
+				const float t = (-b - sqrt(disc)) / a;
+				if (t >= 0)
+					best = std::min(best, t);
+			}
+		}
+	}
+	return best;
+#endif
+}
+
+capsule_chain::capsule_chain(std::vector<vec2> points, float radius, const vec2& velocity)
+	: entity(CapsuleChain, velocity), radius(radius), points(std::move(points))
+{
+	rebuild();
+}
+
+void capsule_chain::setPoints(const std::vector<vec2>& newPoints)
+{
+	points = newPoints;
+	size_t blocks = (std::max<size_t>(segments(), 1) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	if (blocks > capacity)
+		rebuild();
+	else
+		refit();
+}
+
+void capsule_chain::rebuild()
+{
+	size_t blocks = (std::max<size_t>(segments(), 1) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	capacity = 1;
+	while (capacity < blocks)
+		capacity *= 2;
+
+	const size_t lanes = capacity * BLOCK_SIZE;
+	ax.assign(lanes, 0);
+	ay.assign(lanes, 0);
+	bx.assign(lanes, 0);
+	by.assign(lanes, 0);
+	nodes.assign(2 * capacity, node());
+	refit();
+}
+
+void capsule_chain::refit()
+{
+	const node empty{ vec2(FLT_MAX, FLT_MAX), vec2(-FLT_MAX, -FLT_MAX) };
+	std::fill(nodes.begin(), nodes.end(), empty);
+	if (points.empty())
+		return;
+
+	// a single node is a degenerate segment, i.e. a circle
+	const size_t n = segments();
+	const size_t used = std::max<size_t>(n, 1);
+	const size_t lanes = capacity * BLOCK_SIZE;
+	for (size_t i = 0; i < lanes; ++i)
+	{
+		// pad the last block with copies of the last segment
+		const size_t seg = std::min(i, used - 1);
+		const vec2& a = points[seg];
+		const vec2& b = points[std::min(seg + 1, points.size() - 1)];
+		ax[i] = a.x; ay[i] = a.y;
+		bx[i] = b.x; by[i] = b.y;
+	}
+
+	const vec2 r(radius, radius);
+	for (size_t i = 0; i < used; ++i)
+	{
+		node& leaf = nodes[capacity + i / BLOCK_SIZE];
+		const vec2 a(ax[i], ay[i]), b(bx[i], by[i]);
+		leaf.min = vec2::minv(leaf.min, vec2::minv(a, b) - r);
+		leaf.max = vec2::maxv(leaf.max, vec2::maxv(a, b) + r);
+	}
+	for (size_t i = capacity - 1; i >= 1; --i)
+	{
+		nodes[i].min = vec2::minv(nodes[2 * i].min, nodes[2 * i + 1].min);
+		nodes[i].max = vec2::maxv(nodes[2 * i].max, nodes[2 * i + 1].max);
+	}
+}
+
+float capsule_chain::sweep(const vec2& origin, const vec2& relVel, float inflate) const
+{
+	TH_COUNT(PredictChain);
+	if (points.empty())
+		return -1;
+
+	const float o[] = { origin.x, origin.y };
+	const float v[] = { relVel.x, relVel.y };
+	const float r = radius + inflate;
+
+	float best = FLT_MAX;
+	size_t stack[64];
+	size_t sp = 0;
+	stack[sp++] = 1;
+	while (sp)
+	{
+		const size_t i = stack[--sp];
+		const node& n = nodes[i];
+		if (n.min.x > n.max.x)
+			continue;
+
+		// slab test of the swept center against the box inflated by the circle
+		const float lo[] = { n.min.x - inflate, n.min.y - inflate };
+		const float hi[] = { n.max.x + inflate, n.max.y + inflate };
+		float tmin = 0, tmax = best;
+		bool hit = true;
+		for (int k = 0; k < 2 && hit; ++k)
+		{
+			if (v[k] == 0)
+			{
+				hit = o[k] >= lo[k] && o[k] <= hi[k];
+				continue;
+			}
+			float t0 = (lo[k] - o[k]) / v[k];
+			float t1 = (hi[k] - o[k]) / v[k];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tmin = std::max(tmin, t0);
+			tmax = std::min(tmax, t1);
+			hit = tmin <= tmax;
+		}
+		if (!hit)
+			continue;
+
+		if (i >= capacity)
+		{
+			const size_t lane = (i - capacity) * BLOCK_SIZE;
+			float t = sweepBlock(&ax[lane], &ay[lane], &bx[lane], &by[lane], origin, relVel, r);
+			if (t == 0)
+			{
+				TH_COUNT(AlreadyColliding);
+				return 0;
+			}
+			best = std::min(best, t);
+		}
+		else
+		{
+			stack[sp++] = 2 * i + 1;
+			stack[sp++] = 2 * i;
+		}
+	}
+	return best == FLT_MAX ? -1 : best;
+}
+
+vec2 capsule_chain::com() const
+{
+	if (nodes.size() < 2)
+		return vec2();
+	return nodes[1].min / 2 + nodes[1].max / 2;
+}
+
+std::shared_ptr<entity> capsule_chain::translate(vec2 delta) const
+{
+	auto c = std::make_shared<capsule_chain>(*this);
+	c->move(delta);
+	return c;
+}
+
+void capsule_chain::move(vec2 delta)
+{
+	for (vec2& v : points)
+		v += delta;
+	refit();
+}
+
+std::shared_ptr<entity> capsule_chain::withVelocity(vec2 newVelocity) const
+{
+	auto c = std::make_shared<capsule_chain>(*this);
+	c->velocity = newVelocity;
+	return c;
+}
+
+std::shared_ptr<aabb> capsule_chain::boundingBox() const
+{
+	if (points.empty())
+		return std::make_shared<aabb>(vec2(), velocity, vec2());
+	return std::make_shared<aabb>(nodes[1].min, velocity, nodes[1].max - nodes[1].min);
+}
+
+float capsule_chain::willExit(const entity& o) const
+{
+	switch (o.type)
+	{
+	default: return -1.f;
+	}
+}
+
+float capsule_chain::willCollideWith(const entity& o) const
+{
+	switch (o.type)
+	{
+	case Circle: {
+		const auto& a = dynamic_cast<const circle&>(o);
+		return sweep(a.center, a.velocity - velocity, a.radius);
+	}
+	case AABB: {
+		// Conservatively use the circumscribed circle of the box
+		const auto& a = dynamic_cast<const aabb&>(o);
+		return sweep(a.com(), a.velocity - velocity, a.size.len() / 2);
+	}
+	default: return -1.f;
+	}
+}
+
+std::ostream& capsule_chain::serialize(std::ostream& os) const
+{
+	os << "capsule_chain n" << points.size() << " r" << radius << " v" << velocity;
+	return os;
+}
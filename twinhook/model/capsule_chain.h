@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/vec2.h"
+#include "entity.h"
+
+/**
+ * \brief Polyline of capsules with a common radius, e.g. a curvy laser.
+ *
+ * Segments are stored in blocks of BLOCK_SIZE, and a bounding volume hierarchy
+ * is kept over the blocks as an implicit binary heap (root at 1, leaves at
+ * [capacity, 2 * capacity)). Since the topology only depends on the capacity,
+ * moving or growing the chain within its capacity only refits the bounds.
+ *
+ * Sweep queries descend only into nodes hit by the swept path of the other
+ * entity, and evaluate the time of impact of a whole block of capsules at once.
+ */
+class capsule_chain : public entity
+{
+public:
+	static const int BLOCK_SIZE = 4;
+
+	float radius;
+
+	capsule_chain(std::vector<vec2> points, float radius, const vec2& velocity = vec2());
+
+	const std::vector<vec2>& getPoints() const { return points; }
+	size_t segments() const { return points.size() > 1 ? points.size() - 1 : 0; }
+
+	/**
+	 * \brief Move the nodes of the chain, refitting the hierarchy. The hierarchy
+	 * is only rebuilt if the chain outgrows its capacity.
+	 * \param newPoints The new nodes
+	 */
+	void setPoints(const std::vector<vec2>& newPoints);
+
+	/**
+	 * \brief Time of impact of a circle moving relative to the chain
+	 * \param origin Center of the circle
+	 * \param relVel Velocity of the circle relative to the chain
+	 * \param inflate Radius of the circle
+	 * \return 0 if already collided, -1 if no collision, otherwise frames until collision
+	 */
+	float sweep(const vec2& origin, const vec2& relVel, float inflate) const;
+
+	vec2 com() const override;
+	std::shared_ptr<entity> translate(vec2 delta) const override;
+	void move(vec2 delta) override;
+	std::shared_ptr<entity> withVelocity(vec2 newVelocity) const override;
+	std::shared_ptr<aabb> boundingBox() const override;
+
+	float willExit(const entity& o) const override;
+	float willCollideWith(const entity& o) const override;
+
+	std::ostream& serialize(std::ostream& os) const override;
+
+private:
+	struct node
+	{
+		vec2 min;
+		vec2 max;
+	};
+
+	std::vector<vec2> points;
+
+	// Segment endpoints as structure of arrays, padded to capacity * BLOCK_SIZE
+	std::vector<float> ax, ay, bx, by;
+	std::vector<node> nodes;
+	// Number of leaf blocks, a power of two
+	size_t capacity = 0;
+
+	void rebuild();
+	void refit();
+};
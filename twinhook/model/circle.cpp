@@ -1,6 +1,11 @@
-#include "stdafx.h"
 #include "circle.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
 #include "aabb.h"
+#include "obb.h"
 
 vec2 circle::com() const
 {
@@ -10,10 +15,15 @@ vec2 circle::com() const
 std::shared_ptr<entity> circle::translate(vec2 delta) const
 {
 	auto c = std::make_shared<circle>(*this);
-	c->center += delta;
+	c->move(delta);
 	return c;
 }
 
+void circle::move(vec2 delta)
+{
+	center += delta;
+}
+
 std::shared_ptr<entity> circle::withVelocity(vec2 newVelocity) const
 {
 	auto c = std::make_shared<circle>(*this);
@@ -48,6 +58,15 @@ float circle::willCollideWith(const entity& o) const
 		return vec2::willCollideCircle(center, a.center,
 			radius, a.radius, velocity, a.velocity);
 	}
+	case Polygon: {
+		// Only rotating lasers are defined against circles
+		const auto r = dynamic_cast<const obb*>(&o);
+		return r && r->isRotating() ? r->willCollideWith(*this) : -1.f;
+	}
+	case CapsuleChain: {
+		// The opposite is already defined, so use that one
+		return o.willCollideWith(*this);
+	}
 	default: return -1.f;
 	}
 }
@@ -17,7 +17,8 @@ public:
 	{
 		AABB,
 		Circle,
-		Polygon
+		Polygon,
+		CapsuleChain
 	};
 protected:
 	entity(entity_type type, vec2 velocity = vec2())
@@ -52,6 +53,11 @@ public:
 	 * \return Entity translated by delta
 	 */
 	virtual std::shared_ptr<entity> translate(vec2 delta) const = 0;
+	/**
+	 * \brief Translate this entity in place, e.g. to advance it by its velocity
+	 * \param delta Translation delta
+	 */
+	virtual void move(vec2 delta) = 0;
 	/**
 	 * \brief Get entity with new velocity
 	 * \param newVelocity The new velocity
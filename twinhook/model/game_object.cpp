@@ -18,6 +18,22 @@ static void cdraw_polygon(const std::vector<vec2> &points)
 	}
 }
 
+static void cdraw_polyline(const std::vector<vec2> &points)
+{
+	for (size_t i = 1; i < points.size(); i++)
+	{
+		vec2 p1 = points[i - 1];
+		vec2 p2 = points[i];
+		cdraw::line(
+			th_param.GAME_X_OFFSET + p1.x,
+			th_param.GAME_Y_OFFSET + p1.y,
+			th_param.GAME_X_OFFSET + p2.x,
+			th_param.GAME_Y_OFFSET + p2.y,
+			D3DCOLOR_ARGB(255, 255, 0, 0)
+		);
+	}
+}
+
 static void cdraw_aabb(const std::shared_ptr<aabb> &c)
 {
 	cdraw::rect(th_param.GAME_X_OFFSET + c->position.x,
@@ -51,5 +67,10 @@ void game_object::render() const
 		cdraw_polygon(c->points);
 		break;
 	}
+	case entity::CapsuleChain: {
+		auto c = std::dynamic_pointer_cast<capsule_chain>(obj);
+		cdraw_polyline(c->getPoints());
+		break;
+	}
 	}
 }
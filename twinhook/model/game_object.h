@@ -44,6 +44,9 @@ class laser : public game_object
 public:
 	laser(const obb &a)
 		: game_object(Laser, std::make_shared<obb>(a)) {}
+
+	laser(const capsule_chain &a)
+		: game_object(Laser, std::make_shared<capsule_chain>(a)) {}
 };
 
 class player : public game_object
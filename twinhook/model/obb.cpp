@@ -1,6 +1,12 @@
-#include "stdafx.h"
 #include "obb.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include "aabb.h"
+#include "circle.h"
+#include "util/counters.h"
+
 std::vector<vec2> obb::toVertices(const vec2& position, float length, float radius, float angle)
 {
 	return {
@@ -10,3 +16,98 @@ std::vector<vec2> obb::toVertices(const vec2& position, float length, float radi
 		vec2(length, radius).rotate(angle) + position
 	};
 }
+
+float obb::lengthAt(float t) const
+{
+	return std::max(0.f, std::min(LENGTH_LIMIT, length + lengthVelocity * t));
+}
+
+float obb::distanceAt(const vec2& p, float t) const
+{
+	// Express the point in the frame of the box at time t
+	const vec2 local = (p - position).rotate(-(angle + angularVelocity * t));
+	const float len = lengthAt(t);
+	const float dx = std::max(std::max(-local.x, local.x - len), 0.f);
+	const float dy = std::max(abs(local.y) - radius, 0.f);
+	return sqrt(dx * dx + dy * dy);
+}
+
+float obb::timeOfImpact(const vec2& center, const vec2& relVel, float inflate, float horizon) const
+{
+	TH_COUNT(PredictRotor);
+	const float speed = relVel.len();
+	const float omega = abs(angularVelocity);
+	const float grow = abs(lengthVelocity);
+
+	// A point of the box never moves faster than the pivot-relative speed of its
+	// farthest corner, so the distance to the circle shrinks by at most
+	// speed + omega * reach + grow per frame, where reach is taken at the longest
+	// extent of the step. Advancing by distance / bound can therefore never
+	// step over the time of impact.
+	float t = 0;
+	for (int i = 0; i < TOI_ITERATIONS; ++i)
+	{
+		const float d = distanceAt(center + relVel * t, t) - inflate;
+		if (d <= TOI_TOLERANCE)
+		{
+			if (t == 0)
+				TH_COUNT(AlreadyColliding);
+			return t;
+		}
+
+		float len = lengthAt(t);
+		float dt = d / (speed + omega * sqrt(len * len + radius * radius) + grow);
+		// The length is linear in t, so the longest extent over the step is at an end
+		const float lenEnd = lengthAt(t + dt);
+		if (lenEnd > len)
+		{
+			len = lenEnd;
+			dt = d / (speed + omega * sqrt(len * len + radius * radius) + grow);
+		}
+
+		t += dt;
+		if (t > horizon)
+			return -1;
+	}
+	return t;
+}
+
+std::shared_ptr<entity> obb::translate(vec2 delta) const
+{
+	auto c = std::make_shared<obb>(*this);
+	c->move(delta);
+	return c;
+}
+
+void obb::move(vec2 delta)
+{
+	polygon::move(delta);
+	position += delta;
+}
+
+std::shared_ptr<entity> obb::withVelocity(vec2 newVelocity) const
+{
+	auto c = std::make_shared<obb>(*this);
+	c->velocity = newVelocity;
+	return c;
+}
+
+float obb::willCollideWith(const entity& o) const
+{
+	if (!isRotating())
+		return polygon::willCollideWith(o);
+
+	switch (o.type)
+	{
+	case Circle: {
+		const auto& a = dynamic_cast<const circle&>(o);
+		return timeOfImpact(a.center, a.velocity - velocity, a.radius);
+	}
+	case AABB: {
+		// Conservatively use the circumscribed circle of the box
+		const auto& a = dynamic_cast<const aabb&>(o);
+		return timeOfImpact(a.com(), a.velocity - velocity, a.size.len() / 2);
+	}
+	default: return polygon::willCollideWith(o);
+	}
+}
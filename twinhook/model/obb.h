@@ -6,11 +6,76 @@
 #include "util/vec2.h"
 #include "polygon.h"
 
+/**
+ * \brief Oriented box swept from a pivot, e.g. a straight laser.
+ *
+ * The box spans [0, length] along its angle and [-radius, radius] across it.
+ * Lasers may rotate about the pivot and extend over time; such boxes are
+ * predicted by conservative advancement instead of the static polygon tests.
+ */
 class obb : public polygon
 {
 	static std::vector<vec2> toVertices(const vec2& position,
 		float length, float radius, float angle);
 public:
-	obb(const vec2& position, float length, float radius, float angle, const vec2& velocity = vec2())
-		: polygon(toVertices(position, length, radius, angle), velocity) {}
+	// Extrapolated lengths are clamped to this, which exceeds any playfield diagonal
+	static constexpr float LENGTH_LIMIT = 1024.f;
+	// Distance at which conservative advancement reports an impact
+	static constexpr float TOI_TOLERANCE = 0.05f;
+	// Maximum conservative advancement steps per query
+	static const int TOI_ITERATIONS = 128;
+
+	vec2 position;
+	float length;
+	float radius;
+	float angle;
+	// Radians per frame about the pivot
+	float angularVelocity;
+	// Pixels per frame along the angle
+	float lengthVelocity;
+
+	obb(const vec2& position, float length, float radius, float angle, const vec2& velocity = vec2(),
+		float angularVelocity = 0, float lengthVelocity = 0)
+		: polygon(toVertices(position, length, radius, angle), velocity),
+		position(position), length(length), radius(radius), angle(angle),
+		angularVelocity(angularVelocity), lengthVelocity(lengthVelocity) {}
+
+	bool isRotating() const { return angularVelocity != 0 || lengthVelocity != 0; }
+
+	/**
+	 * \brief Length of the box some frames from now
+	 * \param t Frames from now
+	 * \return The extrapolated length
+	 */
+	float lengthAt(float t) const;
+
+	/**
+	 * \brief Distance from a point to the box some frames from now, ignoring the
+	 * linear velocity of the pivot
+	 * \param p The point
+	 * \param t Frames from now
+	 * \return 0 if the point is inside, otherwise the distance
+	 */
+	float distanceAt(const vec2& p, float t) const;
+
+	/**
+	 * \brief Time of impact of a circle moving relative to the rotating box.
+	 * The search never steps over the time of impact and reports the first
+	 * time the circle comes within TOI_TOLERANCE of the box. If the iteration
+	 * limit is hit first, the time reached so far is reported, which is a
+	 * conservative lower bound of the time of impact.
+	 * \param center Center of the circle
+	 * \param relVel Velocity of the circle relative to the pivot
+	 * \param inflate Radius of the circle
+	 * \param horizon Number of frames to look ahead
+	 * \return 0 if already collided, -1 if no collision, otherwise frames until collision
+	 */
+	float timeOfImpact(const vec2& center, const vec2& relVel, float inflate,
+		float horizon = 6000.f) const;
+
+	std::shared_ptr<entity> translate(vec2 delta) const override;
+	void move(vec2 delta) override;
+	std::shared_ptr<entity> withVelocity(vec2 newVelocity) const override;
+
+	float willCollideWith(const entity& o) const override;
 };
@@ -5,3 +5,4 @@
 #include "circle.h"
 #include "polygon.h"
 #include "obb.h"
+#include "capsule_chain.h"
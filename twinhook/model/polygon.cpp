@@ -16,11 +16,16 @@ vec2 polygon::com() const
 std::shared_ptr<entity> polygon::translate(vec2 delta) const
 {
 	auto c = std::make_shared<polygon>(*this);
-	for (vec2& v : c->points)
-		v += delta;
+	c->move(delta);
 	return c;
 }
 
+void polygon::move(vec2 delta)
+{
+	for (vec2& v : points)
+		v += delta;
+}
+
 std::shared_ptr<entity> polygon::withVelocity(vec2 newVelocity) const
 {
 	auto c = std::make_shared<polygon>(*this);
@@ -0,0 +1,331 @@
+#include "sim/danmaku.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+static const float TWO_PI = float(2 * M_PI);
+// Direction of bullets falling down the screen
+static const float DOWN = float(M_PI / 2);
+// Ticks a laser takes to grow to its full length
+static const float LASER_GROWTH_TICKS = 30.f;
+// Fewest bullets per volley which still look like the archetype
+static const int MIN_WAYS[danmaku::ArchetypeCount] = { 8, 2, 3, 1, 8, 1, 1, 8, 8 };
+
+/**
+ * \brief Average ticks until bullets fired evenly over a range of directions
+ * leave a field, ignoring their size
+ */
+static float meanFlight(const vec2& origin, const vec2& size, float angle, float spread,
+	float speed, float acceleration)
+{
+	const int SAMPLES = 64;
+	float total = 0;
+	for (int i = 0; i < SAMPLES; ++i)
+	{
+		const float a = angle - spread / 2 + spread * (i + 0.5f) / SAMPLES;
+		const float dx = cos(a), dy = sin(a);
+		// distance along the direction to the first edge crossed
+		float d = FLT_MAX;
+		if (dx > 0) d = std::min(d, (size.x - origin.x) / dx);
+		if (dx < 0) d = std::min(d, -origin.x / dx);
+		if (dy > 0) d = std::min(d, (size.y - origin.y) / dy);
+		if (dy < 0) d = std::min(d, -origin.y / dy);
+		// d = v t + a t^2 / 2
+		total += acceleration > 0
+			? (sqrt(speed * speed + 2 * acceleration * d) - speed) / acceleration
+			: d / speed;
+	}
+	return total / SAMPLES;
+}
+
+uint64_t danmaku::rng::next()
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+float danmaku::rng::uniform()
+{
+	// 24 bits fill the mantissa exactly, so the result is below 1
+	return (next() >> 40) * (1.f / 16777216.f);
+}
+
+danmaku::pattern danmaku::preset(archetype type, const vec2& origin, float density, const vec2& fieldSize)
+{
+	pattern p;
+	p.type = type;
+	p.origin = origin;
+
+	switch (type)
+	{
+	case Ring:
+		p.speed = 1.5f; p.period = 20; p.size = 4.f;
+		break;
+	case Spiral:
+		p.speed = 2.f; p.period = 3; p.spin = 0.21f; p.size = 3.f;
+		break;
+	case AimedFan:
+		p.speed = 3.f; p.period = 15; p.spread = 1.2f; p.size = 3.f;
+		break;
+	case Spray:
+		p.speed = 2.f; p.period = 1; p.spread = 2.f; p.size = 2.5f;
+		break;
+	case Wall:
+		p.speed = 1.f; p.period = 40; p.size = 5.f;
+		break;
+	case StaticLaser:
+		p.period = 90; p.lifetime = 60; p.size = 6.f;
+		break;
+	case RotatingLaser:
+		p.period = 240; p.lifetime = 240; p.spin = 0.01f; p.size = 5.f;
+		break;
+	case Accelerating:
+		p.speed = 0.5f; p.period = 30; p.acceleration = 0.03f; p.size = 4.f;
+		break;
+	case Curving:
+		p.speed = 1.5f; p.period = 25; p.turn = 0.008f; p.size = 4.f;
+		break;
+	default:
+		break;
+	}
+
+	if (type == StaticLaser || type == RotatingLaser)
+	{
+		// a laser is a single shot, its density is its reach
+		p.ways = 1;
+		p.extent = fieldSize.len();
+		return p;
+	}
+	if (type == Wall)
+		p.extent = fieldSize.x;
+
+	// Bullets alive = bullets per tick * ticks until they leave the field
+	float flight;
+	switch (type)
+	{
+	case Wall:
+		flight = (fieldSize.y - origin.y) / p.speed;
+		break;
+	case AimedFan:
+		// the target is not known yet, assume it is below
+	case Spray:
+		flight = meanFlight(origin, fieldSize, DOWN, p.spread, p.speed, 0);
+		break;
+	default:
+		flight = meanFlight(origin, fieldSize, 0, TWO_PI, p.speed, p.acceleration);
+		break;
+	}
+	const float rate = density / flight;
+
+	// volleys keep the shape of their archetype, sparse patterns fire less often
+	p.ways = std::max(MIN_WAYS[type], (int)std::lround(rate * p.period));
+	p.period = std::max(p.period, (int)std::lround(p.ways / rate));
+	return p;
+}
+
+void danmaku::emitter::emit(uint32_t tick, const vec2& target, std::vector<shot>& out)
+{
+	if (tick % p.period != 0)
+		return;
+
+	auto fire = [&](float angle, float speed)
+	{
+		shot s;
+		s.type = p.type;
+		s.acceleration = p.acceleration;
+		s.turn = p.turn;
+		s.shape = std::make_shared<circle>(p.origin, vec2(cos(angle), sin(angle)) * speed, p.size);
+		out.push_back(std::move(s));
+	};
+	const vec2 aim = target - p.origin;
+	const float aimAngle = atan2(aim.y, aim.x);
+
+	switch (p.type)
+	{
+	case Ring:
+	case Accelerating:
+	case Curving: {
+		const float phase = random.uniform(0, TWO_PI);
+		for (int i = 0; i < p.ways; ++i)
+			fire(phase + TWO_PI * i / p.ways, p.speed);
+		break;
+	}
+	case Spiral:
+		for (int i = 0; i < p.ways; ++i)
+			fire(volleys * p.spin + TWO_PI * i / p.ways, p.speed);
+		break;
+	case AimedFan:
+		if (p.ways == 1)
+			fire(aimAngle, p.speed);
+		for (int i = 0; p.ways > 1 && i < p.ways; ++i)
+			fire(aimAngle - p.spread / 2 + p.spread * i / (p.ways - 1), p.speed);
+		break;
+	case Spray:
+		for (int i = 0; i < p.ways; ++i)
+		{
+			const float angle = DOWN + random.uniform(-p.spread / 2, p.spread / 2);
+			fire(angle, p.speed * random.uniform(0.5f, 1.5f));
+		}
+		break;
+	case Wall: {
+		// boxes spaced evenly over the extent, with a gap three boxes wide
+		const float spacing = p.extent / p.ways;
+		const int gap = (int)random.uniform(0, (float)std::max(1, p.ways - 3));
+		const vec2 sz(2 * p.size, 2 * p.size);
+		for (int i = 0; i < p.ways; ++i)
+		{
+			if (i >= gap && i < gap + 3)
+				continue;
+			const vec2 pos(p.origin.x - p.extent / 2 + spacing * (i + 0.5f), p.origin.y);
+			shot s;
+			s.type = p.type;
+			s.shape = std::make_shared<aabb>(pos - sz / 2, vec2(0, p.speed), sz);
+			out.push_back(std::move(s));
+		}
+		break;
+	}
+	case StaticLaser:
+	case RotatingLaser: {
+		shot s;
+		s.type = p.type;
+		s.ttl = p.lifetime;
+		s.reach = p.extent;
+		if (p.type == StaticLaser)
+			s.shape = std::make_shared<obb>(p.origin, 0.f, p.size, aimAngle, vec2(),
+				0.f, p.extent / LASER_GROWTH_TICKS);
+		else
+			s.shape = std::make_shared<obb>(p.origin, p.extent, p.size,
+				random.uniform(0, TWO_PI), vec2(), p.spin, 0.f);
+		out.push_back(std::move(s));
+		break;
+	}
+	default:
+		break;
+	}
+	++volleys;
+}
+
+bool danmaku::steer(shot& s)
+{
+	if (s.type == StaticLaser || s.type == RotatingLaser)
+	{
+		const auto& l = static_cast<const obb&>(*s.shape);
+		if (!l.isRotating())
+			return false;
+
+		// grow until the full length, then only rotate
+		float length = l.length + l.lengthVelocity;
+		float lengthVelocity = l.lengthVelocity;
+		if (length >= s.reach)
+		{
+			length = s.reach;
+			lengthVelocity = 0;
+		}
+		s.shape = std::make_shared<obb>(l.position, length, l.radius,
+			l.angle + l.angularVelocity, l.velocity, l.angularVelocity, lengthVelocity);
+		return true;
+	}
+
+	if (s.acceleration == 0 && s.turn == 0)
+		return false;
+	vec2& v = s.shape->velocity;
+	if (s.turn != 0)
+		v = v.rotate(s.turn);
+	if (s.acceleration != 0 && v.lensq() > 0)
+		v += v.unit() * s.acceleration;
+	return true;
+}
+
+danmaku::field danmaku::field::mixed(const vec2& size, uint64_t seed, float density)
+{
+	field f(size, seed);
+	// lasers are single shots and take no share of the bullets
+	const float share = density / (ArchetypeCount - 2);
+	const vec2 top(size.x / 2, size.y / 5);
+	for (int i = 0; i < ArchetypeCount; ++i)
+	{
+		const archetype type = (archetype)i;
+		// emitters spread over the upper part of the field, walls from the top
+		vec2 origin = type == Wall ? vec2(size.x / 2, 0)
+			: vec2(size.x * (i + 1) / (ArchetypeCount + 1), top.y);
+		f.add(preset(type, origin, share, size));
+	}
+	return f;
+}
+
+void danmaku::field::add(const pattern& p)
+{
+	// every emitter draws from its own stream, so adding one leaves the others unchanged
+	rng streams(seed + emitters.size());
+	emitters.emplace_back(p, streams.next());
+}
+
+bool danmaku::field::expired(const shot& s, const vec2& size)
+{
+	if (s.ttl >= 0)
+		return s.ttl == 0;
+
+	vec2 min, max;
+	if (s.shape->type == entity::Circle)
+	{
+		const auto& c = static_cast<const circle&>(*s.shape);
+		min = c.center - vec2(c.radius);
+		max = c.center + vec2(c.radius);
+	}
+	else if (s.shape->type == entity::AABB)
+	{
+		const auto& a = static_cast<const aabb&>(*s.shape);
+		min = a.position;
+		max = a.position + a.size;
+	}
+	else
+	{
+		const auto box = s.shape->boundingBox();
+		min = box->position;
+		max = box->position + box->size;
+	}
+	return max.x < 0 || max.y < 0 || min.x > size.x || min.y > size.y;
+}
+
+void danmaku::field::tick(const vec2& target)
+{
+	for (shot& s : live)
+	{
+		steer(s);
+		s.shape->move(s.shape->velocity);
+		if (s.ttl > 0)
+			--s.ttl;
+	}
+	live.erase(std::remove_if(live.begin(), live.end(),
+		[this](const shot& s) { return expired(s, size); }), live.end());
+	emit(target, live);
+}
+
+void danmaku::field::emit(const vec2& target, std::vector<shot>& out)
+{
+	for (emitter& e : emitters)
+		e.emit(ticks, target, out);
+	++ticks;
+}
+
+void danmaku::field::collect(std::vector<bullet>& bullets, std::vector<laser>& lasers) const
+{
+	for (const shot& s : live)
+	{
+		switch (s.shape->type)
+		{
+		case entity::Circle:
+			bullets.emplace_back(static_cast<const circle&>(*s.shape), s.type);
+			break;
+		case entity::AABB:
+			bullets.emplace_back(static_cast<const aabb&>(*s.shape), s.type);
+			break;
+		default:
+			lasers.emplace_back(static_cast<const obb&>(*s.shape));
+			break;
+		}
+	}
+}
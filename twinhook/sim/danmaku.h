@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "model/game_object.h"
+#include "model/object.h"
+
+/**
+ * \brief Synthetic bullet patterns for benchmarks and offline simulation.
+ *
+ * Emitters fire the common danmaku archetypes as the shapes the game pollers
+ * produce: bullets are circles or AABBs, lasers are OBBs pivoting at their
+ * emitter. All randomness comes from a seeded generator owned by each emitter,
+ * so a pattern fires the same bullets in the same order on every run.
+ *
+ * Shots move linearly between ticks, like polled bullets. Accelerating and
+ * curving bullets and rotating lasers change their velocity or shape once per
+ * tick in steer(), so collision engines can translate the shapes in place and
+ * only redo predictions for the shots which were steered.
+ */
+namespace danmaku
+{
+	enum archetype : uint8_t
+	{
+		Ring,			// evenly spaced bullets in all directions
+		Spiral,			// rings of few bullets, rotated every volley
+		AimedFan,		// n-way fan centered on the target
+		Spray,			// random directions and speeds within a cone
+		Wall,			// a row of boxes falling down, with a gap to pass
+		StaticLaser,	// laser aimed at the target, growing to full length
+		RotatingLaser,	// laser sweeping about its emitter
+		Accelerating,	// rings which start slow and speed up
+		Curving,		// rings whose bullets turn while they fly
+
+		ArchetypeCount
+	};
+
+	/**
+	 * \brief Deterministic random numbers (splitmix64), identical on every platform
+	 * unlike the standard distributions
+	 */
+	class rng
+	{
+		uint64_t state;
+
+	public:
+		explicit rng(uint64_t seed) : state(seed) {}
+
+		uint64_t next();
+		// Uniform within [0, 1)
+		float uniform();
+		float uniform(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+	};
+
+	struct shot
+	{
+		// aabb or circle for bullets, obb for lasers
+		std::shared_ptr<entity> shape;
+		// Added to the velocity every tick, along the velocity
+		float acceleration = 0;
+		// Radians the velocity turns every tick
+		float turn = 0;
+		// Ticks until a laser disappears, or -1 for bullets, which disappear
+		// when they leave the field
+		int ttl = -1;
+		// Full length of a laser
+		float reach = 0;
+		archetype type = Ring;
+	};
+
+	/**
+	 * \brief Parameters of an emitter, see preset() for sensible values
+	 */
+	struct pattern
+	{
+		archetype type = Ring;
+		vec2 origin;
+		// Pixels per tick
+		float speed = 2.f;
+		// Bullets per volley
+		int ways = 16;
+		// Ticks between volleys
+		int period = 30;
+		// Radians covered by fans and spray
+		float spread = 1.f;
+		// Radians the volley rotates by (spirals), or the laser per tick
+		float spin = 0.f;
+		// Bullet radius, half size of boxes, or half width of lasers
+		float size = 4.f;
+		// Width covered by walls, or length of lasers
+		float extent = 0.f;
+		// See shot::acceleration and shot::turn
+		float acceleration = 0.f;
+		float turn = 0.f;
+		// Ticks a laser lasts
+		int lifetime = 120;
+	};
+
+	/**
+	 * \brief Parameters of an archetype, scaled to keep about a number of
+	 * bullets alive on a field
+	 * \param type The archetype
+	 * \param origin Position of the emitter
+	 * \param density Bullets alive at once, from dozens to about 10000
+	 * \param fieldSize Size of the field
+	 * \return The pattern
+	 */
+	pattern preset(archetype type, const vec2& origin, float density, const vec2& fieldSize);
+
+	/**
+	 * \brief Fires one pattern
+	 */
+	class emitter
+	{
+		pattern p;
+		rng random;
+		uint32_t volleys = 0;
+
+	public:
+		emitter(const pattern& p, uint64_t seed) : p(p), random(seed) {}
+
+		const pattern& getPattern() const { return p; }
+
+		/**
+		 * \brief Fire the volley of a tick, if any
+		 * \param tick Ticks since the emitter started
+		 * \param target Position aimed at, e.g. the player
+		 * \param out New shots are appended to this
+		 */
+		void emit(uint32_t tick, const vec2& target, std::vector<shot>& out);
+	};
+
+	/**
+	 * \brief Advance the non-linear part of a shot's motion by one tick, i.e.
+	 * accelerate or turn its velocity and rotate lasers. Lasers get a new shape.
+	 * \param s The shot
+	 * \return Whether the velocity or shape changed, which voids predictions
+	 */
+	bool steer(shot& s);
+
+	/**
+	 * \brief A simulated field of emitters and their shots, for headless use.
+	 */
+	class field
+	{
+		vec2 size;
+		uint64_t seed;
+		std::vector<emitter> emitters;
+		std::vector<shot> live;
+		uint32_t ticks = 0;
+
+	public:
+		/**
+		 * \param size Size of the field, shots which leave it disappear
+		 * \param seed Seed of the emitters
+		 */
+		field(const vec2& size, uint64_t seed) : size(size), seed(seed) {}
+
+		/**
+		 * \brief A field of one emitter of each archetype
+		 * \param size Size of the field
+		 * \param seed Seed of the emitters
+		 * \param density Bullets alive at once, in total
+		 * \return The field
+		 */
+		static field mixed(const vec2& size, uint64_t seed, float density);
+
+		void add(const pattern& p);
+
+		/**
+		 * \brief Steer and move all shots, drop expired shots and fire new ones
+		 * \param target Position emitters aim at
+		 */
+		void tick(const vec2& target);
+
+		/**
+		 * \brief Fire the volleys of the current tick and advance to the next, for
+		 * callers which keep the shots themselves
+		 * \param target Position emitters aim at
+		 * \param out New shots are appended to this
+		 */
+		void emit(const vec2& target, std::vector<shot>& out);
+
+		/**
+		 * \brief Whether a shot has left a field or expired
+		 */
+		static bool expired(const shot& s, const vec2& size);
+
+		/**
+		 * \brief Copy the shots as polled game objects, with the archetype as the
+		 * bullet meta
+		 * \param bullets Bullets are appended to this
+		 * \param lasers Lasers are appended to this
+		 */
+		void collect(std::vector<bullet>& bullets, std::vector<laser>& lasers) const;
+
+		const std::vector<shot>& shots() const { return live; }
+		uint32_t elapsed() const { return ticks; }
+	};
+}
@@ -1,10 +1,10 @@
 #include "stdafx.h"
 
+#include <atomic>
 #include <unordered_map>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/logger.h>
-#include <spdlog/sinks/msvc_sink.h>
 
 #include "hook/th_di8_hook.h"
 #include "hook/th_d3d9_hook.h"
@@ -19,10 +19,16 @@
 #include "control/th11_player.h"
 #include "control/th15_player.h"
 
-#include "algo/th_vo_algo.h"
+#include "algo/route_book.h"
+#include "algo/th_algorithm_registry.h"
+#include "algo/th_recording.h"
+#include "algo/th_shadow.h"
 
 #include "patch/th_patch_registry.h"
 #include "gfx/imgui_window.h"
+#include "ipc/th_telemetry.h"
+#include "util/counters.h"
+#include "util/detour.h"
 #include "util/spdlog_msvc.h"
 
 // Stores global context initialized on DLL load, to be freed on DLL unload.
@@ -30,16 +36,84 @@ struct twinhook_ctx
 {
 	std::shared_ptr<th_player> th_player;
 	std::shared_ptr<th_algorithm> th_algo;
+	std::shared_ptr<th_shadow> th_shadow;
+	std::shared_ptr<th_recorder> th_recorder;
+	std::shared_ptr<route_book> th_routes;
 	std::shared_ptr<spdlog_msvc> logger;
+	// Whether twinhook_shutdown() stopped the background threads
+	bool shutDown = false;
 };
 
 twinhook_ctx* context;
 
+/**
+ * \brief Create the algorithm selected by the "algo" environment variable,
+ * defaulting to th_vo_algo, and bind it to the player. If the "shadow"
+ * environment variable names another algorithm, it is evaluated in shadow mode.
+ * If the "record" environment variable names a file, every game tick is
+ * recorded to it. If the "routes" environment variable names a file, it is
+ * used as the route book, and the routes taken are saved to it on detach.
+ * \param player Player controller to bind to
+ */
+static void bind_algorithms(th_player* player)
+{
+	size_t len;
+	char buf[256] = { 0 };
+	getenv_s(&len, buf, 256, "algo");
+	if (len > 0)
+		context->th_algo = th_registry::createAlgorithm(buf, player);
+	if (!context->th_algo)
+		context->th_algo = th_registry::createAlgorithm("vo", player);
+	player->bindAlgorithm(context->th_algo.get());
+
+	getenv_s(&len, buf, 256, "shadow");
+	if (len > 0)
+	{
+		if (auto algo = th_registry::createAlgorithm(buf, player))
+		{
+			context->th_shadow = std::make_shared<th_shadow>(buf, algo);
+			context->th_algo->setShadow(context->th_shadow.get());
+		}
+	}
+
+	getenv_s(&len, buf, 256, "record");
+	if (len > 0)
+	{
+		char game[16] = { 0 };
+		getenv_s(&len, game, sizeof(game), "th");
+		context->th_recorder = std::make_shared<th_recorder>();
+		if (context->th_recorder->open(buf, game))
+		{
+			SPDLOG_INFO("Recording to '{}'", buf);
+			context->th_algo->setRecorder(context->th_recorder.get());
+		}
+		else
+		{
+			SPDLOG_WARN("Could not open recording '{}'", buf);
+		}
+	}
+
+	getenv_s(&len, buf, 256, "routes");
+	if (len > 0)
+	{
+		context->th_routes = std::make_shared<route_book>();
+		if (context->th_routes->open(buf))
+		{
+			SPDLOG_INFO("Using route book '{}' with {} routes", buf, context->th_routes->size());
+			context->th_algo->setRouteBook(context->th_routes.get());
+		}
+		else
+		{
+			SPDLOG_WARN("Could not open route book '{}'", buf);
+			context->th_routes.reset();
+		}
+	}
+}
+
 void th06_init()
 {
 	context->th_player = std::make_shared<th06_player>();
-	context->th_algo = std::make_shared<th_vo_algo>(context->th_player.get());
-	context->th_player->bindAlgorithm(context->th_algo.get());
+	bind_algorithms(context->th_player.get());
 
 	th_d3d9_hook::bind(context->th_player.get(), true);
 	th_di8_hook::bind(context->th_player.get());
@@ -47,8 +121,7 @@ void th06_init()
 void th07_init()
 {
 	context->th_player = std::make_shared<th07_player>();
-	context->th_algo = std::make_shared<th_vo_algo>(context->th_player.get());
-	context->th_player->bindAlgorithm(context->th_algo.get());
+	bind_algorithms(context->th_player.get());
 
 	th_d3d9_hook::bind(context->th_player.get(), true);
 	th_di8_hook::bind(context->th_player.get());
@@ -58,8 +131,7 @@ void th07_init()
 void th08_init()
 {
 	context->th_player = std::make_shared<th08_player>();
-	context->th_algo = std::make_shared<th_vo_algo>(context->th_player.get());
-	context->th_player->bindAlgorithm(context->th_algo.get());
+	bind_algorithms(context->th_player.get());
 
 	th_d3d9_hook::bind(context->th_player.get(), true);
 	th_di8_hook::bind(context->th_player.get());
@@ -69,8 +141,7 @@ void th08_init()
 void th10_init()
 {
 	context->th_player = std::make_shared<th10_player>();
-	context->th_algo = std::make_shared<th_vo_algo>(context->th_player.get());
-	context->th_player->bindAlgorithm(context->th_algo.get());
+	bind_algorithms(context->th_player.get());
 
 	th_d3d9_hook::bind(context->th_player.get(), false);
 	th_di8_hook::bind(context->th_player.get());
@@ -80,8 +151,7 @@ void th10_init()
 void th11_init()
 {
 	context->th_player = std::make_shared<th11_player>();
-	context->th_algo = std::make_shared<th_vo_algo>(context->th_player.get());
-	context->th_player->bindAlgorithm(context->th_algo.get());
+	bind_algorithms(context->th_player.get());
 
 	th_d3d9_hook::bind(context->th_player.get(), false);
 	th_di8_hook::bind(context->th_player.get());
@@ -91,14 +161,57 @@ void th11_init()
 void th15_init()
 {
 	context->th_player = std::make_shared<th15_player>();
-	context->th_algo = std::make_shared<th_vo_algo>(context->th_player.get());
-	context->th_player->bindAlgorithm(context->th_algo.get());
+	bind_algorithms(context->th_player.get());
 
 	th_d3d9_hook::bind(context->th_player.get(), false);
 	th_di8_hook::bind(context->th_player.get());
 	th15_bullet_proc_hook::bind(std::dynamic_pointer_cast<th15_player>(context->th_player).get());
 }
 
+/**
+ * \brief Save the route book and stop all background threads, including the
+ * logger. Joining threads under the loader lock can deadlock, so this runs
+ * before the process exits rather than from DllMain; anyone unloading the DLL
+ * with FreeLibrary must call it first. Later calls do nothing.
+ */
+extern "C" __declspec(dllexport) void twinhook_shutdown()
+{
+	static std::atomic<bool> done{ false };
+	if (done.exchange(true))
+		return;
+
+	SPDLOG_INFO("Shutting down");
+	th_counters::stopExport();
+	th_telemetry::stopExport();
+	if (context->th_routes)
+	{
+		const size_t added = context->th_routes->pending();
+		if (context->th_routes->save())
+			SPDLOG_INFO("Saved {} new routes to '{}'", added, context->th_routes->path());
+		else
+			SPDLOG_WARN("Could not save route book '{}'", context->th_routes->path());
+	}
+	if (context->th_algo)
+	{
+		context->th_algo->setShadow(nullptr);
+		context->th_algo->setRecorder(nullptr);
+	}
+	context->th_shadow.reset();
+	context->th_recorder.reset();
+	// last, so the messages above are still delivered
+	th_log::stop();
+	context->shutDown = true;
+}
+
+typedef VOID(WINAPI *ExitProcess_t)(UINT);
+static ExitProcess_t ExitProcess_Original = ExitProcess;
+
+static VOID WINAPI ExitProcess_Hook(UINT exitCode)
+{
+	twinhook_shutdown();
+	ExitProcess_Original(exitCode);
+}
+
 typedef void(*th_loader_t)();
 
 static std::unordered_map<std::string, th_loader_t> th_init{
@@ -122,13 +235,23 @@ __declspec(dllexport) BOOL WINAPI DllMain(HMODULE hModule, DWORD reasonForCall,
 
 		context = new twinhook_ctx;
 
+		// configuration from twinject's channel goes into the environment, so
+		// it has to be applied before anything reads it
+		const bool channel = th_telemetry::connect();
+
 		context->logger = std::make_shared<spdlog_msvc>();
 		spdlog::set_default_logger(context->logger->get_logger());
-		spdlog::set_pattern("[%L:%!@%s:L%#] %v");
 		SPDLOG_INFO("spdlog_msvc initialized");
+		if (channel)
+			SPDLOG_INFO("Connected to twinject channel");
+
+		if (DetourFunction(&(PVOID&)ExitProcess_Original, ExitProcess_Hook))
+			SPDLOG_INFO("Detours: Hooked ExitProcess");
+		else
+			SPDLOG_ERROR("Detours: Failed to hook ExitProcess, threads are not stopped on exit");
 
-		// get game name from environment variable passed from twinject
-		// we should probably use IPC instead of envvars, but it works so hey
+		// get game name from environment variable, set by twinject either
+		// directly or through the channel
 		size_t len;
 		char buf[256];
 		getenv_s(&len, buf, 256, "th");
@@ -153,9 +276,17 @@ __declspec(dllexport) BOOL WINAPI DllMain(HMODULE hModule, DWORD reasonForCall,
 		break;
 	}
 	case DLL_PROCESS_DETACH:
-		SPDLOG_INFO("Detaching from process");
+		// Background threads cannot be joined under the loader lock, so they
+		// are stopped by the ExitProcess hook. A process exiting some other way
+		// has terminated them already, and joining them returns at once; a DLL
+		// unloaded without twinhook_shutdown() still runs them, so its state
+		// is leaked instead.
+		if (lpReserved == nullptr && !context->shutDown)
+			break;
+		twinhook_shutdown();
 		imgui_window_cleanup();
 		delete context;
+		th_telemetry::disconnect();
 		break;
 	default:
 		break;
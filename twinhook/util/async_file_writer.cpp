@@ -0,0 +1,58 @@
+#include "async_file_writer.h"
+
+bool async_file_writer::open(const std::string& filename)
+{
+	close();
+	out.open(filename, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+	stopping = false;
+	written = 0;
+	worker = std::thread(&async_file_writer::run, this);
+	return true;
+}
+
+void async_file_writer::write(const void* data, size_t len)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		const char* bytes = static_cast<const char*>(data);
+		pending.insert(pending.end(), bytes, bytes + len);
+	}
+	cv.notify_one();
+}
+
+void async_file_writer::close()
+{
+	if (!worker.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	cv.notify_one();
+	worker.join();
+	out.close();
+}
+
+void async_file_writer::run()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true)
+	{
+		cv.wait(lock, [this] { return stopping || !pending.empty(); });
+		if (pending.empty() && stopping)
+			break;
+
+		// swap buffers so the game thread can keep appending while we write
+		writing.swap(pending);
+		lock.unlock();
+
+		out.write(writing.data(), writing.size());
+		written += writing.size();
+		writing.clear();
+
+		lock.lock();
+	}
+	out.flush();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Binary file writer which performs disk I/O on a background thread.
+ *
+ * Writers append to an in-memory buffer, which the background thread swaps
+ * out and writes to disk, so the game thread never blocks on the file system.
+ */
+class async_file_writer
+{
+	std::ofstream out;
+	std::thread worker;
+	std::mutex mtx;
+	std::condition_variable cv;
+
+	// Buffer being appended to by the game thread
+	std::vector<char> pending;
+	// Buffer being written to disk by the worker thread
+	std::vector<char> writing;
+
+	bool stopping = false;
+	std::atomic<size_t> written{ 0 };
+
+	void run();
+public:
+	async_file_writer() = default;
+	~async_file_writer() { close(); }
+
+	async_file_writer(const async_file_writer& other) = delete;
+	async_file_writer& operator=(const async_file_writer& other) = delete;
+
+	/**
+	 * \brief Open a file for writing, truncating it, and start the worker thread
+	 * \param filename Path of file to write
+	 * \return Whether the file could be opened
+	 */
+	bool open(const std::string& filename);
+
+	/**
+	 * \brief Queue data to be written to the file
+	 * \param data Pointer to data
+	 * \param len Length of data in bytes
+	 */
+	void write(const void* data, size_t len);
+
+	/**
+	 * \brief Flush all queued data and stop the worker thread
+	 */
+	void close();
+
+	bool isOpen() const { return worker.joinable(); }
+	size_t bytesWritten() const { return written; }
+};
@@ -0,0 +1,424 @@
+#include "async_log.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const uint32_t PADDING = 0xFFFFFFFF;
+	const uint32_t BINARY_VERSION = 1;
+	const uint8_t ENTRY_SITE = 1;
+	const uint8_t ENTRY_RECORD = 2;
+
+	struct record_header
+	{
+		// Size of the record including the header, records start at multiples of 8
+		uint32_t size;
+		uint32_t site;
+		uint64_t time;
+	};
+
+	/**
+	 * \brief Single-producer single-consumer byte ring of one thread.
+	 * Positions increase monotonically and are masked on access. Fewer than
+	 * sizeof(record_header) bytes left before the end of the ring are padding
+	 * without a header.
+	 */
+	struct ring
+	{
+		std::atomic<size_t> head{ 0 };
+		std::atomic<size_t> tail{ 0 };
+		// Set when the owning thread exits, so the ring is removed once drained
+		std::atomic<bool> orphaned{ false };
+
+		/* Producer only */
+		size_t cachedTail = 0;
+		size_t pendingHead = 0;
+
+		alignas(8) uint8_t data[th_log::RING_SIZE];
+	};
+
+	struct ring_holder
+	{
+		std::shared_ptr<ring> r;
+		~ring_holder() { if (r) r->orphaned = true; }
+	};
+
+	std::mutex registryMtx;
+	std::vector<std::shared_ptr<ring>> rings;
+	std::vector<th_log::site> sites;
+	std::atomic<uint64_t> droppedCount{ 0 };
+
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::function<void(const th_log::site&, const std::string&)> textSink;
+	std::ofstream binaryOut;
+	std::vector<bool> sitesWritten;
+
+	thread_local ring_holder localRing;
+
+	ring& getLocalRing()
+	{
+		if (!localRing.r)
+		{
+			localRing.r = std::make_shared<ring>();
+			std::lock_guard<std::mutex> lock(registryMtx);
+			rings.push_back(localRing.r);
+		}
+		return *localRing.r;
+	}
+
+	uint64_t now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	template<typename T>
+	void writeRaw(std::ostream& os, const T& v)
+	{
+		os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+	}
+
+	void writeString(std::ostream& os, const char* s)
+	{
+		const uint16_t len = (uint16_t)std::min<size_t>(strlen(s), 0xFFFF);
+		writeRaw(os, len);
+		os.write(s, len);
+	}
+
+	void emit(const record_header& h, const uint8_t* args, size_t len)
+	{
+		th_log::site s;
+		{
+			std::lock_guard<std::mutex> lock(registryMtx);
+			if (h.site >= sites.size())
+				return;
+			s = sites[h.site];
+		}
+
+		if (textSink)
+		{
+			textSink(s, th_log::format(s.fmt, args, len));
+			return;
+		}
+
+		// Binary logs describe each call site before its first record
+		if (sitesWritten.size() <= h.site)
+			sitesWritten.resize(h.site + 1, false);
+		if (!sitesWritten[h.site])
+		{
+			writeRaw(binaryOut, ENTRY_SITE);
+			writeRaw(binaryOut, s.id);
+			writeRaw(binaryOut, (uint8_t)s.lvl);
+			writeRaw(binaryOut, (int32_t)s.line);
+			writeString(binaryOut, s.file);
+			writeString(binaryOut, s.fmt);
+			sitesWritten[h.site] = true;
+		}
+		writeRaw(binaryOut, ENTRY_RECORD);
+		writeRaw(binaryOut, h.site);
+		writeRaw(binaryOut, h.time);
+		writeRaw(binaryOut, (uint32_t)len);
+		binaryOut.write(reinterpret_cast<const char*>(args), len);
+	}
+
+	// Consume all published records of a ring, returning whether there were any
+	bool drain(ring& r)
+	{
+		size_t t = r.tail.load(std::memory_order_relaxed);
+		const size_t h = r.head.load(std::memory_order_acquire);
+		if (t == h)
+			return false;
+		while (t != h)
+		{
+			const size_t offset = t & (th_log::RING_SIZE - 1);
+			if (th_log::RING_SIZE - offset < sizeof(record_header))
+			{
+				t += th_log::RING_SIZE - offset;
+				continue;
+			}
+			record_header hdr;
+			memcpy(&hdr, r.data + offset, sizeof(hdr));
+			if (hdr.site != PADDING)
+				emit(hdr, r.data + offset + sizeof(hdr), hdr.size - sizeof(hdr));
+			t += (hdr.size + 7) & ~(size_t)7;
+		}
+		r.tail.store(t, std::memory_order_release);
+		return true;
+	}
+
+	bool drainAll()
+	{
+		std::vector<std::shared_ptr<ring>> current;
+		{
+			std::lock_guard<std::mutex> lock(registryMtx);
+			current = rings;
+		}
+
+		bool any = false;
+		for (const auto& r : current)
+			any |= drain(*r);
+
+		// Forget rings of exited threads once they are empty
+		std::lock_guard<std::mutex> lock(registryMtx);
+		rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<ring>& r) {
+			return r->orphaned && r->tail.load() == r->head.load();
+		}), rings.end());
+		return any;
+	}
+
+	void run()
+	{
+		while (running)
+		{
+			if (!drainAll())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		drainAll();
+		if (binaryOut.is_open())
+			binaryOut.flush();
+	}
+}
+
+th_log::site th_log::makeSite(level lvl, const char* fmt, const char* file, int line)
+{
+	std::lock_guard<std::mutex> lock(registryMtx);
+	site s = { lvl, fmt, file, line, (uint32_t)sites.size() };
+	sites.push_back(s);
+	return s;
+}
+
+uint8_t* th_log::detail::begin(const site& s, size_t argBytes)
+{
+	ring& r = getLocalRing();
+	const size_t bytes = sizeof(record_header) + argBytes;
+	const size_t size = (bytes + 7) & ~(size_t)7;
+	if (size > RING_SIZE / 2)
+	{
+		++droppedCount;
+		return nullptr;
+	}
+
+	size_t head = r.head.load(std::memory_order_relaxed);
+	const size_t offset = head & (RING_SIZE - 1);
+	// Records are contiguous, so pad to the start of the ring if needed
+	const size_t pad = offset + size > RING_SIZE ? RING_SIZE - offset : 0;
+	if (head + pad + size - r.cachedTail > RING_SIZE)
+	{
+		r.cachedTail = r.tail.load(std::memory_order_acquire);
+		if (head + pad + size - r.cachedTail > RING_SIZE)
+		{
+			++droppedCount;
+			return nullptr;
+		}
+	}
+
+	// A padding header only fits if there is room for it
+	if (pad >= sizeof(record_header))
+	{
+		const record_header padding = { (uint32_t)pad, PADDING, 0 };
+		memcpy(r.data + offset, &padding, sizeof(padding));
+	}
+	head += pad;
+
+	const record_header hdr = { (uint32_t)bytes, s.id, now() };
+	uint8_t* p = r.data + (head & (RING_SIZE - 1));
+	memcpy(p, &hdr, sizeof(hdr));
+	r.pendingHead = head + size;
+	return p + sizeof(hdr);
+}
+
+void th_log::detail::commit()
+{
+	ring& r = *localRing.r;
+	r.head.store(r.pendingHead, std::memory_order_release);
+}
+
+void th_log::start(std::function<void(const site&, const std::string&)> sink)
+{
+	stop();
+	textSink = std::move(sink);
+	running = true;
+	worker = std::thread(run);
+}
+
+bool th_log::startBinary(const std::string& filename)
+{
+	stop();
+	binaryOut.open(filename, std::ios::binary | std::ios::trunc);
+	if (!binaryOut)
+		return false;
+	binaryOut.write("TLOG", 4);
+	writeRaw(binaryOut, BINARY_VERSION);
+	sitesWritten.clear();
+	textSink = nullptr;
+	running = true;
+	worker = std::thread(run);
+	return true;
+}
+
+void th_log::stop()
+{
+	if (!worker.joinable())
+		return;
+	running = false;
+	worker.join();
+	if (binaryOut.is_open())
+		binaryOut.close();
+}
+
+uint64_t th_log::dropped()
+{
+	return droppedCount;
+}
+
+std::string th_log::format(const char* fmt, const uint8_t* args, size_t len)
+{
+	std::string out;
+	const uint8_t* p = args;
+	const uint8_t* end = args + len;
+
+	for (const char* c = fmt; *c; ++c)
+	{
+		if ((c[0] == '{' && c[1] == '{') || (c[0] == '}' && c[1] == '}'))
+		{
+			out += *c++;
+			continue;
+		}
+		const char* close = c[0] == '{' ? strchr(c, '}') : nullptr;
+		if (!close || p >= end)
+		{
+			out += *c;
+			continue;
+		}
+
+		// Only a fixed precision is supported, e.g. {:.2f}
+		int precision = -1;
+		if (c[1] == ':' && c[2] == '.')
+			precision = atoi(c + 3);
+
+		char buf[64];
+		const uint8_t type = *p++;
+		switch (type)
+		{
+		case ArgInt: {
+			int64_t v;
+			memcpy(&v, p, 8); p += 8;
+			out += std::to_string(v);
+			break;
+		}
+		case ArgUInt: {
+			uint64_t v;
+			memcpy(&v, p, 8); p += 8;
+			out += std::to_string(v);
+			break;
+		}
+		case ArgDouble: {
+			double v;
+			memcpy(&v, p, 8); p += 8;
+			if (precision >= 0)
+				snprintf(buf, sizeof(buf), "%.*f", precision, v);
+			else
+				snprintf(buf, sizeof(buf), "%g", v);
+			out += buf;
+			break;
+		}
+		case ArgBool: {
+			uint64_t v;
+			memcpy(&v, p, 8); p += 8;
+			out += v ? "true" : "false";
+			break;
+		}
+		case ArgString: {
+			uint16_t n;
+			memcpy(&n, p, 2);
+			out.append(reinterpret_cast<const char*>(p + 2), n);
+			p += 2 + n;
+			break;
+		}
+		default:
+			// Malformed arguments, stop substituting
+			p = end;
+			break;
+		}
+		c = close;
+	}
+	return out;
+}
+
+bool th_log::decode(std::istream& in, std::ostream& out)
+{
+	static const char* const LEVELS = "TDIWE";
+
+	char magic[4];
+	uint32_t version;
+	if (!in.read(magic, 4) || memcmp(magic, "TLOG", 4) != 0
+		|| !in.read(reinterpret_cast<char*>(&version), 4) || version != BINARY_VERSION)
+		return false;
+
+	struct decoded_site
+	{
+		uint8_t lvl;
+		int32_t line;
+		std::string file;
+		std::string fmt;
+	};
+	std::vector<decoded_site> decoded;
+	std::vector<uint8_t> args;
+
+	auto readString = [&in](std::string& s) {
+		uint16_t n;
+		if (!in.read(reinterpret_cast<char*>(&n), 2))
+			return false;
+		s.resize(n);
+		return n == 0 || (bool)in.read(&s[0], n);
+	};
+
+	uint8_t kind;
+	while (in.read(reinterpret_cast<char*>(&kind), 1))
+	{
+		uint32_t id;
+		if (!in.read(reinterpret_cast<char*>(&id), 4))
+			return false;
+
+		if (kind == ENTRY_SITE)
+		{
+			if (decoded.size() <= id)
+				decoded.resize(id + 1);
+			decoded_site& s = decoded[id];
+			if (!in.read(reinterpret_cast<char*>(&s.lvl), 1)
+				|| !in.read(reinterpret_cast<char*>(&s.line), 4)
+				|| !readString(s.file) || !readString(s.fmt))
+				return false;
+		}
+		else if (kind == ENTRY_RECORD)
+		{
+			uint64_t time;
+			uint32_t len;
+			if (!in.read(reinterpret_cast<char*>(&time), 8)
+				|| !in.read(reinterpret_cast<char*>(&len), 4))
+				return false;
+			args.resize(len);
+			if (len && !in.read(reinterpret_cast<char*>(args.data()), len))
+				return false;
+			if (id >= decoded.size())
+				return false;
+			const decoded_site& s = decoded[id];
+			out << time << " [" << LEVELS[std::min<int>(s.lvl, 4)] << ":" << s.file << ":L" << s.line << "] "
+				<< format(s.fmt.c_str(), args.data(), args.size()) << "\n";
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
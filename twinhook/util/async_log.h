@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+
+/**
+ * \brief Asynchronous logging with deferred formatting.
+ *
+ * Call sites are registered once (see TH_LOG) and log records only carry the
+ * site's id, a timestamp and the raw argument bytes. Each thread appends its
+ * records to its own lock-free single-producer ring buffer, so logging never
+ * takes a lock or makes a system call on the calling thread. A background
+ * thread drains the rings and either formats records for a text sink (e.g.
+ * OutputDebugString), or writes them verbatim to a binary file which decode()
+ * turns back into text.
+ *
+ * Records which do not fit into a full ring are dropped and counted, rather
+ * than blocking the caller.
+ *
+ * Format strings use "{}" placeholders, optionally with a fixed precision for
+ * floating point arguments ("{:.2f}"); "{{" and "}}" are literal braces.
+ */
+namespace th_log
+{
+	enum level : uint8_t
+	{
+		Trace,
+		Debug,
+		Info,
+		Warn,
+		Error
+	};
+
+	/**
+	 * \brief A logging call site, with static storage duration
+	 */
+	struct site
+	{
+		level lvl;
+		const char* fmt;
+		const char* file;
+		int line;
+		uint32_t id;
+	};
+
+	// Type tags of encoded arguments
+	enum arg_type : uint8_t
+	{
+		ArgInt = 1,		// int64_t
+		ArgUInt,		// uint64_t
+		ArgDouble,		// double
+		ArgBool,		// uint64_t, 0 or 1
+		ArgString		// uint16_t length, then the characters
+	};
+
+	// Bytes of string arguments beyond this are cut off
+	static const size_t MAX_STRING_ARG = 256;
+	// Size of the ring buffer of each thread, a power of two
+	static const size_t RING_SIZE = 1 << 16;
+
+	/**
+	 * \brief String argument which is not null terminated, e.g. a string view
+	 */
+	struct str
+	{
+		const char* data;
+		size_t size;
+	};
+
+	/**
+	 * \brief Register a call site, assigning its id
+	 * \return The site
+	 */
+	site makeSite(level lvl, const char* fmt, const char* file, int line);
+
+	/**
+	 * \brief Start the background thread, formatting records for a text sink
+	 * \param sink Receives the call site and formatted message of every record
+	 */
+	void start(std::function<void(const site&, const std::string&)> sink);
+
+	/**
+	 * \brief Start the background thread, writing records to a binary file
+	 * \param filename File to write
+	 * \return Whether the file could be opened
+	 */
+	bool startBinary(const std::string& filename);
+
+	/**
+	 * \brief Drain all rings and stop the background thread
+	 */
+	void stop();
+
+	/**
+	 * \brief Number of records dropped because a ring was full
+	 */
+	uint64_t dropped();
+
+	/**
+	 * \brief Convert a binary log written by startBinary() to text
+	 * \param in Binary log
+	 * \param out One formatted line per record
+	 * \return Whether the log was well formed
+	 */
+	bool decode(std::istream& in, std::ostream& out);
+
+	/**
+	 * \brief Format a record's arguments
+	 * \param fmt Format string
+	 * \param args Encoded arguments
+	 * \param len Size of the encoded arguments
+	 * \return The formatted message
+	 */
+	std::string format(const char* fmt, const uint8_t* args, size_t len);
+
+	namespace detail
+	{
+		// Encoded size of an argument
+		template<typename T>
+		inline typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type
+			argSize(const T&) { return 1 + 8; }
+		inline size_t argSize(const char* s) { return 1 + 2 + std::min(strlen(s), MAX_STRING_ARG); }
+		inline size_t argSize(const std::string& s) { return 1 + 2 + std::min(s.size(), MAX_STRING_ARG); }
+		inline size_t argSize(const str& s) { return 1 + 2 + std::min(s.size, MAX_STRING_ARG); }
+
+		inline uint8_t* putString(uint8_t* p, const char* s, size_t n)
+		{
+			const uint16_t len = (uint16_t)std::min(n, MAX_STRING_ARG);
+			*p++ = ArgString;
+			memcpy(p, &len, 2);
+			memcpy(p + 2, s, len);
+			return p + 2 + len;
+		}
+
+		// Encode an argument, returning the end of its bytes
+		template<typename T>
+		inline typename std::enable_if<std::is_arithmetic<T>::value, uint8_t*>::type
+			put(uint8_t* p, const T& v)
+		{
+			if (std::is_same<T, bool>::value)
+			{
+				*p++ = ArgBool;
+				const uint64_t b = v ? 1 : 0;
+				memcpy(p, &b, 8);
+			}
+			else if (std::is_floating_point<T>::value)
+			{
+				*p++ = ArgDouble;
+				const double d = (double)v;
+				memcpy(p, &d, 8);
+			}
+			else if (std::is_signed<T>::value)
+			{
+				*p++ = ArgInt;
+				const int64_t i = (int64_t)v;
+				memcpy(p, &i, 8);
+			}
+			else
+			{
+				*p++ = ArgUInt;
+				const uint64_t u = (uint64_t)v;
+				memcpy(p, &u, 8);
+			}
+			return p + 8;
+		}
+		inline uint8_t* put(uint8_t* p, const char* s) { return putString(p, s, strlen(s)); }
+		inline uint8_t* put(uint8_t* p, const std::string& s) { return putString(p, s.data(), s.size()); }
+		inline uint8_t* put(uint8_t* p, const str& s) { return putString(p, s.data, s.size); }
+
+		inline size_t totalSize() { return 0; }
+		template<typename T, typename... Rest>
+		inline size_t totalSize(const T& v, const Rest&... rest) { return argSize(v) + totalSize(rest...); }
+
+		inline uint8_t* putAll(uint8_t* p) { return p; }
+		template<typename T, typename... Rest>
+		inline uint8_t* putAll(uint8_t* p, const T& v, const Rest&... rest) { return putAll(put(p, v), rest...); }
+
+		/**
+		 * \brief Reserve space for a record in the calling thread's ring
+		 * \param argBytes Size of the encoded arguments
+		 * \return Start of the argument bytes, or nullptr if the ring is full
+		 */
+		uint8_t* begin(const site& s, size_t argBytes);
+
+		/**
+		 * \brief Publish the record reserved by the last begin()
+		 */
+		void commit();
+	}
+
+	/**
+	 * \brief Append a record to the calling thread's ring
+	 * \param s Call site
+	 * \param args Arithmetic or string arguments
+	 */
+	template<typename... Args>
+	inline void write(const site& s, const Args&... args)
+	{
+		uint8_t* p = detail::begin(s, detail::totalSize(args...));
+		if (!p)
+			return;
+		detail::putAll(p, args...);
+		detail::commit();
+	}
+}
+
+#define TH_LOG(lvl, fmt, ...) do { \
+		static const th_log::site th_log_site_ = th_log::makeSite(lvl, fmt, __FILE__, __LINE__); \
+		th_log::write(th_log_site_, ##__VA_ARGS__); \
+	} while (0)
+
+#define TH_LOG_DEBUG(fmt, ...) TH_LOG(th_log::Debug, fmt, ##__VA_ARGS__)
+#define TH_LOG_INFO(fmt, ...) TH_LOG(th_log::Info, fmt, ##__VA_ARGS__)
+#define TH_LOG_WARN(fmt, ...) TH_LOG(th_log::Warn, fmt, ##__VA_ARGS__)
+#define TH_LOG_ERROR(fmt, ...) TH_LOG(th_log::Error, fmt, ##__VA_ARGS__)
@@ -0,0 +1,201 @@
+#include "counters.h"
+
+#ifdef TH_COUNTERS
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <imgui.h>
+
+#include "util/async_file_writer.h"
+
+namespace
+{
+	const uint32_t BINARY_MAGIC = 0x54434854;	// "THCT"
+	const uint32_t BINARY_VERSION = 1;
+
+	const char* const COUNTER_NAMES[th_counters::CounterCount] = {
+		"predict_aabb",
+		"predict_circle",
+		"predict_sat",
+		"predict_rotor",
+		"predict_chain",
+		"predict_batch",
+		"already_colliding",
+		"obstacles",
+		"obstacles_culled",
+		"obstacles_overlapping",
+		"obstacles_clustered",
+		"clusters_expanded",
+		"powerups",
+		"powerups_collectable",
+		"route_hits",
+		"route_rejected",
+		"polled_bullets",
+		"polled_enemies",
+		"polled_powerups",
+		"polled_lasers",
+		"poll_slots_read",
+		"poll_slots_skipped",
+		"hooked_bullets",
+		"hooked_powerups",
+		"hooked_dropped",
+	};
+
+	const char* const GAUGE_NAMES[th_counters::GaugeCount] = {
+		"chosen_margin",
+	};
+
+	// Blocks are never freed, so counts of exited threads are kept in the totals
+	std::mutex registryMtx;
+	std::vector<std::unique_ptr<th_counters::detail::slot_block>> blocks;
+
+	uint64_t previous[th_counters::CounterCount];
+	float gauges[th_counters::GaugeCount];
+	th_counters::frame lastFrame;
+
+	async_file_writer exportFile;
+	bool exportBinary = false;
+
+	void writeString(const char* s)
+	{
+		const uint16_t len = (uint16_t)strlen(s);
+		exportFile.write(&len, sizeof(len));
+		exportFile.write(s, len);
+	}
+
+	void writeHeader()
+	{
+		if (exportBinary)
+		{
+			const uint32_t header[] = { BINARY_MAGIC, BINARY_VERSION,
+				th_counters::CounterCount, th_counters::GaugeCount };
+			exportFile.write(header, sizeof(header));
+			for (const char* n : COUNTER_NAMES)
+				writeString(n);
+			for (const char* n : GAUGE_NAMES)
+				writeString(n);
+			return;
+		}
+
+		std::string line = "tick";
+		for (const char* n : COUNTER_NAMES)
+			line += std::string(",") + n;
+		for (const char* n : GAUGE_NAMES)
+			line += std::string(",") + n;
+		line += "\n";
+		exportFile.write(line.data(), line.size());
+	}
+
+	void writeFrame(const th_counters::frame& f)
+	{
+		if (exportBinary)
+		{
+			exportFile.write(&f, sizeof(f));
+			return;
+		}
+
+		char buf[32];
+		std::string line = std::to_string(f.gameTick);
+		for (uint64_t c : f.counts)
+			line += "," + std::to_string(c);
+		for (float g : f.gauges)
+		{
+			snprintf(buf, sizeof(buf), ",%g", g);
+			line += buf;
+		}
+		line += "\n";
+		exportFile.write(line.data(), line.size());
+	}
+}
+
+thread_local th_counters::detail::slot_block* th_counters::detail::localSlots = nullptr;
+
+th_counters::detail::slot_block* th_counters::detail::registerThread()
+{
+	auto block = std::make_unique<slot_block>();
+	for (auto& c : block->counts)
+		c.store(0, std::memory_order_relaxed);
+	localSlots = block.get();
+
+	std::lock_guard<std::mutex> lock(registryMtx);
+	blocks.push_back(std::move(block));
+	return localSlots;
+}
+
+void th_counters::set(gauge g, float v)
+{
+	gauges[g] = v;
+}
+
+void th_counters::endFrame(uint32_t gameTick)
+{
+	uint64_t totals[CounterCount] = {};
+	{
+		std::lock_guard<std::mutex> lock(registryMtx);
+		for (const auto& b : blocks)
+		{
+			for (int i = 0; i < CounterCount; ++i)
+				totals[i] += b->counts[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	lastFrame.gameTick = gameTick;
+	lastFrame.reserved = 0;
+	for (int i = 0; i < CounterCount; ++i)
+	{
+		lastFrame.counts[i] = totals[i] - previous[i];
+		previous[i] = totals[i];
+	}
+	for (int i = 0; i < GaugeCount; ++i)
+		lastFrame.gauges[i] = gauges[i];
+
+	if (exportFile.isOpen())
+		writeFrame(lastFrame);
+}
+
+const th_counters::frame& th_counters::last()
+{
+	return lastFrame;
+}
+
+bool th_counters::startExport(const std::string& filename, bool binary)
+{
+	if (!exportFile.open(filename))
+		return false;
+	exportBinary = binary;
+	writeHeader();
+	return true;
+}
+
+void th_counters::stopExport()
+{
+	exportFile.close();
+}
+
+const char* th_counters::name(counter c)
+{
+	return COUNTER_NAMES[c];
+}
+
+const char* th_counters::name(gauge g)
+{
+	return GAUGE_NAMES[g];
+}
+
+void th_counters::render()
+{
+	using namespace ImGui;
+	if (!CollapsingHeader("Counters"))
+		return;
+
+	for (int i = 0; i < CounterCount; ++i)
+		Text("%s: %llu", COUNTER_NAMES[i], (unsigned long long)lastFrame.counts[i]);
+	for (int i = 0; i < GaugeCount; ++i)
+		Text("%s: %.1f", GAUGE_NAMES[i], lastFrame.gauges[i]);
+}
+
+#endif
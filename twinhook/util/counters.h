@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Per-frame counters of the work done by the algorithms, e.g. how many
+ * collision predictions of each shape pair were made.
+ *
+ * Every thread increments its own block of counter slots, without atomic
+ * read-modify-write operations or locks. At the end of each frame, endFrame()
+ * sums the blocks of all threads (including shadow evaluation) and keeps the
+ * difference to the previous frame, which is shown in the overlay and
+ * optionally exported to a CSV or binary file.
+ *
+ * Counters only exist if TH_COUNTERS is defined; otherwise the TH_COUNT macros
+ * expand to nothing and the frame functions are empty.
+ */
+namespace th_counters
+{
+	enum counter : uint8_t
+	{
+		PredictAabb,		// vec2::willCollideAABB
+		PredictCircle,		// vec2::willCollideCircle
+		PredictSat,			// vec2::willCollideSAT
+		PredictRotor,		// obb::timeOfImpact of rotating lasers
+		PredictChain,		// capsule_chain::sweep
+		PredictBatch,		// shapes predicted by the kernels batch predictors
+		AlreadyColliding,	// predictions which returned 0
+		Obstacles,			// dangers given to th_vo_algo's velocity obstacle field
+		ObstaclesCulled,	// of those, out of reach within the horizon
+		ObstaclesOverlapping,	// of those, already overlapping the player
+		ObstaclesClustered,	// of those, far away and merged into clusters
+		ClustersExpanded,	// clusters whose members were predicted one by one
+		Powerups,			// powerups given to target_field::build
+		PowerupsCollectable,	// of those, worth collecting
+		RouteHits,			// route book routes followed by th_vo_algo
+		RouteRejected,		// route book routes which failed validation
+		PolledBullets,
+		PolledEnemies,
+		PolledPowerups,
+		PolledLasers,
+		PollSlotsRead,		// object pool slots read by slot_tracker
+		PollSlotsSkipped,	// of the pools' slots, those not read
+		HookedBullets,
+		HookedPowerups,
+		HookedDropped,		// hooked objects beyond the capacity of their record_buffer
+
+		CounterCount
+	};
+
+	enum gauge : uint8_t
+	{
+		ChosenMargin,		// frames until collision of the applied decision
+
+		GaugeCount
+	};
+
+	/**
+	 * \brief Counters of one frame
+	 */
+	struct frame
+	{
+		uint32_t gameTick;
+		uint32_t reserved;
+		uint64_t counts[CounterCount];
+		float gauges[GaugeCount];
+	};
+
+#ifdef TH_COUNTERS
+	namespace detail
+	{
+		struct slot_block
+		{
+			// Only written by the owning thread, atomic so endFrame() may read them
+			std::atomic<uint64_t> counts[CounterCount];
+		};
+
+		extern thread_local slot_block* localSlots;
+
+		/**
+		 * \brief Allocate and register the calling thread's slots
+		 */
+		slot_block* registerThread();
+	}
+
+	inline void add(counter c, uint64_t n)
+	{
+		detail::slot_block* s = detail::localSlots;
+		if (!s)
+			s = detail::registerThread();
+		std::atomic<uint64_t>& slot = s->counts[c];
+		slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief Set a gauge. Only called from the game thread.
+	 */
+	void set(gauge g, float v);
+
+	/**
+	 * \brief Collect the counters of the frame which just ended, and export them
+	 * \param gameTick Game tick of the frame
+	 */
+	void endFrame(uint32_t gameTick);
+
+	/**
+	 * \brief Counters of the last frame
+	 */
+	const frame& last();
+
+	/**
+	 * \brief Export every frame to a file
+	 * \param filename File to write
+	 * \param binary Whether to write frame structs rather than CSV
+	 * \return Whether the file could be opened
+	 */
+	bool startExport(const std::string& filename, bool binary);
+
+	/**
+	 * \brief Flush and close the export file
+	 */
+	void stopExport();
+
+	const char* name(counter c);
+	const char* name(gauge g);
+
+	/**
+	 * \brief Show the counters of the last frame in the current ImGui window
+	 */
+	void render();
+#else
+	inline void set(gauge, float) {}
+	inline void endFrame(uint32_t) {}
+	inline bool startExport(const std::string&, bool) { return false; }
+	inline void stopExport() {}
+	inline void render() {}
+#endif
+}
+
+#ifdef TH_COUNTERS
+#define TH_COUNT_N(c, n) th_counters::add(th_counters::c, (n))
+#define TH_GAUGE(g, v) th_counters::set(th_counters::g, (v))
+#else
+#define TH_COUNT_N(c, n) ((void)0)
+#define TH_GAUGE(g, v) ((void)0)
+#endif
+
+#define TH_COUNT(c) TH_COUNT_N(c, 1)
@@ -0,0 +1,332 @@
+#include "util/kernels.h"
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "util/counters.h"
+#include "util/simd.h"
+
+#ifdef TH_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace kernels
+{
+	namespace detail
+	{
+#ifdef TH_SSE2
+		// Defined in kernels_x86.cpp
+		extern const table SSE41_TABLE;
+		extern const table AVX2_TABLE;
+		extern const table AVX512_TABLE;
+#endif
+	}
+}
+
+namespace
+{
+	const char* const NAMES[kernels::IsaCount] = { "scalar", "sse4.1", "avx2", "avx512" };
+	const char* const PREDICTOR_NAMES[kernels::PredictorCount] = { "continuous", "discrete" };
+
+	// Frames the discrete kernels are compared over by conformance()
+	const int CONFORMANCE_HORIZON = 64;
+
+	void scalarCircles(const vec2& center, float radius, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		for (size_t i = 0; i < c.size(); ++i)
+			out[i] = vec2::willCollideCircle(center, vec2(c.x[i], c.y[i]),
+				radius, c.w[i], velocity, vec2(c.vx[i], c.vy[i]));
+	}
+
+	void scalarBoxes(const vec2& position, const vec2& size, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		for (size_t i = 0; i < c.size(); ++i)
+			out[i] = vec2::willCollideAABB(position, vec2(c.x[i], c.y[i]),
+				size, vec2(c.w[i], c.h[i]), velocity, vec2(c.vx[i], c.vy[i]));
+	}
+
+	void scalarDiscreteCircles(const vec2& center, float radius, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		for (size_t i = 0; i < c.size(); ++i)
+			out[i] = vec2::willCollideCircleDiscrete(center, vec2(c.x[i], c.y[i]),
+				radius, c.w[i], velocity, vec2(c.vx[i], c.vy[i]), horizon);
+	}
+
+	void scalarDiscreteBoxes(const vec2& position, const vec2& size, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		for (size_t i = 0; i < c.size(); ++i)
+			out[i] = vec2::willCollideAABBDiscrete(position, vec2(c.x[i], c.y[i]),
+				size, vec2(c.w[i], c.h[i]), velocity, vec2(c.vx[i], c.vy[i]), horizon);
+	}
+
+	const kernels::table SCALAR_TABLE = { kernels::Scalar, scalarCircles, scalarBoxes,
+		scalarDiscreteCircles, scalarDiscreteBoxes };
+
+	const kernels::table* tableOf(kernels::isa level)
+	{
+		switch (level)
+		{
+		case kernels::Scalar: return &SCALAR_TABLE;
+#ifdef TH_SSE2
+		case kernels::SSE41: return &kernels::detail::SSE41_TABLE;
+		case kernels::AVX2: return &kernels::detail::AVX2_TABLE;
+		case kernels::AVX512: return &kernels::detail::AVX512_TABLE;
+#endif
+		default: return nullptr;
+		}
+	}
+
+	std::atomic<const kernels::table*> current{ nullptr };
+	std::atomic<kernels::predictor> currentPredictor{ kernels::Continuous };
+
+	int frames(float horizon)
+	{
+		// also for NaN, which fails both comparisons
+		if (!(horizon >= 0))
+			return -1;
+		return horizon < kernels::MAX_HORIZON ? (int)horizon : kernels::MAX_HORIZON;
+	}
+
+#ifdef TH_SSE2
+	void cpuid(int leaf, int subleaf, int regs[4])
+	{
+#ifdef _MSC_VER
+		__cpuidex(regs, leaf, subleaf);
+#else
+		unsigned a, b, c, d;
+		__cpuid_count(leaf, subleaf, a, b, c, d);
+		regs[0] = (int)a; regs[1] = (int)b; regs[2] = (int)c; regs[3] = (int)d;
+#endif
+	}
+
+	// Register state the OS saves on context switches
+	uint64_t xcr0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32_t lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return (uint64_t)hi << 32 | lo;
+#endif
+	}
+#endif
+}
+
+void kernels::columns::clear()
+{
+	x.clear(); y.clear();
+	w.clear(); h.clear();
+	vx.clear(); vy.clear();
+}
+
+void kernels::columns::addBox(const vec2& position, const vec2& size, const vec2& velocity)
+{
+	x.push_back(position.x); y.push_back(position.y);
+	w.push_back(size.x); h.push_back(size.y);
+	vx.push_back(velocity.x); vy.push_back(velocity.y);
+}
+
+void kernels::columns::addCircle(const vec2& center, float radius, const vec2& velocity)
+{
+	addBox(center, vec2(radius), velocity);
+}
+
+const char* kernels::name(isa level)
+{
+	return level < IsaCount ? NAMES[level] : "unknown";
+}
+
+const char* kernels::name(predictor p)
+{
+	return p < PredictorCount ? PREDICTOR_NAMES[p] : "unknown";
+}
+
+bool kernels::parse(const char* name, isa& level)
+{
+	for (int i = 0; i < IsaCount; ++i)
+	{
+		if (strcmp(name, NAMES[i]) == 0)
+		{
+			level = (isa)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool kernels::parse(const char* name, predictor& p)
+{
+	for (int i = 0; i < PredictorCount; ++i)
+	{
+		if (strcmp(name, PREDICTOR_NAMES[i]) == 0)
+		{
+			p = (predictor)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+kernels::isa kernels::detect()
+{
+#ifdef TH_SSE2
+	int regs[4];
+	cpuid(0, 0, regs);
+	const int maxLeaf = regs[0];
+
+	cpuid(1, 0, regs);
+	const bool sse41 = (regs[2] & (1 << 19)) != 0;
+	// AVX registers are only usable if the OS saves them, see OSXSAVE
+	const bool osxsave = (regs[2] & (1 << 27)) != 0;
+	const bool avx = (regs[2] & (1 << 28)) != 0;
+	if (!sse41)
+		return Scalar;
+	if (!avx || !osxsave || maxLeaf < 7)
+		return SSE41;
+
+	const uint64_t xcr = xcr0();
+	cpuid(7, 0, regs);
+	const bool avx2 = (regs[1] & (1 << 5)) != 0 && (xcr & 0x6) == 0x6;
+	// AVX-512 additionally needs the opmask and upper zmm state
+	const bool avx512 = (regs[1] & (1 << 16)) != 0 && (xcr & 0xE6) == 0xE6;
+	if (avx2 && avx512)
+		return AVX512;
+	return avx2 ? AVX2 : SSE41;
+#else
+	return Scalar;
+#endif
+}
+
+bool kernels::supported(isa level)
+{
+	static const isa best = detect();
+	return tableOf(level) && level <= best;
+}
+
+bool kernels::select(isa level)
+{
+	if (!supported(level))
+		return false;
+	current.store(tableOf(level));
+	return true;
+}
+
+const kernels::table& kernels::active()
+{
+	const table* t = current.load(std::memory_order_relaxed);
+	if (!t)
+	{
+		select(detect());
+		t = current.load();
+	}
+	return *t;
+}
+
+const kernels::table* kernels::variant(isa level)
+{
+	return supported(level) ? tableOf(level) : nullptr;
+}
+
+void kernels::usePredictor(predictor p)
+{
+	currentPredictor.store(p);
+}
+
+kernels::predictor kernels::activePredictor()
+{
+	return currentPredictor.load(std::memory_order_relaxed);
+}
+
+size_t kernels::conformance(isa level, uint64_t seed, size_t count)
+{
+	const table* t = variant(level);
+	if (!t)
+		return count * 4;
+
+	// splitmix64, coarse values so shapes touch and velocities coincide often
+	uint64_t state = seed;
+	auto random = [&state](int steps, float step)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		return (float)((int)(z % (2 * steps + 1)) - steps) * step;
+	};
+
+	const vec2 center(random(8, 4.f), random(8, 4.f));
+	const vec2 size(random(4, 2.f) + 8.f, random(4, 2.f) + 8.f);
+	const vec2 velocity(random(2, 1.f), random(2, 1.f));
+
+	columns c;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const vec2 v = i % 7 == 0 ? velocity : vec2(random(6, .5f), random(6, .5f));
+		c.addBox(vec2(random(32, 2.f), random(32, 2.f)),
+			vec2(random(4, 2.f) + 8.f, random(4, 2.f) + 8.f), v);
+	}
+
+	std::vector<float> expected(count), actual(count);
+	size_t mismatches = 0;
+	auto compare = [&]()
+	{
+		for (size_t i = 0; i < count; ++i)
+			mismatches += memcmp(&expected[i], &actual[i], sizeof(float)) != 0;
+	};
+
+	SCALAR_TABLE.circles(center, size.x, velocity, c, expected.data());
+	t->circles(center, size.x, velocity, c, actual.data());
+	compare();
+	SCALAR_TABLE.boxes(center, size, velocity, c, expected.data());
+	t->boxes(center, size, velocity, c, actual.data());
+	compare();
+	SCALAR_TABLE.discreteCircles(center, size.x, velocity, CONFORMANCE_HORIZON, c, expected.data());
+	t->discreteCircles(center, size.x, velocity, CONFORMANCE_HORIZON, c, actual.data());
+	compare();
+	SCALAR_TABLE.discreteBoxes(center, size, velocity, CONFORMANCE_HORIZON, c, expected.data());
+	t->discreteBoxes(center, size, velocity, CONFORMANCE_HORIZON, c, actual.data());
+	compare();
+	return mismatches;
+}
+
+void kernels::circles(const vec2& center, float radius, const vec2& velocity,
+	const columns& c, float* out, float horizon, predictor p)
+{
+	TH_COUNT_N(PredictBatch, c.size());
+	if (p == Discrete)
+		active().discreteCircles(center, radius, velocity, frames(horizon), c, out);
+	else
+		active().circles(center, radius, velocity, c, out);
+}
+
+void kernels::boxes(const vec2& position, const vec2& size, const vec2& velocity,
+	const columns& c, float* out, float horizon, predictor p)
+{
+	TH_COUNT_N(PredictBatch, c.size());
+	if (p == Discrete)
+		active().discreteBoxes(position, size, velocity, frames(horizon), c, out);
+	else
+		active().boxes(position, size, velocity, c, out);
+}
+
+float kernels::earliest(const float* times, size_t count)
+{
+	float min = FLT_MAX;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (times[i] >= 0 && times[i] < min)
+			min = times[i];
+	}
+	return min == FLT_MAX ? -1.f : min;
+}
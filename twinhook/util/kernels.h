@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "util/vec2.h"
+
+/**
+ * \brief Collision predictors over many shapes at once, compiled for several
+ * instruction sets and selected at runtime.
+ *
+ * Every kernel comes in two predictors: the continuous one computes the time
+ * of impact like vec2::willCollideAABB, the discrete one tests the shapes at
+ * whole frames up to a horizon like the games do, and stops as soon as every
+ * shape of a vector collided or moved apart. The discrete predictor needs no
+ * divisions or square roots and does not report grazes between two frames,
+ * which the game would never register; it is only faster for horizons of a few
+ * frames, as a vector waits for its slowest shape (see thoracle's throughput).
+ *
+ * The shapes are kept in columns (structure of arrays), so a kernel predicts 4
+ * (SSE4.1), 8 (AVX2) or 16 (AVX-512) shapes per instruction. Every kernel
+ * returns exactly what the scalar vec2 predictor returns for each shape: the
+ * vector code performs the same IEEE operations in the same order, and shapes
+ * which do not fill a vector are given to the vec2 predictor itself.
+ *
+ * The best instruction set the CPU and OS support is selected on first use.
+ * select() forces another one for the whole process, e.g. for benchmarks, and
+ * conformance() compares a kernel table against the scalar one.
+ */
+namespace kernels
+{
+	enum isa : uint8_t
+	{
+		Scalar,
+		SSE41,
+		AVX2,
+		AVX512,
+
+		IsaCount
+	};
+
+	enum predictor : uint8_t
+	{
+		Continuous,	// time of impact, see vec2::willCollideAABB
+		Discrete,	// first whole frame, see vec2::willCollideAABBDiscrete
+
+		PredictorCount
+	};
+
+	// Frames the discrete predictor tests at most, as far as vec2 predicts
+	const int MAX_HORIZON = 6000;
+
+	/**
+	 * \brief Moving shapes, one column per coordinate
+	 */
+	struct columns
+	{
+		// Position of boxes, or center of circles
+		std::vector<float> x, y;
+		// Size of boxes, or radius of circles in both
+		std::vector<float> w, h;
+		std::vector<float> vx, vy;
+
+		void clear();
+		size_t size() const { return x.size(); }
+
+		void addBox(const vec2& position, const vec2& size, const vec2& velocity);
+		void addCircle(const vec2& center, float radius, const vec2& velocity);
+	};
+
+	/**
+	 * \brief One variant of every kernel. A kernel writes the frames until a
+	 * moving shape collides with each of the columns to out, which holds
+	 * columns::size() floats.
+	 */
+	struct table
+	{
+		isa level;
+		// As vec2::willCollideCircle, with the circle first
+		void (*circles)(const vec2& center, float radius, const vec2& velocity,
+			const columns& c, float* out);
+		// As vec2::willCollideAABB, with the box first
+		void (*boxes)(const vec2& position, const vec2& size, const vec2& velocity,
+			const columns& c, float* out);
+		// As vec2::willCollideCircleDiscrete, with the circle first
+		void (*discreteCircles)(const vec2& center, float radius, const vec2& velocity,
+			int horizon, const columns& c, float* out);
+		// As vec2::willCollideAABBDiscrete, with the box first
+		void (*discreteBoxes)(const vec2& position, const vec2& size, const vec2& velocity,
+			int horizon, const columns& c, float* out);
+	};
+
+	const char* name(isa level);
+	const char* name(predictor p);
+
+	/**
+	 * \brief Find an instruction set by name
+	 * \param name As returned by name(), case sensitive
+	 * \param level Set to the instruction set if found
+	 * \return Whether the name is known
+	 */
+	bool parse(const char* name, isa& level);
+	bool parse(const char* name, predictor& p);
+
+	/**
+	 * \brief Query the CPU and OS
+	 * \return The best instruction set with kernels which can run
+	 */
+	isa detect();
+
+	bool supported(isa level);
+
+	/**
+	 * \brief Use the kernels of an instruction set from now on
+	 * \param level Instruction set, which must be supported
+	 * \return Whether the kernels were selected
+	 */
+	bool select(isa level);
+
+	// The selected kernels
+	const table& active();
+
+	// Kernels of an instruction set, or nullptr if it is not supported
+	const table* variant(isa level);
+
+	// Predict with the continuous or the discrete kernels from now on
+	void usePredictor(predictor p);
+
+	// The predictor of the active kernels, continuous unless chosen otherwise
+	predictor activePredictor();
+
+	/**
+	 * \brief Run the kernels of an instruction set and the scalar kernels on
+	 * random shapes, including touching, resting and parallel ones
+	 * \param level Supported instruction set to check
+	 * \param seed Seed of the shapes
+	 * \param count Number of shapes per kernel
+	 * \return Number of shapes whose results are not bitwise equal, over the
+	 * continuous and the discrete kernels
+	 */
+	size_t conformance(isa level, uint64_t seed, size_t count);
+
+	// Kernels of the active table, counted as batch predictions. The discrete
+	// predictor tests the frames up to horizon, the continuous one may predict
+	// collisions after it.
+
+	void circles(const vec2& center, float radius, const vec2& velocity,
+		const columns& c, float* out, float horizon, predictor p = activePredictor());
+	void boxes(const vec2& position, const vec2& size, const vec2& velocity,
+		const columns& c, float* out, float horizon, predictor p = activePredictor());
+
+	/**
+	 * \brief Earliest collision of a kernel's output
+	 * \param times Output of a kernel
+	 * \param count Number of times
+	 * \return The smallest time >= 0, or -1 if there is none
+	 */
+	float earliest(const float* times, size_t count);
+}
@@ -0,0 +1,687 @@
+#include "util/kernels.h"
+
+#include <cmath>
+
+#include "util/simd.h"
+
+/*
+ * Vector variants of the kernels. Each performs the operations of its vec2
+ * predictor in the same order, lane by lane, so the results are bitwise equal:
+ * negation flips the sign bit like the scalar unary minus, and the branches of
+ * the predictor become comparisons whose masks blend the candidate results.
+ * Shapes which do not fill a vector are predicted by vec2.
+ *
+ * Functions (and their lambdas) are compiled for their instruction set with
+ * TH_TARGET and must not call inline functions, whose single definition might
+ * be taken from here.
+ */
+#ifdef TH_SSE2
+#include <immintrin.h>
+
+// GCC would fuse multiplies and adds once AVX-512 implies FMA, rounding once
+// where vec2 rounds twice. MSVC never fuses intrinsics.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace
+{
+	void scalarCircles(const vec2& center, float radius, const vec2& velocity,
+		const kernels::columns& c, size_t begin, float* out)
+	{
+		for (size_t i = begin; i < c.size(); ++i)
+			out[i] = vec2::willCollideCircle(center, vec2(c.x[i], c.y[i]),
+				radius, c.w[i], velocity, vec2(c.vx[i], c.vy[i]));
+	}
+
+	void scalarBoxes(const vec2& position, const vec2& size, const vec2& velocity,
+		const kernels::columns& c, size_t begin, float* out)
+	{
+		for (size_t i = begin; i < c.size(); ++i)
+			out[i] = vec2::willCollideAABB(position, vec2(c.x[i], c.y[i]),
+				size, vec2(c.w[i], c.h[i]), velocity, vec2(c.vx[i], c.vy[i]));
+	}
+
+	void scalarDiscreteCircles(const vec2& center, float radius, const vec2& velocity,
+		int horizon, const kernels::columns& c, size_t begin, float* out)
+	{
+		for (size_t i = begin; i < c.size(); ++i)
+			out[i] = vec2::willCollideCircleDiscrete(center, vec2(c.x[i], c.y[i]),
+				radius, c.w[i], velocity, vec2(c.vx[i], c.vy[i]), horizon);
+	}
+
+	void scalarDiscreteBoxes(const vec2& position, const vec2& size, const vec2& velocity,
+		int horizon, const kernels::columns& c, size_t begin, float* out)
+	{
+		for (size_t i = begin; i < c.size(); ++i)
+			out[i] = vec2::willCollideAABBDiscrete(position, vec2(c.x[i], c.y[i]),
+				size, vec2(c.w[i], c.h[i]), velocity, vec2(c.vx[i], c.vy[i]), horizon);
+	}
+
+	// See the discrete kernels below
+	float roundingMargin(int horizon)
+	{
+		return (float)(horizon + 8) / 4194304.f;
+	}
+
+	/* SSE4.1, 4 shapes per vector */
+
+	TH_TARGET("sse4.1")
+	void sse41Circles(const vec2& center, float radius, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)3;
+		const __m128 px = _mm_set1_ps(center.x), py = _mm_set1_ps(center.y);
+		const __m128 pvx = _mm_set1_ps(velocity.x), pvy = _mm_set1_ps(velocity.y);
+		const __m128 r1 = _mm_set1_ps(radius);
+		const __m128 sign = _mm_set1_ps(-0.f), zero = _mm_setzero_ps(), none = _mm_set1_ps(-1.f);
+		const __m128 two = _mm_set1_ps(2.f), four = _mm_set1_ps(4.f);
+		for (size_t i = 0; i < end; i += 4)
+		{
+			const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&c.x[i]), px);
+			const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&c.y[i]), py);
+			const __m128 dvx = _mm_sub_ps(_mm_loadu_ps(&c.vx[i]), pvx);
+			const __m128 dvy = _mm_sub_ps(_mm_loadu_ps(&c.vy[i]), pvy);
+			const __m128 r = _mm_add_ps(r1, _mm_loadu_ps(&c.w[i]));
+			const __m128 rr = _mm_mul_ps(r, r);
+			const __m128 dd = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+			const __m128 a = _mm_add_ps(_mm_mul_ps(dvx, dvx), _mm_mul_ps(dvy, dvy));
+			const __m128 b = _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(dx, dvx), _mm_mul_ps(dy, dvy)));
+			const __m128 k = _mm_sub_ps(dd, rr);
+			const __m128 d = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_mul_ps(four, a), k));
+			const __m128 nb = _mm_xor_ps(b, sign);
+
+			// the smaller root, or the root of the linear equation if a == 0
+			__m128 t = _mm_div_ps(_mm_sub_ps(nb, _mm_sqrt_ps(d)), _mm_mul_ps(two, a));
+			t = _mm_blendv_ps(t, none, _mm_cmplt_ps(d, zero));
+			const __m128 linear = _mm_blendv_ps(_mm_div_ps(_mm_xor_ps(k, sign), b), none,
+				_mm_cmpeq_ps(b, zero));
+			t = _mm_blendv_ps(t, linear, _mm_cmpeq_ps(a, zero));
+			t = _mm_blendv_ps(t, zero, _mm_cmple_ps(dd, rr));
+			_mm_storeu_ps(out + i, t);
+		}
+		scalarCircles(center, radius, velocity, c, end, out);
+	}
+
+	TH_TARGET("sse4.1")
+	void sse41Boxes(const vec2& position, const vec2& size, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)3;
+		const __m128 px = _mm_set1_ps(position.x), py = _mm_set1_ps(position.y);
+		const __m128 sx = _mm_set1_ps(size.x), sy = _mm_set1_ps(size.y);
+		const __m128 pvx = _mm_set1_ps(velocity.x), pvy = _mm_set1_ps(velocity.y);
+		const __m128 zero = _mm_setzero_ps(), none = _mm_set1_ps(-1.f);
+		const __m128 inf = _mm_set1_ps(INFINITY), limit = _mm_set1_ps(6000.f);
+		for (size_t i = 0; i < end; i += 4)
+		{
+			const __m128 qx = _mm_loadu_ps(&c.x[i]), qy = _mm_loadu_ps(&c.y[i]);
+			const __m128 qw = _mm_loadu_ps(&c.w[i]), qh = _mm_loadu_ps(&c.h[i]);
+			const __m128 qvx = _mm_loadu_ps(&c.vx[i]), qvy = _mm_loadu_ps(&c.vy[i]);
+			const __m128 dvx = _mm_sub_ps(qvx, pvx), dvy = _mm_sub_ps(qvy, pvy);
+			const __m128 dx = _mm_sub_ps(px, qx), dy = _mm_sub_ps(py, qy);
+
+			// vec2::isCollideAABB of the boxes at some positions
+			auto overlap = [&](__m128 ax, __m128 ay, __m128 bx, __m128 by) TH_TARGET("sse4.1")
+			{
+				return _mm_and_ps(
+					_mm_and_ps(_mm_cmple_ps(ax, _mm_add_ps(bx, qw)), _mm_cmpge_ps(_mm_add_ps(ax, sx), bx)),
+					_mm_and_ps(_mm_cmple_ps(ay, _mm_add_ps(by, qh)), _mm_cmpge_ps(_mm_add_ps(sy, ay), by)));
+			};
+			// the earliest time a side touches and the boxes overlap
+			__m128 min = inf;
+			auto side = [&](__m128 t) TH_TARGET("sse4.1")
+			{
+				const __m128 hit = _mm_and_ps(_mm_cmpge_ps(t, zero), overlap(
+					_mm_add_ps(px, _mm_mul_ps(pvx, t)), _mm_add_ps(py, _mm_mul_ps(pvy, t)),
+					_mm_add_ps(qx, _mm_mul_ps(qvx, t)), _mm_add_ps(qy, _mm_mul_ps(qvy, t))));
+				min = _mm_min_ps(min, _mm_blendv_ps(inf, t, hit));
+			};
+			side(_mm_div_ps(_mm_sub_ps(dx, qw), dvx));
+			side(_mm_div_ps(_mm_add_ps(dx, sx), dvx));
+			side(_mm_div_ps(_mm_sub_ps(dy, qh), dvy));
+			side(_mm_div_ps(_mm_add_ps(dy, sy), dvy));
+
+			__m128 t = _mm_blendv_ps(none, min, _mm_cmplt_ps(min, limit));
+			t = _mm_blendv_ps(t, zero, overlap(px, py, qx, qy));
+			_mm_storeu_ps(out + i, t);
+		}
+		scalarBoxes(position, size, velocity, c, end, out);
+	}
+
+	/*
+	 * The discrete kernels advance the distances of a vector of shapes frame by
+	 * frame and keep the first frame of every shape which overlaps. A shape is
+	 * no longer pending once it overlapped or moves apart on an axis, see vec2,
+	 * and a vector is done once no shape of it is pending.
+	 *
+	 * Shapes which are too far apart on an axis to meet within the horizon are
+	 * not pending to begin with. Each frame's sum rounds by at most 2^-24 of the
+	 * largest distance on the way, so the gap must exceed the distance covered
+	 * by a margin of (horizon + 8) * 2^-22 of that extent, which also covers the
+	 * rounding of the test itself. vec2 runs every frame, so the conformance
+	 * tests compare this shortcut against the plain loop.
+	 */
+
+	TH_TARGET("sse4.1")
+	void sse41DiscreteCircles(const vec2& center, float radius, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)3;
+		const __m128 px = _mm_set1_ps(center.x), py = _mm_set1_ps(center.y);
+		const __m128 pvx = _mm_set1_ps(velocity.x), pvy = _mm_set1_ps(velocity.y);
+		const __m128 r1 = _mm_set1_ps(radius);
+		const __m128 sign = _mm_set1_ps(-0.f), zero = _mm_setzero_ps(), none = _mm_set1_ps(-1.f), one = _mm_set1_ps(1.f);
+		const __m128 frames = _mm_set1_ps((float)horizon), margin = _mm_set1_ps(roundingMargin(horizon));
+		for (size_t i = 0; i < end; i += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(&c.x[i]), px);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(&c.y[i]), py);
+			const __m128 dvx = _mm_sub_ps(_mm_loadu_ps(&c.vx[i]), pvx);
+			const __m128 dvy = _mm_sub_ps(_mm_loadu_ps(&c.vy[i]), pvy);
+			const __m128 r = _mm_add_ps(r1, _mm_loadu_ps(&c.w[i]));
+			const __m128 rr = _mm_mul_ps(r, r);
+			const __m128 right = _mm_cmpge_ps(dvx, zero), left = _mm_cmple_ps(dvx, zero);
+			const __m128 down = _mm_cmpge_ps(dvy, zero), up = _mm_cmple_ps(dvy, zero);
+
+			const __m128 reachX = _mm_mul_ps(frames, _mm_andnot_ps(sign, dvx));
+			const __m128 reachY = _mm_mul_ps(frames, _mm_andnot_ps(sign, dvy));
+			const __m128 ar = _mm_andnot_ps(sign, r);
+			const __m128 ax = _mm_andnot_ps(sign, dx), ay = _mm_andnot_ps(sign, dy);
+			const __m128 far = _mm_or_ps(
+				_mm_cmpgt_ps(_mm_sub_ps(ax, reachX),
+					_mm_add_ps(ar, _mm_mul_ps(margin, _mm_add_ps(_mm_add_ps(ax, reachX), ar)))),
+				_mm_cmpgt_ps(_mm_sub_ps(ay, reachY),
+					_mm_add_ps(ar, _mm_mul_ps(margin, _mm_add_ps(_mm_add_ps(ay, reachY), ar)))));
+
+			__m128 t = none, frame = zero;
+			__m128 pending = _mm_andnot_ps(far, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+			for (int f = 0; f <= horizon && _mm_movemask_ps(pending); ++f)
+			{
+				const __m128 xx = _mm_mul_ps(dx, dx), yy = _mm_mul_ps(dy, dy);
+				const __m128 hit = _mm_and_ps(pending, _mm_cmple_ps(_mm_add_ps(xx, yy), rr));
+				t = _mm_blendv_ps(t, frame, hit);
+				const __m128 gone = _mm_or_ps(
+					_mm_and_ps(_mm_cmpgt_ps(xx, rr), _mm_or_ps(
+						_mm_and_ps(_mm_cmpgt_ps(dx, zero), right), _mm_and_ps(_mm_cmplt_ps(dx, zero), left))),
+					_mm_and_ps(_mm_cmpgt_ps(yy, rr), _mm_or_ps(
+						_mm_and_ps(_mm_cmpgt_ps(dy, zero), down), _mm_and_ps(_mm_cmplt_ps(dy, zero), up))));
+				pending = _mm_andnot_ps(_mm_or_ps(hit, gone), pending);
+				dx = _mm_add_ps(dx, dvx);
+				dy = _mm_add_ps(dy, dvy);
+				frame = _mm_add_ps(frame, one);
+			}
+			_mm_storeu_ps(out + i, t);
+		}
+		scalarDiscreteCircles(center, radius, velocity, horizon, c, end, out);
+	}
+
+	TH_TARGET("sse4.1")
+	void sse41DiscreteBoxes(const vec2& position, const vec2& size, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)3;
+		const __m128 px = _mm_set1_ps(position.x), py = _mm_set1_ps(position.y);
+		const __m128 sx = _mm_set1_ps(size.x), sy = _mm_set1_ps(size.y);
+		const __m128 pvx = _mm_set1_ps(velocity.x), pvy = _mm_set1_ps(velocity.y);
+		const __m128 sign = _mm_set1_ps(-0.f), zero = _mm_setzero_ps(), none = _mm_set1_ps(-1.f), one = _mm_set1_ps(1.f);
+		const __m128 frames = _mm_set1_ps((float)horizon), margin = _mm_set1_ps(roundingMargin(horizon));
+		for (size_t i = 0; i < end; i += 4)
+		{
+			const __m128 qw = _mm_loadu_ps(&c.w[i]), qh = _mm_loadu_ps(&c.h[i]);
+			__m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&c.x[i]));
+			__m128 dy = _mm_sub_ps(py, _mm_loadu_ps(&c.y[i]));
+			const __m128 dvx = _mm_sub_ps(pvx, _mm_loadu_ps(&c.vx[i]));
+			const __m128 dvy = _mm_sub_ps(pvy, _mm_loadu_ps(&c.vy[i]));
+			const __m128 right = _mm_cmpge_ps(dvx, zero), left = _mm_cmple_ps(dvx, zero);
+			const __m128 down = _mm_cmpge_ps(dvy, zero), up = _mm_cmple_ps(dvy, zero);
+
+			const __m128 reachX = _mm_mul_ps(frames, _mm_andnot_ps(sign, dvx));
+			const __m128 reachY = _mm_mul_ps(frames, _mm_andnot_ps(sign, dvy));
+			const __m128 gapX = _mm_max_ps(_mm_sub_ps(dx, qw), _mm_xor_ps(_mm_add_ps(dx, sx), sign));
+			const __m128 gapY = _mm_max_ps(_mm_sub_ps(dy, qh), _mm_xor_ps(_mm_add_ps(dy, sy), sign));
+			const __m128 extentX = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign, dx), _mm_andnot_ps(sign, qw)),
+				_mm_add_ps(_mm_andnot_ps(sign, sx), reachX));
+			const __m128 extentY = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign, dy), _mm_andnot_ps(sign, qh)),
+				_mm_add_ps(_mm_andnot_ps(sign, sy), reachY));
+			const __m128 far = _mm_or_ps(
+				_mm_cmpgt_ps(gapX, _mm_add_ps(reachX, _mm_mul_ps(margin, extentX))),
+				_mm_cmpgt_ps(gapY, _mm_add_ps(reachY, _mm_mul_ps(margin, extentY))));
+
+			__m128 t = none, frame = zero;
+			__m128 pending = _mm_andnot_ps(far, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+			for (int f = 0; f <= horizon && _mm_movemask_ps(pending); ++f)
+			{
+				const __m128 ax = _mm_add_ps(dx, sx), ay = _mm_add_ps(dy, sy);
+				const __m128 overlap = _mm_and_ps(
+					_mm_and_ps(_mm_cmple_ps(dx, qw), _mm_cmpge_ps(ax, zero)),
+					_mm_and_ps(_mm_cmple_ps(dy, qh), _mm_cmpge_ps(ay, zero)));
+				const __m128 hit = _mm_and_ps(pending, overlap);
+				t = _mm_blendv_ps(t, frame, hit);
+				const __m128 gone = _mm_or_ps(
+					_mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(dx, qw), right), _mm_and_ps(_mm_cmplt_ps(ax, zero), left)),
+					_mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(dy, qh), down), _mm_and_ps(_mm_cmplt_ps(ay, zero), up)));
+				pending = _mm_andnot_ps(_mm_or_ps(hit, gone), pending);
+				dx = _mm_add_ps(dx, dvx);
+				dy = _mm_add_ps(dy, dvy);
+				frame = _mm_add_ps(frame, one);
+			}
+			_mm_storeu_ps(out + i, t);
+		}
+		scalarDiscreteBoxes(position, size, velocity, horizon, c, end, out);
+	}
+
+	/* AVX2, 8 shapes per vector */
+
+	TH_TARGET("avx2")
+	void avx2Circles(const vec2& center, float radius, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)7;
+		const __m256 px = _mm256_set1_ps(center.x), py = _mm256_set1_ps(center.y);
+		const __m256 pvx = _mm256_set1_ps(velocity.x), pvy = _mm256_set1_ps(velocity.y);
+		const __m256 r1 = _mm256_set1_ps(radius);
+		const __m256 sign = _mm256_set1_ps(-0.f), zero = _mm256_setzero_ps(), none = _mm256_set1_ps(-1.f);
+		const __m256 two = _mm256_set1_ps(2.f), four = _mm256_set1_ps(4.f);
+		for (size_t i = 0; i < end; i += 8)
+		{
+			const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&c.x[i]), px);
+			const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&c.y[i]), py);
+			const __m256 dvx = _mm256_sub_ps(_mm256_loadu_ps(&c.vx[i]), pvx);
+			const __m256 dvy = _mm256_sub_ps(_mm256_loadu_ps(&c.vy[i]), pvy);
+			const __m256 r = _mm256_add_ps(r1, _mm256_loadu_ps(&c.w[i]));
+			const __m256 rr = _mm256_mul_ps(r, r);
+			const __m256 dd = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+			const __m256 a = _mm256_add_ps(_mm256_mul_ps(dvx, dvx), _mm256_mul_ps(dvy, dvy));
+			const __m256 b = _mm256_mul_ps(two, _mm256_add_ps(_mm256_mul_ps(dx, dvx), _mm256_mul_ps(dy, dvy)));
+			const __m256 k = _mm256_sub_ps(dd, rr);
+			const __m256 d = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(_mm256_mul_ps(four, a), k));
+			const __m256 nb = _mm256_xor_ps(b, sign);
+
+			__m256 t = _mm256_div_ps(_mm256_sub_ps(nb, _mm256_sqrt_ps(d)), _mm256_mul_ps(two, a));
+			t = _mm256_blendv_ps(t, none, _mm256_cmp_ps(d, zero, _CMP_LT_OQ));
+			const __m256 linear = _mm256_blendv_ps(_mm256_div_ps(_mm256_xor_ps(k, sign), b), none,
+				_mm256_cmp_ps(b, zero, _CMP_EQ_OQ));
+			t = _mm256_blendv_ps(t, linear, _mm256_cmp_ps(a, zero, _CMP_EQ_OQ));
+			t = _mm256_blendv_ps(t, zero, _mm256_cmp_ps(dd, rr, _CMP_LE_OQ));
+			_mm256_storeu_ps(out + i, t);
+		}
+		scalarCircles(center, radius, velocity, c, end, out);
+	}
+
+	TH_TARGET("avx2")
+	void avx2Boxes(const vec2& position, const vec2& size, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)7;
+		const __m256 px = _mm256_set1_ps(position.x), py = _mm256_set1_ps(position.y);
+		const __m256 sx = _mm256_set1_ps(size.x), sy = _mm256_set1_ps(size.y);
+		const __m256 pvx = _mm256_set1_ps(velocity.x), pvy = _mm256_set1_ps(velocity.y);
+		const __m256 zero = _mm256_setzero_ps(), none = _mm256_set1_ps(-1.f);
+		const __m256 inf = _mm256_set1_ps(INFINITY), limit = _mm256_set1_ps(6000.f);
+		for (size_t i = 0; i < end; i += 8)
+		{
+			const __m256 qx = _mm256_loadu_ps(&c.x[i]), qy = _mm256_loadu_ps(&c.y[i]);
+			const __m256 qw = _mm256_loadu_ps(&c.w[i]), qh = _mm256_loadu_ps(&c.h[i]);
+			const __m256 qvx = _mm256_loadu_ps(&c.vx[i]), qvy = _mm256_loadu_ps(&c.vy[i]);
+			const __m256 dvx = _mm256_sub_ps(qvx, pvx), dvy = _mm256_sub_ps(qvy, pvy);
+			const __m256 dx = _mm256_sub_ps(px, qx), dy = _mm256_sub_ps(py, qy);
+
+			auto overlap = [&](__m256 ax, __m256 ay, __m256 bx, __m256 by) TH_TARGET("avx2")
+			{
+				return _mm256_and_ps(
+					_mm256_and_ps(_mm256_cmp_ps(ax, _mm256_add_ps(bx, qw), _CMP_LE_OQ),
+						_mm256_cmp_ps(_mm256_add_ps(ax, sx), bx, _CMP_GE_OQ)),
+					_mm256_and_ps(_mm256_cmp_ps(ay, _mm256_add_ps(by, qh), _CMP_LE_OQ),
+						_mm256_cmp_ps(_mm256_add_ps(sy, ay), by, _CMP_GE_OQ)));
+			};
+			__m256 min = inf;
+			auto side = [&](__m256 t) TH_TARGET("avx2")
+			{
+				const __m256 hit = _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), overlap(
+					_mm256_add_ps(px, _mm256_mul_ps(pvx, t)), _mm256_add_ps(py, _mm256_mul_ps(pvy, t)),
+					_mm256_add_ps(qx, _mm256_mul_ps(qvx, t)), _mm256_add_ps(qy, _mm256_mul_ps(qvy, t))));
+				min = _mm256_min_ps(min, _mm256_blendv_ps(inf, t, hit));
+			};
+			side(_mm256_div_ps(_mm256_sub_ps(dx, qw), dvx));
+			side(_mm256_div_ps(_mm256_add_ps(dx, sx), dvx));
+			side(_mm256_div_ps(_mm256_sub_ps(dy, qh), dvy));
+			side(_mm256_div_ps(_mm256_add_ps(dy, sy), dvy));
+
+			__m256 t = _mm256_blendv_ps(none, min, _mm256_cmp_ps(min, limit, _CMP_LT_OQ));
+			t = _mm256_blendv_ps(t, zero, overlap(px, py, qx, qy));
+			_mm256_storeu_ps(out + i, t);
+		}
+		scalarBoxes(position, size, velocity, c, end, out);
+	}
+
+	TH_TARGET("avx2")
+	void avx2DiscreteCircles(const vec2& center, float radius, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)7;
+		const __m256 px = _mm256_set1_ps(center.x), py = _mm256_set1_ps(center.y);
+		const __m256 pvx = _mm256_set1_ps(velocity.x), pvy = _mm256_set1_ps(velocity.y);
+		const __m256 r1 = _mm256_set1_ps(radius);
+		const __m256 sign = _mm256_set1_ps(-0.f), zero = _mm256_setzero_ps();
+		const __m256 none = _mm256_set1_ps(-1.f), one = _mm256_set1_ps(1.f);
+		const __m256 frames = _mm256_set1_ps((float)horizon), margin = _mm256_set1_ps(roundingMargin(horizon));
+		for (size_t i = 0; i < end; i += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&c.x[i]), px);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&c.y[i]), py);
+			const __m256 dvx = _mm256_sub_ps(_mm256_loadu_ps(&c.vx[i]), pvx);
+			const __m256 dvy = _mm256_sub_ps(_mm256_loadu_ps(&c.vy[i]), pvy);
+			const __m256 r = _mm256_add_ps(r1, _mm256_loadu_ps(&c.w[i]));
+			const __m256 rr = _mm256_mul_ps(r, r);
+			const __m256 right = _mm256_cmp_ps(dvx, zero, _CMP_GE_OQ), left = _mm256_cmp_ps(dvx, zero, _CMP_LE_OQ);
+			const __m256 down = _mm256_cmp_ps(dvy, zero, _CMP_GE_OQ), up = _mm256_cmp_ps(dvy, zero, _CMP_LE_OQ);
+
+			const __m256 reachX = _mm256_mul_ps(frames, _mm256_andnot_ps(sign, dvx));
+			const __m256 reachY = _mm256_mul_ps(frames, _mm256_andnot_ps(sign, dvy));
+			const __m256 ar = _mm256_andnot_ps(sign, r);
+			const __m256 ax = _mm256_andnot_ps(sign, dx), ay = _mm256_andnot_ps(sign, dy);
+			const __m256 far = _mm256_or_ps(
+				_mm256_cmp_ps(_mm256_sub_ps(ax, reachX),
+					_mm256_add_ps(ar, _mm256_mul_ps(margin, _mm256_add_ps(_mm256_add_ps(ax, reachX), ar))), _CMP_GT_OQ),
+				_mm256_cmp_ps(_mm256_sub_ps(ay, reachY),
+					_mm256_add_ps(ar, _mm256_mul_ps(margin, _mm256_add_ps(_mm256_add_ps(ay, reachY), ar))), _CMP_GT_OQ));
+
+			__m256 t = none, frame = zero;
+			__m256 pending = _mm256_andnot_ps(far, _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+			for (int f = 0; f <= horizon && _mm256_movemask_ps(pending); ++f)
+			{
+				const __m256 xx = _mm256_mul_ps(dx, dx), yy = _mm256_mul_ps(dy, dy);
+				const __m256 hit = _mm256_and_ps(pending,
+					_mm256_cmp_ps(_mm256_add_ps(xx, yy), rr, _CMP_LE_OQ));
+				t = _mm256_blendv_ps(t, frame, hit);
+				const __m256 gone = _mm256_or_ps(
+					_mm256_and_ps(_mm256_cmp_ps(xx, rr, _CMP_GT_OQ), _mm256_or_ps(
+						_mm256_and_ps(_mm256_cmp_ps(dx, zero, _CMP_GT_OQ), right),
+						_mm256_and_ps(_mm256_cmp_ps(dx, zero, _CMP_LT_OQ), left))),
+					_mm256_and_ps(_mm256_cmp_ps(yy, rr, _CMP_GT_OQ), _mm256_or_ps(
+						_mm256_and_ps(_mm256_cmp_ps(dy, zero, _CMP_GT_OQ), down),
+						_mm256_and_ps(_mm256_cmp_ps(dy, zero, _CMP_LT_OQ), up))));
+				pending = _mm256_andnot_ps(_mm256_or_ps(hit, gone), pending);
+				dx = _mm256_add_ps(dx, dvx);
+				dy = _mm256_add_ps(dy, dvy);
+				frame = _mm256_add_ps(frame, one);
+			}
+			_mm256_storeu_ps(out + i, t);
+		}
+		scalarDiscreteCircles(center, radius, velocity, horizon, c, end, out);
+	}
+
+	TH_TARGET("avx2")
+	void avx2DiscreteBoxes(const vec2& position, const vec2& size, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)7;
+		const __m256 px = _mm256_set1_ps(position.x), py = _mm256_set1_ps(position.y);
+		const __m256 sx = _mm256_set1_ps(size.x), sy = _mm256_set1_ps(size.y);
+		const __m256 pvx = _mm256_set1_ps(velocity.x), pvy = _mm256_set1_ps(velocity.y);
+		const __m256 sign = _mm256_set1_ps(-0.f), zero = _mm256_setzero_ps();
+		const __m256 none = _mm256_set1_ps(-1.f), one = _mm256_set1_ps(1.f);
+		const __m256 frames = _mm256_set1_ps((float)horizon), margin = _mm256_set1_ps(roundingMargin(horizon));
+		for (size_t i = 0; i < end; i += 8)
+		{
+			const __m256 qw = _mm256_loadu_ps(&c.w[i]), qh = _mm256_loadu_ps(&c.h[i]);
+			__m256 dx = _mm256_sub_ps(px, _mm256_loadu_ps(&c.x[i]));
+			__m256 dy = _mm256_sub_ps(py, _mm256_loadu_ps(&c.y[i]));
+			const __m256 dvx = _mm256_sub_ps(pvx, _mm256_loadu_ps(&c.vx[i]));
+			const __m256 dvy = _mm256_sub_ps(pvy, _mm256_loadu_ps(&c.vy[i]));
+			const __m256 right = _mm256_cmp_ps(dvx, zero, _CMP_GE_OQ), left = _mm256_cmp_ps(dvx, zero, _CMP_LE_OQ);
+			const __m256 down = _mm256_cmp_ps(dvy, zero, _CMP_GE_OQ), up = _mm256_cmp_ps(dvy, zero, _CMP_LE_OQ);
+
+			const __m256 reachX = _mm256_mul_ps(frames, _mm256_andnot_ps(sign, dvx));
+			const __m256 reachY = _mm256_mul_ps(frames, _mm256_andnot_ps(sign, dvy));
+			const __m256 gapX = _mm256_max_ps(_mm256_sub_ps(dx, qw), _mm256_xor_ps(_mm256_add_ps(dx, sx), sign));
+			const __m256 gapY = _mm256_max_ps(_mm256_sub_ps(dy, qh), _mm256_xor_ps(_mm256_add_ps(dy, sy), sign));
+			const __m256 extentX = _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(sign, dx), _mm256_andnot_ps(sign, qw)),
+				_mm256_add_ps(_mm256_andnot_ps(sign, sx), reachX));
+			const __m256 extentY = _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(sign, dy), _mm256_andnot_ps(sign, qh)),
+				_mm256_add_ps(_mm256_andnot_ps(sign, sy), reachY));
+			const __m256 far = _mm256_or_ps(
+				_mm256_cmp_ps(gapX, _mm256_add_ps(reachX, _mm256_mul_ps(margin, extentX)), _CMP_GT_OQ),
+				_mm256_cmp_ps(gapY, _mm256_add_ps(reachY, _mm256_mul_ps(margin, extentY)), _CMP_GT_OQ));
+
+			__m256 t = none, frame = zero;
+			__m256 pending = _mm256_andnot_ps(far, _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+			for (int f = 0; f <= horizon && _mm256_movemask_ps(pending); ++f)
+			{
+				const __m256 ax = _mm256_add_ps(dx, sx), ay = _mm256_add_ps(dy, sy);
+				const __m256 overlap = _mm256_and_ps(
+					_mm256_and_ps(_mm256_cmp_ps(dx, qw, _CMP_LE_OQ), _mm256_cmp_ps(ax, zero, _CMP_GE_OQ)),
+					_mm256_and_ps(_mm256_cmp_ps(dy, qh, _CMP_LE_OQ), _mm256_cmp_ps(ay, zero, _CMP_GE_OQ)));
+				const __m256 hit = _mm256_and_ps(pending, overlap);
+				t = _mm256_blendv_ps(t, frame, hit);
+				const __m256 gone = _mm256_or_ps(
+					_mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(dx, qw, _CMP_GT_OQ), right),
+						_mm256_and_ps(_mm256_cmp_ps(ax, zero, _CMP_LT_OQ), left)),
+					_mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(dy, qh, _CMP_GT_OQ), down),
+						_mm256_and_ps(_mm256_cmp_ps(ay, zero, _CMP_LT_OQ), up)));
+				pending = _mm256_andnot_ps(_mm256_or_ps(hit, gone), pending);
+				dx = _mm256_add_ps(dx, dvx);
+				dy = _mm256_add_ps(dy, dvy);
+				frame = _mm256_add_ps(frame, one);
+			}
+			_mm256_storeu_ps(out + i, t);
+		}
+		scalarDiscreteBoxes(position, size, velocity, horizon, c, end, out);
+	}
+
+	/* AVX-512F, 16 shapes per vector, with comparisons into mask registers */
+
+	TH_TARGET("avx512f")
+	void avx512Circles(const vec2& center, float radius, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)15;
+		const __m512 px = _mm512_set1_ps(center.x), py = _mm512_set1_ps(center.y);
+		const __m512 pvx = _mm512_set1_ps(velocity.x), pvy = _mm512_set1_ps(velocity.y);
+		const __m512 r1 = _mm512_set1_ps(radius);
+		const __m512 zero = _mm512_setzero_ps(), none = _mm512_set1_ps(-1.f);
+		const __m512 two = _mm512_set1_ps(2.f), four = _mm512_set1_ps(4.f);
+		// floating point xor needs AVX512DQ
+		const __m512i sign = _mm512_set1_epi32((int)0x80000000);
+		for (size_t i = 0; i < end; i += 16)
+		{
+			const __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(&c.x[i]), px);
+			const __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(&c.y[i]), py);
+			const __m512 dvx = _mm512_sub_ps(_mm512_loadu_ps(&c.vx[i]), pvx);
+			const __m512 dvy = _mm512_sub_ps(_mm512_loadu_ps(&c.vy[i]), pvy);
+			const __m512 r = _mm512_add_ps(r1, _mm512_loadu_ps(&c.w[i]));
+			const __m512 rr = _mm512_mul_ps(r, r);
+			const __m512 dd = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+
+			const __m512 a = _mm512_add_ps(_mm512_mul_ps(dvx, dvx), _mm512_mul_ps(dvy, dvy));
+			const __m512 b = _mm512_mul_ps(two, _mm512_add_ps(_mm512_mul_ps(dx, dvx), _mm512_mul_ps(dy, dvy)));
+			const __m512 k = _mm512_sub_ps(dd, rr);
+			const __m512 d = _mm512_sub_ps(_mm512_mul_ps(b, b), _mm512_mul_ps(_mm512_mul_ps(four, a), k));
+			const __m512 nb = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(b), sign));
+			const __m512 nk = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(k), sign));
+
+			__m512 t = _mm512_div_ps(_mm512_sub_ps(nb, _mm512_sqrt_ps(d)), _mm512_mul_ps(two, a));
+			t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(d, zero, _CMP_LT_OQ), t, none);
+			const __m512 linear = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(b, zero, _CMP_EQ_OQ),
+				_mm512_div_ps(nk, b), none);
+			t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, zero, _CMP_EQ_OQ), t, linear);
+			t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(dd, rr, _CMP_LE_OQ), t, zero);
+			_mm512_storeu_ps(out + i, t);
+		}
+		scalarCircles(center, radius, velocity, c, end, out);
+	}
+
+	TH_TARGET("avx512f")
+	void avx512Boxes(const vec2& position, const vec2& size, const vec2& velocity,
+		const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)15;
+		const __m512 px = _mm512_set1_ps(position.x), py = _mm512_set1_ps(position.y);
+		const __m512 sx = _mm512_set1_ps(size.x), sy = _mm512_set1_ps(size.y);
+		const __m512 pvx = _mm512_set1_ps(velocity.x), pvy = _mm512_set1_ps(velocity.y);
+		const __m512 zero = _mm512_setzero_ps(), none = _mm512_set1_ps(-1.f);
+		const __m512 inf = _mm512_set1_ps(INFINITY), limit = _mm512_set1_ps(6000.f);
+		for (size_t i = 0; i < end; i += 16)
+		{
+			const __m512 qx = _mm512_loadu_ps(&c.x[i]), qy = _mm512_loadu_ps(&c.y[i]);
+			const __m512 qw = _mm512_loadu_ps(&c.w[i]), qh = _mm512_loadu_ps(&c.h[i]);
+			const __m512 qvx = _mm512_loadu_ps(&c.vx[i]), qvy = _mm512_loadu_ps(&c.vy[i]);
+			const __m512 dvx = _mm512_sub_ps(qvx, pvx), dvy = _mm512_sub_ps(qvy, pvy);
+			const __m512 dx = _mm512_sub_ps(px, qx), dy = _mm512_sub_ps(py, qy);
+
+			auto overlap = [&](__m512 ax, __m512 ay, __m512 bx, __m512 by) TH_TARGET("avx512f")
+			{
+				return (__mmask16)(_mm512_cmp_ps_mask(ax, _mm512_add_ps(bx, qw), _CMP_LE_OQ)
+					& _mm512_cmp_ps_mask(_mm512_add_ps(ax, sx), bx, _CMP_GE_OQ)
+					& _mm512_cmp_ps_mask(ay, _mm512_add_ps(by, qh), _CMP_LE_OQ)
+					& _mm512_cmp_ps_mask(_mm512_add_ps(sy, ay), by, _CMP_GE_OQ));
+			};
+			__m512 min = inf;
+			auto side = [&](__m512 t) TH_TARGET("avx512f")
+			{
+				const __mmask16 hit = _mm512_cmp_ps_mask(t, zero, _CMP_GE_OQ) & overlap(
+					_mm512_add_ps(px, _mm512_mul_ps(pvx, t)), _mm512_add_ps(py, _mm512_mul_ps(pvy, t)),
+					_mm512_add_ps(qx, _mm512_mul_ps(qvx, t)), _mm512_add_ps(qy, _mm512_mul_ps(qvy, t)));
+				min = _mm512_min_ps(min, _mm512_mask_blend_ps(hit, inf, t));
+			};
+			side(_mm512_div_ps(_mm512_sub_ps(dx, qw), dvx));
+			side(_mm512_div_ps(_mm512_add_ps(dx, sx), dvx));
+			side(_mm512_div_ps(_mm512_sub_ps(dy, qh), dvy));
+			side(_mm512_div_ps(_mm512_add_ps(dy, sy), dvy));
+
+			__m512 t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(min, limit, _CMP_LT_OQ), none, min);
+			t = _mm512_mask_blend_ps(overlap(px, py, qx, qy), t, zero);
+			_mm512_storeu_ps(out + i, t);
+		}
+		scalarBoxes(position, size, velocity, c, end, out);
+	}
+
+	TH_TARGET("avx512f")
+	void avx512DiscreteCircles(const vec2& center, float radius, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)15;
+		const __m512 px = _mm512_set1_ps(center.x), py = _mm512_set1_ps(center.y);
+		const __m512 pvx = _mm512_set1_ps(velocity.x), pvy = _mm512_set1_ps(velocity.y);
+		const __m512 r1 = _mm512_set1_ps(radius);
+		const __m512 zero = _mm512_setzero_ps(), none = _mm512_set1_ps(-1.f), one = _mm512_set1_ps(1.f);
+		const __m512 frames = _mm512_set1_ps((float)horizon), margin = _mm512_set1_ps(roundingMargin(horizon));
+		for (size_t i = 0; i < end; i += 16)
+		{
+			__m512 dx = _mm512_sub_ps(_mm512_loadu_ps(&c.x[i]), px);
+			__m512 dy = _mm512_sub_ps(_mm512_loadu_ps(&c.y[i]), py);
+			const __m512 dvx = _mm512_sub_ps(_mm512_loadu_ps(&c.vx[i]), pvx);
+			const __m512 dvy = _mm512_sub_ps(_mm512_loadu_ps(&c.vy[i]), pvy);
+			const __m512 r = _mm512_add_ps(r1, _mm512_loadu_ps(&c.w[i]));
+			const __m512 rr = _mm512_mul_ps(r, r);
+			const __mmask16 right = _mm512_cmp_ps_mask(dvx, zero, _CMP_GE_OQ);
+			const __mmask16 left = _mm512_cmp_ps_mask(dvx, zero, _CMP_LE_OQ);
+			const __mmask16 down = _mm512_cmp_ps_mask(dvy, zero, _CMP_GE_OQ);
+			const __mmask16 up = _mm512_cmp_ps_mask(dvy, zero, _CMP_LE_OQ);
+
+			const __m512 reachX = _mm512_mul_ps(frames, _mm512_abs_ps(dvx));
+			const __m512 reachY = _mm512_mul_ps(frames, _mm512_abs_ps(dvy));
+			const __m512 ar = _mm512_abs_ps(r);
+			const __m512 ax = _mm512_abs_ps(dx), ay = _mm512_abs_ps(dy);
+			const __mmask16 far = (__mmask16)(
+				_mm512_cmp_ps_mask(_mm512_sub_ps(ax, reachX),
+					_mm512_add_ps(ar, _mm512_mul_ps(margin, _mm512_add_ps(_mm512_add_ps(ax, reachX), ar))), _CMP_GT_OQ)
+				| _mm512_cmp_ps_mask(_mm512_sub_ps(ay, reachY),
+					_mm512_add_ps(ar, _mm512_mul_ps(margin, _mm512_add_ps(_mm512_add_ps(ay, reachY), ar))), _CMP_GT_OQ));
+
+			__m512 t = none, frame = zero;
+			__mmask16 pending = (__mmask16)~far;
+			for (int f = 0; f <= horizon && pending; ++f)
+			{
+				const __m512 xx = _mm512_mul_ps(dx, dx), yy = _mm512_mul_ps(dy, dy);
+				const __mmask16 hit = _mm512_mask_cmp_ps_mask(pending, _mm512_add_ps(xx, yy), rr, _CMP_LE_OQ);
+				t = _mm512_mask_blend_ps(hit, t, frame);
+				const __mmask16 gone = (__mmask16)(
+					(_mm512_cmp_ps_mask(xx, rr, _CMP_GT_OQ) & ((_mm512_cmp_ps_mask(dx, zero, _CMP_GT_OQ) & right)
+						| (_mm512_cmp_ps_mask(dx, zero, _CMP_LT_OQ) & left)))
+					| (_mm512_cmp_ps_mask(yy, rr, _CMP_GT_OQ) & ((_mm512_cmp_ps_mask(dy, zero, _CMP_GT_OQ) & down)
+						| (_mm512_cmp_ps_mask(dy, zero, _CMP_LT_OQ) & up))));
+				pending = (__mmask16)(pending & ~(hit | gone));
+				dx = _mm512_add_ps(dx, dvx);
+				dy = _mm512_add_ps(dy, dvy);
+				frame = _mm512_add_ps(frame, one);
+			}
+			_mm512_storeu_ps(out + i, t);
+		}
+		scalarDiscreteCircles(center, radius, velocity, horizon, c, end, out);
+	}
+
+	TH_TARGET("avx512f")
+	void avx512DiscreteBoxes(const vec2& position, const vec2& size, const vec2& velocity,
+		int horizon, const kernels::columns& c, float* out)
+	{
+		const size_t end = c.size() & ~(size_t)15;
+		const __m512 px = _mm512_set1_ps(position.x), py = _mm512_set1_ps(position.y);
+		const __m512 sx = _mm512_set1_ps(size.x), sy = _mm512_set1_ps(size.y);
+		const __m512 pvx = _mm512_set1_ps(velocity.x), pvy = _mm512_set1_ps(velocity.y);
+		const __m512 zero = _mm512_setzero_ps(), none = _mm512_set1_ps(-1.f), one = _mm512_set1_ps(1.f);
+		const __m512 frames = _mm512_set1_ps((float)horizon), margin = _mm512_set1_ps(roundingMargin(horizon));
+		for (size_t i = 0; i < end; i += 16)
+		{
+			const __m512 qw = _mm512_loadu_ps(&c.w[i]), qh = _mm512_loadu_ps(&c.h[i]);
+			__m512 dx = _mm512_sub_ps(px, _mm512_loadu_ps(&c.x[i]));
+			__m512 dy = _mm512_sub_ps(py, _mm512_loadu_ps(&c.y[i]));
+			const __m512 dvx = _mm512_sub_ps(pvx, _mm512_loadu_ps(&c.vx[i]));
+			const __m512 dvy = _mm512_sub_ps(pvy, _mm512_loadu_ps(&c.vy[i]));
+			const __mmask16 right = _mm512_cmp_ps_mask(dvx, zero, _CMP_GE_OQ);
+			const __mmask16 left = _mm512_cmp_ps_mask(dvx, zero, _CMP_LE_OQ);
+			const __mmask16 down = _mm512_cmp_ps_mask(dvy, zero, _CMP_GE_OQ);
+			const __mmask16 up = _mm512_cmp_ps_mask(dvy, zero, _CMP_LE_OQ);
+
+			const __m512 reachX = _mm512_mul_ps(frames, _mm512_abs_ps(dvx));
+			const __m512 reachY = _mm512_mul_ps(frames, _mm512_abs_ps(dvy));
+			const __m512 gapX = _mm512_max_ps(_mm512_sub_ps(dx, qw), _mm512_sub_ps(zero, _mm512_add_ps(dx, sx)));
+			const __m512 gapY = _mm512_max_ps(_mm512_sub_ps(dy, qh), _mm512_sub_ps(zero, _mm512_add_ps(dy, sy)));
+			const __m512 extentX = _mm512_add_ps(_mm512_add_ps(_mm512_abs_ps(dx), _mm512_abs_ps(qw)),
+				_mm512_add_ps(_mm512_abs_ps(sx), reachX));
+			const __m512 extentY = _mm512_add_ps(_mm512_add_ps(_mm512_abs_ps(dy), _mm512_abs_ps(qh)),
+				_mm512_add_ps(_mm512_abs_ps(sy), reachY));
+			const __mmask16 far = (__mmask16)(
+				_mm512_cmp_ps_mask(gapX, _mm512_add_ps(reachX, _mm512_mul_ps(margin, extentX)), _CMP_GT_OQ)
+				| _mm512_cmp_ps_mask(gapY, _mm512_add_ps(reachY, _mm512_mul_ps(margin, extentY)), _CMP_GT_OQ));
+
+			__m512 t = none, frame = zero;
+			__mmask16 pending = (__mmask16)~far;
+			for (int f = 0; f <= horizon && pending; ++f)
+			{
+				const __m512 ax = _mm512_add_ps(dx, sx), ay = _mm512_add_ps(dy, sy);
+				const __mmask16 hit = _mm512_mask_cmp_ps_mask(pending, dx, qw, _CMP_LE_OQ)
+					& _mm512_cmp_ps_mask(ax, zero, _CMP_GE_OQ)
+					& _mm512_cmp_ps_mask(dy, qh, _CMP_LE_OQ)
+					& _mm512_cmp_ps_mask(ay, zero, _CMP_GE_OQ);
+				t = _mm512_mask_blend_ps(hit, t, frame);
+				const __mmask16 gone = (__mmask16)(
+					(_mm512_cmp_ps_mask(dx, qw, _CMP_GT_OQ) & right) | (_mm512_cmp_ps_mask(ax, zero, _CMP_LT_OQ) & left)
+					| (_mm512_cmp_ps_mask(dy, qh, _CMP_GT_OQ) & down) | (_mm512_cmp_ps_mask(ay, zero, _CMP_LT_OQ) & up));
+				pending = (__mmask16)(pending & ~(hit | gone));
+				dx = _mm512_add_ps(dx, dvx);
+				dy = _mm512_add_ps(dy, dvy);
+				frame = _mm512_add_ps(frame, one);
+			}
+			_mm512_storeu_ps(out + i, t);
+		}
+		scalarDiscreteBoxes(position, size, velocity, horizon, c, end, out);
+	}
+}
+
+namespace kernels
+{
+	namespace detail
+	{
+		extern const table SSE41_TABLE = { SSE41, sse41Circles, sse41Boxes,
+			sse41DiscreteCircles, sse41DiscreteBoxes };
+		extern const table AVX2_TABLE = { AVX2, avx2Circles, avx2Boxes,
+			avx2DiscreteCircles, avx2DiscreteBoxes };
+		extern const table AVX512_TABLE = { AVX512, avx512Circles, avx512Boxes,
+			avx512DiscreteCircles, avx512DiscreteBoxes };
+	}
+}
+#endif
@@ -0,0 +1,97 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool mapped_file::open(const std::string& path, bool sequential)
+{
+	close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || (uint64_t)size.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// the mapping keeps the file open
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping)
+		return false;
+
+	base = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!base)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	length = (size_t)size.QuadPart;
+	handle = (intptr_t)mapping;
+	return true;
+}
+
+void mapped_file::close()
+{
+	if (base)
+		UnmapViewOfFile(base);
+	if (handle != -1)
+		CloseHandle((HANDLE)handle);
+	base = nullptr;
+	length = 0;
+	handle = -1;
+}
+
+#else
+
+bool mapped_file::open(const std::string& path, bool sequential)
+{
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		::close(fd);
+		return false;
+	}
+	madvise(p, (size_t)st.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	base = static_cast<const uint8_t*>(p);
+	length = (size_t)st.st_size;
+	handle = fd;
+	return true;
+}
+
+void mapped_file::close()
+{
+	if (base)
+		munmap(const_cast<uint8_t*>(base), length);
+	if (handle != -1)
+		::close((int)handle);
+	base = nullptr;
+	length = 0;
+	handle = -1;
+}
+
+#endif
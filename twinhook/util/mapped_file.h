@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Read-only memory mapping of a whole file.
+ */
+class mapped_file
+{
+	const uint8_t* base = nullptr;
+	size_t length = 0;
+	// File mapping handle (Win32) or file descriptor (POSIX)
+	intptr_t handle = -1;
+
+public:
+	mapped_file() = default;
+	~mapped_file() { close(); }
+
+	mapped_file(const mapped_file& other) = delete;
+	mapped_file& operator=(const mapped_file& other) = delete;
+
+	/**
+	 * \brief Map a file
+	 * \param path File to map
+	 * \param sequential Whether the file is read front to back, rather than probed
+	 * \return Whether the file could be mapped
+	 */
+	bool open(const std::string& path, bool sequential = true);
+
+	void close();
+
+	const uint8_t* data() const { return base; }
+	size_t size() const { return length; }
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * \brief Fixed-capacity buffer of plain records, appended to from detoured
+ * game functions.
+ *
+ * Appending is an index increment into storage allocated up front, so hooks
+ * running inside the game's per-object loops do not allocate. The records
+ * are decoded once per frame by whoever owns the buffer, which then clears
+ * it. Records beyond the capacity are dropped and counted. Not thread safe;
+ * the hooks and the frame callbacks run on the game's thread.
+ */
+template <typename T, size_t N>
+class record_buffer
+{
+	T records[N];
+	size_t count = 0;
+	size_t dropped = 0;
+
+public:
+	/**
+	 * \brief Reserve the next record
+	 * \return The record to fill, or nullptr if the buffer is full
+	 */
+	T* append()
+	{
+		if (count == N)
+		{
+			++dropped;
+			return nullptr;
+		}
+		return &records[count++];
+	}
+
+	/**
+	 * \brief Forget all records
+	 * \return Records dropped since the last clear
+	 */
+	size_t clear()
+	{
+		const size_t d = dropped;
+		count = 0;
+		dropped = 0;
+		return d;
+	}
+
+	const T* begin() const { return records; }
+	const T* end() const { return records + count; }
+	size_t size() const { return count; }
+	static constexpr size_t capacity() { return N; }
+};
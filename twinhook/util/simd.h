@@ -0,0 +1,18 @@
+#pragma once
+
+// Whether SSE2 intrinsics can be used. twinhook is built with /arch:SSE2,
+// the scalar paths are kept for other toolchains.
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define TH_SSE2
+#include <emmintrin.h>
+#endif
+
+// Compile a function for an instruction set beyond the build's /arch, to be
+// called only after checking the CPU supports it, see util/kernels.h. MSVC
+// accepts intrinsics of every instruction set without this; GCC and Clang need
+// the instruction set enabled per function.
+#if defined(__GNUC__) || defined(__clang__)
+#define TH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TH_TARGET(isa)
+#endif
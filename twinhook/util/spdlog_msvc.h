@@ -3,21 +3,88 @@
 
 #include <spdlog/spdlog.h>
 #include <spdlog/logger.h>
-#include <spdlog/sinks/msvc_sink.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include "util/async_log.h"
+#include "ipc/th_telemetry.h"
+
+/**
+ * \brief spdlog sink which forwards messages to the asynchronous logger, so
+ * delivery to twinject (through the shared-memory channel, or OutputDebugString
+ * and the debugger) happens on the logging thread instead of the caller's.
+ *
+ * spdlog still formats the payload on the calling thread; hot paths should use
+ * TH_LOG instead, which defers formatting as well.
+ */
+class async_log_sink : public spdlog::sinks::base_sink<spdlog::details::null_mutex>
+{
+protected:
+	void sink_it_(const spdlog::details::log_msg& msg) override
+	{
+		// One call site per spdlog level, the message itself is already formatted
+		static const th_log::site sites[] = {
+			th_log::makeSite(th_log::Trace, "[T:{}@{}:L{}] {}", "", 0),
+			th_log::makeSite(th_log::Debug, "[D:{}@{}:L{}] {}", "", 0),
+			th_log::makeSite(th_log::Info, "[I:{}@{}:L{}] {}", "", 0),
+			th_log::makeSite(th_log::Warn, "[W:{}@{}:L{}] {}", "", 0),
+			th_log::makeSite(th_log::Error, "[E:{}@{}:L{}] {}", "", 0),
+			th_log::makeSite(th_log::Error, "[C:{}@{}:L{}] {}", "", 0),
+		};
+		const int lvl = std::min((int)msg.level, 5);
+		const char* func = msg.source.funcname ? msg.source.funcname : "";
+		const char* file = msg.source.filename ? msg.source.filename : "";
+		th_log::write(sites[lvl], func, file, msg.source.line,
+			th_log::str{ msg.payload.data(), msg.payload.size() });
+	}
+
+	void flush_() override {}
+};
 
 class spdlog_msvc
 {
-	std::shared_ptr<spdlog::sinks::msvc_sink_mt> msvc_sink;
+	std::shared_ptr<async_log_sink> sink;
 	std::shared_ptr<spdlog::logger> logger;
 
 public:
 	spdlog_msvc()
 	{
-		msvc_sink = std::make_shared<spdlog::sinks::msvc_sink_mt>();
-		logger = std::make_shared<spdlog::logger>("msvc_logger", msvc_sink);
+		// optional, log to a binary file instead of the debugger, see th_log::decode
+		size_t len;
+		char buf[16] = { 0 };
+		getenv_s(&len, buf, sizeof(buf), "log");
+		if (strcmp(buf, "binary") != 0 || !th_log::startBinary("twinject_log.bin"))
+		{
+			th_log::start([](const th_log::site& s, const std::string& msg)
+			{
+				static const char* const LEVELS = "TDIWE";
+				std::string line;
+				if (*s.file)
+				{
+					line = std::string("[") + LEVELS[s.lvl] + ":" + s.file + ":L"
+						+ std::to_string(s.line) + "] ";
+				}
+				line += msg;
+				if (th_telemetry::connected())
+				{
+					th_telemetry::sendLog(s.lvl, line);
+					return;
+				}
+				line += "\n";
+				OutputDebugStringA(line.c_str());
+			});
+		}
+
+		sink = std::make_shared<async_log_sink>();
+		logger = std::make_shared<spdlog::logger>("async_logger", sink);
 		spdlog::set_default_logger(logger);
 	}
 
+	~spdlog_msvc()
+	{
+		th_log::stop();
+	}
+
 	std::shared_ptr<spdlog::logger> get_logger() const
 	{
 		return logger;
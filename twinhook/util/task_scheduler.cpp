@@ -0,0 +1,77 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+
+task_scheduler::task_scheduler(clock_fn clock) : clock(std::move(clock)) {}
+
+task_scheduler::duration task_scheduler::steadyClock()
+{
+	return std::chrono::duration_cast<duration>(
+		std::chrono::steady_clock::now().time_since_epoch());
+}
+
+bool task_scheduler::before(const entry& a, const entry& b)
+{
+	if (a.priority != b.priority)
+		return a.priority > b.priority;
+	if (a.deadline != b.deadline)
+		return a.deadline < b.deadline;
+	// Tasks added earlier run first
+	return a.id < b.id;
+}
+
+task_scheduler::task_id task_scheduler::add(std::unique_ptr<task> t, int priority, duration deadline)
+{
+	const duration now = clock();
+	entry e;
+	e.t = std::move(t);
+	e.id = nextId++;
+	if (nextId == INVALID_TASK)
+		++nextId;
+	e.priority = priority;
+	// Saturate instead of overflowing for tasks without a deadline
+	e.deadline = deadline > duration::max() - now ? duration::max() : now + deadline;
+
+	auto it = std::upper_bound(tasks.begin(), tasks.end(), e, before);
+	const task_id id = e.id;
+	tasks.insert(it, std::move(e));
+	return id;
+}
+
+bool task_scheduler::cancel(task_id id)
+{
+	auto it = std::find_if(tasks.begin(), tasks.end(),
+		[id](const entry& e) { return e.id == id; });
+	if (it == tasks.end())
+		return false;
+	tasks.erase(it);
+	return true;
+}
+
+int task_scheduler::run(duration slice)
+{
+	if (slice <= duration::zero())
+		return 0;
+
+	const duration end = clock() + slice;
+	int steps = 0;
+	// Tasks are kept sorted, so the front is always the most urgent one. A
+	// task keeps running until it is done or the slice ends, since switching
+	// between tasks of the same urgency would only delay all of them.
+	while (!tasks.empty())
+	{
+		const task::status st = tasks.front().t->step();
+		++steps;
+		const duration now = clock();
+		if (st == task::Done)
+		{
+			if (now > tasks.front().deadline)
+				++missedCount;
+			++completedCount;
+			tasks.erase(tasks.begin());
+		}
+		if (now >= end)
+			break;
+	}
+	return steps;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * \brief Resumable unit of background work.
+ *
+ * A task keeps its own progress between calls to step(), and each step should
+ * only do a small amount of work (well below a millisecond), so the scheduler
+ * can stop at any step boundary once its time slice is used up.
+ */
+class task
+{
+public:
+	enum status
+	{
+		Pending,	// more steps are needed
+		Done		// the task is finished and is removed
+	};
+
+	virtual ~task() = default;
+
+	/**
+	 * \brief Advance the task by one small increment of work
+	 * \return Whether the task is finished
+	 */
+	virtual status step() = 0;
+};
+
+/**
+ * \brief Task whose steps are calls to a function, which returns true when done
+ */
+class function_task : public task
+{
+	std::function<bool()> fn;
+public:
+	explicit function_task(std::function<bool()> fn) : fn(std::move(fn)) {}
+
+	status step() override { return fn() ? Done : Pending; }
+};
+
+/**
+ * \brief Cooperative scheduler running tasks in time slices between frames.
+ *
+ * The hook gives the scheduler whatever is left of the frame budget after the
+ * bot's synchronous work, and the scheduler steps tasks until that slice is
+ * used up. Tasks with a higher priority run first, and among equal priorities
+ * the earliest deadline runs first. A deadline is only a hint for ordering;
+ * tasks which finish late are counted, but never preempt the frame.
+ *
+ * The scheduler does not depend on the game or on Windows, and reads the time
+ * from a clock function, so it can be driven by a mock clock.
+ */
+class task_scheduler
+{
+public:
+	typedef std::chrono::nanoseconds duration;
+	typedef std::function<duration()> clock_fn;
+	typedef unsigned int task_id;
+
+	static const task_id INVALID_TASK = 0;
+
+	/**
+	 * \brief Create a scheduler
+	 * \param clock Monotonic clock, defaults to std::chrono::steady_clock
+	 */
+	explicit task_scheduler(clock_fn clock = steadyClock);
+
+	task_scheduler(const task_scheduler& other) = delete;
+	task_scheduler& operator=(const task_scheduler& other) = delete;
+
+	/**
+	 * \brief Add a task
+	 * \param t The task
+	 * \param priority Tasks with higher priorities run first
+	 * \param deadline Time from now by which the task should be done
+	 * \return Identifier of the task, for cancel()
+	 */
+	task_id add(std::unique_ptr<task> t, int priority = 0, duration deadline = duration::max());
+
+	/**
+	 * \brief Remove a task before it is done
+	 * \param id Identifier returned by add()
+	 * \return Whether the task was still scheduled
+	 */
+	bool cancel(task_id id);
+
+	/**
+	 * \brief Step tasks until the slice is used up or no tasks are left. The step
+	 * in progress when the slice ends always completes.
+	 * \param slice Time available to the tasks
+	 * \return Number of steps taken
+	 */
+	int run(duration slice);
+
+	size_t size() const { return tasks.size(); }
+	size_t completed() const { return completedCount; }
+	size_t missedDeadlines() const { return missedCount; }
+
+	static duration steadyClock();
+
+private:
+	struct entry
+	{
+		std::unique_ptr<task> t;
+		task_id id;
+		int priority;
+		duration deadline;
+	};
+
+	clock_fn clock;
+	std::vector<entry> tasks;
+	task_id nextId = 1;
+	size_t completedCount = 0;
+	size_t missedCount = 0;
+
+	// Whether a should run before b
+	static bool before(const entry& a, const entry& b);
+};
@@ -1,8 +1,12 @@
-#include "stdafx.h"
 #include "vec2.h"
 
+#include <cfloat>
+#include <cmath>
+#include <ostream>
 #include <set>
 
+#include "counters.h"
+
 bool vec2::operator==(const vec2& o) const
 {
 	return x == o.x && y == o.y;
@@ -115,7 +119,7 @@ bool vec2::zero() const
 
 bool vec2::nan() const
 {
-	return isnan(x) || isnan(y);
+	return std::isnan(x) || std::isnan(y);
 }
 
 vec2 vec2::rotate(float rad) const
@@ -209,10 +213,14 @@ float vec2::willCollideAABB(const vec2& p1, const vec2& p2, const vec2& s1, cons
 	const vec2& v1, const vec2& v2)
 {
 	// TODO this implementation is way too inefficient
+	TH_COUNT(PredictAabb);
 
 	// check if they're already colliding
 	if (isCollideAABB(p1, p2, s1, s2))
+	{
+		TH_COUNT(AlreadyColliding);
 		return 0;
+	}
 
 	// check time required until collision for each side
 	float t = (p1.x - p2.x - s2.x) / (v2.x - v1.x);
@@ -235,6 +243,29 @@ float vec2::willCollideAABB(const vec2& p1, const vec2& p2, const vec2& s1, cons
 	return -1;
 }
 
+float vec2::willCollideAABBDiscrete(const vec2& p1, const vec2& p2, const vec2& s1, const vec2& s2,
+	const vec2& v1, const vec2& v2, int horizon)
+{
+	TH_COUNT(PredictAabb);
+
+	// position of AABB 1 relative to AABB 2, advanced one frame at a time as
+	// the games advance their objects
+	vec2 d = p1 - p2;
+	const vec2 dv = v1 - v2;
+	for (int t = 0; t <= horizon; ++t)
+	{
+		if (d.x <= s2.x && d.x + s1.x >= 0 && d.y <= s2.y && d.y + s1.y >= 0)
+			return (float)t;
+		// apart on an axis and not approaching on it: rounded sums never turn
+		// back, so the boxes stay apart
+		if ((d.x > s2.x && dv.x >= 0) || (d.x + s1.x < 0 && dv.x <= 0)
+			|| (d.y > s2.y && dv.y >= 0) || (d.y + s1.y < 0 && dv.y <= 0))
+			return -1;
+		d += dv;
+	}
+	return -1;
+}
+
 float vec2::willExitAABB(const vec2& p1, const vec2& p2, const vec2& s1, const vec2& s2, const vec2& v1, const vec2& v2)
 {
 	// check if they're already exited
@@ -270,8 +301,12 @@ bool vec2::isCollideCircle(const vec2& p1, const vec2& p2, float r1, float r2)
 float vec2::willCollideCircle(const vec2& p1, const vec2& p2, float r1, float r2,
 	const vec2& v1, const vec2& v2)
 {
+	TH_COUNT(PredictCircle);
 	if (isCollideCircle(p1, p2, r1, r2))
+	{
+		TH_COUNT(AlreadyColliding);
 		return 0;
+	}
 
 	float a = (v2 - v1).lensq();
 	float b = 2 * dot(p2 - p1, v2 - v1);
@@ -287,6 +322,27 @@ float vec2::willCollideCircle(const vec2& p1, const vec2& p2, float r1, float r2
 	return std::min(x1, x2);
 }
 
+float vec2::willCollideCircleDiscrete(const vec2& p1, const vec2& p2, float r1, float r2,
+	const vec2& v1, const vec2& v2, int horizon)
+{
+	TH_COUNT(PredictCircle);
+
+	vec2 d = p2 - p1;
+	const vec2 dv = v2 - v1;
+	const float rr = (r1 + r2) * (r1 + r2);
+	for (int t = 0; t <= horizon; ++t)
+	{
+		if (d.lensq() <= rr)
+			return (float)t;
+		// too far apart on an axis and not approaching on it
+		if ((d.x * d.x > rr && ((d.x > 0 && dv.x >= 0) || (d.x < 0 && dv.x <= 0)))
+			|| (d.y * d.y > rr && ((d.y > 0 && dv.y >= 0) || (d.y < 0 && dv.y <= 0))))
+			return -1;
+		d += dv;
+	}
+	return -1;
+}
+
 vec2 vec2::closestPointOnCircle(const vec2& ct, float r, const vec2& o)
 {
 	return ct + r * (o - ct).unit();
@@ -361,6 +417,7 @@ bool vec2::isCollideSAT(const std::vector<vec2>& a, const std::vector<vec2>& b)
 float vec2::willCollideSAT(const std::vector<vec2>& a, const vec2& va,
 	const std::vector<vec2>& b, const vec2& vb)
 {
+	TH_COUNT(PredictSat);
 	const int sizeA = a.size();
 	const int sizeB = b.size();
 	std::vector<vec2> normals(sizeA + sizeB);
@@ -403,7 +460,11 @@ float vec2::willCollideSAT(const std::vector<vec2>& a, const vec2& va,
 	}
 
 	if (currentInterval.first < 6000)
+	{
+		if (currentInterval.first == 0)
+			TH_COUNT(AlreadyColliding);
 		return currentInterval.first;
+	}
 
 	return -1;
 }
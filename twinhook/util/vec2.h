@@ -109,6 +109,22 @@ public:
 	static float willCollideAABB(const vec2& p1, const vec2& p2, const vec2& s1, const vec2& s2,
 		const vec2& v1, const vec2& v2);
 
+	/**
+	 * \brief Determine the first frame at which AABB 1 overlaps AABB 2, testing
+	 * whole frames only like the games do. The boxes move by their velocity per
+	 * frame, so a graze between two frames is not a collision.
+	 * \param p1 Position of AABB 1 (top-left corner)
+	 * \param p2 Position of AABB 2 (top-left corner)
+	 * \param s1 Size (x=width, y=height) of AABB 1
+	 * \param s2 Size (x=width, y=height) of AABB 2
+	 * \param v1 Velocity of AABB 1 (pixels/frame)
+	 * \param v2 Velocity of AABB 2 (pixels/frame)
+	 * \param horizon Last frame to test
+	 * \return 0 if already collided, -1 if no collision until horizon, otherwise the frame of collision
+	 */
+	static float willCollideAABBDiscrete(const vec2& p1, const vec2& p2, const vec2& s1, const vec2& s2,
+		const vec2& v1, const vec2& v2, int horizon);
+
 
 	/**
 	 * \brief Determine if AABB 2 will exit AABB 1 in the future
@@ -145,6 +161,21 @@ public:
 	static float willCollideCircle(const vec2& p1, const vec2& p2, float r1, float r2,
 		const vec2& v1, const vec2& v2);
 
+	/**
+	 * \brief Determine the first frame at which circle 1 overlaps circle 2,
+	 * testing whole frames only like the games do
+	 * \param p1 Position of circle 1 center
+	 * \param p2 Position of circle 2 center
+	 * \param r1 Radius of circle 1
+	 * \param r2 Radius of circle 2
+	 * \param v1 Velocity of circle 1 (pixels/frame)
+	 * \param v2 Velocity of circle 2 (pixels/frame)
+	 * \param horizon Last frame to test
+	 * \return 0 if already collided, -1 if no collision until horizon, otherwise the frame of collision
+	 */
+	static float willCollideCircleDiscrete(const vec2& p1, const vec2& p2, float r1, float r2,
+		const vec2& v1, const vec2& v2, int horizon);
+
 	/**
 	 * \brief Find the point on a circle that is the closest to some point
 	 * \param ct The center of the circle
@@ -0,0 +1,112 @@
+#include "channel.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Frames between summaries of the frame statistics
+static const unsigned int SUMMARY_INTERVAL = 600;
+// Time to sleep when all rings are empty
+static const DWORD POLL_INTERVAL_MS = 5;
+
+bool SendChannelConfig(shm_channel& channel, const char* key, const std::string& value)
+{
+	shm_msg::config_msg msg = {};
+	if (strlen(key) >= sizeof(msg.key) || value.size() >= sizeof(msg.value))
+		return false;
+	strcpy_s(msg.key, key);
+	strcpy_s(msg.value, value.c_str());
+	return channel.ring(shm_channel::ConfigRing).write(shm_msg::Config, &msg, sizeof(msg));
+}
+
+namespace
+{
+	struct frame_summary
+	{
+		unsigned int frames = 0;
+		unsigned int decisions = 0;
+		float frameMs = 0;
+		float workMs = 0;
+		float maxWorkMs = 0;
+		shm_msg::frame_stats_msg last = {};
+
+		void add(const shm_msg::frame_stats_msg& msg)
+		{
+			++frames;
+			frameMs += msg.frameMs;
+			workMs += msg.workMs;
+			if (msg.workMs > maxWorkMs)
+				maxWorkMs = msg.workMs;
+			last = msg;
+		}
+
+		void print() const
+		{
+			printf("[twinject] tick %u: %u frames, %u decisions, frame %.2f ms, work %.2f ms "
+				"(max %.2f), quality %.2f, %u bullets, %u enemies, %u powerups, %u lasers\n",
+				last.gameTick, frames, decisions, frameMs / frames, workMs / frames, maxWorkMs,
+				last.quality, last.bullets, last.enemies, last.powerups, last.lasers);
+		}
+	};
+
+	// Drain a ring, returning the number of messages read
+	int Drain(shm_ring& ring, frame_summary& summary)
+	{
+		uint16_t type;
+		std::vector<uint8_t> payload;
+		int count = 0;
+		while (ring.read(type, payload))
+		{
+			++count;
+			switch (type)
+			{
+			case shm_msg::Log:
+				if (payload.size() >= sizeof(shm_msg::log_msg))
+				{
+					const char* text = (const char*)payload.data() + sizeof(shm_msg::log_msg);
+					printf("%.*s\n", (int)(payload.size() - sizeof(shm_msg::log_msg)), text);
+				}
+				break;
+			case shm_msg::FrameStats:
+				if (payload.size() == sizeof(shm_msg::frame_stats_msg))
+				{
+					shm_msg::frame_stats_msg msg;
+					memcpy(&msg, payload.data(), sizeof(msg));
+					summary.add(msg);
+					if (summary.frames >= SUMMARY_INTERVAL)
+					{
+						summary.print();
+						summary = frame_summary();
+					}
+				}
+				break;
+			case shm_msg::Decision:
+				++summary.decisions;
+				break;
+			default:
+				break;
+			}
+		}
+		return count;
+	}
+}
+
+void EnterChannelLoop(shm_channel& channel, HANDLE process)
+{
+	frame_summary summary;
+	bool running = true;
+	while (running)
+	{
+		// drain once more after the exit, for the last lines
+		running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+		int count = Drain(channel.ring(shm_channel::LogRing), summary);
+		count += Drain(channel.ring(shm_channel::TelemetryRing), summary);
+		if (count == 0 && running)
+			Sleep(POLL_INTERVAL_MS);
+	}
+
+	const uint32_t dropped = channel.ring(shm_channel::LogRing).dropped()
+		+ channel.ring(shm_channel::TelemetryRing).dropped();
+	if (dropped > 0)
+		printf("[twinject] %u messages were dropped by twinhook\n", dropped);
+}
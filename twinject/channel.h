@@ -0,0 +1,17 @@
+#pragma once
+
+#include <windows.h>
+
+#include "../twinhook/ipc/shm_channel.h"
+
+/**
+ * \brief Queue a configuration value for twinhook, which copies it into its environment
+ * \return Whether the value fit into the channel
+ */
+bool SendChannelConfig(shm_channel& channel, const char* key, const std::string& value);
+
+/**
+ * \brief Print the log lines and a periodic summary of the frame statistics and
+ * decisions sent by twinhook, until the process exits
+ */
+void EnterChannelLoop(shm_channel& channel, HANDLE process);
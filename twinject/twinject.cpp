@@ -1,11 +1,15 @@
 #include <iostream>
 #include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <windows.h>
 #include <detours.h>
 
 #include <cpptoml.h>
 
+#include "channel.h"
 #include "debugger.h"
 
 STARTUPINFOA si;
@@ -65,10 +69,71 @@ int main(const int argc, const char* argv[])
 	std::cout << "WARNING: Injector was compiled in debug mode!" << std::endl;
 #endif
 
-	SetEnvironmentVariable("th", env.c_str());
+	// configuration for twinhook, sent through the channel if it can be created
+	// and through environment variables otherwise
+	std::vector<std::pair<const char*, std::string>> hook_config;
+	hook_config.emplace_back("th", env);
+	// optional, the algorithm twinhook should bind to the player
+	if (auto algo = config->get_as<std::string>("algo"))
+		hook_config.emplace_back("algo", *algo);
+	// optional, an algorithm evaluated alongside without controlling the player
+	if (auto shadow = config->get_as<std::string>("shadow"))
+		hook_config.emplace_back("shadow", *shadow);
+	// optional, "binary" to log to a file instead of the channel or debugger
+	if (auto log = config->get_as<std::string>("log"))
+		hook_config.emplace_back("log", *log);
+	// optional, the share of each frame twinhook may use, in percent
+	if (auto budget = config->get_as<int64_t>("budget"))
+		hook_config.emplace_back("budget", std::to_string(*budget));
+	// optional, file to record every game tick to, see thanalytics
+	if (auto record = config->get_as<std::string>("record"))
+		hook_config.emplace_back("record", *record);
+	// optional, route book to follow and extend, see thanalytics -r
+	if (auto routes = config->get_as<std::string>("routes"))
+		hook_config.emplace_back("routes", *routes);
+	// optional, "csv" or "binary" to export per-frame algorithm counters
+	if (auto counters = config->get_as<std::string>("counters"))
+		hook_config.emplace_back("counters", *counters);
+	// optional, instruction set of the collision kernels, e.g. "scalar" or "avx2"
+	if (auto simd = config->get_as<std::string>("simd"))
+		hook_config.emplace_back("simd", *simd);
+	// optional, "discrete" to predict collisions at whole frames like the games,
+	// taken from the game's table first so that each game can choose its own
+	auto predictor = config->get_qualified_as<std::string>(env + ".predictor");
+	if (!predictor)
+		predictor = config->get_as<std::string>("predictor");
+	if (predictor)
+		hook_config.emplace_back("predictor", *predictor);
+	// optional, frames a new bullet may go unseen by games polling object pools
+	if (auto latency = config->get_as<int64_t>("poll_latency"))
+		hook_config.emplace_back("poll_latency", std::to_string(*latency));
+	// optional, pipe or socket name of a telemetry collector, see thtelemetry
+	if (auto telemetry = config->get_as<std::string>("telemetry"))
+		hook_config.emplace_back("telemetry", *telemetry);
+	// optional, block name of the planner service the "planner" algorithm uses, see thplanner
+	if (auto planner = config->get_as<std::string>("planner"))
+		hook_config.emplace_back("planner", *planner);
+
+	// each launch has its own channel, which the game inherits the name of
+	shm_channel channel;
+	const std::string channel_name = shm_channel::launchName(GetCurrentProcessId());
+	bool use_channel = channel.create(channel_name);
+	for (const auto& kv : hook_config)
+	{
+		if (!use_channel || !SendChannelConfig(channel, kv.first, kv.second))
+			SetEnvironmentVariable(kv.first, kv.second.c_str());
+	}
+	if (use_channel)
+	{
+		SetEnvironmentVariable(shm_channel::NAME_VARIABLE, channel_name.c_str());
+		std::cout << "twinject: Created channel '" << channel_name << "'" << std::endl;
+	}
+	else
+		std::cout << "twinject: Could not create channel, falling back to the debugger" << std::endl;
 
 #ifndef DEBUGGER
-	std::cout << "WARNING: Debugger disabled upon compile-time! No debug messages will appear!" << std::endl;
+	if (!use_channel)
+		std::cout << "WARNING: Debugger disabled upon compile-time! No debug messages will appear!" << std::endl;
 #endif
 	std::cout << "twinject: Adding path to DLL search path: " << twinhook_dll_path << std::endl;
 	SetDllDirectory(twinhook_dll_path.string().c_str());
@@ -80,7 +145,8 @@ int main(const int argc, const char* argv[])
 		NULL, NULL, NULL, TRUE,
 		CREATE_DEFAULT_ERROR_MODE | CREATE_NEW_CONSOLE
 #ifdef DEBUGGER
-		| DEBUG_PROCESS
+		// messages arrive through the channel if there is one
+		| (use_channel ? 0 : DEBUG_PROCESS)
 #endif
 		, NULL,
 		cur_path.string().c_str(),
@@ -94,8 +160,15 @@ int main(const int argc, const char* argv[])
 		return 1;
 	}
 
-	DEBUG_EVENT debugEv;
-	EnterDebugLoop(&debugEv);
+	if (use_channel)
+	{
+		EnterChannelLoop(channel, pi.hProcess);
+	}
+	else
+	{
+		DEBUG_EVENT debugEv;
+		EnterDebugLoop(&debugEv);
+	}
 
 	return 0;
 }